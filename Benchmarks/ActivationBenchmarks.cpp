@@ -0,0 +1,75 @@
+#include <Benchmarks/BenchmarkUtilities.h>
+#include <NeuralNetworks/Activations/ActivationFunctionFactory.h>
+
+#include <algorithm>
+
+namespace nnb
+{
+	static std::vector<int64_t> GetActivationTypes()
+	{
+		std::vector<int64_t> ret;
+		for (size_t type = static_cast<size_t>(nn::ActivationFunctionType::Null) + 1; type < static_cast<size_t>(nn::ActivationFunctionType::__END__); ++type)
+			ret.push_back(static_cast<int64_t>(type));
+		return ret;
+	}
+	
+	// NB: GFLOP/s counts a single operation per element, so that it's comparable across activations: these kernels are
+	// memory bound anyway, and GB/s is the figure to look at
+	template<MathDomain mathDomain>
+	static void ActivationEvaluate(benchmark::State& state)
+	{
+		const auto type = static_cast<nn::ActivationFunctionType>(state.range(0));
+		const auto activationFunction = nn::ActivationFunctionFactory<mathDomain>::Create(type);
+		state.SetLabel(nn::ToString(type));
+		
+		nn::Matrix<mathDomain> input(static_cast<unsigned>(state.range(1)), static_cast<unsigned>(state.range(2)));
+		input.RandomGaussian();
+		nn::Matrix<mathDomain> output(static_cast<unsigned>(state.range(1)), static_cast<unsigned>(state.range(2)));
+		
+		for (auto _: state)
+		{
+			activationFunction->Evaluate(output, input);
+			Synchronise<mathDomain>();
+		}
+		
+		const double n = static_cast<double>(input.size());
+		SetThroughput(state, n, 2.0 * n * ElementarySize<mathDomain>());
+	}
+	
+	template<MathDomain mathDomain>
+	static void ActivationEvaluateGradient(benchmark::State& state)
+	{
+		const auto type = static_cast<nn::ActivationFunctionType>(state.range(0));
+		const auto activationFunction = nn::ActivationFunctionFactory<mathDomain>::Create(type);
+		state.SetLabel(nn::ToString(type));
+		
+		nn::Matrix<mathDomain> input(static_cast<unsigned>(state.range(1)), static_cast<unsigned>(state.range(2)));
+		input.RandomGaussian();
+		nn::Matrix<mathDomain> activation(static_cast<unsigned>(state.range(1)), static_cast<unsigned>(state.range(2)));
+		activationFunction->Evaluate(activation, input);
+		nn::Matrix<mathDomain> output(static_cast<unsigned>(state.range(1)), static_cast<unsigned>(state.range(2)));
+		
+		for (auto _: state)
+		{
+			activationFunction->EvaluateGradient(output, input, activation);
+			Synchronise<mathDomain>();
+		}
+		
+		// input and activation are both read, although most derivatives only need one of them
+		const double n = static_cast<double>(input.size());
+		SetThroughput(state, n, 3.0 * n * ElementarySize<mathDomain>());
+	}
+	
+	// softmax's gradient is folded into its cost function, so only the evaluation is measured
+	static std::vector<int64_t> GetDifferentiableActivationTypes()
+	{
+		auto ret = GetActivationTypes();
+		ret.erase(std::remove(ret.begin(), ret.end(), static_cast<int64_t>(nn::ActivationFunctionType::SoftMax)), ret.end());
+		return ret;
+	}
+	
+	BENCHMARK_TEMPLATE(ActivationEvaluate, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b, GetActivationTypes()); });
+	BENCHMARK_TEMPLATE(ActivationEvaluate, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b, GetActivationTypes()); });
+	BENCHMARK_TEMPLATE(ActivationEvaluateGradient, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b, GetDifferentiableActivationTypes()); });
+	BENCHMARK_TEMPLATE(ActivationEvaluateGradient, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b, GetDifferentiableActivationTypes()); });
+}
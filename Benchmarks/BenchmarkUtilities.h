@@ -0,0 +1,70 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <NeuralNetworks/Network.h>
+
+#include <vector>
+
+namespace nnb
+{
+	static const std::vector<int64_t> layerWidths = { 64, 256, 1024 };
+	static const std::vector<int64_t> batchSizes = { 16, 128, 1024 };
+	static const std::vector<int64_t> threadCounts = { 1, 2, 4 };
+	
+	template<MathDomain mathDomain>
+	static constexpr size_t ElementarySize() noexcept
+	{
+		return sizeof(typename Traits<mathDomain>::stdType);
+	}
+	
+	// kernels are launched asynchronously: reading back a single element makes the host wait for all of them
+	template<MathDomain mathDomain>
+	static inline void Synchronise() noexcept
+	{
+		thread_local nn::Vector<mathDomain> cache(1u, 0.0);
+		benchmark::DoNotOptimize(cache.Get());
+	}
+	
+	// flop and byte counts of a single iteration, reported as rates
+	static inline void SetThroughput(benchmark::State& state, const double flops, const double bytes)
+	{
+		state.counters["GFLOP/s"] = benchmark::Counter(flops * 1e-9, benchmark::Counter::kIsIterationInvariantRate);
+		state.counters["GB/s"] = benchmark::Counter(bytes * 1e-9, benchmark::Counter::kIsIterationInvariantRate);
+	}
+	
+	// every combination of the extra arguments with layer width and batch size
+	static inline void ApplySizes(benchmark::internal::Benchmark* benchmark, const std::vector<int64_t>& extraArguments = { -1 })
+	{
+		for (const int64_t extra: extraArguments)
+		{
+			for (const int64_t width: layerWidths)
+			{
+				for (const int64_t batchSize: batchSizes)
+				{
+					if (extra < 0)
+						benchmark->Args({ width, batchSize });
+					else
+						benchmark->Args({ extra, width, batchSize });
+				}
+			}
+		}
+		
+		benchmark->UseRealTime();
+	}
+	
+	// layer width and batch size, with the number of host threads used by the library (e.g. nEvaluationThreads) as
+	// last argument
+	static inline void ApplyThreadCounts(benchmark::internal::Benchmark* benchmark)
+	{
+		for (const int64_t width: layerWidths)
+		{
+			for (const int64_t batchSize: batchSizes)
+			{
+				for (const int64_t nThreads: threadCounts)
+					benchmark->Args({ width, batchSize, nThreads });
+			}
+		}
+		
+		benchmark->UseRealTime();
+	}
+}
@@ -0,0 +1,91 @@
+#include <Benchmarks/BenchmarkUtilities.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+
+namespace nnb
+{
+	template<MathDomain mathDomain>
+	static std::unique_ptr<nn::ICostFunction<mathDomain>> CreateCostFunction(const nn::CostFunctionType type)
+	{
+		switch (type)
+		{
+			case nn::CostFunctionType::Quadratic:
+				return std::make_unique<nn::QuadraticCostFunction<mathDomain>>();
+			case nn::CostFunctionType::CrossEntropy:
+				return std::make_unique<nn::CrossEntropyCostFunction<mathDomain>>();
+			case nn::CostFunctionType::LogLikelihood:
+				return std::make_unique<nn::LogLikelihoodCostFunction<mathDomain>>();
+			default:
+				return nullptr;
+		}
+	}
+	
+	static std::vector<int64_t> GetCostFunctionTypes()
+	{
+		std::vector<int64_t> ret;
+		for (size_t type = static_cast<size_t>(nn::CostFunctionType::Null) + 1; type < static_cast<size_t>(nn::CostFunctionType::__END__); ++type)
+			ret.push_back(static_cast<int64_t>(type));
+		return ret;
+	}
+	
+	// NB: the cost functions overwrite the model output, which is then refilled with valid probabilities at every
+	// iteration, outside of the timed region
+	template<MathDomain mathDomain>
+	static void CostFunctionEvaluateSum(benchmark::State& state)
+	{
+		const auto type = static_cast<nn::CostFunctionType>(state.range(0));
+		const auto costFunction = CreateCostFunction<mathDomain>(type);
+		state.SetLabel(nn::ToString(type));
+		
+		const unsigned nRows = static_cast<unsigned>(state.range(1));
+		const unsigned nCols = static_cast<unsigned>(state.range(2));
+		nn::Matrix<mathDomain> modelOutput(nRows, nCols);
+		const nn::Matrix<mathDomain> expectedOutput(nRows, nCols, 1.0);
+		
+		for (auto _: state)
+		{
+			state.PauseTiming();
+			modelOutput.Set(0.5);
+			Synchronise<mathDomain>();
+			state.ResumeTiming();
+			
+			benchmark::DoNotOptimize(costFunction->EvaluateSum(modelOutput, expectedOutput));
+		}
+		
+		// element-wise cost, plus the reduction
+		const double n = static_cast<double>(modelOutput.size());
+		SetThroughput(state, 3.0 * n, 2.0 * n * ElementarySize<mathDomain>());
+	}
+	
+	template<MathDomain mathDomain>
+	static void CostFunctionEvaluateGradient(benchmark::State& state)
+	{
+		const auto type = static_cast<nn::CostFunctionType>(state.range(0));
+		const auto costFunction = CreateCostFunction<mathDomain>(type);
+		state.SetLabel(nn::ToString(type));
+		
+		const unsigned nRows = static_cast<unsigned>(state.range(1));
+		const unsigned nCols = static_cast<unsigned>(state.range(2));
+		nn::Matrix<mathDomain> gradient(nRows, nCols);
+		const nn::Matrix<mathDomain> expectedOutput(nRows, nCols, 1.0);
+		const nn::Matrix<mathDomain> activationDerivative(nRows, nCols, 0.25);
+		
+		for (auto _: state)
+		{
+			state.PauseTiming();
+			gradient.Set(0.5);
+			Synchronise<mathDomain>();
+			state.ResumeTiming();
+			
+			costFunction->EvaluateGradient(gradient, expectedOutput, activationDerivative);
+			Synchronise<mathDomain>();
+		}
+		
+		const double n = static_cast<double>(gradient.size());
+		SetThroughput(state, 2.0 * n, 4.0 * n * ElementarySize<mathDomain>());
+	}
+	
+	BENCHMARK_TEMPLATE(CostFunctionEvaluateSum, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b, GetCostFunctionTypes()); });
+	BENCHMARK_TEMPLATE(CostFunctionEvaluateSum, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b, GetCostFunctionTypes()); });
+	BENCHMARK_TEMPLATE(CostFunctionEvaluateGradient, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b, GetCostFunctionTypes()); });
+	BENCHMARK_TEMPLATE(CostFunctionEvaluateGradient, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b, GetCostFunctionTypes()); });
+}
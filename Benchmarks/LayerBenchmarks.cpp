@@ -0,0 +1,141 @@
+#include <Benchmarks/BenchmarkUtilities.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+
+namespace nnb
+{
+	static constexpr unsigned nOutputs = { 10 };
+	
+	// gives access to a single backward pass, without shuffling and without updating the layers
+	template<MathDomain mathDomain>
+	class AdjointDifferentiationBenchmark final: public nn::BatchedSgd<mathDomain>
+	{
+	public:
+		using nn::BatchedSgd<mathDomain>::BatchedSgd;
+		using nn::BatchedSgd<mathDomain>::TrainMiniBatch;
+		
+		// gradients are accumulated by TrainMiniBatch: training resets them once per mini-batch
+		void ResetGradients() noexcept { this->_gradients.Zero(); }
+	};
+	
+	// square dense layer: z = W * x + b, a = sigmoid(z), with its derivative
+	template<MathDomain mathDomain>
+	static void DenseLayerEvaluate(benchmark::State& state)
+	{
+		const unsigned width = static_cast<unsigned>(state.range(0));
+		const unsigned batchSize = static_cast<unsigned>(state.range(1));
+		nn::DenseLayer<mathDomain> layer(width, width, std::make_unique<nn::SigmoidActivationFunction<mathDomain>>(), nn::SmallVarianceRandomBiasWeightInitializer<mathDomain>());
+		layer.Reserve(batchSize);
+		
+		nn::Matrix<mathDomain> input(width, batchSize);
+		input.RandomGaussian();
+		
+		for (auto _: state)
+		{
+			layer.Evaluate(input, true, nullptr);
+			Synchronise<mathDomain>();
+		}
+		
+		const double n = static_cast<double>(width);
+		const double b = static_cast<double>(batchSize);
+		SetThroughput(state, 2.0 * n * n * b + 3.0 * n * b, (n * n + n + n * b + 4.0 * n * b) * ElementarySize<mathDomain>());
+	}
+	
+	// forward and backward pass through a hidden sigmoid layer and a softmax output layer
+	template<MathDomain mathDomain>
+	static void AdjointDifferentiation(benchmark::State& state)
+	{
+		const unsigned width = static_cast<unsigned>(state.range(0));
+		const unsigned batchSize = static_cast<unsigned>(state.range(1));
+		
+		nn::TrainingData<mathDomain> trainingData(nn::Matrix<mathDomain>(width, batchSize), nn::Matrix<mathDomain>(nOutputs, batchSize, 0.0));
+		trainingData.input.RandomGaussian();
+		const std::function<double(nn::Matrix<mathDomain>&, const nn::Matrix<mathDomain>&)> evaluator = [](nn::Matrix<mathDomain>&, const nn::Matrix<mathDomain>&) { return 0.0; };
+		nn::NetworkTrainingData<mathDomain> networkTrainingData(trainingData, trainingData, trainingData, evaluator);
+		networkTrainingData.hyperParameters.miniBatchSize = batchSize;
+		
+		std::vector<std::unique_ptr<nn::ILayer<mathDomain>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<mathDomain>>(width, width, std::make_unique<nn::SigmoidActivationFunction<mathDomain>>(), nn::SmallVarianceRandomBiasWeightInitializer<mathDomain>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<mathDomain>>(width, nOutputs, std::make_unique<nn::SoftMaxActivationFunction<mathDomain>>(), nn::ZeroBiasWeightInitializer<mathDomain>()));
+		nn::NetworkTopology<mathDomain> topology(std::move(layers));
+		
+		AdjointDifferentiationBenchmark<mathDomain> optimizer(topology, batchSize, std::make_unique<nn::LogLikelihoodCostFunction<mathDomain>>(), std::make_unique<nn::IdentityShuffler<mathDomain>>());
+		nn::MiniBatchData<mathDomain> batchData(networkTrainingData);
+		batchData.endIndex = batchSize;
+		
+		for (auto _: state)
+		{
+			optimizer.ResetGradients();
+			optimizer.TrainMiniBatch(batchData);
+			Synchronise<mathDomain>();
+		}
+		
+		// a GEMM forward, and two backward (bias and weight gradients) per layer
+		const double n = static_cast<double>(width);
+		const double b = static_cast<double>(batchSize);
+		const double nParameters = n * n + n * nOutputs;
+		SetThroughput(state, 6.0 * nParameters * b, (3.0 * nParameters + 6.0 * (n + nOutputs) * b) * ElementarySize<mathDomain>());
+	}
+	
+	// plain gradient descent step with L2 regularisation, the batch size is irrelevant here
+	template<MathDomain mathDomain>
+	static void LayerUpdate(benchmark::State& state)
+	{
+		const unsigned width = static_cast<unsigned>(state.range(0));
+		nn::DenseLayer<mathDomain> layer(width, width, std::make_unique<nn::SigmoidActivationFunction<mathDomain>>(), nn::SmallVarianceRandomBiasWeightInitializer<mathDomain>());
+		const nn::Vector<mathDomain> biasGradient(width, 1e-6);
+		const nn::Matrix<mathDomain> weightGradient(width, width, 1e-6);
+		
+		for (auto _: state)
+		{
+			layer.Update(biasGradient, weightGradient, 0.1, 1.0 - 1e-6);
+			Synchronise<mathDomain>();
+		}
+		
+		const double nParameters = static_cast<double>(width) * (width + 1);
+		SetThroughput(state, 3.0 * nParameters, 3.0 * nParameters * ElementarySize<mathDomain>());
+	}
+	
+	// chunked inference of the hidden plus softmax topology, from nEvaluationThreads host threads
+	template<MathDomain mathDomain>
+	static void NetworkEvaluate(benchmark::State& state)
+	{
+		const unsigned width = static_cast<unsigned>(state.range(0));
+		const unsigned batchSize = static_cast<unsigned>(state.range(1));
+		const size_t nEvaluationThreads = static_cast<size_t>(state.range(2));
+		
+		nn::TrainingData<mathDomain> data(nn::Matrix<mathDomain>(width, batchSize), nn::Matrix<mathDomain>(nOutputs, batchSize, 0.0));
+		data.input.RandomGaussian();
+		const std::function<double(nn::Matrix<mathDomain>&, const nn::Matrix<mathDomain>&)> evaluator = [](nn::Matrix<mathDomain>&, const nn::Matrix<mathDomain>&) { return 0.0; };
+		
+		std::vector<std::unique_ptr<nn::ILayer<mathDomain>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<mathDomain>>(width, width, std::make_unique<nn::SigmoidActivationFunction<mathDomain>>(), nn::SmallVarianceRandomBiasWeightInitializer<mathDomain>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<mathDomain>>(width, nOutputs, std::make_unique<nn::SoftMaxActivationFunction<mathDomain>>(), nn::ZeroBiasWeightInitializer<mathDomain>()));
+		nn::Network<mathDomain> network((nn::NetworkTopology<mathDomain>(std::move(layers))));
+		
+		// one chunk per thread
+		const size_t chunkSize = (batchSize + nEvaluationThreads - 1) / nEvaluationThreads;
+		for (auto _: state)
+		{
+			benchmark::DoNotOptimize(network.Evaluate(data, evaluator, chunkSize, nEvaluationThreads));
+			Synchronise<mathDomain>();
+		}
+		
+		const double n = static_cast<double>(width);
+		const double b = static_cast<double>(batchSize);
+		const double nParameters = n * n + n * nOutputs;
+		SetThroughput(state, 2.0 * nParameters * b, (nParameters + 2.0 * (n + nOutputs) * b) * ElementarySize<mathDomain>());
+	}
+	
+	BENCHMARK_TEMPLATE(DenseLayerEvaluate, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(DenseLayerEvaluate, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(AdjointDifferentiation, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(AdjointDifferentiation, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(LayerUpdate, MathDomain::Float)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(LayerUpdate, MathDomain::Double)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(NetworkEvaluate, MathDomain::Float)->Apply(ApplyThreadCounts);
+	BENCHMARK_TEMPLATE(NetworkEvaluate, MathDomain::Double)->Apply(ApplyThreadCounts);
+}
@@ -0,0 +1,31 @@
+#include <Benchmarks/BenchmarkUtilities.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+namespace nnb
+{
+	// input (width x nSamples) and expected output (10 x nSamples) are permuted together
+	template<MathDomain mathDomain, typename Shuffler>
+	static void Shuffle(benchmark::State& state)
+	{
+		const unsigned width = static_cast<unsigned>(state.range(0));
+		const unsigned nSamples = static_cast<unsigned>(state.range(1));
+		nn::Matrix<mathDomain> input(width, nSamples);
+		input.RandomGaussian();
+		nn::Matrix<mathDomain> expectedOutput(10, nSamples, 0.0);
+		
+		const Shuffler shuffler {};
+		for (auto _: state)
+		{
+			shuffler.Shuffle(input, expectedOutput);
+			Synchronise<mathDomain>();
+		}
+		
+		// every column is read and written once
+		const double n = static_cast<double>(width + 10) * nSamples;
+		SetThroughput(state, 0.0, 2.0 * n * ElementarySize<mathDomain>());
+	}
+	
+	BENCHMARK_TEMPLATE(Shuffle, MathDomain::Float, nn::RandomShuffler<MathDomain::Float>)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(Shuffle, MathDomain::Double, nn::RandomShuffler<MathDomain::Double>)->Apply([](auto* b) { ApplySizes(b); });
+	BENCHMARK_TEMPLATE(Shuffle, MathDomain::Float, nn::IdentityShuffler<MathDomain::Float>)->Apply([](auto* b) { ApplySizes(b); });
+}
@@ -0,0 +1,43 @@
+#include <Benchmarks/BenchmarkUtilities.h>
+#include <NeuralNetworks/StaticNetwork.h>
+
+#include <memory>
+#include <random>
+
+namespace nnb
+{
+	// single-sample host inference of the 784-100-10 sigmoid/softmax model: the time per iteration is the latency
+	template<MathDomain mathDomain>
+	static void StaticNetworkEvaluate(benchmark::State& state)
+	{
+		using Mnist = nn::StaticNetwork<mathDomain, nn::StaticDense<784, 100, nn::ActivationFunctionType::Sigmoid>, nn::StaticSoftMax<100, 10>>;
+		using Real = typename Mnist::Real;
+		
+		// NB: the parameters are stored inline
+		const auto network = std::make_unique<Mnist>();
+		std::mt19937 generator(1234);
+		std::normal_distribution<Real> distribution(static_cast<Real>(0.0), static_cast<Real>(0.1));
+		for (auto& w: network->template GetParameters<0>().weight)
+			w = distribution(generator);
+		for (auto& w: network->template GetParameters<1>().weight)
+			w = distribution(generator);
+		
+		std::array<Real, Mnist::nInput> input;
+		for (auto& x: input)
+			x = distribution(generator);
+		
+		std::array<Real, Mnist::nOutput> output;
+		for (auto _: state)
+		{
+			network->Evaluate(output.data(), input.data());
+			benchmark::DoNotOptimize(output.data());
+			benchmark::ClobberMemory();
+		}
+		
+		const double nParameters = 784.0 * 100.0 + 100.0 * 10.0;
+		SetThroughput(state, 2.0 * nParameters, (nParameters + 784.0 + 10.0) * ElementarySize<mathDomain>());
+	}
+	
+	BENCHMARK_TEMPLATE(StaticNetworkEvaluate, MathDomain::Float)->Unit(benchmark::kMicrosecond);
+	BENCHMARK_TEMPLATE(StaticNetworkEvaluate, MathDomain::Double)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,242 @@
+// the training phases are timed by the profiler spans, which are then always enabled for this executable
+// NB: USE_PROFILER may already come from the command line (the CMake option)
+#ifndef USE_PROFILER
+	#define USE_PROFILER
+#endif
+
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/Stopwatch.h>
+#include <NeuralNetworks/Profiler.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+/**
+* End-to-end training throughput on synthetic, MNIST-shaped by default, data: no DATA_PATH needed.
+* Usage: NnTrainingBenchmark [--samples=50000] [--inputs=784] [--hidden=100[,100...]] [--outputs=10] [--miniBatchSize=10]
+*                            [--epochs=3] [--double] [--seed=1234] [--output=file.json]
+* The results are written as JSON (to stdout if no output file is given).
+*/
+namespace nnb
+{
+	struct TrainingBenchmarkSettings
+	{
+		size_t nSamples = 50000;
+		size_t nInputs = 784;
+		std::vector<size_t> hiddenLayers = { 100 };
+		size_t nOutputs = 10;
+		size_t miniBatchSize = 10;
+		size_t nEpochs = 3;
+		bool useDouble = false;
+		unsigned seed = 1234;
+		std::string outputFile {};
+	};
+	
+	static TrainingBenchmarkSettings ParseSettings(const int argc, char** argv)
+	{
+		TrainingBenchmarkSettings settings;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const size_t separator = argument.find('=');
+			const std::string key = argument.substr(0, separator);
+			const std::string value = separator == std::string::npos ? "" : argument.substr(separator + 1);
+			
+			if (key == "--samples")
+				settings.nSamples = std::stoul(value);
+			else if (key == "--inputs")
+				settings.nInputs = std::stoul(value);
+			else if (key == "--hidden")
+			{
+				settings.hiddenLayers.clear();
+				std::stringstream stream(value);
+				for (std::string width; std::getline(stream, width, ',');)
+					settings.hiddenLayers.push_back(std::stoul(width));
+			}
+			else if (key == "--outputs")
+				settings.nOutputs = std::stoul(value);
+			else if (key == "--miniBatchSize")
+				settings.miniBatchSize = std::stoul(value);
+			else if (key == "--epochs")
+				settings.nEpochs = std::stoul(value);
+			else if (key == "--double")
+				settings.useDouble = true;
+			else if (key == "--seed")
+				settings.seed = static_cast<unsigned>(std::stoul(value));
+			else if (key == "--output")
+				settings.outputFile = value;
+			else
+				std::cerr << "Unknown argument " << argument << std::endl;
+		}
+		
+		return settings;
+	}
+	
+	// gaussian input, and one-hot labels given by a fixed random linear map of the input, so that there's something to learn
+	template<MathDomain mathDomain>
+	static nn::TrainingData<mathDomain> MakeSyntheticData(const TrainingBenchmarkSettings& settings)
+	{
+		using stdType = typename Traits<mathDomain>::stdType;
+		
+		std::mt19937 generator(settings.seed);
+		std::normal_distribution<double> gaussian(0.0, 1.0);
+		
+		std::vector<double> projection(settings.nOutputs * settings.nInputs);
+		for (auto& x: projection)
+			x = gaussian(generator);
+		
+		std::vector<stdType> input(settings.nInputs * settings.nSamples);
+		std::vector<stdType> expectedOutput(settings.nOutputs * settings.nSamples, static_cast<stdType>(0.0));
+		for (size_t j = 0; j < settings.nSamples; ++j)
+		{
+			for (size_t i = 0; i < settings.nInputs; ++i)
+				input[i + j * settings.nInputs] = static_cast<stdType>(gaussian(generator));
+			
+			size_t label = 0;
+			double maxScore = -std::numeric_limits<double>::max();
+			for (size_t k = 0; k < settings.nOutputs; ++k)
+			{
+				double score = 0.0;
+				for (size_t i = 0; i < settings.nInputs; ++i)
+					score += projection[k + i * settings.nOutputs] * input[i + j * settings.nInputs];
+				if (score > maxScore)
+				{
+					maxScore = score;
+					label = k;
+				}
+			}
+			expectedOutput[label + j * settings.nOutputs] = static_cast<stdType>(1.0);
+		}
+		
+		nn::TrainingData<mathDomain> ret(nn::Matrix<mathDomain>(static_cast<unsigned>(settings.nInputs), static_cast<unsigned>(settings.nSamples)),
+		                                 nn::Matrix<mathDomain>(static_cast<unsigned>(settings.nOutputs), static_cast<unsigned>(settings.nSamples)));
+		ret.input.ReadFrom(input);
+		ret.expectedOutput.ReadFrom(expectedOutput);
+		return ret;
+	}
+	
+	static size_t GetPeakResidentSetSize() noexcept
+	{
+		rusage usage {};
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;  // NB: kilobytes on Linux
+	}
+	
+	template<MathDomain mathDomain>
+	static void Run(const TrainingBenchmarkSettings& settings, std::ostream& stream)
+	{
+		auto trainingData = MakeSyntheticData<mathDomain>(settings);
+		const std::function<double(nn::Matrix<mathDomain>&, const nn::Matrix<mathDomain>&)> evaluator = [](nn::Matrix<mathDomain>&, const nn::Matrix<mathDomain>&) { return 0.0; };
+		nn::NetworkTrainingData<mathDomain> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.nEpochs = settings.nEpochs;
+		data.hyperParameters.miniBatchSize = settings.miniBatchSize;
+		
+		std::vector<std::unique_ptr<nn::ILayer<mathDomain>>> layers;
+		size_t nInputs = settings.nInputs;
+		for (const size_t width: settings.hiddenLayers)
+		{
+			layers.emplace_back(std::make_unique<nn::DenseLayer<mathDomain>>(nInputs, width, std::make_unique<nn::SigmoidActivationFunction<mathDomain>>(), nn::SmallVarianceRandomBiasWeightInitializer<mathDomain>()));
+			nInputs = width;
+		}
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<mathDomain>>(nInputs, settings.nOutputs, std::make_unique<nn::SoftMaxActivationFunction<mathDomain>>(), nn::ZeroBiasWeightInitializer<mathDomain>()));
+		nn::NetworkTopology<mathDomain> topology(std::move(layers));
+		nn::BatchedSgd<mathDomain> optimizer(topology, settings.miniBatchSize, std::make_unique<nn::LogLikelihoodCostFunction<mathDomain>>(), std::make_unique<nn::RandomShuffler<mathDomain>>());
+		
+		// the ring buffer is cleared after every epoch, so it only needs to hold one epoch worth of spans
+		auto& profiler = nn::Profiler::Instance();
+		const size_t nMiniBatches = settings.nSamples / settings.miniBatchSize;
+		profiler.SetCapacity(nMiniBatches * (2 * topology.GetSize() + 4) + 16);
+		
+		std::vector<double> epochTimes;
+		std::map<std::string, nn::ProfilerStatistics> phases;
+		nn::Stopwatch sw;
+		for (size_t epoch = 0; epoch < settings.nEpochs; ++epoch)
+		{
+			profiler.Reset();
+			sw.Start();
+			optimizer.Train(data);
+			
+			// a single read back of the parameters waits for the outstanding kernels
+			topology.EvaluateTotalWeightCost();
+			sw.Stop();
+			epochTimes.push_back(sw.GetSeconds());
+			
+			// layer spans are summed up
+			for (const auto& entry: profiler.GetStatistics())
+			{
+				auto& phase = phases[std::get<0>(entry.first)];
+				phase.count += entry.second.count;
+				phase.total += entry.second.total;
+				phase.min = std::min(phase.min, entry.second.min);
+				phase.max = std::max(phase.max, entry.second.max);
+			}
+		}
+		
+		double totalTime = 0.0;
+		for (const double t: epochTimes)
+			totalTime += t;
+		
+		stream << "{\n";
+		stream << "\t\"mathDomain\": \"" << (mathDomain == MathDomain::Double ? "Double" : "Float") << "\",\n";
+		stream << "\t\"samples\": " << settings.nSamples << ",\n";
+		stream << "\t\"topology\": [" << settings.nInputs;
+		for (const size_t width: settings.hiddenLayers)
+			stream << ", " << width;
+		stream << ", " << settings.nOutputs << "],\n";
+		stream << "\t\"miniBatchSize\": " << settings.miniBatchSize << ",\n";
+		stream << "\t\"epochs\": " << settings.nEpochs << ",\n";
+		stream << "\t\"totalSeconds\": " << totalTime << ",\n";
+		stream << "\t\"samplesPerSecond\": " << (totalTime > 0.0 ? static_cast<double>(nMiniBatches * settings.miniBatchSize * settings.nEpochs) / totalTime : 0.0) << ",\n";
+		
+		stream << "\t\"epochSeconds\": [";
+		for (size_t i = 0; i < epochTimes.size(); ++i)
+			stream << (i > 0 ? ", " : "") << epochTimes[i];
+		stream << "],\n";
+		
+		// NB: phases nest (e.g. Forward and Backward are part of AdjointDifferentiation, which is part of MiniBatch)
+		stream << "\t\"phases\": {";
+		bool first = true;
+		for (const auto& phase: phases)
+		{
+			stream << (first ? "\n" : ",\n") << "\t\t\"" << phase.first << "\": { \"count\": " << phase.second.count
+			       << ", \"totalSeconds\": " << static_cast<double>(phase.second.total) * 1e-9
+			       << ", \"meanMicroSeconds\": " << static_cast<double>(phase.second.total) * 1e-3 / static_cast<double>(phase.second.count) << " }";
+			first = false;
+		}
+		stream << "\n\t},\n";
+		
+		stream << "\t\"peakResidentSetSize\": " << GetPeakResidentSetSize() << "\n";
+		stream << "}" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto settings = nnb::ParseSettings(argc, argv);
+	
+	std::ofstream file;
+	if (!settings.outputFile.empty())
+		file.open(settings.outputFile);
+	std::ostream& stream = settings.outputFile.empty() ? std::cout : file;
+	
+	if (settings.useDouble)
+		nnb::Run<MathDomain::Double>(settings, stream);
+	else
+		nnb::Run<MathDomain::Float>(settings, stream);
+	
+	return 0;
+}
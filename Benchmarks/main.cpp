@@ -0,0 +1,8 @@
+#include <benchmark/benchmark.h>
+
+int main(int ac, char* av[])
+{
+	benchmark::Initialize(&ac, av);
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cmath>
+
+/**
+* Element-wise activations as inlineable functors, so that they can be applied inside someone else's loop (e.g. at
+* the end of a matrix product, or when back-propagating) rather than as a separate pass over memory.
+* Every functor provides:
+*     - Value(x) = f(x)
+*     - Derivative(x) = f'(x)
+*     - DerivativeFromOutput(y) = f'(f^-1(y)), so that the backward pass only needs the activation
+* These are the formulas used by the activation kernels in ObjectiveFunctions.cu
+*/
+#ifdef __CUDACC__
+	#define ACTIVATION_FUNCTOR_QUALIFIER __host__ __device__ inline
+#else
+	#define ACTIVATION_FUNCTOR_QUALIFIER inline
+#endif
+
+struct IdentityFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return x;
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T)
+	{
+		return static_cast<T>(1.0);
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T)
+	{
+		return static_cast<T>(1.0);
+	}
+};
+
+/**
+* Sigmoid(x) = 1.0 / (1.0 + e^(-x))
+*/
+struct SigmoidFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return static_cast<T>(1.0) / (static_cast<T>(1.0) + std::exp(-x));
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T x)
+	{
+		return DerivativeFromOutput(Value(x));
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T y)
+	{
+		return y * (static_cast<T>(1.0) - y);
+	}
+};
+
+/**
+* tanh(x) = 2 * sigmoid(2 * x) - 1
+*/
+struct HyperbolicTangentFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return static_cast<T>(2.0) * SigmoidFunctor::Value(static_cast<T>(2.0) * x) - static_cast<T>(1.0);
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T x)
+	{
+		return DerivativeFromOutput(Value(x));
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T y)
+	{
+		return static_cast<T>(1.0) - y * y;
+	}
+};
+
+/**
+* ReLu(x) = \xi(x > 0) * x + \xi(x <= 0) * alpha * x, alpha being given in percent
+* NB: as alpha >= 0, y <= 0 if and only if x <= 0
+*/
+template <int alphaPercent>
+struct GenericRectifiedLinearUnitFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return x <= static_cast<T>(0.0) ? static_cast<T>(alphaPercent * 0.01) * x : x;
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T x)
+	{
+		return x <= static_cast<T>(0.0) ? static_cast<T>(alphaPercent * 0.01) : static_cast<T>(1.0);
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T y)
+	{
+		return Derivative(y);
+	}
+};
+using RectifiedLinearUnitFunctor = GenericRectifiedLinearUnitFunctor<0>;
+using LeakyRectifiedLinearUnitFunctor = GenericRectifiedLinearUnitFunctor<1>;
+
+/**
+* IsrLu(x) = \xi(x > 0) * x + \xi(x <= 0) * x / sqrt(1 + x^2)
+* IsrLu'(x) = \xi(x > 0) + \xi(x <= 0) * (1 / sqrt(1 + x^2))^3, and 1 / (1 + x^2) = 1 - y^2
+* NB: the original kernels used x / (1 + x^2) and (1 / (1 + x^2))^3, which is not the ISRLU of Carlile et al.
+*/
+struct InverseSquareRootLinearUnitFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return x <= static_cast<T>(0.0) ? x / std::sqrt(static_cast<T>(1.0) + x * x) : x;
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T x)
+	{
+		if (x > static_cast<T>(0.0))
+			return static_cast<T>(1.0);
+		
+		const T factor = static_cast<T>(1.0) / std::sqrt(static_cast<T>(1.0) + x * x);
+		return factor * factor * factor;
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T y)
+	{
+		if (y > static_cast<T>(0.0))
+			return static_cast<T>(1.0);
+		
+		const T factor2 = static_cast<T>(1.0) - y * y;
+		return factor2 * std::sqrt(factor2);
+	}
+};
+
+/**
+* ELU(x) = \xi(x > 0) * x + \xi(x <= 0) * (e^x - 1)
+* ELU'(x) = \xi(x > 0) + \xi(x <= 0) * e^x
+* NB: the original exports ran the ISRLU kernels, and the original derivative returned x for x > 0
+*/
+struct ExponentialLinearUnitFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return x <= static_cast<T>(0.0) ? std::exp(x) - static_cast<T>(1.0) : x;
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T x)
+	{
+		return x <= static_cast<T>(0.0) ? std::exp(x) : static_cast<T>(1.0);
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T y)
+	{
+		return y <= static_cast<T>(0.0) ? y + static_cast<T>(1.0) : static_cast<T>(1.0);
+	}
+};
+
+/**
+* BentIdentity(x) = x + 0.5 * (sqrt(x^2 + 1) - 1)
+* NB: it's invertible, with x = (2 * c - sqrt(c^2 + 3)) / 3 and c = 2 * y + 1
+*/
+struct BentIdentityFunctor
+{
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Value(const T x)
+	{
+		return x + static_cast<T>(0.5) * (std::sqrt(x * x + static_cast<T>(1.0)) - static_cast<T>(1.0));
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T Derivative(const T x)
+	{
+		return static_cast<T>(1.0) + static_cast<T>(0.5) * x / std::sqrt(x * x + static_cast<T>(1.0));
+	}
+	
+	template <typename T>
+	static ACTIVATION_FUNCTOR_QUALIFIER T DerivativeFromOutput(const T y)
+	{
+		const T c = static_cast<T>(2.0) * y + static_cast<T>(1.0);
+		return Derivative((static_cast<T>(2.0) * c - std::sqrt(c * c + static_cast<T>(3.0))) / static_cast<T>(3.0));
+	}
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+* Shape of nBatches independent column-major products, stored one after the other:
+*     C_k = alpha * op(A_k) * op(B_k) + beta * C_k,    A_k = a + k * aStride, B_k = b + k * bStride, C_k = c + k * cStride
+* with C_k (nRows, nCols), op(A_k) (nRows, nInner) and op(B_k) (nInner, nCols). Strides are in elements: a zero
+* stride shares the same matrix across the batch (e.g. the input of a stack of models, or a vector of ones).
+* NB: beta = 0 overwrites C_k without reading it
+*/
+struct BatchedMultiplyGeometry
+{
+	unsigned nBatches = 0;
+	unsigned nRows = 0;
+	unsigned nCols = 0;
+	unsigned nInner = 0;
+
+	bool transposeA = false;
+	bool transposeB = false;
+
+	unsigned aStride = 0;
+	unsigned bStride = 0;
+	unsigned cStride = 0;
+
+	double alpha = 1.0;
+	double beta = 0.0;
+
+	// element (i, p) of op(A_k) and (p, j) of op(B_k)
+	inline unsigned GetIndexA(const unsigned i, const unsigned p) const { return transposeA ? p + i * nInner : i + p * nRows; }
+	inline unsigned GetIndexB(const unsigned p, const unsigned j) const { return transposeB ? j + p * nCols : p + j * nInner; }
+
+	inline unsigned GetOutputSize() const { return nBatches * nRows * nCols; }
+};
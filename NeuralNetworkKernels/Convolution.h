@@ -0,0 +1,52 @@
+#pragma once
+
+#ifdef __CUDACC__
+	#define CONVOLUTION_QUALIFIER __host__ __device__ inline
+#else
+	#define CONVOLUTION_QUALIFIER inline
+#endif
+
+/**
+* Shape of a 2D convolution (or pooling) over a batch of images, stored one per column in channel-major order:
+*     x(c, y, x) = column[c * height * width + y * width + x]
+* with the same layout for the output, whose channels are the filters.
+* NB: "valid" convolution (no padding), so that the output is ((height - kernelSize) / stride + 1) pixels high
+*/
+
+// the convolution kernels work on this many filters at a time, so that every input element they load feeds several outputs
+static constexpr unsigned convolutionFilterBlock = { 4 };
+
+struct ConvolutionGeometry
+{
+	unsigned nChannels = 0;
+	unsigned height = 0;
+	unsigned width = 0;
+	
+	unsigned nFilters = 0;
+	unsigned kernelSize = 0;
+	unsigned stride = 1;
+	
+	CONVOLUTION_QUALIFIER unsigned GetOutputHeight() const { return (height - kernelSize) / stride + 1; }
+	CONVOLUTION_QUALIFIER unsigned GetOutputWidth() const { return (width - kernelSize) / stride + 1; }
+	
+	CONVOLUTION_QUALIFIER unsigned GetNumberOfPixels() const { return GetOutputHeight() * GetOutputWidth(); }
+	
+	CONVOLUTION_QUALIFIER unsigned GetNumberOfInputs() const { return nChannels * height * width; }
+	CONVOLUTION_QUALIFIER unsigned GetNumberOfOutputs() const { return nFilters * GetNumberOfPixels(); }
+	
+	// weight is a (nFilters, nChannels * kernelSize * kernelSize) matrix: filters are contiguous for the same tap
+	CONVOLUTION_QUALIFIER unsigned GetNumberOfTaps() const { return nChannels * kernelSize * kernelSize; }
+	
+	CONVOLUTION_QUALIFIER unsigned GetNumberOfFilterBlocks() const { return (nFilters + convolutionFilterBlock - 1) / convolutionFilterBlock; }
+	
+	CONVOLUTION_QUALIFIER bool IsValid() const
+	{
+		return nChannels > 0 && nFilters > 0 && kernelSize > 0 && stride > 0 && kernelSize <= height && kernelSize <= width;
+	}
+};
+
+enum class PoolingType
+{
+	Max,
+	Average,
+};
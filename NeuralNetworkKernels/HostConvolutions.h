@@ -0,0 +1,357 @@
+#pragma once
+
+#include <Convolution.h>
+#include <HostThreadPool.h>
+
+#include <algorithm>
+
+/**
+* Host counterparts of the convolution and pooling kernels, see Convolution.h for the layout.
+* They work directly on the images, without an im2col copy:
+*     - the forward pass takes a block of filters at a time, so that every input row that is loaded feeds several
+*       output rows, and a block of output rows at a time, so that the tile being accumulated stays in L1
+*     - the input gradient is the transpose of the forward pass, and scatters with the same filter blocking
+*     - weight and bias gradients are reduced in registers, one filter per thread
+*/
+
+static constexpr unsigned convolutionTileBytes = { 16384 };
+
+/**
+* y[i] += alpha * x[i * stride]
+* NB: unit stride is the common case, and it's the one that vectorises
+*/
+template <typename T>
+inline void __GatherAxpyRow__(T* __restrict y, const T* __restrict x, const T alpha, const unsigned n, const unsigned stride)
+{
+	if (stride == 1)
+	{
+		for (unsigned i = 0; i < n; ++i)
+			y[i] += alpha * x[i];
+	}
+	else
+	{
+		for (unsigned i = 0; i < n; ++i)
+			y[i] += alpha * x[i * stride];
+	}
+}
+
+/**
+* y[i * stride] += alpha * x[i]
+*/
+template <typename T>
+inline void __ScatterAxpyRow__(T* __restrict y, const T* __restrict x, const T alpha, const unsigned n, const unsigned stride)
+{
+	if (stride == 1)
+	{
+		for (unsigned i = 0; i < n; ++i)
+			y[i] += alpha * x[i];
+	}
+	else
+	{
+		for (unsigned i = 0; i < n; ++i)
+			y[i * stride] += alpha * x[i];
+	}
+}
+
+/**
+* sum_i x[i] * y[i * stride]
+*/
+template <typename T>
+inline T __StridedDotRow__(const T* __restrict x, const T* __restrict y, const unsigned n, const unsigned stride)
+{
+	T ret = static_cast<T>(0.0);
+	if (stride == 1)
+	{
+		for (unsigned i = 0; i < n; ++i)
+			ret += x[i] * y[i];
+	}
+	else
+	{
+		for (unsigned i = 0; i < n; ++i)
+			ret += x[i] * y[i * stride];
+	}
+	
+	return ret;
+}
+
+/**
+* z = weight * x + bias, for the columns in [colStart, colEnd)
+*/
+template <typename T>
+inline void __ConvolutionWorker__(T* z, const T* x, const T* weight, const T* bias, const ConvolutionGeometry& geometry, const unsigned colStart, const unsigned colEnd)
+{
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = outputHeight * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	const unsigned rowBlock = std::max(1u, static_cast<unsigned>(convolutionTileBytes / (sizeof(T) * outputWidth * convolutionFilterBlock)));
+	
+	for (unsigned j = colStart; j < colEnd; ++j)
+	{
+		const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs();
+		T* zj = z + static_cast<size_t>(j) * geometry.GetNumberOfOutputs();
+		
+		for (unsigned filterStart = 0; filterStart < geometry.nFilters; filterStart += convolutionFilterBlock)
+		{
+			const unsigned filterEnd = std::min(geometry.nFilters, filterStart + convolutionFilterBlock);
+			for (unsigned rowStart = 0; rowStart < outputHeight; rowStart += rowBlock)
+			{
+				const unsigned rowEnd = std::min(outputHeight, rowStart + rowBlock);
+				for (unsigned f = filterStart; f < filterEnd; ++f)
+					std::fill(zj + f * outputPlane + rowStart * outputWidth, zj + f * outputPlane + rowEnd * outputWidth, bias[f]);
+				
+				for (unsigned c = 0; c < geometry.nChannels; ++c)
+				{
+					for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+					{
+						for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+						{
+							const T* w = weight + static_cast<size_t>((c * geometry.kernelSize + ky) * geometry.kernelSize + kx) * geometry.nFilters;
+							for (unsigned oy = rowStart; oy < rowEnd; ++oy)
+							{
+								const T* xRow = xj + c * inputPlane + (oy * geometry.stride + ky) * geometry.width + kx;
+								for (unsigned f = filterStart; f < filterEnd; ++f)
+									__GatherAxpyRow__(zj + f * outputPlane + oy * outputWidth, xRow, w[f], outputWidth, geometry.stride);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+* inputGradient = weight^T * delta, for the columns in [colStart, colEnd)
+*/
+template <typename T>
+inline void __ConvolutionInputGradientWorker__(T* inputGradient, const T* delta, const T* weight, const ConvolutionGeometry& geometry, const unsigned colStart, const unsigned colEnd)
+{
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = outputHeight * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	
+	for (unsigned j = colStart; j < colEnd; ++j)
+	{
+		T* inputGradientJ = inputGradient + static_cast<size_t>(j) * geometry.GetNumberOfInputs();
+		const T* deltaJ = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs();
+		std::fill(inputGradientJ, inputGradientJ + geometry.GetNumberOfInputs(), static_cast<T>(0.0));
+		
+		for (unsigned filterStart = 0; filterStart < geometry.nFilters; filterStart += convolutionFilterBlock)
+		{
+			const unsigned filterEnd = std::min(geometry.nFilters, filterStart + convolutionFilterBlock);
+			for (unsigned c = 0; c < geometry.nChannels; ++c)
+			{
+				for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+				{
+					for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+					{
+						const T* w = weight + static_cast<size_t>((c * geometry.kernelSize + ky) * geometry.kernelSize + kx) * geometry.nFilters;
+						for (unsigned oy = 0; oy < outputHeight; ++oy)
+						{
+							T* inputGradientRow = inputGradientJ + c * inputPlane + (oy * geometry.stride + ky) * geometry.width + kx;
+							for (unsigned f = filterStart; f < filterEnd; ++f)
+								__ScatterAxpyRow__(inputGradientRow, deltaJ + f * outputPlane + oy * outputWidth, w[f], outputWidth, geometry.stride);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+* biasGradient += delta summed over pixels and columns, weightGradient += delta * x^T, for the filters in [filterStart, filterEnd)
+*/
+template <typename T>
+inline void __ConvolutionGradientWorker__(T* biasGradient, T* weightGradient, const T* delta, const T* x, const ConvolutionGeometry& geometry, const unsigned nCols, const unsigned filterStart, const unsigned filterEnd)
+{
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = outputHeight * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	
+	for (unsigned j = 0; j < nCols; ++j)
+	{
+		const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs();
+		const T* deltaJ = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs();
+		for (unsigned f = filterStart; f < filterEnd; ++f)
+		{
+			const T* deltaPlane = deltaJ + f * outputPlane;
+			
+			T biasSum = static_cast<T>(0.0);
+			for (unsigned p = 0; p < outputPlane; ++p)
+				biasSum += deltaPlane[p];
+			biasGradient[f] += biasSum;
+			
+			for (unsigned c = 0; c < geometry.nChannels; ++c)
+			{
+				for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+				{
+					for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+					{
+						T sum = static_cast<T>(0.0);
+						for (unsigned oy = 0; oy < outputHeight; ++oy)
+							sum += __StridedDotRow__(deltaPlane + oy * outputWidth, xj + c * inputPlane + (oy * geometry.stride + ky) * geometry.width + kx, outputWidth, geometry.stride);
+						
+						weightGradient[f + static_cast<size_t>((c * geometry.kernelSize + ky) * geometry.kernelSize + kx) * geometry.nFilters] += sum;
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+* offset (from the top left corner) of the first largest element of the window
+*/
+template <typename T>
+inline unsigned __PoolingWindowArgMax__(const T* window, const unsigned width, const unsigned kernelSize)
+{
+	unsigned argMax = 0;
+	T max = window[0];
+	for (unsigned ky = 0; ky < kernelSize; ++ky)
+	{
+		for (unsigned kx = 0; kx < kernelSize; ++kx)
+		{
+			const unsigned offset = ky * width + kx;
+			if (window[offset] > max)
+			{
+				max = window[offset];
+				argMax = offset;
+			}
+		}
+	}
+	
+	return argMax;
+}
+
+template <typename T, PoolingType type>
+inline void __PoolingWorker__(T* z, const T* x, const ConvolutionGeometry& geometry, const unsigned colStart, const unsigned colEnd)
+{
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned inputPlane = geometry.height * geometry.width;
+	const T scale = static_cast<T>(1.0) / static_cast<T>(geometry.kernelSize * geometry.kernelSize);
+	
+	for (unsigned j = colStart; j < colEnd; ++j)
+	{
+		const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs();
+		T* zj = z + static_cast<size_t>(j) * geometry.GetNumberOfOutputs();
+		for (unsigned c = 0; c < geometry.nChannels; ++c)
+		{
+			for (unsigned oy = 0; oy < outputHeight; ++oy)
+			{
+				for (unsigned ox = 0; ox < outputWidth; ++ox)
+				{
+					const T* window = xj + c * inputPlane + oy * geometry.stride * geometry.width + ox * geometry.stride;
+					if (type == PoolingType::Max)
+						*zj++ = window[__PoolingWindowArgMax__(window, geometry.width, geometry.kernelSize)];
+					else
+					{
+						T sum = static_cast<T>(0.0);
+						for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+							for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+								sum += window[ky * geometry.width + kx];
+						*zj++ = scale * sum;
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+* max pooling routes each delta to the (first) largest element of its window, average pooling spreads it evenly
+*/
+template <typename T, PoolingType type>
+inline void __PoolingInputGradientWorker__(T* inputGradient, const T* delta, const T* x, const ConvolutionGeometry& geometry, const unsigned colStart, const unsigned colEnd)
+{
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned inputPlane = geometry.height * geometry.width;
+	const T scale = static_cast<T>(1.0) / static_cast<T>(geometry.kernelSize * geometry.kernelSize);
+	
+	for (unsigned j = colStart; j < colEnd; ++j)
+	{
+		const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs();
+		T* inputGradientJ = inputGradient + static_cast<size_t>(j) * geometry.GetNumberOfInputs();
+		const T* deltaJ = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs();
+		std::fill(inputGradientJ, inputGradientJ + geometry.GetNumberOfInputs(), static_cast<T>(0.0));
+		
+		for (unsigned c = 0; c < geometry.nChannels; ++c)
+		{
+			for (unsigned oy = 0; oy < outputHeight; ++oy)
+			{
+				for (unsigned ox = 0; ox < outputWidth; ++ox)
+				{
+					const unsigned corner = c * inputPlane + oy * geometry.stride * geometry.width + ox * geometry.stride;
+					const T d = *deltaJ++;
+					if (type == PoolingType::Max)
+						inputGradientJ[corner + __PoolingWindowArgMax__(xj + corner, geometry.width, geometry.kernelSize)] += d;
+					else
+					{
+						for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+							for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+								inputGradientJ[corner + ky * geometry.width + kx] += scale * d;
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+* host entry points: columns (or filters, for the parameter gradients) are split across threads
+*/
+template <typename T>
+inline void __ConvolutionHost__(T* z, const T* x, const T* weight, const T* bias, const ConvolutionGeometry& geometry, const unsigned nCols)
+{
+	__ParallelForHost__(nCols, 8, [&](const unsigned colStart, const unsigned colEnd)
+	{
+		__ConvolutionWorker__(z, x, weight, bias, geometry, colStart, colEnd);
+	});
+}
+
+template <typename T>
+inline void __ConvolutionInputGradientHost__(T* inputGradient, const T* delta, const T* weight, const ConvolutionGeometry& geometry, const unsigned nCols)
+{
+	__ParallelForHost__(nCols, 8, [&](const unsigned colStart, const unsigned colEnd)
+	{
+		__ConvolutionInputGradientWorker__(inputGradient, delta, weight, geometry, colStart, colEnd);
+	});
+}
+
+template <typename T>
+inline void __ConvolutionGradientHost__(T* biasGradient, T* weightGradient, const T* delta, const T* x, const ConvolutionGeometry& geometry, const unsigned nCols)
+{
+	__ParallelForHost__(geometry.nFilters, 1, [&](const unsigned filterStart, const unsigned filterEnd)
+	{
+		__ConvolutionGradientWorker__(biasGradient, weightGradient, delta, x, geometry, nCols, filterStart, filterEnd);
+	});
+}
+
+template <typename T>
+inline void __PoolingHost__(T* z, const T* x, const ConvolutionGeometry& geometry, const PoolingType type, const unsigned nCols)
+{
+	__ParallelForHost__(nCols, 64, [&](const unsigned colStart, const unsigned colEnd)
+	{
+		if (type == PoolingType::Max)
+			__PoolingWorker__<T, PoolingType::Max>(z, x, geometry, colStart, colEnd);
+		else
+			__PoolingWorker__<T, PoolingType::Average>(z, x, geometry, colStart, colEnd);
+	});
+}
+
+template <typename T>
+inline void __PoolingInputGradientHost__(T* inputGradient, const T* delta, const T* x, const ConvolutionGeometry& geometry, const PoolingType type, const unsigned nCols)
+{
+	__ParallelForHost__(nCols, 64, [&](const unsigned colStart, const unsigned colEnd)
+	{
+		if (type == PoolingType::Max)
+			__PoolingInputGradientWorker__<T, PoolingType::Max>(inputGradient, delta, x, geometry, colStart, colEnd);
+		else
+			__PoolingInputGradientWorker__<T, PoolingType::Average>(inputGradient, delta, x, geometry, colStart, colEnd);
+	});
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <ParameterUpdate.h>
+#include <HostThreadPool.h>
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+/**
+* Host counterparts of the objective function kernels, used when the buffers live in MemorySpace::Host.
+* They are plain C++ so that they can be shared by the CUDA library and by host code.
+*/
+
+/**
+* index of the first element with the largest absolute value (same convention as ColumnWiseArgAbsMaximum)
+* NB: written branch-free, so that the compiler can vectorise it
+*/
+template <typename T>
+inline unsigned __ColumnArgAbsMaximumWorker__(const T* x, const unsigned nRows)
+{
+	unsigned argMax = 0;
+	T max = x[0] < static_cast<T>(0.0) ? -x[0] : x[0];
+	for (unsigned i = 1; i < nRows; ++i)
+	{
+		const T absX = x[i] < static_cast<T>(0.0) ? -x[i] : x[i];
+		const bool isGreater = absX > max;
+		argMax = isGreater ? i : argMax;
+		max = isGreater ? absX : max;
+	}
+	
+	return argMax;
+}
+
+/**
+* number of columns whose arg-abs-maximum matches, with argmax, compare and count done in a single pass
+*/
+template <typename T>
+inline int __ClassificationAccuracyWorker__(const T* modelOutput, const T* expectedOutput, const unsigned nRows, const unsigned colStart, const unsigned colEnd)
+{
+	int nCorrect = 0;
+	for (unsigned j = colStart; j < colEnd; ++j)
+	{
+		const size_t offset = static_cast<size_t>(j) * nRows;
+		nCorrect += __ColumnArgAbsMaximumWorker__(modelOutput + offset, nRows) == __ColumnArgAbsMaximumWorker__(expectedOutput + offset, nRows);
+	}
+	
+	return nCorrect;
+}
+
+/**
+* splits the columns in contiguous blocks, one per thread of the pool (see __ParallelForHost__)
+*/
+template <typename T>
+inline int __ClassificationAccuracyHost__(const T* modelOutput, const T* expectedOutput, const unsigned nRows, const unsigned nCols, unsigned nThreads = 0)
+{
+	static constexpr unsigned minColumnsPerThread = { 1024 };
+	
+	std::atomic<int> nCorrect { 0 };
+	__ParallelForHost__(nCols, minColumnsPerThread, [&](const unsigned colStart, const unsigned colEnd)
+	{
+		nCorrect += __ClassificationAccuracyWorker__(modelOutput, expectedOutput, nRows, colStart, colEnd);
+	}, nThreads);
+	
+	return nCorrect;
+}
+
+/**
+* element-wise activation, see ActivationFunctors.h: the functor is a template parameter, so that each loop is
+* specialised (and vectorised) for its activation
+*/
+template <typename Functor, typename T>
+inline void __ActivationHost__(T* z, const T* x, const unsigned sz)
+{
+	for (unsigned i = 0; i < sz; ++i)
+		z[i] = Functor::Value(x[i]);
+}
+
+template <typename Functor, typename T>
+inline void __ActivationPrimeHost__(T* z, const T* x, const unsigned sz)
+{
+	for (unsigned i = 0; i < sz; ++i)
+		z[i] = Functor::Derivative(x[i]);
+}
+
+template <typename Functor, typename T>
+inline void __ActivationPrimeFromOutputHost__(T* z, const T* y, const unsigned sz)
+{
+	for (unsigned i = 0; i < sz; ++i)
+		z[i] = Functor::DerivativeFromOutput(y[i]);
+}
+
+/**
+* fused parameter update, see ParameterUpdate.h
+* NB: firstState and secondState may be null if the rule doesn't need them
+*/
+template <typename T>
+inline void __ParameterUpdateHost__(T* x, T* firstState, T* secondState, const T* gradient, const unsigned sz, const ParameterUpdateSettings& settings)
+{
+	// the decayed and the non-decayed ranges are updated separately, so that the loop bodies stay branch-free
+	if (settings.decayedSize < sz)
+	{
+		const unsigned n = settings.decayedSize;
+		ParameterUpdateSettings decayedSettings = settings;
+		decayedSettings.decayedSize = std::numeric_limits<unsigned>::max();
+		ParameterUpdateSettings nonDecayedSettings = decayedSettings;
+		nonDecayedSettings.decay = 0.0;
+		
+		__ParameterUpdateHost__(x, firstState, secondState, gradient, n, decayedSettings);
+		__ParameterUpdateHost__(x + n, firstState ? firstState + n : nullptr, secondState ? secondState + n : nullptr, gradient + n, sz - n, nonDecayedSettings);
+		return;
+	}
+	
+	const T learningRate = static_cast<T>(settings.learningRate);
+	const T gradientScale = static_cast<T>(settings.gradientScale);
+	const T decay = static_cast<T>(settings.decay);
+	const T beta1 = static_cast<T>(settings.beta1);
+	const T beta2 = static_cast<T>(settings.beta2);
+	const T epsilon = static_cast<T>(settings.epsilon);
+	
+	// one loop per rule, so that the branch is hoisted and every loop body can be vectorised
+	switch (settings.type)
+	{
+		case ParameterUpdateType::GradientDescent:
+			for (unsigned i = 0; i < sz; ++i)
+				x[i] -= learningRate * (gradientScale * gradient[i] + decay * x[i]);
+			break;
+		case ParameterUpdateType::Momentum:
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i] + decay * x[i];
+				firstState[i] = beta1 * firstState[i] - learningRate * g;
+				x[i] += firstState[i];
+			}
+			break;
+		case ParameterUpdateType::Nesterov:
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i] + decay * x[i];
+				const T previousVelocity = firstState[i];
+				firstState[i] = beta1 * firstState[i] - learningRate * g;
+				x[i] += (static_cast<T>(1.0) + beta1) * firstState[i] - beta1 * previousVelocity;
+			}
+			break;
+		case ParameterUpdateType::RmsProp:
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i] + decay * x[i];
+				firstState[i] = beta2 * firstState[i] + (static_cast<T>(1.0) - beta2) * g * g;
+				x[i] -= learningRate * g / (std::sqrt(firstState[i]) + epsilon);
+			}
+			break;
+		case ParameterUpdateType::Adam:
+		{
+			const T firstMomentCorrection = static_cast<T>(settings.firstMomentCorrection);
+			const T secondMomentCorrection = static_cast<T>(settings.secondMomentCorrection);
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i] + decay * x[i];
+				firstState[i] = beta1 * firstState[i] + (static_cast<T>(1.0) - beta1) * g;
+				secondState[i] = beta2 * secondState[i] + (static_cast<T>(1.0) - beta2) * g * g;
+				x[i] -= learningRate * firstState[i] * firstMomentCorrection / (std::sqrt(secondState[i] * secondMomentCorrection) + epsilon);
+			}
+			break;
+		}
+		case ParameterUpdateType::Lars:
+		{
+			const T scaledLearningRate = learningRate * static_cast<T>(settings.trustRatio);
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i] + decay * x[i];
+				firstState[i] = beta1 * firstState[i] - scaledLearningRate * g;
+				x[i] += firstState[i];
+			}
+			break;
+		}
+		case ParameterUpdateType::Lamb:
+		{
+			// NB: the moments have already been updated by __ParameterUpdateNormsHost__
+			const T scaledLearningRate = learningRate * static_cast<T>(settings.trustRatio);
+			const T firstMomentCorrection = static_cast<T>(settings.firstMomentCorrection);
+			const T secondMomentCorrection = static_cast<T>(settings.secondMomentCorrection);
+			for (unsigned i = 0; i < sz; ++i)
+				x[i] -= scaledLearningRate * (firstState[i] * firstMomentCorrection / (std::sqrt(secondState[i] * secondMomentCorrection) + epsilon) + decay * x[i]);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+/**
+* first pass of the layer-wise rules: |x| and |g| for LARS, while LAMB updates its moments and returns |x| and |r|,
+* r being the Adam direction plus the decoupled weight decay
+*/
+template <typename T>
+inline void __ParameterUpdateNormsHost__(double& parameterNorm, double& updateNorm, const T* x, T* firstState, T* secondState, const T* gradient, const unsigned sz, const ParameterUpdateSettings& settings)
+{
+	const T gradientScale = static_cast<T>(settings.gradientScale);
+	const T decay = static_cast<T>(settings.decay);
+	const T beta1 = static_cast<T>(settings.beta1);
+	const T beta2 = static_cast<T>(settings.beta2);
+	const T epsilon = static_cast<T>(settings.epsilon);
+	const T firstMomentCorrection = static_cast<T>(settings.firstMomentCorrection);
+	const T secondMomentCorrection = static_cast<T>(settings.secondMomentCorrection);
+	
+	double parameterNorm2 = 0.0;
+	double updateNorm2 = 0.0;
+	switch (settings.type)
+	{
+		case ParameterUpdateType::Lars:
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i];
+				parameterNorm2 += static_cast<double>(x[i] * x[i]);
+				updateNorm2 += static_cast<double>(g * g);
+			}
+			break;
+		case ParameterUpdateType::Lamb:
+			for (unsigned i = 0; i < sz; ++i)
+			{
+				const T g = gradientScale * gradient[i];
+				firstState[i] = beta1 * firstState[i] + (static_cast<T>(1.0) - beta1) * g;
+				secondState[i] = beta2 * secondState[i] + (static_cast<T>(1.0) - beta2) * g * g;
+				const T r = firstState[i] * firstMomentCorrection / (std::sqrt(secondState[i] * secondMomentCorrection) + epsilon) + decay * x[i];
+				parameterNorm2 += static_cast<double>(x[i] * x[i]);
+				updateNorm2 += static_cast<double>(r * r);
+			}
+			break;
+		default:
+			break;
+	}
+	
+	parameterNorm = std::sqrt(parameterNorm2);
+	updateNorm = std::sqrt(updateNorm2);
+}
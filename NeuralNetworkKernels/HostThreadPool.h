@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* Persistent worker threads for the host kernels, so that a kernel call doesn't pay for creating and joining its
+* threads: they're created once, at the first call, and then wait for work.
+* The calling thread takes part in the work, so that a pool of n threads has n - 1 workers.
+* NB: a call made from within a task, or while another thread is using the pool, runs serially on the calling thread
+*/
+class HostThreadPool
+{
+public:
+	static HostThreadPool& Instance()
+	{
+		static HostThreadPool instance(std::max(1u, std::thread::hardware_concurrency()));
+		return instance;
+	}
+	
+	explicit HostThreadPool(const unsigned nThreads)
+	{
+		_workers.reserve(nThreads - 1);
+		for (unsigned t = 1; t < nThreads; ++t)
+			_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+	
+	~HostThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wakeUp.notify_all();
+		for (auto& worker: _workers)
+			worker.join();
+	}
+	
+	HostThreadPool(const HostThreadPool&) = delete;
+	HostThreadPool& operator=(const HostThreadPool&) = delete;
+	
+	inline unsigned GetNumberOfThreads() const noexcept { return static_cast<unsigned>(_workers.size()) + 1; }
+	
+	/**
+	* calls task(i) for every i in [0, nTasks), and returns when they're all done
+	*/
+	template <typename Task>
+	void Run(const unsigned nTasks, const Task& task)
+	{
+		std::unique_lock<std::mutex> runLock(_runMutex, std::defer_lock);
+		if (nTasks <= 1 || _workers.empty() || IsInsideTask() || !runLock.try_lock())
+		{
+			for (unsigned i = 0; i < nTasks; ++i)
+				task(i);
+			return;
+		}
+		
+		{
+			// NB: workers that woke up too late for the previous call could still be looking at its counters
+			std::unique_lock<std::mutex> lock(_mutex);
+			_done.wait(lock, [this]() { return _nBusyWorkers == 0; });
+			
+			_task = [&task](const unsigned i) { task(i); };
+			_nTasks = nTasks;
+			_nextTask = 0;
+			++_generation;
+		}
+		_wakeUp.notify_all();
+		
+		Work();
+		
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done.wait(lock, [this]() { return _nBusyWorkers == 0; });
+		_task = nullptr;
+	}
+
+private:
+	static bool& IsInsideTask() noexcept
+	{
+		thread_local bool ret = false;
+		return ret;
+	}
+	
+	// takes tasks until there are none left
+	void Work()
+	{
+		IsInsideTask() = true;
+		for (unsigned i = _nextTask++; i < _nTasks; i = _nextTask++)
+			_task(i);
+		IsInsideTask() = false;
+	}
+	
+	void WorkerLoop()
+	{
+		size_t generation = 0;
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (;;)
+		{
+			_wakeUp.wait(lock, [&]() { return _stop || _generation != generation; });
+			if (_stop)
+				return;
+			
+			generation = _generation;
+			++_nBusyWorkers;
+			lock.unlock();
+			
+			Work();
+			
+			lock.lock();
+			if (--_nBusyWorkers == 0)
+				_done.notify_all();
+		}
+	}
+
+private:
+	std::vector<std::thread> _workers {};
+	
+	std::mutex _runMutex {};  // one call at a time
+	std::mutex _mutex {};
+	std::condition_variable _wakeUp {};
+	std::condition_variable _done {};
+	
+	std::function<void(const unsigned)> _task {};
+	unsigned _nTasks = 0;
+	std::atomic<unsigned> _nextTask { 0 };
+	size_t _generation = 0;
+	unsigned _nBusyWorkers = 0;
+	bool _stop = false;
+};
+
+/**
+* splits [0, n) in contiguous blocks, one per thread (0 -> every thread of the pool), and calls worker(begin, end) on each
+*/
+template <typename Worker>
+inline void __ParallelForHost__(const unsigned n, const unsigned minItemsPerThread, const Worker& worker, unsigned nThreads = 0)
+{
+	auto& pool = HostThreadPool::Instance();
+	if (nThreads == 0)
+		nThreads = pool.GetNumberOfThreads();
+	nThreads = std::max(1u, std::min(nThreads, n / std::max(1u, minItemsPerThread)));
+	if (nThreads == 1)
+	{
+		worker(0u, n);
+		return;
+	}
+	
+	const unsigned blockSize = (n + nThreads - 1) / nThreads;
+	pool.Run(nThreads, [&](const unsigned t)
+	{
+		const unsigned begin = std::min(n, t * blockSize);
+		const unsigned end = std::min(n, begin + blockSize);
+		if (begin < end)
+			worker(begin, end);
+	});
+}
@@ -3,521 +3,1241 @@
 #include <CuBlasWrappers.cuh>
 #include <MemoryManager.cuh>
 #include <BufferInitializer.cuh>
+#include <HostObjectiveFunctions.h>
+#include <HostConvolutions.h>
+#include <ActivationFunctors.h>
 
-template <typename T>
-DEVICE T __SigmoidWorker__(const T x)
-{
-	return static_cast<T>(1.0) / (static_cast<T>(1.0) + exp(-x));
-}
-
-template <typename T>
-DEVICE T __HyperbolicTangentWorker__(const T x)
-{
-	return static_cast<T>(2.0) * __SigmoidWorker__<T>(static_cast<T>(2.0) * x) - static_cast<T>(1.0);
-}
-
-template <typename T>
-DEVICE T __InverseSquareRootLinearUnitDenominatorWorker__(const T x)
-{
-	return static_cast<T>(1.0) / (static_cast<T>(1.0) + x * x);
-}
+#include <cublas_v2.h>
+#include <type_traits>
 
 template <typename T>
-DEVICE T __ExponentialLinearUnitPrimeWorker__(const T x)
+DEVICE T __CrossEntropyWorker__(const T x, const T y)
 {
-	return exp(x);
+	return 	x * log(y);
 }
 
-template <typename T>
-DEVICE T __BentIdentityPrimeWorker__(const T x)
+template <typename T, typename Functor>
+GLOBAL void __Activation__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
 {
-	return sqrt(x * x + static_cast<T>(1.0));
+	CUDA_FUNCTION_PROLOGUE;
+	
+	CUDA_FOR_LOOP_PROLOGUE
+		z[i] = Functor::Value(x[i]);
+	CUDA_FOR_LOOP_EPILOGUE
 }
 
-template <typename T>
-DEVICE T __CrossEntropyWorker__(const T x, const T y)
+// same as above, for z = f(z): z can't be both RESTRICT and aliased by x
+template <typename T, typename Functor>
+GLOBAL void __ActivationInPlace__(T* z, const unsigned sz)
 {
-	return 	x * log(y);
+	CUDA_FUNCTION_PROLOGUE;
+	
+	CUDA_FOR_LOOP_PROLOGUE
+		z[i] = Functor::Value(z[i]);
+	CUDA_FOR_LOOP_EPILOGUE
 }
 
-template <typename T>
-GLOBAL void __Sigmoid__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+template <typename T, typename Functor>
+GLOBAL void __ActivationPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
 	CUDA_FOR_LOOP_PROLOGUE
-		z[i] = __SigmoidWorker__<T>(x[i]);
+		z[i] = Functor::Derivative(x[i]);
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
-template <typename T>
-GLOBAL void __SigmoidPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+template <typename T, typename Functor>
+GLOBAL void __ActivationPrimeFromOutput__(T* RESTRICT z, const T* RESTRICT y, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
 	CUDA_FOR_LOOP_PROLOGUE
-		const T sigmoidZ = __SigmoidWorker__<T>(x[i]);
-		z[i] = sigmoidZ * (static_cast<T>(1.0) - sigmoidZ);
+		z[i] = Functor::DerivativeFromOutput(y[i]);
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __HyperbolicTangent__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __SoftMax__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
 	CUDA_FOR_LOOP_PROLOGUE
-		z[i] = __HyperbolicTangentWorker__<T>(x[i]);
+		z[i] = exp(x[i]);  // normalised later on!
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __HyperbolicTangentPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __SoftMaxInPlace__(T* z, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
 	CUDA_FOR_LOOP_PROLOGUE
-		const T tanhZ = __HyperbolicTangentWorker__<T>(x[i]);
-		z[i] = static_cast<T>(1.0) - tanhZ * tanhZ;
+		z[i] = exp(z[i]);  // normalised later on!
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __RectifiedLinearUnit__(T* RESTRICT z, const T* RESTRICT x, const T alpha, const unsigned sz)
+GLOBAL void __CrossEntropyCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
 	CUDA_FOR_LOOP_PROLOGUE
-		if (x[i] <= static_cast<T>(0.0))
-			z[i] = alpha * x[i];
+		const T crossEntropy = -__CrossEntropyWorker__(y[i], x[i]) - __CrossEntropyWorker__(1.0 - y[i], 1.0 - x[i]);
+		if (!isfinite(crossEntropy))
+			x[i] = 0.0;
 		else
-			z[i] = x[i];
+			x[i] = crossEntropy;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __RectifiedLinearUnitPrime__(T* RESTRICT z, const T* RESTRICT x, const T alpha, const unsigned sz)
+GLOBAL void __LogLikelihoodCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
 	CUDA_FOR_LOOP_PROLOGUE
-		if (x[i] <= static_cast<T>(0.0))
-			z[i] = alpha;
+		const T crossEntropy = -__CrossEntropyWorker__(y[i], x[i]);
+		if (!isfinite(crossEntropy))
+			x[i] = 0.0;
 		else
-			z[i] = 1.0;
+			x[i] = crossEntropy;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
+// the warp reads the column side by side (lane l reads rows l, l + warpSize, ...), so that the loads are coalesced,
+// then the lanes' maxima are reduced with shuffles. Ties go to the lowest row, as in the host version.
+// NB: the whole warp must call this, as the shuffles are synchronised on the full mask
+template <typename T>
+DEVICE unsigned __ColumnArgAbsMaximumWarpWorker__(const T* RESTRICT x, const unsigned nRows, const unsigned lane)
+{
+	unsigned argMax = nRows;
+	T max = static_cast<T>(-1.0);
+	for (unsigned i = lane; i < nRows; i += warpSize)
+	{
+		const T absX = fabs(x[i]);
+		if (absX > max)
+		{
+			max = absX;
+			argMax = i;
+		}
+	}
+	
+	for (unsigned offset = warpSize / 2; offset > 0; offset /= 2)
+	{
+		const T otherMax = __shfl_down_sync(0xffffffff, max, offset);
+		const unsigned otherArgMax = __shfl_down_sync(0xffffffff, argMax, offset);
+		if (otherMax > max || (otherMax == max && otherArgMax < argMax))
+		{
+			max = otherMax;
+			argMax = otherArgMax;
+		}
+	}
+	
+	// only lane 0 holds the reduced value
+	return argMax;
+}
+
 template <typename T>
-GLOBAL void __InverseSquareRootLinearUnit__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __ClassificationAccuracy__(int* RESTRICT nCorrect, const T* RESTRICT x, const T* RESTRICT y, const unsigned nRows, const unsigned nCols)
+{
+	CUDA_FUNCTION_PROLOGUE;
+	
+	// one warp per column: the warp index is uniform across its lanes, so they all take part in the shuffles.
+	// Lane 0 accumulates locally, and hits the global counter only once
+	const unsigned lane = tid % warpSize;
+	const unsigned nWarps = step / warpSize;
+	int warpCorrect = 0;
+	for (unsigned j = tid / warpSize; j < nCols; j += nWarps)
+	{
+		const size_t offset = static_cast<size_t>(j) * nRows;
+		const unsigned xArgMax = __ColumnArgAbsMaximumWarpWorker__<T>(x + offset, nRows, lane);
+		const unsigned yArgMax = __ColumnArgAbsMaximumWarpWorker__<T>(y + offset, nRows, lane);
+		if (lane == 0)
+			warpCorrect += xArgMax == yArgMax;
+	}
+	
+	if (warpCorrect > 0)
+		atomicAdd(nCorrect, warpCorrect);
+}
+
+template <typename T, ParameterUpdateType type>
+GLOBAL void __UpdateParameters__(T* RESTRICT x, T* RESTRICT firstState, T* RESTRICT secondState, const T* RESTRICT gradient, const ParameterUpdateSettings settings, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const T learningRate = static_cast<T>(settings.learningRate);
+	const T gradientScale = static_cast<T>(settings.gradientScale);
+	const T decay = static_cast<T>(settings.decay);
+	const T beta1 = static_cast<T>(settings.beta1);
+	const T beta2 = static_cast<T>(settings.beta2);
+	const T epsilon = static_cast<T>(settings.epsilon);
+	
+	// type is a template parameter: the switch is resolved at compile time
 	CUDA_FOR_LOOP_PROLOGUE
-		if (x[i] <= static_cast<T>(0.0))
-			z[i] = x[i] * __InverseSquareRootLinearUnitDenominatorWorker__(x[i]);
-		else
-			z[i] = x[i];
+		const T decayX = i < settings.decayedSize ? decay * x[i] : static_cast<T>(0.0);
+		const T g = gradientScale * gradient[i] + decayX;
+		switch (type)
+		{
+			case ParameterUpdateType::GradientDescent:
+				x[i] -= learningRate * g;
+				break;
+			case ParameterUpdateType::Momentum:
+				firstState[i] = beta1 * firstState[i] - learningRate * g;
+				x[i] += firstState[i];
+				break;
+			case ParameterUpdateType::Nesterov:
+			{
+				const T previousVelocity = firstState[i];
+				firstState[i] = beta1 * firstState[i] - learningRate * g;
+				x[i] += (static_cast<T>(1.0) + beta1) * firstState[i] - beta1 * previousVelocity;
+				break;
+			}
+			case ParameterUpdateType::RmsProp:
+				firstState[i] = beta2 * firstState[i] + (static_cast<T>(1.0) - beta2) * g * g;
+				x[i] -= learningRate * g / (sqrt(firstState[i]) + epsilon);
+				break;
+			case ParameterUpdateType::Adam:
+				firstState[i] = beta1 * firstState[i] + (static_cast<T>(1.0) - beta1) * g;
+				secondState[i] = beta2 * secondState[i] + (static_cast<T>(1.0) - beta2) * g * g;
+				x[i] -= learningRate * firstState[i] * static_cast<T>(settings.firstMomentCorrection) / (sqrt(secondState[i] * static_cast<T>(settings.secondMomentCorrection)) + epsilon);
+				break;
+			case ParameterUpdateType::Lars:
+				firstState[i] = beta1 * firstState[i] - learningRate * static_cast<T>(settings.trustRatio) * g;
+				x[i] += firstState[i];
+				break;
+			case ParameterUpdateType::Lamb:
+				// NB: the moments have already been updated by __ParameterUpdateNorms__
+				x[i] -= learningRate * static_cast<T>(settings.trustRatio) * (firstState[i] * static_cast<T>(settings.firstMomentCorrection) / (sqrt(secondState[i] * static_cast<T>(settings.secondMomentCorrection)) + epsilon) + decayX);
+				break;
+			default:
+				break;
+		}
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
-template <typename T>
-GLOBAL void __InverseSquareRootLinearUnitPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+template <typename T, ParameterUpdateType type>
+GLOBAL void __ParameterUpdateNorms__(double* RESTRICT norms, const T* RESTRICT x, T* RESTRICT firstState, T* RESTRICT secondState, const T* RESTRICT gradient, const ParameterUpdateSettings settings, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const T gradientScale = static_cast<T>(settings.gradientScale);
+	const T decay = static_cast<T>(settings.decay);
+	const T beta1 = static_cast<T>(settings.beta1);
+	const T beta2 = static_cast<T>(settings.beta2);
+	const T epsilon = static_cast<T>(settings.epsilon);
+	
+	// squared norms are accumulated locally, and each thread hits the global accumulators only once
+	double parameterNorm2 = 0.0;
+	double updateNorm2 = 0.0;
 	CUDA_FOR_LOOP_PROLOGUE
-		if (x[i] <= static_cast<T>(0.0))
+		const T g = gradientScale * gradient[i];
+		parameterNorm2 += static_cast<double>(x[i] * x[i]);
+		switch (type)
 		{
-			const double factor = __InverseSquareRootLinearUnitDenominatorWorker__(x[i]);
-			z[i] = factor * factor * factor;
+			case ParameterUpdateType::Lars:
+				updateNorm2 += static_cast<double>(g * g);
+				break;
+			case ParameterUpdateType::Lamb:
+			{
+				firstState[i] = beta1 * firstState[i] + (static_cast<T>(1.0) - beta1) * g;
+				secondState[i] = beta2 * secondState[i] + (static_cast<T>(1.0) - beta2) * g * g;
+				const T r = firstState[i] * static_cast<T>(settings.firstMomentCorrection) / (sqrt(secondState[i] * static_cast<T>(settings.secondMomentCorrection)) + epsilon) + decay * x[i];
+				updateNorm2 += static_cast<double>(r * r);
+				break;
+			}
+			default:
+				break;
 		}
-		else
-			z[i] = 1.0;
 	CUDA_FOR_LOOP_EPILOGUE
+	
+	atomicAdd(norms, parameterNorm2);
+	atomicAdd(norms + 1, updateNorm2);
 }
 
 template <typename T>
-GLOBAL void __ExponentialLinearUnit__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __Convolution__(T* RESTRICT z, const T* RESTRICT x, const T* RESTRICT weight, const T* RESTRICT bias, const ConvolutionGeometry geometry, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = geometry.GetNumberOfPixels();
+	const unsigned inputPlane = geometry.height * geometry.width;
+	const unsigned nFilterBlocks = geometry.GetNumberOfFilterBlocks();
+	
+	// one output pixel per thread, for a block of filters: every input element that is loaded feeds all of them, and
+	// the partial sums stay in registers
 	CUDA_FOR_LOOP_PROLOGUE
-		if (x[i] <= static_cast<T>(0.0))
-			z[i] = __ExponentialLinearUnitPrimeWorker__(x[i]) - static_cast<T>(1.0);
-		else
-			z[i] = x[i];
+		const unsigned j = i / (nFilterBlocks * outputPlane);
+		const unsigned r = i % (nFilterBlocks * outputPlane);
+		const unsigned filterStart = (r / outputPlane) * convolutionFilterBlock;
+		const unsigned nBlockFilters = filterStart + convolutionFilterBlock <= geometry.nFilters ? convolutionFilterBlock : geometry.nFilters - filterStart;
+		const unsigned p = r % outputPlane;
+		const unsigned oy = p / outputWidth;
+		const unsigned ox = p % outputWidth;
+		
+		T sum[convolutionFilterBlock];
+		for (unsigned b = 0; b < convolutionFilterBlock; ++b)
+			sum[b] = b < nBlockFilters ? bias[filterStart + b] : static_cast<T>(0.0);
+		
+		const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs() + oy * geometry.stride * geometry.width + ox * geometry.stride;
+		for (unsigned c = 0; c < geometry.nChannels; ++c)
+		{
+			for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+			{
+				for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+				{
+					const T xValue = xj[c * inputPlane + ky * geometry.width + kx];
+					const T* w = weight + ((c * geometry.kernelSize + ky) * geometry.kernelSize + kx) * geometry.nFilters + filterStart;
+					for (unsigned b = 0; b < nBlockFilters; ++b)
+						sum[b] += w[b] * xValue;
+				}
+			}
+		}
+		
+		T* zj = z + static_cast<size_t>(j) * geometry.GetNumberOfOutputs() + p;
+		for (unsigned b = 0; b < nBlockFilters; ++b)
+			zj[(filterStart + b) * outputPlane] = sum[b];
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __ExponentialLinearUnitPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __ConvolutionInputGradient__(T* RESTRICT inputGradient, const T* RESTRICT delta, const T* RESTRICT weight, const ConvolutionGeometry geometry, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = outputHeight * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	
+	// one input pixel per thread, gathering from the windows that cover it: no atomics needed
 	CUDA_FOR_LOOP_PROLOGUE
-		if (x[i] <= static_cast<T>(0.0))
-			z[i] = __ExponentialLinearUnitPrimeWorker__(x[i]);
-		else
-			z[i] = x[i];
+		const unsigned j = i / geometry.GetNumberOfInputs();
+		const unsigned r = i % geometry.GetNumberOfInputs();
+		const unsigned c = r / inputPlane;
+		const unsigned y = (r % inputPlane) / geometry.width;
+		const unsigned x = r % geometry.width;
+		
+		const T* deltaJ = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs();
+		T sum = static_cast<T>(0.0);
+		for (unsigned ky = 0; ky < geometry.kernelSize && ky <= y; ++ky)
+		{
+			const unsigned oy = (y - ky) / geometry.stride;
+			if ((y - ky) % geometry.stride != 0 || oy >= outputHeight)
+				continue;
+			
+			for (unsigned kx = 0; kx < geometry.kernelSize && kx <= x; ++kx)
+			{
+				const unsigned ox = (x - kx) / geometry.stride;
+				if ((x - kx) % geometry.stride != 0 || ox >= outputWidth)
+					continue;
+				
+				const T* w = weight + ((c * geometry.kernelSize + ky) * geometry.kernelSize + kx) * geometry.nFilters;
+				for (unsigned f = 0; f < geometry.nFilters; ++f)
+					sum += w[f] * deltaJ[f * outputPlane + oy * outputWidth + ox];
+			}
+		}
+		inputGradient[i] = sum;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __BentIdentity__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __ConvolutionWeightGradient__(T* RESTRICT weightGradient, const T* RESTRICT delta, const T* RESTRICT x, const ConvolutionGeometry geometry, const unsigned nCols, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = outputHeight * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	
+	// one weight per thread, reduced over pixels and columns
 	CUDA_FOR_LOOP_PROLOGUE
-		const T sqrtX2 = __BentIdentityPrimeWorker__(x[i]);
-		z[i] = x[i] + static_cast<T>(0.5) * (sqrtX2 - static_cast<T>(1.0));
+		const unsigned f = i % geometry.nFilters;
+		const unsigned tap = i / geometry.nFilters;
+		const unsigned c = tap / (geometry.kernelSize * geometry.kernelSize);
+		const unsigned ky = (tap / geometry.kernelSize) % geometry.kernelSize;
+		const unsigned kx = tap % geometry.kernelSize;
+		
+		T sum = static_cast<T>(0.0);
+		for (unsigned j = 0; j < nCols; ++j)
+		{
+			const T* deltaPlane = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs() + f * outputPlane;
+			const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs() + c * inputPlane + ky * geometry.width + kx;
+			for (unsigned oy = 0; oy < outputHeight; ++oy)
+				for (unsigned ox = 0; ox < outputWidth; ++ox)
+					sum += deltaPlane[oy * outputWidth + ox] * xj[(oy * geometry.width + ox) * geometry.stride];
+		}
+		weightGradient[i] += sum;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __BentIdentityPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+GLOBAL void __ConvolutionBiasGradient__(T* RESTRICT biasGradient, const T* RESTRICT delta, const ConvolutionGeometry geometry, const unsigned nCols, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const unsigned outputPlane = geometry.GetOutputHeight() * geometry.GetOutputWidth();
+	
+	// one filter per thread
 	CUDA_FOR_LOOP_PROLOGUE
-		const T sqrtX2 = __BentIdentityPrimeWorker__(x[i]);
-		z[i] = static_cast<T>(1.0) + static_cast<T>(0.5) * x[i] / sqrtX2;
+		T sum = static_cast<T>(0.0);
+		for (unsigned j = 0; j < nCols; ++j)
+		{
+			const T* deltaPlane = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs() + i * outputPlane;
+			for (unsigned p = 0; p < outputPlane; ++p)
+				sum += deltaPlane[p];
+		}
+		biasGradient[i] += sum;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __SoftMax__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz)
+DEVICE unsigned __PoolingWindowArgMaxDeviceWorker__(const T* RESTRICT window, const unsigned width, const unsigned kernelSize)
+{
+	unsigned argMax = 0;
+	T max = window[0];
+	for (unsigned ky = 0; ky < kernelSize; ++ky)
+	{
+		for (unsigned kx = 0; kx < kernelSize; ++kx)
+		{
+			const unsigned offset = ky * width + kx;
+			if (window[offset] > max)
+			{
+				max = window[offset];
+				argMax = offset;
+			}
+		}
+	}
+	
+	return argMax;
+}
+
+template <typename T, PoolingType type>
+GLOBAL void __Pooling__(T* RESTRICT z, const T* RESTRICT x, const ConvolutionGeometry geometry, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = geometry.GetOutputHeight() * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	const T scale = static_cast<T>(1.0) / static_cast<T>(geometry.kernelSize * geometry.kernelSize);
+	
+	// one output pixel per thread
 	CUDA_FOR_LOOP_PROLOGUE
-		z[i] = exp(x[i]);  // normalised later on!
+		const unsigned j = i / geometry.GetNumberOfOutputs();
+		const unsigned r = i % geometry.GetNumberOfOutputs();
+		const unsigned c = r / outputPlane;
+		const unsigned oy = (r % outputPlane) / outputWidth;
+		const unsigned ox = r % outputWidth;
+		
+		const T* window = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs() + c * inputPlane + oy * geometry.stride * geometry.width + ox * geometry.stride;
+		if (type == PoolingType::Max)
+			z[i] = window[__PoolingWindowArgMaxDeviceWorker__<T>(window, geometry.width, geometry.kernelSize)];
+		else
+		{
+			T sum = static_cast<T>(0.0);
+			for (unsigned ky = 0; ky < geometry.kernelSize; ++ky)
+				for (unsigned kx = 0; kx < geometry.kernelSize; ++kx)
+					sum += window[ky * geometry.width + kx];
+			z[i] = scale * sum;
+		}
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
-template <typename T>
-GLOBAL void __CrossEntropyCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz)
+template <typename T, PoolingType type>
+GLOBAL void __PoolingInputGradient__(T* RESTRICT inputGradient, const T* RESTRICT delta, const T* RESTRICT x, const ConvolutionGeometry geometry, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	const unsigned outputHeight = geometry.GetOutputHeight();
+	const unsigned outputWidth = geometry.GetOutputWidth();
+	const unsigned outputPlane = outputHeight * outputWidth;
+	const unsigned inputPlane = geometry.height * geometry.width;
+	const T scale = static_cast<T>(1.0) / static_cast<T>(geometry.kernelSize * geometry.kernelSize);
+	
+	// one input pixel per thread, gathering from the windows that cover it
 	CUDA_FOR_LOOP_PROLOGUE
-		const T crossEntropy = -__CrossEntropyWorker__(y[i], x[i]) - __CrossEntropyWorker__(1.0 - y[i], 1.0 - x[i]);
-		if (!isfinite(crossEntropy))
-			x[i] = 0.0;
-		else
-			x[i] = crossEntropy;
+		const unsigned j = i / geometry.GetNumberOfInputs();
+		const unsigned r = i % geometry.GetNumberOfInputs();
+		const unsigned c = r / inputPlane;
+		const unsigned y = (r % inputPlane) / geometry.width;
+		const unsigned xx = r % geometry.width;
+		
+		const T* xj = x + static_cast<size_t>(j) * geometry.GetNumberOfInputs() + c * inputPlane;
+		const T* deltaJ = delta + static_cast<size_t>(j) * geometry.GetNumberOfOutputs() + c * outputPlane;
+		T sum = static_cast<T>(0.0);
+		for (unsigned ky = 0; ky < geometry.kernelSize && ky <= y; ++ky)
+		{
+			const unsigned oy = (y - ky) / geometry.stride;
+			if ((y - ky) % geometry.stride != 0 || oy >= outputHeight)
+				continue;
+			
+			for (unsigned kx = 0; kx < geometry.kernelSize && kx <= xx; ++kx)
+			{
+				const unsigned ox = (xx - kx) / geometry.stride;
+				if ((xx - kx) % geometry.stride != 0 || ox >= outputWidth)
+					continue;
+				
+				if (type == PoolingType::Max)
+				{
+					const T* window = xj + oy * geometry.stride * geometry.width + ox * geometry.stride;
+					if (__PoolingWindowArgMaxDeviceWorker__<T>(window, geometry.width, geometry.kernelSize) == ky * geometry.width + kx)
+						sum += deltaJ[oy * outputWidth + ox];
+				}
+				else
+					sum += scale * deltaJ[oy * outputWidth + ox];
+			}
+		}
+		inputGradient[i] = sum;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
 template <typename T>
-GLOBAL void __LogLikelihoodCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz)
+GLOBAL void __CsrMultiply__(T* RESTRICT z, const T* RESTRICT values, const int* RESTRICT columnIndices, const int* RESTRICT rowPointers, const T* RESTRICT x, const T* RESTRICT bias, const unsigned nRows, const unsigned nInput, const unsigned sz)
 {
 	CUDA_FUNCTION_PROLOGUE;
 	
+	// one output per thread: consecutive threads share the same column, and read the same rows of x
 	CUDA_FOR_LOOP_PROLOGUE
-		const T crossEntropy = -__CrossEntropyWorker__(y[i], x[i]);
-		if (!isfinite(crossEntropy))
-			x[i] = 0.0;
-		else
-			x[i] = crossEntropy;
+		const unsigned row = i % nRows;
+		const T* xj = x + static_cast<size_t>(i / nRows) * nInput;
+		
+		T sum = bias[row];
+		for (int p = rowPointers[row]; p < rowPointers[row + 1]; ++p)
+			sum += values[p] * xj[columnIndices[p]];
+		z[i] = sum;
 	CUDA_FOR_LOOP_EPILOGUE
 }
 
-
-static inline int RectifiedLinearUnitWorker(MemoryBuffer& z, const MemoryBuffer& x, const double alpha)
+template <typename T>
+static inline int ParameterUpdateNormsWorker(const MemoryBuffer& x, MemoryBuffer& firstState, MemoryBuffer& secondState, const MemoryBuffer& gradient, const ParameterUpdateSettings& settings, MemoryBuffer& normCache)
 {
-	switch (z.mathDomain)
+	#define CALL_PARAMETER_UPDATE_NORMS(TYPE)\
+		if (std::is_same<T, float>::value)\
+		{\
+			CUDA_CALL_SINGLE((__ParameterUpdateNorms__<T, TYPE>), (double*)normCache.pointer, (T*)x.pointer, (T*)firstState.pointer, (T*)secondState.pointer, (T*)gradient.pointer, settings, x.size);\
+		}\
+		else\
+		{\
+			CUDA_CALL_DOUBLE((__ParameterUpdateNorms__<T, TYPE>), (double*)normCache.pointer, (T*)x.pointer, (T*)firstState.pointer, (T*)secondState.pointer, (T*)gradient.pointer, settings, x.size);\
+		}
+	
+	switch (settings.type)
 	{
-		case MathDomain::Float:
-			CUDA_CALL_SINGLE(__RectifiedLinearUnit__<float>, (float*)z.pointer, (float*)x.pointer, (float)alpha, z.size);
+		case ParameterUpdateType::Lars:
+			CALL_PARAMETER_UPDATE_NORMS(ParameterUpdateType::Lars);
 			break;
-		case MathDomain::Double:
-			CUDA_CALL_DOUBLE(__RectifiedLinearUnit__<double>, (double*)z.pointer, (double*)x.pointer, (double)alpha, z.size);
+		case ParameterUpdateType::Lamb:
+			CALL_PARAMETER_UPDATE_NORMS(ParameterUpdateType::Lamb);
 			break;
 		default:
 			return CudaKernelException::_NotImplementedException;
 	}
+	
+	#undef CALL_PARAMETER_UPDATE_NORMS
+	
 	return cudaGetLastError();
 }
 
-static inline int RectifiedLinearUnitPrimeWorker(MemoryBuffer& z, const MemoryBuffer& x, const double alpha)
+template <typename T>
+static inline int UpdateParametersWorker(MemoryBuffer& x, MemoryBuffer& firstState, MemoryBuffer& secondState, const MemoryBuffer& gradient, const ParameterUpdateSettings& settings)
 {
-	switch (z.mathDomain)
+	#define CALL_UPDATE_PARAMETERS(TYPE)\
+		if (std::is_same<T, float>::value)\
+		{\
+			CUDA_CALL_SINGLE((__UpdateParameters__<T, TYPE>), (T*)x.pointer, (T*)firstState.pointer, (T*)secondState.pointer, (T*)gradient.pointer, settings, x.size);\
+		}\
+		else\
+		{\
+			CUDA_CALL_DOUBLE((__UpdateParameters__<T, TYPE>), (T*)x.pointer, (T*)firstState.pointer, (T*)secondState.pointer, (T*)gradient.pointer, settings, x.size);\
+		}
+	
+	switch (settings.type)
 	{
-		case MathDomain::Float:
-			CUDA_CALL_SINGLE(__RectifiedLinearUnitPrime__<float>, (float*)z.pointer, (float*)x.pointer, (float)alpha, z.size);
+		case ParameterUpdateType::GradientDescent:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::GradientDescent);
 			break;
-		case MathDomain::Double:
-			CUDA_CALL_DOUBLE(__RectifiedLinearUnitPrime__<double>, (double*)z.pointer, (double*)x.pointer, (double)alpha, z.size);
+		case ParameterUpdateType::Momentum:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::Momentum);
+			break;
+		case ParameterUpdateType::Nesterov:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::Nesterov);
+			break;
+		case ParameterUpdateType::RmsProp:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::RmsProp);
+			break;
+		case ParameterUpdateType::Adam:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::Adam);
+			break;
+		case ParameterUpdateType::Lars:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::Lars);
+			break;
+		case ParameterUpdateType::Lamb:
+			CALL_UPDATE_PARAMETERS(ParameterUpdateType::Lamb);
 			break;
 		default:
 			return CudaKernelException::_NotImplementedException;
 	}
+	
+	#undef CALL_UPDATE_PARAMETERS
+	
 	return cudaGetLastError();
 }
 
-EXTERN_C
+// one kernel per activation and per math domain, the functor being a template parameter
+template <typename Functor>
+static inline int ActivationWorker(MemoryBuffer& z, const MemoryBuffer& x)
 {
-	EXPORT int _Sigmoid(MemoryBuffer& z, const MemoryBuffer& x)
+	if (z.memorySpace == MemorySpace::Host)
 	{
 		switch (z.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__Sigmoid__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
+				__ActivationHost__<Functor, float>((float*)z.pointer, (float*)x.pointer, z.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__Sigmoid__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
+				__ActivationHost__<Functor, double>((double*)z.pointer, (double*)x.pointer, z.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
-		return cudaGetLastError();
+		return 0;
 	}
 	
-	EXPORT int _SigmoidPrime(MemoryBuffer& z, const MemoryBuffer& x, const MemoryBuffer& sigmoid)
+	// NB: layers apply their activation in place
+	const bool inPlace = z.pointer == x.pointer;
+	switch (z.mathDomain)
 	{
-		#ifdef REUSE_SIGMOID_OUTPUT
-			_ElementwiseProduct(z, sigmoid, sigmoid, -1.0);
-			_AddEqual(z, sigmoid);
-		#else
-			switch (z.mathDomain)
+		case MathDomain::Float:
+			if (inPlace)
 			{
-				case MathDomain::Float:
-					CUDA_CALL_SINGLE(__SigmoidPrime__<float>, (float*) z.pointer, (float*) x.pointer, z.size);
-					break;
-				case MathDomain::Double:
-					CUDA_CALL_DOUBLE(__SigmoidPrime__<double>, (double*) z.pointer, (double*) x.pointer, z.size);
-					break;
-				default:
-					return CudaKernelException::_NotImplementedException;
+				CUDA_CALL_SINGLE((__ActivationInPlace__<float, Functor>), (float*)z.pointer, z.size);
 			}
-		#endif
-		return cudaGetLastError();
+			else
+			{
+				CUDA_CALL_SINGLE((__Activation__<float, Functor>), (float*)z.pointer, (float*)x.pointer, z.size);
+			}
+			break;
+		case MathDomain::Double:
+			if (inPlace)
+			{
+				CUDA_CALL_DOUBLE((__ActivationInPlace__<double, Functor>), (double*)z.pointer, z.size);
+			}
+			else
+			{
+				CUDA_CALL_DOUBLE((__Activation__<double, Functor>), (double*)z.pointer, (double*)x.pointer, z.size);
+			}
+			break;
+		default:
+			return CudaKernelException::_NotImplementedException;
 	}
+	return cudaGetLastError();
+}
 
-	EXPORT int _HyperbolicTangent(MemoryBuffer& z, const MemoryBuffer& x)
+template <typename Functor>
+static inline int ActivationPrimeWorker(MemoryBuffer& z, const MemoryBuffer& x)
+{
+	if (z.memorySpace == MemorySpace::Host)
 	{
 		switch (z.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__HyperbolicTangent__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
+				__ActivationPrimeHost__<Functor, float>((float*)z.pointer, (float*)x.pointer, z.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__HyperbolicTangent__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
+				__ActivationPrimeHost__<Functor, double>((double*)z.pointer, (double*)x.pointer, z.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
-		return cudaGetLastError();
+		return 0;
 	}
 	
-	EXPORT int _HyperbolicTangentPrime(MemoryBuffer& z, const MemoryBuffer& x)
+	switch (z.mathDomain)
+	{
+		case MathDomain::Float:
+			CUDA_CALL_SINGLE((__ActivationPrime__<float, Functor>), (float*)z.pointer, (float*)x.pointer, z.size);
+			break;
+		case MathDomain::Double:
+			CUDA_CALL_DOUBLE((__ActivationPrime__<double, Functor>), (double*)z.pointer, (double*)x.pointer, z.size);
+			break;
+		default:
+			return CudaKernelException::_NotImplementedException;
+	}
+	return cudaGetLastError();
+}
+
+template <typename Functor>
+static inline int ActivationPrimeFromOutputWorker(MemoryBuffer& z, const MemoryBuffer& y)
+{
+	if (z.memorySpace == MemorySpace::Host)
 	{
 		switch (z.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__HyperbolicTangentPrime__<float>, (float*) z.pointer, (float*) x.pointer, z.size);
+				__ActivationPrimeFromOutputHost__<Functor, float>((float*)z.pointer, (float*)y.pointer, z.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__HyperbolicTangentPrime__<double>, (double*) z.pointer, (double*) x.pointer, z.size);
+				__ActivationPrimeFromOutputHost__<Functor, double>((double*)z.pointer, (double*)y.pointer, z.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
-		return cudaGetLastError();
+		return 0;
+	}
+	
+	switch (z.mathDomain)
+	{
+		case MathDomain::Float:
+			CUDA_CALL_SINGLE((__ActivationPrimeFromOutput__<float, Functor>), (float*)z.pointer, (float*)y.pointer, z.size);
+			break;
+		case MathDomain::Double:
+			CUDA_CALL_DOUBLE((__ActivationPrimeFromOutput__<double, Functor>), (double*)z.pointer, (double*)y.pointer, z.size);
+			break;
+		default:
+			return CudaKernelException::_NotImplementedException;
+	}
+	return cudaGetLastError();
+}
+
+EXTERN_C
+{
+	EXPORT int _Sigmoid(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationWorker<SigmoidFunctor>(z, x);
+	}
+	
+	EXPORT int _SigmoidPrime(MemoryBuffer& z, const MemoryBuffer& x, const MemoryBuffer& sigmoid)
+	{
+		#ifdef REUSE_SIGMOID_OUTPUT
+			return ActivationPrimeFromOutputWorker<SigmoidFunctor>(z, sigmoid);
+		#else
+			return ActivationPrimeWorker<SigmoidFunctor>(z, x);
+		#endif
+	}
+
+	EXPORT int _HyperbolicTangent(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationWorker<HyperbolicTangentFunctor>(z, x);
+	}
+	
+	EXPORT int _HyperbolicTangentPrime(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationPrimeWorker<HyperbolicTangentFunctor>(z, x);
 	}
 
 	EXPORT int _RectifiedLinearUnit(MemoryBuffer& z, const MemoryBuffer& x)
 	{
-		return RectifiedLinearUnitWorker(z, x, 0.0);
+		return ActivationWorker<RectifiedLinearUnitFunctor>(z, x);
 	}
 
 	EXPORT int _RectifiedLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x)
 	{
-		return RectifiedLinearUnitPrimeWorker(z, x, 0.0);
+		return ActivationPrimeWorker<RectifiedLinearUnitFunctor>(z, x);
 	}
 
 	EXPORT int _LeakyRectifiedLinearUnit(MemoryBuffer& z, const MemoryBuffer& x)
 	{
-		return RectifiedLinearUnitWorker(z, x, 0.01);
+		return ActivationWorker<LeakyRectifiedLinearUnitFunctor>(z, x);
 	}
 	
 	EXPORT int _LeakyRectifiedLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x)
 	{
-		return RectifiedLinearUnitPrimeWorker(z, x, 0.01);
+		return ActivationPrimeWorker<LeakyRectifiedLinearUnitFunctor>(z, x);
 	}
 
 	EXPORT int _InverseSquareRootLinearUnit(MemoryBuffer& z, const MemoryBuffer& x)
 	{
-		switch (z.mathDomain)
-		{
-			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__InverseSquareRootLinearUnit__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
-				break;
-			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__InverseSquareRootLinearUnit__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
-				break;
-			default:
-				return CudaKernelException::_NotImplementedException;
-		}
-		return cudaGetLastError();
+		return ActivationWorker<InverseSquareRootLinearUnitFunctor>(z, x);
 	}
-	
+
 	EXPORT int _InverseSquareRootLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x)
 	{
+		return ActivationPrimeWorker<InverseSquareRootLinearUnitFunctor>(z, x);
+	}
+
+	EXPORT int _ExponentialLinearUnit(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationWorker<ExponentialLinearUnitFunctor>(z, x);
+	}
+
+	EXPORT int _ExponentialLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationPrimeWorker<ExponentialLinearUnitFunctor>(z, x);
+	}
+
+	EXPORT int _BentIdentity(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationWorker<BentIdentityFunctor>(z, x);
+	}
+
+	EXPORT int _BentIdentityPrime(MemoryBuffer& z, const MemoryBuffer& x)
+	{
+		return ActivationPrimeWorker<BentIdentityFunctor>(z, x);
+	}
+
+	EXPORT int _SoftMax(MemoryTile& z, const MemoryTile& x, MemoryBuffer& columnWiseSumCache, MemoryBuffer& onesCache)
+	{
+		const bool inPlace = z.pointer == x.pointer;
 		switch (z.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__InverseSquareRootLinearUnitPrime__<float>, (float*) z.pointer, (float*) x.pointer, z.size);
+				if (inPlace)
+				{
+					CUDA_CALL_SINGLE(__SoftMaxInPlace__<float>, (float*)z.pointer, z.size);
+				}
+				else
+				{
+					CUDA_CALL_SINGLE(__SoftMax__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
+				}
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__InverseSquareRootLinearUnitPrime__<double>, (double*) z.pointer, (double*) x.pointer, z.size);
+				if (inPlace)
+				{
+					CUDA_CALL_DOUBLE(__SoftMaxInPlace__<double>, (double*)z.pointer, z.size);
+				}
+				else
+				{
+					CUDA_CALL_DOUBLE(__SoftMax__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
+				}
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
+		
+		if (columnWiseSumCache.size != z.nCols)
+		{
+			if (columnWiseSumCache.pointer != 0)
+				_Free(columnWiseSumCache);
+			columnWiseSumCache.pointer = 0;
+		}
+		
+		if (columnWiseSumCache.pointer == 0)
+		{
+			columnWiseSumCache = MemoryBuffer(0, z.nCols, z.memorySpace, z.mathDomain);
+			_Alloc(columnWiseSumCache);
+		}
+		
+		int err = _RowWiseSum(columnWiseSumCache, z, onesCache, MatrixOperation::Transpose);
+		if (err)
+			return err;
+		
+		err = _Reciprocal(columnWiseSumCache);
+		if (err)
+			return err;
+		
+		err = _ScaleColumns(z, columnWiseSumCache);
+		if (err)
+			return err;
+		
 		return cudaGetLastError();
 	}
 
-	EXPORT int _ExponentialLinearUnit(MemoryBuffer& z, const MemoryBuffer& x)
+	EXPORT int _CrossEntropyCostFunction(double& cost, MemoryBuffer& x, const MemoryBuffer& y)
 	{
-		switch (z.mathDomain)
+		switch (x.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__InverseSquareRootLinearUnit__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
+				CUDA_CALL_SINGLE(__CrossEntropyCostFunction__<float>, (float*)x.pointer, (float*)y.pointer, x.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__InverseSquareRootLinearUnit__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
+				CUDA_CALL_DOUBLE(__CrossEntropyCostFunction__<double>, (double*)x.pointer, (double*)y.pointer, x.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
+		
+		// now sum everything together
+		return _Sum(cost, x);
+	}
+
+	EXPORT int _LogLikelihoodCostFunction(double& cost, MemoryBuffer& x, const MemoryBuffer& y)
+	{
+		switch (x.mathDomain)
+		{
+			case MathDomain::Float:
+				CUDA_CALL_SINGLE(__LogLikelihoodCostFunction__<float>, (float*)x.pointer, (float*)y.pointer, x.size);
+				break;
+			case MathDomain::Double:
+				CUDA_CALL_DOUBLE(__LogLikelihoodCostFunction__<double>, (double*)x.pointer, (double*)y.pointer, x.size);
+				break;
+			default:
+				return CudaKernelException::_NotImplementedException;
+		}
+		
+		// now sum everything together
+		return _Sum(cost, x);
+	}
+
+	EXPORT int _ClassificationAccuracy(int& nCorrect, const MemoryTile& x, const MemoryTile& y, MemoryBuffer& counterCache)
+	{
+		nCorrect = 0;
+		if (x.memorySpace == MemorySpace::Host)
+		{
+			switch (x.mathDomain)
+			{
+				case MathDomain::Float:
+					nCorrect = __ClassificationAccuracyHost__<float>((float*)x.pointer, (float*)y.pointer, x.nRows, x.nCols);
+					break;
+				case MathDomain::Double:
+					nCorrect = __ClassificationAccuracyHost__<double>((double*)x.pointer, (double*)y.pointer, x.nRows, x.nCols);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
+		}
+		
+		if (counterCache.pointer == 0)
+		{
+			counterCache = MemoryBuffer(0, 1, x.memorySpace, MathDomain::Int);
+			_Alloc(counterCache);
+		}
+		
+		int err = cudaMemset((void*)counterCache.pointer, 0, sizeof(int));
+		if (err)
+			return err;
+		
+		switch (x.mathDomain)
+		{
+			case MathDomain::Float:
+				CUDA_CALL_SINGLE(__ClassificationAccuracy__<float>, (int*)counterCache.pointer, (float*)x.pointer, (float*)y.pointer, x.nRows, x.nCols);
+				break;
+			case MathDomain::Double:
+				CUDA_CALL_DOUBLE(__ClassificationAccuracy__<double>, (int*)counterCache.pointer, (double*)x.pointer, (double*)y.pointer, x.nRows, x.nCols);
+				break;
+			default:
+				return CudaKernelException::_NotImplementedException;
+		}
+		
+		err = cudaMemcpy(&nCorrect, (void*)counterCache.pointer, sizeof(int), cudaMemcpyDeviceToHost);
+		if (err)
+			return err;
+		
 		return cudaGetLastError();
 	}
-	
-	EXPORT int _ExponentialLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x)
+
+	EXPORT int _UpdateParameters(MemoryBuffer& x, MemoryBuffer& firstState, MemoryBuffer& secondState, const MemoryBuffer& gradient, const ParameterUpdateSettings& settings)
 	{
-		switch (z.mathDomain)
+		if (x.memorySpace == MemorySpace::Host)
+		{
+			switch (x.mathDomain)
+			{
+				case MathDomain::Float:
+					__ParameterUpdateHost__<float>((float*)x.pointer, (float*)firstState.pointer, (float*)secondState.pointer, (float*)gradient.pointer, x.size, settings);
+					break;
+				case MathDomain::Double:
+					__ParameterUpdateHost__<double>((double*)x.pointer, (double*)firstState.pointer, (double*)secondState.pointer, (double*)gradient.pointer, x.size, settings);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
+		}
+		
+		switch (x.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__InverseSquareRootLinearUnitPrime__<float>, (float*) z.pointer, (float*) x.pointer, z.size);
+				return UpdateParametersWorker<float>(x, firstState, secondState, gradient, settings);
+			case MathDomain::Double:
+				return UpdateParametersWorker<double>(x, firstState, secondState, gradient, settings);
+			default:
+				return CudaKernelException::_NotImplementedException;
+		}
+	}
+
+	EXPORT int _ParameterUpdateNorms(double& parameterNorm, double& updateNorm, const MemoryBuffer& x, MemoryBuffer& firstState, MemoryBuffer& secondState, const MemoryBuffer& gradient, const ParameterUpdateSettings& settings, MemoryBuffer& normCache)
+	{
+		if (x.memorySpace == MemorySpace::Host)
+		{
+			switch (x.mathDomain)
+			{
+				case MathDomain::Float:
+					__ParameterUpdateNormsHost__<float>(parameterNorm, updateNorm, (float*)x.pointer, (float*)firstState.pointer, (float*)secondState.pointer, (float*)gradient.pointer, x.size, settings);
+					break;
+				case MathDomain::Double:
+					__ParameterUpdateNormsHost__<double>(parameterNorm, updateNorm, (double*)x.pointer, (double*)firstState.pointer, (double*)secondState.pointer, (double*)gradient.pointer, x.size, settings);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
+		}
+		
+		if (normCache.pointer == 0)
+		{
+			normCache = MemoryBuffer(0, 2, x.memorySpace, MathDomain::Double);
+			_Alloc(normCache);
+		}
+		
+		int err = cudaMemset((void*)normCache.pointer, 0, 2 * sizeof(double));
+		if (err)
+			return err;
+		
+		switch (x.mathDomain)
+		{
+			case MathDomain::Float:
+				err = ParameterUpdateNormsWorker<float>(x, firstState, secondState, gradient, settings, normCache);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__InverseSquareRootLinearUnitPrime__<double>, (double*) z.pointer, (double*) x.pointer, z.size);
+				err = ParameterUpdateNormsWorker<double>(x, firstState, secondState, gradient, settings, normCache);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
+		if (err)
+			return err;
+		
+		double norms[2];
+		err = cudaMemcpy(norms, (void*)normCache.pointer, 2 * sizeof(double), cudaMemcpyDeviceToHost);
+		if (err)
+			return err;
+		
+		parameterNorm = sqrt(norms[0]);
+		updateNorm = sqrt(norms[1]);
+		
 		return cudaGetLastError();
 	}
 
-	EXPORT int _BentIdentity(MemoryBuffer& z, const MemoryBuffer& x)
+	EXPORT int _Convolution(MemoryTile& z, const MemoryTile& x, const MemoryTile& weight, const MemoryBuffer& bias, const ConvolutionGeometry& geometry)
 	{
+		if (z.memorySpace == MemorySpace::Host)
+		{
+			switch (z.mathDomain)
+			{
+				case MathDomain::Float:
+					__ConvolutionHost__<float>((float*)z.pointer, (float*)x.pointer, (float*)weight.pointer, (float*)bias.pointer, geometry, z.nCols);
+					break;
+				case MathDomain::Double:
+					__ConvolutionHost__<double>((double*)z.pointer, (double*)x.pointer, (double*)weight.pointer, (double*)bias.pointer, geometry, z.nCols);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
+		}
+		
 		switch (z.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__BentIdentity__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
+				CUDA_CALL_SINGLE(__Convolution__<float>, (float*)z.pointer, (float*)x.pointer, (float*)weight.pointer, (float*)bias.pointer, geometry, z.nCols * geometry.GetNumberOfFilterBlocks() * geometry.GetNumberOfPixels());
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__BentIdentity__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
+				CUDA_CALL_DOUBLE(__Convolution__<double>, (double*)z.pointer, (double*)x.pointer, (double*)weight.pointer, (double*)bias.pointer, geometry, z.nCols * geometry.GetNumberOfFilterBlocks() * geometry.GetNumberOfPixels());
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
+		
 		return cudaGetLastError();
 	}
 	
-	EXPORT int _BentIdentityPrime(MemoryBuffer& z, const MemoryBuffer& x)
+	EXPORT int _ConvolutionGradient(MemoryBuffer& biasGradient, MemoryTile& weightGradient, const MemoryTile& delta, const MemoryTile& x, const ConvolutionGeometry& geometry)
 	{
-		switch (z.mathDomain)
+		if (delta.memorySpace == MemorySpace::Host)
+		{
+			switch (delta.mathDomain)
+			{
+				case MathDomain::Float:
+					__ConvolutionGradientHost__<float>((float*)biasGradient.pointer, (float*)weightGradient.pointer, (float*)delta.pointer, (float*)x.pointer, geometry, delta.nCols);
+					break;
+				case MathDomain::Double:
+					__ConvolutionGradientHost__<double>((double*)biasGradient.pointer, (double*)weightGradient.pointer, (double*)delta.pointer, (double*)x.pointer, geometry, delta.nCols);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
+		}
+		
+		switch (delta.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__BentIdentityPrime__<float>, (float*) z.pointer, (float*) x.pointer, z.size);
+				CUDA_CALL_SINGLE(__ConvolutionWeightGradient__<float>, (float*)weightGradient.pointer, (float*)delta.pointer, (float*)x.pointer, geometry, delta.nCols, weightGradient.size);
+				CUDA_CALL_SINGLE(__ConvolutionBiasGradient__<float>, (float*)biasGradient.pointer, (float*)delta.pointer, geometry, delta.nCols, biasGradient.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__BentIdentityPrime__<double>, (double*) z.pointer, (double*) x.pointer, z.size);
+				CUDA_CALL_DOUBLE(__ConvolutionWeightGradient__<double>, (double*)weightGradient.pointer, (double*)delta.pointer, (double*)x.pointer, geometry, delta.nCols, weightGradient.size);
+				CUDA_CALL_DOUBLE(__ConvolutionBiasGradient__<double>, (double*)biasGradient.pointer, (double*)delta.pointer, geometry, delta.nCols, biasGradient.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
+		
 		return cudaGetLastError();
 	}
-
-	EXPORT int _SoftMax(MemoryTile& z, const MemoryTile& x, MemoryBuffer& columnWiseSumCache, MemoryBuffer& onesCache)
+	
+	EXPORT int _ConvolutionInputGradient(MemoryTile& inputGradient, const MemoryTile& delta, const MemoryTile& weight, const ConvolutionGeometry& geometry)
 	{
-		switch (z.mathDomain)
+		if (inputGradient.memorySpace == MemorySpace::Host)
+		{
+			switch (inputGradient.mathDomain)
+			{
+				case MathDomain::Float:
+					__ConvolutionInputGradientHost__<float>((float*)inputGradient.pointer, (float*)delta.pointer, (float*)weight.pointer, geometry, inputGradient.nCols);
+					break;
+				case MathDomain::Double:
+					__ConvolutionInputGradientHost__<double>((double*)inputGradient.pointer, (double*)delta.pointer, (double*)weight.pointer, geometry, inputGradient.nCols);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
+		}
+		
+		switch (inputGradient.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__SoftMax__<float>, (float*)z.pointer, (float*)x.pointer, z.size);
+				CUDA_CALL_SINGLE(__ConvolutionInputGradient__<float>, (float*)inputGradient.pointer, (float*)delta.pointer, (float*)weight.pointer, geometry, inputGradient.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__SoftMax__<double>, (double*)z.pointer, (double*)x.pointer, z.size);
+				CUDA_CALL_DOUBLE(__ConvolutionInputGradient__<double>, (double*)inputGradient.pointer, (double*)delta.pointer, (double*)weight.pointer, geometry, inputGradient.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
 		
-		if (columnWiseSumCache.size != z.nCols)
+		return cudaGetLastError();
+	}
+	
+	EXPORT int _Pooling(MemoryTile& z, const MemoryTile& x, const ConvolutionGeometry& geometry, const PoolingType type)
+	{
+		if (z.memorySpace == MemorySpace::Host)
 		{
-			if (columnWiseSumCache.pointer != 0)
-				_Free(columnWiseSumCache);
-			columnWiseSumCache.pointer = 0;
+			switch (z.mathDomain)
+			{
+				case MathDomain::Float:
+					__PoolingHost__<float>((float*)z.pointer, (float*)x.pointer, geometry, type, z.nCols);
+					break;
+				case MathDomain::Double:
+					__PoolingHost__<double>((double*)z.pointer, (double*)x.pointer, geometry, type, z.nCols);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
 		}
 		
-		if (columnWiseSumCache.pointer == 0)
+		#define CALL_POOLING(TYPE)\
+			switch (z.mathDomain)\
+			{\
+				case MathDomain::Float:\
+					CUDA_CALL_SINGLE((__Pooling__<float, TYPE>), (float*)z.pointer, (float*)x.pointer, geometry, z.size);\
+					break;\
+				case MathDomain::Double:\
+					CUDA_CALL_DOUBLE((__Pooling__<double, TYPE>), (double*)z.pointer, (double*)x.pointer, geometry, z.size);\
+					break;\
+				default:\
+					return CudaKernelException::_NotImplementedException;\
+			}
+		
+		if (type == PoolingType::Max)
+			CALL_POOLING(PoolingType::Max)
+		else
+			CALL_POOLING(PoolingType::Average)
+		
+		#undef CALL_POOLING
+		
+		return cudaGetLastError();
+	}
+	
+	EXPORT int _PoolingInputGradient(MemoryTile& inputGradient, const MemoryTile& delta, const MemoryTile& x, const ConvolutionGeometry& geometry, const PoolingType type)
+	{
+		if (inputGradient.memorySpace == MemorySpace::Host)
 		{
-			columnWiseSumCache = MemoryBuffer(0, z.nCols, z.memorySpace, z.mathDomain);
-			_Alloc(columnWiseSumCache);
+			switch (inputGradient.mathDomain)
+			{
+				case MathDomain::Float:
+					__PoolingInputGradientHost__<float>((float*)inputGradient.pointer, (float*)delta.pointer, (float*)x.pointer, geometry, type, inputGradient.nCols);
+					break;
+				case MathDomain::Double:
+					__PoolingInputGradientHost__<double>((double*)inputGradient.pointer, (double*)delta.pointer, (double*)x.pointer, geometry, type, inputGradient.nCols);
+					break;
+				default:
+					return CudaKernelException::_NotImplementedException;
+			}
+			return 0;
 		}
 		
-		int err = _RowWiseSum(columnWiseSumCache, z, onesCache, MatrixOperation::Transpose);
-		if (err)
-			return err;
+		#define CALL_POOLING_INPUT_GRADIENT(TYPE)\
+			switch (inputGradient.mathDomain)\
+			{\
+				case MathDomain::Float:\
+					CUDA_CALL_SINGLE((__PoolingInputGradient__<float, TYPE>), (float*)inputGradient.pointer, (float*)delta.pointer, (float*)x.pointer, geometry, inputGradient.size);\
+					break;\
+				case MathDomain::Double:\
+					CUDA_CALL_DOUBLE((__PoolingInputGradient__<double, TYPE>), (double*)inputGradient.pointer, (double*)delta.pointer, (double*)x.pointer, geometry, inputGradient.size);\
+					break;\
+				default:\
+					return CudaKernelException::_NotImplementedException;\
+			}
 		
-		err = _Reciprocal(columnWiseSumCache);
-		if (err)
-			return err;
+		if (type == PoolingType::Max)
+			CALL_POOLING_INPUT_GRADIENT(PoolingType::Max)
+		else
+			CALL_POOLING_INPUT_GRADIENT(PoolingType::Average)
 		
-		err = _ScaleColumns(z, columnWiseSumCache);
-		if (err)
-			return err;
+		#undef CALL_POOLING_INPUT_GRADIENT
 		
 		return cudaGetLastError();
 	}
-
-	EXPORT int _CrossEntropyCostFunction(double& cost, MemoryBuffer& x, const MemoryBuffer& y)
+	
+	EXPORT int _CsrMultiply(MemoryTile& z, const MemoryBuffer& values, const MemoryBuffer& columnIndices, const MemoryBuffer& rowPointers, const MemoryTile& x, const MemoryBuffer& bias)
 	{
-		switch (x.mathDomain)
+		switch (z.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__CrossEntropyCostFunction__<float>, (float*)x.pointer, (float*)y.pointer, x.size);
+				CUDA_CALL_SINGLE(__CsrMultiply__<float>, (float*)z.pointer, (float*)values.pointer, (int*)columnIndices.pointer, (int*)rowPointers.pointer, (float*)x.pointer, (float*)bias.pointer, z.nRows, x.nRows, z.size);
 				break;
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__CrossEntropyCostFunction__<double>, (double*)x.pointer, (double*)y.pointer, x.size);
+				CUDA_CALL_DOUBLE(__CsrMultiply__<double>, (double*)z.pointer, (double*)values.pointer, (int*)columnIndices.pointer, (int*)rowPointers.pointer, (double*)x.pointer, (double*)bias.pointer, z.nRows, x.nRows, z.size);
 				break;
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
 		
-		// now sum everything together
-		return _Sum(cost, x);
+		return cudaGetLastError();
 	}
-
-	EXPORT int _LogLikelihoodCostFunction(double& cost, MemoryBuffer& x, const MemoryBuffer& y)
+	
+	EXPORT int _BatchedMultiply(MemoryBuffer& c, const MemoryBuffer& a, const MemoryBuffer& b, const BatchedMultiplyGeometry& geometry)
 	{
-		switch (x.mathDomain)
+		const cublasOperation_t aOperation = geometry.transposeA ? CUBLAS_OP_T : CUBLAS_OP_N;
+		const cublasOperation_t bOperation = geometry.transposeB ? CUBLAS_OP_T : CUBLAS_OP_N;
+		const int lda = static_cast<int>(geometry.transposeA ? geometry.nInner : geometry.nRows);
+		const int ldb = static_cast<int>(geometry.transposeB ? geometry.nCols : geometry.nInner);
+		const int ldc = static_cast<int>(geometry.nRows);
+		
+		// NB: same handle as CudaLight's own products, so that they all share its stream and workspace
+		cublasStatus_t status = CUBLAS_STATUS_SUCCESS;
+		switch (c.mathDomain)
 		{
 			case MathDomain::Float:
-				CUDA_CALL_SINGLE(__LogLikelihoodCostFunction__<float>, (float*)x.pointer, (float*)y.pointer, x.size);
+			{
+				const float alpha = static_cast<float>(geometry.alpha);
+				const float beta = static_cast<float>(geometry.beta);
+				status = cublasSgemmStridedBatched(detail::CublasHandle(), aOperation, bOperation, static_cast<int>(geometry.nRows), static_cast<int>(geometry.nCols), static_cast<int>(geometry.nInner),
+				                                   &alpha, (float*)a.pointer, lda, geometry.aStride, (float*)b.pointer, ldb, geometry.bStride,
+				                                   &beta, (float*)c.pointer, ldc, geometry.cStride, static_cast<int>(geometry.nBatches));
 				break;
+			}
 			case MathDomain::Double:
-				CUDA_CALL_DOUBLE(__LogLikelihoodCostFunction__<double>, (double*)x.pointer, (double*)y.pointer, x.size);
+			{
+				const double alpha = geometry.alpha;
+				const double beta = geometry.beta;
+				status = cublasDgemmStridedBatched(detail::CublasHandle(), aOperation, bOperation, static_cast<int>(geometry.nRows), static_cast<int>(geometry.nCols), static_cast<int>(geometry.nInner),
+				                                   &alpha, (double*)a.pointer, lda, geometry.aStride, (double*)b.pointer, ldb, geometry.bStride,
+				                                   &beta, (double*)c.pointer, ldc, geometry.cStride, static_cast<int>(geometry.nBatches));
 				break;
+			}
 			default:
 				return CudaKernelException::_NotImplementedException;
 		}
 		
-		// now sum everything together
-		return _Sum(cost, x);
+		if (status != CUBLAS_STATUS_SUCCESS)
+			return CudaKernelException::_InternalException;
+		
+		return cudaGetLastError();
 	}
 }
\ No newline at end of file
@@ -3,9 +3,14 @@
 #include <Common.cuh>
 #include <Flags.cuh>
 #include <Types.h>
+#include <ParameterUpdate.h>
+#include <Convolution.h>
+#include <BatchedMultiply.h>
 
 EXTERN_C
 {
+	// NB: activations (and SoftMax) accept z == x, in which case they're applied in place
+	
 	/**
 	* Sigmoid(x) = 1.0 / (1.0 + e^(-x))
 	*/
@@ -107,7 +112,7 @@ EXTERN_C
 	}
 
 	/**
-	* IsrLu'(z) = \xi(z >= 0) * 1 + \xi(z < 0) * (z / (sqrt(1 + z^2)))^3
+	* IsrLu'(z) = \xi(z >= 0) * 1 + \xi(z < 0) * (1 / (sqrt(1 + z^2)))^3
 	*/
 	EXPORT int _InverseSquareRootLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x);
 	inline EXPORT int _InverseSquareRootLinearUnitPrimeRaw(const ptr_t z, const ptr_t x, const unsigned size, const MemorySpace memorySpace, const MathDomain mathDomain)
@@ -129,7 +134,7 @@ EXTERN_C
 	}
 	
 	/**
-	* ELU'(z) = \xi(z >= 0) * 1 + \xi(z < 0) * (z / (sqrt(1 + z^2)))^3
+	* ELU'(z) = \xi(z >= 0) * 1 + \xi(z < 0) * e^z
 	*/
 	EXPORT int _ExponentialLinearUnitPrime(MemoryBuffer& z, const MemoryBuffer& x);
 	inline EXPORT int _ExponentialLinearUnitPrimeRaw(const ptr_t z, const ptr_t x, const unsigned size, const MemorySpace memorySpace, const MathDomain mathDomain)
@@ -197,67 +202,123 @@ EXTERN_C
 		MemoryBuffer _y(y, size, memorySpace, mathDomain);
 		return LogLikelihoodCostFunction(cost, _x, _y);
 	}
-}
 
-template <typename T>
-DEVICE T __SigmoidWorker__(const T x);
+	/**
+	* #{j: argmax_i |x_ij| == argmax_i |y_ij|}
+	* argmax, comparison and count are done in a single pass. counterCache is a one-element Int buffer, allocated
+	* if empty, which is used as device accumulator: it can be reused across calls
+	*/
+	EXPORT int _ClassificationAccuracy(int& nCorrect, const MemoryTile& x, const MemoryTile& y, MemoryBuffer& counterCache);
+	inline EXPORT int _ClassificationAccuracyRaw(int& nCorrect, const ptr_t x, const ptr_t y, const unsigned nRows, const unsigned nCols, const MemorySpace memorySpace, const MathDomain mathDomain, const ptr_t cache = 0)
+	{
+		MemoryTile _x(x, nRows, nCols, memorySpace, mathDomain);
+		MemoryTile _y(y, nRows, nCols, memorySpace, mathDomain);
+		MemoryBuffer counterCache(cache, 1, memorySpace, MathDomain::Int);
+		return _ClassificationAccuracy(nCorrect, _x, _y, counterCache);
+	}
 
-template <typename T>
-DEVICE T __HyperbolicTangentWorker__(const T x);
+	/**
+	* x, state <- rule(x, state, gradientScale * gradient + decay * x), see ParameterUpdate.h
+	* NB: decay only applies to the first settings.decayedSize elements, and the state buffers not used by the rule can be empty
+	*/
+	EXPORT int _UpdateParameters(MemoryBuffer& x, MemoryBuffer& firstState, MemoryBuffer& secondState, const MemoryBuffer& gradient, const ParameterUpdateSettings& settings);
 
-template <typename T>
-DEVICE T __InverseSquareRootLinearUnitDenominatorWorker__(const T x);
+	/**
+	* |x| and |g| (LARS) or |x| and |r| (LAMB, which also updates its moments here), in a single pass.
+	* normCache is a two-element Double buffer, allocated if empty, used as device accumulator
+	*/
+	EXPORT int _ParameterUpdateNorms(double& parameterNorm, double& updateNorm, const MemoryBuffer& x, MemoryBuffer& firstState, MemoryBuffer& secondState, const MemoryBuffer& gradient, const ParameterUpdateSettings& settings, MemoryBuffer& normCache);
 
-template <typename T>
-DEVICE T __ExponentialLinearUnitPrimeWorker__(const T x);
+	/**
+	* z = conv(x, weight) + bias, one image per column, see Convolution.h for the layout
+	*/
+	EXPORT int _Convolution(MemoryTile& z, const MemoryTile& x, const MemoryTile& weight, const MemoryBuffer& bias, const ConvolutionGeometry& geometry);
 
-template <typename T>
-DEVICE T __BentIdentityPrimeWorker__(const T x);
+	/**
+	* biasGradient += dL/db, weightGradient += dL/dW, given delta = dL/dz and the layer input x
+	*/
+	EXPORT int _ConvolutionGradient(MemoryBuffer& biasGradient, MemoryTile& weightGradient, const MemoryTile& delta, const MemoryTile& x, const ConvolutionGeometry& geometry);
+
+	/**
+	* inputGradient = dL/dx, given delta = dL/dz
+	*/
+	EXPORT int _ConvolutionInputGradient(MemoryTile& inputGradient, const MemoryTile& delta, const MemoryTile& weight, const ConvolutionGeometry& geometry);
+
+	/**
+	* max or average over each kernelSize x kernelSize window, channel by channel (geometry.nFilters == geometry.nChannels)
+	*/
+	EXPORT int _Pooling(MemoryTile& z, const MemoryTile& x, const ConvolutionGeometry& geometry, const PoolingType type);
+
+	/**
+	* inputGradient = dL/dx, given delta = dL/dz and the pooling input x (max pooling recomputes its arg-max)
+	*/
+	EXPORT int _PoolingInputGradient(MemoryTile& inputGradient, const MemoryTile& delta, const MemoryTile& x, const ConvolutionGeometry& geometry, const PoolingType type);
+
+	/**
+	* z = A * x + bias, with A in compressed sparse row format: values and columnIndices (Int) have one element per
+	* nonzero, rowPointers (Int) has z.nRows + 1 elements
+	*/
+	EXPORT int _CsrMultiply(MemoryTile& z, const MemoryBuffer& values, const MemoryBuffer& columnIndices, const MemoryBuffer& rowPointers, const MemoryTile& x, const MemoryBuffer& bias);
+
+	/**
+	* c_k = alpha * op(a_k) * op(b_k) + beta * c_k for every k in the batch, see BatchedMultiply.h for the layout
+	*/
+	EXPORT int _BatchedMultiply(MemoryBuffer& c, const MemoryBuffer& a, const MemoryBuffer& b, const BatchedMultiplyGeometry& geometry);
+}
 
 template <typename T>
 DEVICE T __CrossEntropyWorker__(const T x, const T y);
 
-template <typename T>
-GLOBAL void __Sigmoid__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+template <typename T, typename Functor>
+GLOBAL void __Activation__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
 
-template <typename T>
-GLOBAL void __SigmoidPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+template <typename T, typename Functor>
+GLOBAL void __ActivationInPlace__(T* z, const unsigned sz);
 
-template <typename T>
-GLOBAL void __HyperbolicTangent__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+template <typename T, typename Functor>
+GLOBAL void __ActivationPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
 
-template <typename T>
-GLOBAL void __HyperbolicTangentPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+template <typename T, typename Functor>
+GLOBAL void __ActivationPrimeFromOutput__(T* RESTRICT z, const T* RESTRICT y, const unsigned sz);
 
 template <typename T>
-GLOBAL void __RectifiedLinearUnit__(T* RESTRICT z, const T* RESTRICT x, const T alpha, const unsigned sz);
+GLOBAL void __SoftMax__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
 
 template <typename T>
-GLOBAL void __RectifiedLinearUnitPrime__(T* RESTRICT z, const T* RESTRICT x, const T alpha, const unsigned sz);
+GLOBAL void __SoftMaxInPlace__(T* z, const unsigned sz);
 
 template <typename T>
-GLOBAL void __InverseSquareRootLinearUnit__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+GLOBAL void __CrossEntropyCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz);
 
 template <typename T>
-GLOBAL void __InverseSquareRootLinearUnitPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+GLOBAL void __LogLikelihoodCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz);
 
-template <typename T>
-GLOBAL void __ExponentialLinearUnit__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+template <typename T, ParameterUpdateType type>
+GLOBAL void __UpdateParameters__(T* RESTRICT x, T* RESTRICT firstState, T* RESTRICT secondState, const T* RESTRICT gradient, const ParameterUpdateSettings settings, const unsigned sz);
+
+template <typename T, ParameterUpdateType type>
+GLOBAL void __ParameterUpdateNorms__(double* RESTRICT norms, const T* RESTRICT x, T* RESTRICT firstState, T* RESTRICT secondState, const T* RESTRICT gradient, const ParameterUpdateSettings settings, const unsigned sz);
 
 template <typename T>
-GLOBAL void __ExponentialLinearUnitPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+GLOBAL void __ClassificationAccuracy__(int* RESTRICT nCorrect, const T* RESTRICT x, const T* RESTRICT y, const unsigned nRows, const unsigned nCols);
 
 template <typename T>
-GLOBAL void __BentIdentity__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+GLOBAL void __Convolution__(T* RESTRICT z, const T* RESTRICT x, const T* RESTRICT weight, const T* RESTRICT bias, const ConvolutionGeometry geometry, const unsigned sz);
 
 template <typename T>
-GLOBAL void __BentIdentityPrime__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+GLOBAL void __ConvolutionInputGradient__(T* RESTRICT inputGradient, const T* RESTRICT delta, const T* RESTRICT weight, const ConvolutionGeometry geometry, const unsigned sz);
 
 template <typename T>
-GLOBAL void __SoftMax__(T* RESTRICT z, const T* RESTRICT x, const unsigned sz);
+GLOBAL void __ConvolutionWeightGradient__(T* RESTRICT weightGradient, const T* RESTRICT delta, const T* RESTRICT x, const ConvolutionGeometry geometry, const unsigned nCols, const unsigned sz);
 
 template <typename T>
-GLOBAL void __CrossEntropyCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz);
+GLOBAL void __ConvolutionBiasGradient__(T* RESTRICT biasGradient, const T* RESTRICT delta, const ConvolutionGeometry geometry, const unsigned nCols, const unsigned sz);
+
+template <typename T, PoolingType type>
+GLOBAL void __Pooling__(T* RESTRICT z, const T* RESTRICT x, const ConvolutionGeometry geometry, const unsigned sz);
+
+template <typename T, PoolingType type>
+GLOBAL void __PoolingInputGradient__(T* RESTRICT inputGradient, const T* RESTRICT delta, const T* RESTRICT x, const ConvolutionGeometry geometry, const unsigned sz);
 
 template <typename T>
-GLOBAL void __LogLikelihoodCostFunction__(T* RESTRICT x, const T* RESTRICT y, const unsigned sz);
\ No newline at end of file
+GLOBAL void __CsrMultiply__(T* RESTRICT z, const T* RESTRICT values, const int* RESTRICT columnIndices, const int* RESTRICT rowPointers, const T* RESTRICT x, const T* RESTRICT bias, const unsigned nRows, const unsigned nInput, const unsigned sz);
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <limits>
+
+/**
+* Update rules applied by the fused parameter update kernel.
+* Every rule reads parameter, gradient and state and writes parameter and state back in a single pass.
+*/
+enum class ParameterUpdateType
+{
+	GradientDescent,
+	Momentum,
+	Nesterov,
+	RmsProp,
+	Adam,
+	
+	// layer-wise adaptive rate scaling: the step is scaled by a per-layer trust ratio, see GetTrustRatio
+	Lars,  // momentum
+	Lamb,  // Adam, with decoupled weight decay
+};
+
+/**
+* number of state buffers (with the same shape as the parameters) needed by each rule
+*/
+static inline unsigned GetNumberOfStateBuffers(const ParameterUpdateType type)
+{
+	switch (type)
+	{
+		case ParameterUpdateType::GradientDescent:
+			return 0;
+		case ParameterUpdateType::Momentum:
+		case ParameterUpdateType::Nesterov:
+		case ParameterUpdateType::RmsProp:
+		case ParameterUpdateType::Lars:
+			return 1;
+		case ParameterUpdateType::Adam:
+		case ParameterUpdateType::Lamb:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+static inline bool IsLayerWise(const ParameterUpdateType type)
+{
+	return type == ParameterUpdateType::Lars || type == ParameterUpdateType::Lamb;
+}
+
+/**
+* rule used for the parameters that don't get a trust ratio (i.e. the bias)
+*/
+static inline ParameterUpdateType GetNonLayerWiseType(const ParameterUpdateType type)
+{
+	switch (type)
+	{
+		case ParameterUpdateType::Lars:
+			return ParameterUpdateType::Momentum;
+		case ParameterUpdateType::Lamb:
+			return ParameterUpdateType::Adam;
+		default:
+			return type;
+	}
+}
+
+struct ParameterUpdateSettings
+{
+	ParameterUpdateType type = ParameterUpdateType::GradientDescent;
+	
+	double learningRate = 0.1;
+	
+	// g = gradientScale * gradient + decay * x, i.e. L2 regularisation is folded into the gradient
+	double gradientScale = 1.0;
+	double decay = 0.0;
+	
+	// decay only applies to x[0, decayedSize), e.g. to the weight region of a whole-network parameter buffer, as bias
+	// is not regularised
+	unsigned decayedSize = std::numeric_limits<unsigned>::max();
+	
+	// momentum, or Adam's first moment decay
+	double beta1 = 0.9;
+	
+	// RMSProp's and Adam's second moment decay
+	double beta2 = 0.999;
+	double epsilon = 1e-8;
+	
+	// Adam's bias corrections: 1 / (1 - beta^t)
+	double firstMomentCorrection = 1.0;
+	double secondMomentCorrection = 1.0;
+	
+	// LARS: eta in trustRatio = eta * |x| / (|g| + decay * |x|)
+	double trustCoefficient = 0.001;
+	
+	// per-layer step scaling, computed from the norms returned by the norm kernel
+	double trustRatio = 1.0;
+};
+
+/**
+* LARS: eta * |x| / (|g| + decay * |x|), LAMB: |x| / |r|. Falls back to 1 when either norm vanishes
+* NB: the norms are the ones computed by the norm kernel, where updateNorm is |g| for LARS and |r| for LAMB
+*/
+static inline double GetTrustRatio(const ParameterUpdateSettings& settings, const double parameterNorm, const double updateNorm)
+{
+	if (parameterNorm <= 0.0 || updateNorm <= 0.0)
+		return 1.0;
+	
+	switch (settings.type)
+	{
+		case ParameterUpdateType::Lars:
+			return settings.trustCoefficient * parameterNorm / (updateNorm + settings.decay * parameterNorm);
+		case ParameterUpdateType::Lamb:
+			return parameterNorm / updateNorm;
+		default:
+			return 1.0;
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 namespace nn
 {
 	enum class ActivationFunctionType
@@ -33,6 +35,8 @@ namespace nn
 	{
 		switch (type)
 		{
+			case ActivationFunctionType::Null:
+				return "Null";
 			case ActivationFunctionType::BentIdentity:
 				return "BentIdentity";
 			case ActivationFunctionType::ExponentialLinearUnity:
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <ActivationFunctors.h>
+#include <NeuralNetworks/Activations/ActivationFunctionType.h>
+
+namespace nn
+{
+	// compile-time mapping from the activation type to its element-wise functor
+	template<ActivationFunctionType type> struct ActivationFunctorTraits;
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::Null> { using Functor = IdentityFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::BentIdentity> { using Functor = BentIdentityFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::ExponentialLinearUnity> { using Functor = ExponentialLinearUnitFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::HyperbolicTangent> { using Functor = HyperbolicTangentFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::InverseSquareRootLinearUnit> { using Functor = InverseSquareRootLinearUnitFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::LeakyRectifiedLinearUnit> { using Functor = LeakyRectifiedLinearUnitFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::RectifiedLinearUnit> { using Functor = RectifiedLinearUnitFunctor; };
+	template<> struct ActivationFunctorTraits<ActivationFunctionType::Sigmoid> { using Functor = SigmoidFunctor; };
+	
+	template<ActivationFunctionType type>
+	using ActivationFunctor = typename ActivationFunctorTraits<type>::Functor;
+}
\ No newline at end of file
@@ -8,3 +8,4 @@
 #include <NeuralNetworks/Activations/ExponentialLinearUnitActivationFunction.h>
 #include <NeuralNetworks/Activations/BentIdentityActivationFunction.h>
 #include <NeuralNetworks/Activations/SoftMaxActivationFunction.h>
+#include <NeuralNetworks/Activations/ActivationFunctorTraits.h>
@@ -6,6 +6,8 @@
 
 namespace nn
 {
+	template<MathDomain mathDomain> class InferenceWorkspace;
+	
 	template<MathDomain mathDomain>
 	class IActivationFunction
 	{
@@ -17,6 +19,9 @@ namespace nn
 		
 		virtual ~IActivationFunction() = default;
 		virtual void Evaluate(Matrix& output, const Matrix& input) const noexcept = 0;
+		
+		// same as Evaluate, with the scratch (if any) taken from the workspace, as inferences may run concurrently
+		virtual void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>&) const noexcept { Evaluate(output, input); }
 		virtual void EvaluateGradient(Matrix& output, const Matrix& input, const Matrix& activation) const noexcept = 0;
 	};
 }
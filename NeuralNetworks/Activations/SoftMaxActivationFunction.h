@@ -2,6 +2,8 @@
 
 #include <NeuralNetworks/Activations/IActivationFunction.h>
 #include <NeuralNetworks/NeuralNetworksManager.h>
+#include <NeuralNetworks/Workspace.h>
+#include <NeuralNetworks/Memory/InferenceWorkspace.h>
 
 namespace nn
 {
@@ -12,21 +14,15 @@ namespace nn
 		constexpr ActivationFunctionType GetType() const noexcept override { return ActivationFunctionType::SoftMax; }
 		constexpr CostFunctionType GetBestCostFunction() const noexcept override { return CostFunctionType::LogLikelihood; }
 		
+		// NB: uses the function's own caches: concurrent inferences go through Infer, with their own workspace
 		void Evaluate(typename IActivationFunction<mathDomain>::Matrix& output, const typename IActivationFunction<mathDomain>::Matrix& input) const noexcept override
 		{
-			auto columnSumCacheIter = _columnSumCache.find(input.nCols());
-			if (columnSumCacheIter == _columnSumCache.end())
-				columnSumCacheIter = _columnSumCache.emplace(std::piecewise_construct,
-				                                   std::forward_as_tuple(input.nCols()),
-				                                   std::forward_as_tuple(Vector<mathDomain>(static_cast<unsigned>(input.nCols()), 0.0))).first;
-			
-			auto onesCacheIter = _onesCache.find(input.nCols());
-			if (onesCacheIter == _onesCache.end())
-				onesCacheIter = _onesCache.emplace(std::piecewise_construct,
-				                                   std::forward_as_tuple(input.nRows()),
-				                                   std::forward_as_tuple(Vector<mathDomain>(static_cast<unsigned>(input.nRows()), 1.0))).first;
-			
-			nn::detail::SoftMax(output.GetBuffer(), input.GetBuffer(), columnSumCacheIter->second.GetBuffer(), onesCacheIter->second.GetBuffer());
+			Apply(output, input, _columnSumCache.Get(input.nCols()), _onesCache.Get(input.nRows()));
+		}
+		
+		void Infer(typename IActivationFunction<mathDomain>::Matrix& output, const typename IActivationFunction<mathDomain>::Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept override
+		{
+			Apply(output, input, workspace.GetColumnScratch(input.nCols()), workspace.GetRowOnes(input.nRows()));
 		}
 		
 		void EvaluateGradient(typename IActivationFunction<mathDomain>::Matrix&, const typename IActivationFunction<mathDomain>::Matrix&, const typename IActivationFunction<mathDomain>::Matrix&) const noexcept override
@@ -35,7 +31,20 @@ namespace nn
 		}
 		
 	private:
-		mutable std::unordered_map<size_t, typename IActivationFunction<mathDomain>::Vector> _columnSumCache {};
-		mutable std::unordered_map<size_t, typename IActivationFunction<mathDomain>::Vector> _onesCache {};
+		static void Apply(typename IActivationFunction<mathDomain>::Matrix& output, const typename IActivationFunction<mathDomain>::Matrix& input,
+		                  typename IActivationFunction<mathDomain>::Vector& columnSums, typename IActivationFunction<mathDomain>::Vector& ones) noexcept
+		{
+			auto& columnSumCache = columnSums.GetBuffer();
+			const auto columnSumCachePointer = columnSumCache.pointer;
+			nn::detail::SoftMax(output.GetBuffer(), input.GetBuffer(), columnSumCache, ones.GetBuffer());
+			
+			// NB: the kernel reallocates its cache when the size doesn't match, which the workspace view should prevent
+			if (columnSumCache.pointer != columnSumCachePointer)
+				AllocationTracker::Instance().Record(columnSumCache);
+		}
+		
+	private:
+		mutable VectorWorkspace<mathDomain> _columnSumCache { 0, 0.0 };
+		mutable VectorWorkspace<mathDomain> _onesCache { 0, 1.0 };
 	};
 }
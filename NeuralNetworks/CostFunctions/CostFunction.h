@@ -15,11 +15,12 @@ namespace nn
 				const NetworkTopology<mathDomain>& topology,
 				const double lambda) const noexcept override
 		{
-			double cost = EvaluateWorker(modelOutput, expectedOutput);
-			cost /= modelOutput.nCols();
-			
-			const double weightCost = topology.EvaluateTotalWeightCost();
-			return cost + 0.5 * lambda * weightCost;
+			return this->EvaluateTotalCost(EvaluateWorker(modelOutput, expectedOutput), modelOutput.nCols(), topology, lambda);
+		}
+		
+		double EvaluateSum(typename ICostFunction<mathDomain>::Matrix& modelOutput, const typename ICostFunction<mathDomain>::Matrix& expectedOutput) const noexcept override
+		{
+			return EvaluateWorker(modelOutput, expectedOutput);
 		}
 	
 	protected:
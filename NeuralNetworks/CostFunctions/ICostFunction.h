@@ -18,6 +18,16 @@ namespace nn
 		virtual ~ICostFunction() = default;
 		virtual CostFunctionType GetType() const noexcept = 0;
 		virtual double Evaluate(Matrix& activations, const Matrix& expectedOutput, const NetworkTopology<mathDomain>& layers, const double lambda) const noexcept = 0;
+		
+		// un-normalised, un-regularised cost: it's additive over columns, so it can be accumulated chunk by chunk
+		virtual double EvaluateSum(Matrix& activations, const Matrix& expectedOutput) const noexcept = 0;
+		
+		// average cost plus L2 regularisation, given the sum of the costs over nSamples columns
+		double EvaluateTotalCost(const double costSum, const size_t nSamples, const NetworkTopology<mathDomain>& layers, const double lambda) const noexcept
+		{
+			const double weightCost = layers.EvaluateTotalWeightCost();
+			return costSum / static_cast<double>(nSamples) + 0.5 * lambda * weightCost;
+		}
 		virtual void EvaluateGradient(Matrix& expected, const Matrix& actual, const Matrix& activationDerivative) const noexcept = 0;
 	};
 }
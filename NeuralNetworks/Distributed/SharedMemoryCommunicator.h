@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nn
+{
+	// Collectives between the processes (ranks) of a job on the same host, over a POSIX shared memory segment: every
+	// rank owns a slot of capacity bytes, the others read it directly, and the only synchronisation is a per-rank
+	// step counter.
+	// AllReduce is a ring all-reduce: the data is split in nRanks chunks, and in nRanks - 1 steps every rank adds its
+	// predecessor's partial sum of one chunk to its own (reduce-scatter), after which it holds one fully reduced chunk;
+	// in nRanks - 1 more steps the reduced chunks are passed along the ring (all-gather). Every rank only ever waits for
+	// its two neighbours, and moves 2 (nRanks - 1) / nRanks of the data, whatever nRanks is.
+	// NB: every rank must open the same name (unique per job, e.g. with the launcher's pid in it) with the same nRanks
+	// and capacity, and call the collectives in the same order with the same sizes. The segment is unlinked by rank 0
+	// when it's destroyed
+	// NB: a rank that waits longer than timeout for the others (i.e. one of them died, or never started) aborts, rather
+	// than hanging the job
+	class SharedMemoryCommunicator
+	{
+		// each counter on its own cache line, so that spinning on a neighbour doesn't slow down its writes
+		struct alignas(64) Counter
+		{
+			std::atomic<uint64_t> value;
+		};
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory counters must be lock free");
+	
+	public:
+		SharedMemoryCommunicator(std::string name, const size_t rank, const size_t nRanks, const size_t capacity,
+		                         const std::chrono::milliseconds timeout = std::chrono::minutes(1)) noexcept
+			: _name(std::move(name)), _rank(rank), _nRanks(nRanks), _capacity(Align(capacity)), _timeout(timeout)
+		{
+			assert(nRanks > 0 && rank < nRanks);
+			
+			// [barrier count | barrier generation | step counters | slots]
+			const size_t headerSize = (2 + nRanks) * sizeof(Counter);
+			_size = headerSize + nRanks * _capacity;
+			
+			// NB: a newly created segment is zero filled, which is a valid initial state for every counter
+			const int fileDescriptor = shm_open(_name.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+			if (fileDescriptor < 0 || ftruncate(fileDescriptor, static_cast<off_t>(_size)) != 0)
+				Abort("shm_open");
+			
+			void* memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+			close(fileDescriptor);
+			if (memory == MAP_FAILED)
+				Abort("mmap");
+			
+			_memory = static_cast<char*>(memory);
+			_counters = reinterpret_cast<Counter*>(_memory);
+			_slots = _memory + headerSize;
+		}
+		
+		~SharedMemoryCommunicator()
+		{
+			// nobody may still be reading this rank's slot
+			Barrier();
+			
+			munmap(_memory, _size);
+			if (_rank == 0)
+				shm_unlink(_name.c_str());
+		}
+		
+		SharedMemoryCommunicator(const SharedMemoryCommunicator&) = delete;
+		SharedMemoryCommunicator& operator=(const SharedMemoryCommunicator&) = delete;
+		
+		inline size_t GetRank() const noexcept { return _rank; }
+		inline size_t GetNumberOfRanks() const noexcept { return _nRanks; }
+		inline size_t GetCapacity() const noexcept { return _capacity; }
+		
+		// data = sum of every rank's data, the same on every rank, bit by bit
+		// NB: more than capacity bytes are reduced a slot at a time
+		template<typename T>
+		void AllReduce(T* data, const size_t size) noexcept
+		{
+			if (_nRanks == 1)
+				return;
+			
+			const size_t slotSize = _capacity / sizeof(T);
+			assert(slotSize > 0);
+			for (size_t offset = 0; offset < size; offset += slotSize)
+				RingAllReduce(data + offset, std::min(slotSize, size - offset));
+		}
+		
+		// data = rank 0's data
+		template<typename T>
+		void Broadcast(T* data, const size_t size) noexcept
+		{
+			// NB: x + 0 is exactly x, so that it's an all-reduce with zeros everywhere else
+			if (_rank != 0)
+				std::fill(data, data + size, T(0));
+			AllReduce(data, size);
+		}
+		
+		void Barrier() noexcept
+		{
+			auto& count = _counters[0].value;
+			auto& generation = _counters[1].value;
+			
+			const uint64_t currentGeneration = generation.load(std::memory_order_acquire);
+			if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == _nRanks)
+			{
+				count.store(0, std::memory_order_relaxed);
+				generation.store(currentGeneration + 1, std::memory_order_release);
+				return;
+			}
+			
+			WaitUntil([&]() { return generation.load(std::memory_order_acquire) != currentGeneration; }, "the barrier");
+		}
+	
+	private:
+		template<typename T>
+		void RingAllReduce(T* data, const size_t size) noexcept
+		{
+			T* slot = GetSlot<T>(_rank);
+			const T* previousSlot = GetSlot<T>((_rank + _nRanks - 1) % _nRanks);
+			const size_t chunkSize = (size + _nRanks - 1) / _nRanks;
+			const auto getChunk = [&](const size_t c) { return std::make_pair(std::min(size, c * chunkSize), std::min(size, (c + 1) * chunkSize)); };
+			
+			// publish
+			WaitForNeighbours();
+			std::copy(data, data + size, slot);
+			CompleteStep();
+			
+			// reduce-scatter: at step s, chunk rank - 1 - s gets the predecessor's partial sum
+			for (size_t s = 0; s + 1 < _nRanks; ++s)
+			{
+				WaitForNeighbours();
+				const auto chunk = getChunk((_rank + 2 * _nRanks - 1 - s) % _nRanks);
+				for (size_t i = chunk.first; i < chunk.second; ++i)
+					slot[i] += previousSlot[i];
+				CompleteStep();
+			}
+			
+			// all-gather: now chunk rank + 1 is reduced, and at step s chunk rank - s comes from the predecessor
+			for (size_t s = 0; s + 1 < _nRanks; ++s)
+			{
+				WaitForNeighbours();
+				const auto chunk = getChunk((_rank + _nRanks - s) % _nRanks);
+				std::copy(previousSlot + chunk.first, previousSlot + chunk.second, slot + chunk.first);
+				CompleteStep();
+			}
+			
+			std::copy(slot, slot + size, data);
+		}
+		
+		static size_t Align(const size_t size) noexcept { return (size + sizeof(Counter) - 1) / sizeof(Counter) * sizeof(Counter); }
+		
+		static void Abort(const char* call) noexcept
+		{
+			std::cerr << "SharedMemoryCommunicator: " << call << " failed (" << std::strerror(errno) << ")" << std::endl;
+			std::abort();
+		}
+		
+		template<typename T>
+		inline T* GetSlot(const size_t rank) const noexcept { return reinterpret_cast<T*>(_slots + rank * _capacity); }
+		
+		inline std::atomic<uint64_t>& GetStep(const size_t rank) const noexcept { return _counters[2 + rank].value; }
+		
+		// the predecessor has produced what's read at this step, and the successor has consumed what's overwritten
+		// NB: steps are counted across calls, so that the publish of a call also waits for the end of the previous one
+		void WaitForNeighbours() const noexcept
+		{
+			const auto& previous = GetStep((_rank + _nRanks - 1) % _nRanks);
+			const auto& next = GetStep((_rank + 1) % _nRanks);
+			WaitUntil([&]() { return previous.load(std::memory_order_acquire) >= _step && next.load(std::memory_order_acquire) >= _step; }, "its neighbours");
+		}
+		
+		// spins until ready(), or aborts after the timeout
+		template<typename F>
+		void WaitUntil(F&& ready, const char* what) const noexcept
+		{
+			const auto deadline = std::chrono::steady_clock::now() + _timeout;
+			for (size_t i = 1; !ready(); ++i)
+			{
+				// NB: the clock is only read every so often, as the wait is usually short
+				if (i % 1024 == 0 && std::chrono::steady_clock::now() > deadline)
+				{
+					std::cerr << "SharedMemoryCommunicator: rank " << _rank << " timed out waiting for " << what << std::endl;
+					std::abort();
+				}
+				std::this_thread::yield();
+			}
+		}
+		
+		void CompleteStep() noexcept
+		{
+			GetStep(_rank).store(++_step, std::memory_order_release);
+		}
+	
+	private:
+		const std::string _name;
+		const size_t _rank;
+		const size_t _nRanks;
+		const size_t _capacity;
+		const std::chrono::milliseconds _timeout;
+		size_t _size = 0;
+		
+		char* _memory = nullptr;
+		Counter* _counters = nullptr;
+		char* _slots = nullptr;
+		uint64_t _step = 0;
+	};
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include <NeuralNetworks/Evaluators/ClassificationAccuracy.h>
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <NeuralNetworks/TrainingData.h>
+#include <NeuralNetworks/NeuralNetworksManager.h>
+#include <NeuralNetworks/Memory/AllocationTracker.h>
+
+#include <cassert>
+
+namespace nn
+{
+	// Counts the columns whose predicted class (i.e. the row with the largest output) matches the expected one.
+	// Argmax, comparison and count run in a single fused kernel, and the only scratch memory is a one-element
+	// counter which is reused across calls, regardless of the number of columns.
+	// The result is additive over columns, so it can be used as NetworkTrainingData::evaluator.
+	template<MathDomain mathDomain>
+	class ClassificationAccuracy
+	{
+	public:
+		ClassificationAccuracy() noexcept = default;
+		
+		// NB: copies don't share the counter, so that they can run concurrently: each one allocates its own on first use
+		ClassificationAccuracy(const ClassificationAccuracy&) noexcept
+		{
+		}
+		ClassificationAccuracy& operator=(const ClassificationAccuracy&) noexcept
+		{
+			return *this;
+		}
+		
+		~ClassificationAccuracy() noexcept
+		{
+			if (_counterCache.pointer != 0)
+				dm::detail::Free(_counterCache);
+		}
+		
+		double operator()(Matrix<mathDomain>& modelOutput, const Matrix<mathDomain>& expectedOutput) const noexcept
+		{
+			assert(modelOutput.nRows() == expectedOutput.nRows());
+			assert(modelOutput.nCols() == expectedOutput.nCols());
+			
+			// the counter is allocated by the first call
+			const bool isAllocated = _counterCache.pointer != 0;
+			int nCorrect = 0;
+			nn::detail::ClassificationAccuracy(nCorrect, modelOutput.GetBuffer(), expectedOutput.GetBuffer(), _counterCache);
+			if (!isAllocated && _counterCache.pointer != 0)
+				AllocationTracker::Instance().Record(_counterCache);
+			return static_cast<double>(nCorrect);
+		}
+	
+	private:
+		// owned by this instance: std::function copies the evaluator, and each copy gets its own
+		mutable MemoryBuffer _counterCache {};
+	};
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/TrainingData.h>
+#include <NeuralNetworks/Workspace.h>
+#include <NeuralNetworks/Profiler.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+#include <NeuralNetworks/Activations/ActivationFunctionFactory.h>
+#include <NeuralNetworks/CostFunctions/ICostFunction.h>
+#include <NeuralNetworks/Memory/InferenceWorkspace.h>
+#include <NeuralNetworks/Memory/ParameterBuffer.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nn
+{
+	enum class ExecutionMode
+	{
+		Inference,
+		Training
+	};
+	
+	enum class ExecutionStepType
+	{
+		LinearTransform,       // output = weight * input + bias
+		Activation,            // output = f(input)
+		ActivationGradient,    // output = f'(input), auxiliary being f(input)
+		CostFunctionGradient,  // output = dL/dy, overwriting the activation, auxiliary being f'(z)
+		BackPropagate,         // output = weight^T * input
+		HadamardProduct,       // output %= input
+		BiasGradient,          // biasGradient += input * ones
+		WeightGradient         // weightGradient += input \cdot auxiliary^T
+	};
+	
+	template<MathDomain mathDomain>
+	struct ExecutionStep
+	{
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		
+		ExecutionStepType type;
+		Matrix* output = nullptr;
+		const Matrix* input = nullptr;
+		const Matrix* auxiliary = nullptr;
+		const Matrix* weight = nullptr;
+		const Vector* bias = nullptr;
+		Vector* biasGradient = nullptr;
+		Matrix* weightGradient = nullptr;
+		const IActivationFunction<mathDomain>* activationFunction = nullptr;
+	};
+	
+	// Flat list of the kernel invocations of a forward (and, when training, backward) pass over a fixed number of
+	// columns. Every buffer is resolved once when the plan is built, so that replaying it doesn't go through the
+	// workspaces, the virtual layer interface, or the cost function checks.
+	// Only the input (and the expected output) change between replays: they're rebound at every call.
+	// NB: the plan borrows the buffers of the layers and of the workspaces: it must be rebuilt if they get reallocated
+	template<MathDomain mathDomain>
+	class ExecutionPlan
+	{
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		
+		// consecutive steps belonging to the same layer, timed as a whole
+		struct Stage
+		{
+			const char* name;
+			size_t layer;
+			size_t begin;
+			size_t end;
+			bool hasGradients = false; // the layer's parameter gradients are final once it's done
+		};
+	
+	public:
+		// the plan only knows about fully connected layers: other topologies go through the layers' own Evaluate
+		static bool IsSupported(const NetworkTopology<mathDomain>& topology) noexcept
+		{
+			if (topology.GetSize() < 2)
+				return false;
+			
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				const auto type = topology[l]->GetType();
+				if (type != LayerType::Dense && type != LayerType::SoftMax)
+					return false;
+				
+				// linear layers have no activation step
+				if (topology[l]->GetActivationFunctionType() == ActivationFunctionType::Null)
+					return false;
+				
+				// softmax is column-wise, and its gradient is only known together with the log-likelihood
+				if (topology[l]->GetActivationFunctionType() == ActivationFunctionType::SoftMax && l + 1 < topology.GetSize())
+					return false;
+			}
+			
+			return true;
+		}
+		
+		// training: forward pass with the activation gradients, and accumulation of the parameter gradients.
+		// deltas are the back-propagation buffers of the hidden layers (dL/dz_l)
+		ExecutionPlan(const NetworkTopology<mathDomain>& topology,
+		              const size_t nCols,
+		              const ICostFunction<mathDomain>& costFunction,
+		              ParameterBuffer<mathDomain>& gradients,
+		              std::vector<Workspace<mathDomain>>& deltas,
+		              VectorWorkspace<mathDomain>& ones) noexcept
+			: _mode(ExecutionMode::Training),
+			  _nCols(nCols),
+			  _input(detail::MakeMatrixView<mathDomain>(0, topology[0]->GetNumberOfInputs(), nCols)),
+			  _expectedOutput(detail::MakeMatrixView<mathDomain>(0, topology.back()->GetNumberOfOutputs(), nCols)),
+			  _ones(detail::MakeVectorView<mathDomain>(ones.Get(nCols).GetBuffer().pointer, nCols))
+		{
+			assert(IsSupported(topology));
+			
+			const size_t nLayers = topology.GetSize();
+			
+			// the last layer's gradient is not needed when it simplifies with the cost function's one
+			const bool needLastGradient = topology.back()->GetBestCostFunctionType() != costFunction.GetType();
+			
+			std::vector<Matrix*> activations(nLayers);
+			std::vector<Matrix*> activationGradients(nLayers);
+			for (size_t l = 0; l < nLayers; ++l)
+			{
+				auto& layer = *topology[l];
+				const size_t nRows = layer.GetNumberOfOutputs();
+				
+				Matrix* z = AddView(layer.GetWorkspace(LayerBufferType::Z).Get(nCols).GetBuffer().pointer, nRows);
+				activations[l] = AddView(layer.GetWorkspace(LayerBufferType::Activation).Get(nCols).GetBuffer().pointer, nRows);
+				const Matrix* layerInput = l == 0 ? &_input : activations[l - 1];
+				
+				const size_t begin = _steps.size();
+				AddLinearTransform(layer, *z, *layerInput);
+				AddActivation(layer, *activations[l], *z);
+				activationGradients[l] = AddView(layer.GetWorkspace(LayerBufferType::ActivationGradient).Get(nCols).GetBuffer().pointer, nRows);
+				if (l + 1 < nLayers || needLastGradient)
+				{
+					ExecutionStep<mathDomain> step { ExecutionStepType::ActivationGradient };
+					step.output = activationGradients[l];
+					step.input = z;
+					step.auxiliary = activations[l];
+					step.activationFunction = _activationFunctions.back().get();
+					_steps.push_back(step);
+				}
+				_stages.push_back({ "Forward", l, begin, _steps.size() });
+			}
+			
+			// dL/dz_L = dL/dy \outerdot f'(z_L), written over the last layer's activation
+			{
+				const size_t begin = _steps.size();
+				ExecutionStep<mathDomain> step { ExecutionStepType::CostFunctionGradient };
+				step.output = activations[nLayers - 1];
+				step.input = &_expectedOutput;
+				step.auxiliary = activationGradients[nLayers - 1];
+				_steps.push_back(step);
+				_costFunction = &costFunction;
+				
+				AddParameterGradients(gradients, nLayers - 1, *activations[nLayers - 1], *activations[nLayers - 2]);
+				_stages.push_back({ "Backward", nLayers - 1, begin, _steps.size(), true });
+			}
+			
+			// dL/dz_l = (W_{l + 1}^T * dL/dz_{l + 1}) \outerdot f'(z_l)
+			const Matrix* delta = activations[nLayers - 1];
+			for (size_t l = nLayers - 1; l-- > 0;)
+			{
+				const size_t begin = _steps.size();
+				Matrix* layerDelta = AddView(deltas[l].Get(nCols).GetBuffer().pointer, topology[l]->GetNumberOfOutputs());
+				
+				ExecutionStep<mathDomain> backPropagate { ExecutionStepType::BackPropagate };
+				backPropagate.output = layerDelta;
+				backPropagate.input = delta;
+				backPropagate.weight = &topology[l + 1]->GetWeight();
+				_steps.push_back(backPropagate);
+				
+				ExecutionStep<mathDomain> hadamardProduct { ExecutionStepType::HadamardProduct };
+				hadamardProduct.output = layerDelta;
+				hadamardProduct.input = activationGradients[l];
+				_steps.push_back(hadamardProduct);
+				
+				AddParameterGradients(gradients, l, *layerDelta, l == 0 ? _input : *activations[l - 1]);
+				_stages.push_back({ "Backward", l, begin, _steps.size(), true });
+				
+				delta = layerDelta;
+			}
+		}
+		
+		// inference: hidden layers ping-pong between the buffers of the workspace, the last one writes into the output
+		ExecutionPlan(const NetworkTopology<mathDomain>& topology, const size_t nCols, InferenceWorkspace<mathDomain>& workspace) noexcept
+			: _mode(ExecutionMode::Inference),
+			  _nCols(nCols),
+			  _input(detail::MakeMatrixView<mathDomain>(0, topology[0]->GetNumberOfInputs(), nCols)),
+			  _output(detail::MakeMatrixView<mathDomain>(0, topology.back()->GetNumberOfOutputs(), nCols)),
+			  _ones(detail::MakeVectorView<mathDomain>(workspace.GetOnes(nCols).GetBuffer().pointer, nCols))
+		{
+			assert(IsSupported(topology));
+			
+			const size_t nLayers = topology.GetSize();
+			const Matrix* layerInput = &_input;
+			for (size_t l = 0; l < nLayers; ++l)
+			{
+				auto& layer = *topology[l];
+				Matrix* layerOutput = &_output;
+				if (l + 1 < nLayers)
+					layerOutput = AddView(workspace.Get(l, layer.GetNumberOfOutputs(), nCols).GetBuffer().pointer, layer.GetNumberOfOutputs());
+				
+				// activations are element-wise (or column-wise), so they can be applied in place (see ObjectiveFunctions.cuh)
+				const size_t begin = _steps.size();
+				AddLinearTransform(layer, *layerOutput, *layerInput);
+				AddActivation(layer, *layerOutput, *layerOutput);
+				_stages.push_back({ "Forward", l, begin, _steps.size() });
+				
+				layerInput = layerOutput;
+			}
+		}
+		
+		ExecutionPlan(const ExecutionPlan&) = delete;
+		ExecutionPlan& operator=(const ExecutionPlan&) = delete;
+		
+		inline ExecutionMode GetMode() const noexcept { return _mode; }
+		inline size_t GetNumberOfColumns() const noexcept { return _nCols; }
+		inline size_t GetNumberOfSteps() const noexcept { return _steps.size(); }
+		
+		// accumulates into the gradients the contribution of these columns. If set, onGradientsReady(l) is called as
+		// soon as layer l's gradients are complete, last layer first (e.g. to start reducing them while the rest runs)
+		void Train(const Matrix& input, const Matrix& expectedOutput, const std::function<void(size_t)>& onGradientsReady = {}) noexcept
+		{
+			assert(_mode == ExecutionMode::Training);
+			assert(input.nCols() == _nCols);
+			
+			Rebind(_input, input);
+			Rebind(_expectedOutput, expectedOutput);
+			Replay(onGradientsReady);
+		}
+		
+		void Infer(Matrix& output, const Matrix& input) noexcept
+		{
+			assert(_mode == ExecutionMode::Inference);
+			assert(input.nCols() == _nCols);
+			
+			Rebind(_input, input);
+			Rebind(_output, output);
+			Replay();
+		}
+	
+	private:
+		Matrix* AddView(const std::ptrdiff_t pointer, const size_t nRows) noexcept
+		{
+			_views.emplace_back(std::make_unique<Matrix>(detail::MakeMatrixView<mathDomain>(pointer, nRows, _nCols)));
+			return _views.back().get();
+		}
+		
+		static void Rebind(Matrix& view, const Matrix& matrix) noexcept
+		{
+			const auto& buffer = matrix.GetBuffer();
+			if (view.GetBuffer().pointer != buffer.pointer)
+				view = detail::MakeMatrixView<mathDomain>(buffer.pointer, buffer.nRows, buffer.nCols);
+		}
+		
+		void AddLinearTransform(const ILayer<mathDomain>& layer, Matrix& output, const Matrix& input)
+		{
+			ExecutionStep<mathDomain> step { ExecutionStepType::LinearTransform };
+			step.output = &output;
+			step.input = &input;
+			step.weight = &layer.GetWeight();
+			step.bias = &layer.GetBias();
+			_steps.push_back(step);
+		}
+		
+		void AddActivation(const ILayer<mathDomain>& layer, Matrix& output, const Matrix& input)
+		{
+			// NB: every plan has its own activations, as some of them (i.e. softmax) have caches
+			_activationFunctions.emplace_back(ActivationFunctionFactory<mathDomain>::Create(layer.GetActivationFunctionType()));
+			
+			ExecutionStep<mathDomain> step { ExecutionStepType::Activation };
+			step.output = &output;
+			step.input = &input;
+			step.activationFunction = _activationFunctions.back().get();
+			_steps.push_back(step);
+		}
+		
+		void AddParameterGradients(ParameterBuffer<mathDomain>& gradients, const size_t l, const Matrix& delta, const Matrix& previousActivation)
+		{
+			ExecutionStep<mathDomain> biasGradient { ExecutionStepType::BiasGradient };
+			biasGradient.input = &delta;
+			biasGradient.biasGradient = &gradients.GetBias(l);
+			_steps.push_back(biasGradient);
+			
+			ExecutionStep<mathDomain> weightGradient { ExecutionStepType::WeightGradient };
+			weightGradient.input = &delta;
+			weightGradient.auxiliary = &previousActivation;
+			weightGradient.weightGradient = &gradients.GetWeight(l);
+			_steps.push_back(weightGradient);
+		}
+		
+		void Replay(const std::function<void(size_t)>& onGradientsReady = {}) noexcept
+		{
+			for (const auto& stage: _stages)
+			{
+				{
+					NN_PROFILE_SCOPE_INDEXED(stage.name, stage.layer);
+					for (size_t i = stage.begin; i < stage.end; ++i)
+						Execute(_steps[i]);
+				}
+				
+				if (stage.hasGradients && onGradientsReady)
+					onGradientsReady(stage.layer);
+			}
+		}
+		
+		void Execute(const ExecutionStep<mathDomain>& step) noexcept
+		{
+			switch (step.type)
+			{
+				case ExecutionStepType::LinearTransform:
+					step.weight->Multiply(*step.output, *step.input);
+					step.output->AddEqualBroadcast(*step.bias, _ones, false);
+					break;
+				case ExecutionStepType::Activation:
+					step.activationFunction->Evaluate(*step.output, *step.input);
+					break;
+				case ExecutionStepType::ActivationGradient:
+					step.activationFunction->EvaluateGradient(*step.output, *step.input, *step.auxiliary);
+					break;
+				case ExecutionStepType::CostFunctionGradient:
+					_costFunction->EvaluateGradient(*step.output, *step.input, *step.auxiliary);
+					break;
+				case ExecutionStepType::BackPropagate:
+					step.weight->Multiply(*step.output, *step.input, MatrixOperation::Transpose);
+					break;
+				case ExecutionStepType::HadamardProduct:
+					*step.output %= *step.input;
+					break;
+				case ExecutionStepType::BiasGradient:
+					step.input->Dot(*step.biasGradient, _ones, MatrixOperation::None, 1.0, 1.0);
+					break;
+				case ExecutionStepType::WeightGradient:
+					Tensor<mathDomain>::AccumulateKroneckerProduct(*step.weightGradient, *step.input, *step.auxiliary);
+					break;
+				default:
+					assert(false);
+					break;
+			}
+		}
+	
+	private:
+		ExecutionMode _mode;
+		size_t _nCols;
+		
+		std::vector<ExecutionStep<mathDomain>> _steps {};
+		std::vector<Stage> _stages {};
+		
+		// rebound at every call
+		Matrix _input;
+		Matrix _expectedOutput { detail::MakeMatrixView<mathDomain>(0, 0, 0) };
+		Matrix _output { detail::MakeMatrixView<mathDomain>(0, 0, 0) };
+		
+		Vector _ones;
+		std::vector<std::unique_ptr<Matrix>> _views {};
+		std::vector<std::unique_ptr<IActivationFunction<mathDomain>>> _activationFunctions {};
+		const ICostFunction<mathDomain>* _costFunction = nullptr;
+	};
+	
+	// plans for the few batch widths met in practice (e.g. the mini-batch, and the ragged last one), the least recently
+	// used one being dropped when full: every plan owns its views and activations, so they can't pile up with the widths
+	template<MathDomain mathDomain>
+	class ExecutionPlanCache
+	{
+	public:
+		explicit ExecutionPlanCache(const size_t capacity = 4) noexcept
+			: _capacity(capacity)
+		{
+			assert(capacity > 0);
+		}
+		
+		template<typename Factory>
+		ExecutionPlan<mathDomain>& Get(const size_t nCols, Factory&& factory)
+		{
+			// most recently used first
+			auto it = std::find_if(_plans.begin(), _plans.end(), [nCols](const auto& plan) { return plan->GetNumberOfColumns() == nCols; });
+			if (it != _plans.end())
+			{
+				std::rotate(_plans.begin(), it, it + 1);
+				return *_plans.front();
+			}
+			
+			if (_plans.size() == _capacity)
+				_plans.pop_back();
+			_plans.insert(_plans.begin(), factory());
+			return *_plans.front();
+		}
+		
+		inline size_t GetSize() const noexcept { return _plans.size(); }
+		void Clear() noexcept { _plans.clear(); }
+	
+	private:
+		size_t _capacity;
+		std::vector<std::unique_ptr<ExecutionPlan<mathDomain>>> _plans {};
+	};
+}
\ No newline at end of file
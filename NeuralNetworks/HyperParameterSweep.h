@@ -0,0 +1,206 @@
+#pragma once
+
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/CostFunctions/LogLikelihoodCostFunction.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nn
+{
+	// Trains several configurations (topology and hyper-parameters) concurrently, in-process, on a single copy of the
+	// training and validation data, with successive halving: every configuration is trained for nMinEpochs and scored
+	// on the validation data with the evaluator, then only the best 1/reductionFactor of them are trained further, for
+	// reductionFactor times as many epochs, and so on until a single one is left and it has run its nEpochs.
+	// Configurations are spread over nThreads threads, each of them training one network at a time.
+	// NB: the data is shared, so the optimizers must not shuffle it in place (the default one uses IdentityShuffler):
+	// shuffle it once before the sweep instead. Run rejects the optimizer factories that do
+	template<MathDomain mathDomain>
+	class HyperParameterSweep
+	{
+		using Metric = typename Network<mathDomain>::Metric;
+	
+	public:
+		using TopologyFactory = std::function<NetworkTopology<mathDomain>()>;
+		using OptimizerFactory = std::function<std::unique_ptr<IOptimizer<mathDomain>>(const NetworkTopology<mathDomain>&, const HyperParameters&)>;
+		
+		struct Configuration
+		{
+			std::string name;
+			HyperParameters hyperParameters;
+			TopologyFactory topologyFactory;
+		};
+		
+		struct Result
+		{
+			std::string name;
+			size_t nEpochs; // trained before being dropped (or in total, for the best one)
+			double score; // on the validation data, as a fraction of its samples
+		};
+		
+		HyperParameterSweep(const TrainingData<mathDomain>& trainingData,
+		                    const TrainingData<mathDomain>& validationData,
+		                    Metric evaluator,
+		                    OptimizerFactory optimizerFactory = MakeBatchedSgd) noexcept
+			: _trainingData(trainingData), _validationData(validationData), _optimizerFactory(std::move(optimizerFactory))
+		{
+			// a single evaluator is shared by every trial, and it may capture state by reference: serialise it across trials too
+			_evaluator = [this, evaluator = std::move(evaluator)](Matrix<mathDomain>& modelOutput, const Matrix<mathDomain>& expectedOutput)
+			{
+				std::lock_guard<std::mutex> lock(_evaluatorMutex);
+				return evaluator(modelOutput, expectedOutput);
+			};
+		}
+		
+		HyperParameterSweep(const HyperParameterSweep&) = delete;
+		HyperParameterSweep& operator=(const HyperParameterSweep&) = delete;
+		
+		void Add(Configuration configuration) noexcept
+		{
+			_configurations.emplace_back(std::move(configuration));
+		}
+		
+		// results are in the order the configurations were added, and empty if any of the optimizers shuffles the data
+		std::vector<Result> Run(const size_t nThreads, const size_t nMinEpochs = 1, const size_t reductionFactor = 3) noexcept
+		{
+			assert(nMinEpochs > 0);
+			assert(reductionFactor > 1);
+			
+			// NB: topologies are built up-front and serially, as the random initializers are not thread safe
+			_trials.clear();
+			for (const auto& configuration: _configurations)
+				_trials.emplace_back(std::make_unique<Trial>(configuration, *this));
+			
+			if (std::any_of(_trials.begin(), _trials.end(), [](const std::unique_ptr<Trial>& trial) { return trial->optimizer->IsShufflingTrainingData(); }))
+			{
+				_trials.clear();
+				return {};
+			}
+			
+			std::vector<Trial*> survivors;
+			for (auto& trial: _trials)
+				survivors.push_back(trial.get());
+			
+			for (size_t rungEpochs = nMinEpochs; !survivors.empty(); rungEpochs *= reductionFactor)
+			{
+				ForEach(survivors, nThreads, [&](Trial& trial) { trial.Train(std::min(rungEpochs, trial.data.hyperParameters.nEpochs)); });
+				
+				std::stable_sort(survivors.begin(), survivors.end(), [](const Trial* lhs, const Trial* rhs) { return lhs->score > rhs->score; });
+				const bool isCompleted = std::all_of(survivors.begin(), survivors.end(), [](const Trial* trial) { return trial->IsCompleted(); });
+				if (survivors.size() == 1 && isCompleted)
+					break;
+				
+				// when everyone has run out of epochs there's nothing left to learn from the next rung but the winner
+				const size_t nSurvivors = isCompleted ? 1 : std::max<size_t>(1, survivors.size() / reductionFactor);
+				survivors.resize(nSurvivors);
+			}
+			
+			_best = survivors.empty() ? 0 : GetIndex(*survivors.front());
+			
+			std::vector<Result> ret;
+			for (const auto& trial: _trials)
+				ret.push_back({ trial->name, trial->nEpochs, trial->score });
+			return ret;
+		}
+		
+		// after a non-empty Run: the configuration that survived every rung, and its trained network
+		inline size_t GetBest() const noexcept { return _best; }
+		inline const Network<mathDomain>& GetNetwork(const size_t i) const noexcept { return *_trials[i]->network; }
+		
+		static std::unique_ptr<IOptimizer<mathDomain>> MakeBatchedSgd(const NetworkTopology<mathDomain>& topology, const HyperParameters& hyperParameters)
+		{
+			return std::make_unique<BatchedSgd<mathDomain>>(topology, hyperParameters.miniBatchSize,
+			                                                std::make_unique<LogLikelihoodCostFunction<mathDomain>>(),
+			                                                std::make_unique<IdentityShuffler<mathDomain>>());
+		}
+	
+	private:
+		struct Trial
+		{
+			std::string name;
+			std::unique_ptr<Network<mathDomain>> network;
+			std::unique_ptr<IOptimizer<mathDomain>> optimizer;
+			NetworkTrainingData<mathDomain> data;
+			size_t nEpochs = 0;
+			double score = 0.0;
+			
+			// NB: NetworkTrainingData wants mutable data for the shufflers, but Run rejects the optimizers that shuffle before
+			// training any of them
+			Trial(const Configuration& configuration, HyperParameterSweep& sweep)
+				: name(configuration.name),
+				  network(std::make_unique<Network<mathDomain>>(configuration.topologyFactory())),
+				  optimizer(sweep._optimizerFactory(network->GetTopology(), configuration.hyperParameters)),
+				  data(const_cast<TrainingData<mathDomain>&>(sweep._trainingData),
+				       const_cast<TrainingData<mathDomain>&>(sweep._validationData),
+				       const_cast<TrainingData<mathDomain>&>(sweep._validationData),
+				       sweep._evaluator,
+				       configuration.hyperParameters)
+			{
+				// evaluations are already run concurrently across trials
+				data.nEvaluationThreads = 1;
+			}
+			
+			inline bool IsCompleted() const noexcept { return nEpochs >= data.hyperParameters.nEpochs; }
+			
+			// same epoch loop as Network::Train, with the early stop decided by the sweep
+			void Train(const size_t nTotalEpochs) noexcept
+			{
+				if (nEpochs >= nTotalEpochs)
+					return;
+				
+				for (; nEpochs < nTotalEpochs; ++nEpochs)
+					optimizer->Train(data);
+				
+				const double accuracy = network->Evaluate(data.validationData, data.evaluator, data.evaluationChunkSize, data.nEvaluationThreads);
+				score = accuracy / static_cast<double>(std::max<size_t>(1, data.validationData.GetNumberOfSamples()));
+			}
+		};
+		
+		size_t GetIndex(const Trial& trial) const noexcept
+		{
+			const auto it = std::find_if(_trials.begin(), _trials.end(), [&trial](const std::unique_ptr<Trial>& t) { return t.get() == &trial; });
+			return static_cast<size_t>(std::distance(_trials.begin(), it));
+		}
+		
+		// same work queue as Network::Evaluate
+		template<typename Worker>
+		static void ForEach(const std::vector<Trial*>& trials, const size_t nThreads, const Worker& worker) noexcept
+		{
+			const size_t actualThreads = std::max<size_t>(1, std::min(nThreads, trials.size()));
+			
+			std::atomic<size_t> nextTrial { 0 };
+			const auto threadWorker = [&]()
+			{
+				for (size_t i = nextTrial++; i < trials.size(); i = nextTrial++)
+					worker(*trials[i]);
+			};
+			
+			std::vector<std::thread> threads;
+			threads.reserve(actualThreads - 1);
+			for (size_t t = 1; t < actualThreads; ++t)
+				threads.emplace_back(threadWorker);
+			threadWorker();
+			for (auto& thread: threads)
+				thread.join();
+		}
+	
+	private:
+		const TrainingData<mathDomain>& _trainingData;
+		const TrainingData<mathDomain>& _validationData;
+		OptimizerFactory _optimizerFactory;
+		Metric _evaluator {};
+		std::mutex _evaluatorMutex {};
+		
+		std::vector<Configuration> _configurations {};
+		std::vector<std::unique_ptr<Trial>> _trials {};
+		size_t _best = 0;
+	};
+}
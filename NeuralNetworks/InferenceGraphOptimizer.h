@@ -0,0 +1,233 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+#include <NeuralNetworks/Layers/LayerFactory.h>
+#include <NeuralNetworks/Activations/ActivationFunctionFactory.h>
+#include <NeuralNetworks/Layers/Initializers/TrivialBiasWeightInitializer.h>
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace nn
+{
+	// feature-wise y = scale * (x - mean) / standardDeviation + shift: either the standardisation applied to the
+	// inputs, or a batch normalization with its running statistics (standardDeviation = sqrt(variance + epsilon))
+	// NB: empty scale and shift mean 1 and 0
+	struct FeatureNormalization
+	{
+		std::vector<double> mean {};
+		std::vector<double> standardDeviation {};
+		std::vector<double> scale {};
+		std::vector<double> shift {};
+		
+		inline size_t size() const noexcept { return mean.size(); }
+		
+		bool IsValid() const noexcept
+		{
+			return standardDeviation.size() == size() && (scale.empty() || scale.size() == size()) && (shift.empty() || shift.size() == size());
+		}
+		
+		// as y = slope * x + intercept
+		inline double GetSlope(const size_t i) const noexcept { return (scale.empty() ? 1.0 : scale[i]) / standardDeviation[i]; }
+		inline double GetIntercept(const size_t i) const noexcept { return (shift.empty() ? 0.0 : shift[i]) - GetSlope(i) * mean[i]; }
+	};
+	
+	// Rewrites a trained topology for serving, with the same outputs up to rounding but fewer passes over memory:
+	//  - the input normalization is folded into the first layer: W' = W diag(a), b' = b + W c
+	//  - the normalization of layer l's z (i.e. before the activation) is folded into it: W' = diag(a) W, b' = a b + c
+	//  - a linear layer (no activation) followed by a fully connected one is merged into a single GEMM:
+	//    W' = W_2 W_1, b' = W_2 b_1 + b_2, unless the merged weight is more expensive than the two it replaces (e.g. a
+	//    bottleneck)
+	// Only fully connected layers are rewritten, the other ones are copied as they are.
+	template<MathDomain mathDomain>
+	class InferenceGraphOptimizer
+	{
+		using Real = typename Traits<mathDomain>::stdType;
+		
+		// weight is column-major, as on the device
+		struct HostLayer
+		{
+			LayerType type;
+			ActivationFunctionType activationFunctionType;
+			size_t nInput;
+			size_t nOutput;
+			ConvolutionGeometry geometry;
+			size_t rank;
+			size_t nWeightRows;
+			std::vector<double> weight;
+			std::vector<double> bias;
+			
+			inline double& W(const size_t i, const size_t j) noexcept { return weight[i + j * nWeightRows]; }
+			inline double W(const size_t i, const size_t j) const noexcept { return weight[i + j * nWeightRows]; }
+		};
+	
+	public:
+		void SetInputNormalization(FeatureNormalization normalization) noexcept
+		{
+			_inputNormalization = std::move(normalization);
+		}
+		
+		// normalization of the l-th layer's z = W x + b, before its activation
+		void SetNormalization(const size_t l, FeatureNormalization normalization) noexcept
+		{
+			_normalizations[l] = std::move(normalization);
+		}
+		
+		// normalizations can only be folded into fully connected layers of the right size
+		bool IsSupported(const NetworkTopology<mathDomain>& topology) const noexcept
+		{
+			if (_inputNormalization.size() > 0)
+			{
+				if (!_inputNormalization.IsValid() || !IsFullyConnected(topology.front()->GetType()) || _inputNormalization.size() != topology.front()->GetNumberOfInputs())
+					return false;
+			}
+			
+			for (const auto& [l, normalization]: _normalizations)
+			{
+				if (l >= topology.GetSize() || !normalization.IsValid())
+					return false;
+				if (!IsFullyConnected(topology[l]->GetType()) || normalization.size() != topology[l]->GetNumberOfOutputs())
+					return false;
+			}
+			
+			return true;
+		}
+		
+		// nullptr if the normalizations don't fit the topology (see IsSupported)
+		std::unique_ptr<NetworkTopology<mathDomain>> Optimize(const NetworkTopology<mathDomain>& topology) const noexcept
+		{
+			if (!IsSupported(topology))
+				return nullptr;
+			
+			std::vector<HostLayer> layers;
+			for (const auto& layer: topology)
+				layers.emplace_back(ToHost(*layer));
+			
+			if (_inputNormalization.size() > 0)
+				FoldInputNormalization(layers.front(), _inputNormalization);
+			for (const auto& [l, normalization]: _normalizations)
+				FoldNormalization(layers[l], normalization);
+			
+			// a merged layer takes the activation of the second one, so it can be merged again only if that's linear too
+			std::vector<HostLayer> fusedLayers;
+			for (auto& layer: layers)
+			{
+				if (!fusedLayers.empty() && CanFuse(fusedLayers.back(), layer))
+					fusedLayers.back() = Fuse(fusedLayers.back(), layer);
+				else
+					fusedLayers.emplace_back(std::move(layer));
+			}
+			
+			return std::make_unique<NetworkTopology<mathDomain>>(ToDevice(fusedLayers));
+		}
+	
+	private:
+		static inline bool IsFullyConnected(const LayerType type) noexcept { return type == LayerType::Dense || type == LayerType::SoftMax; }
+		
+		static HostLayer ToHost(const ILayer<mathDomain>& layer) noexcept
+		{
+			const auto weight = layer.GetWeight().Get();
+			const auto bias = layer.GetBias().Get();
+			
+			return { layer.GetType(),
+			         layer.GetActivationFunctionType(),
+			         layer.GetNumberOfInputs(),
+			         layer.GetNumberOfOutputs(),
+			         layer.GetGeometry(),
+			         layer.GetRank(),
+			         layer.GetWeight().nRows(),
+			         std::vector<double>(weight.begin(), weight.end()),
+			         std::vector<double>(bias.begin(), bias.end()) };
+		}
+		
+		static NetworkTopology<mathDomain> ToDevice(const std::vector<HostLayer>& hostLayers) noexcept
+		{
+			std::vector<std::unique_ptr<ILayer<mathDomain>>> layers;
+			for (const auto& layer: hostLayers)
+			{
+				auto activationFunction = ActivationFunctionFactory<mathDomain>::Create(layer.activationFunctionType);
+				layers.emplace_back(LayerFactory<mathDomain>::CreateWithShape(layer.type, layer.nInput, layer.nOutput, layer.geometry, layer.rank,
+				                                                              std::move(activationFunction), std::move(TrivialBiasWeightInitializer<mathDomain>())));
+			}
+			
+			NetworkTopology<mathDomain> ret(std::move(layers));
+			auto& parameters = ret.GetParameters();
+			for (size_t l = 0; l < hostLayers.size(); ++l)
+			{
+				// NB: the layers without parameters have no block, and their placeholders don't need to be copied
+				if (!HasParameters(hostLayers[l].type))
+					continue;
+				
+				parameters.GetWeight(l).ReadFrom(std::vector<Real>(hostLayers[l].weight.begin(), hostLayers[l].weight.end()));
+				parameters.GetBias(l).ReadFrom(std::vector<Real>(hostLayers[l].bias.begin(), hostLayers[l].bias.end()));
+			}
+			
+			return ret;
+		}
+		
+		// W (a x + c) + b = (W diag(a)) x + (W c + b)
+		static void FoldInputNormalization(HostLayer& layer, const FeatureNormalization& normalization) noexcept
+		{
+			for (size_t j = 0; j < layer.nInput; ++j)
+			{
+				const double slope = normalization.GetSlope(j);
+				const double intercept = normalization.GetIntercept(j);
+				for (size_t i = 0; i < layer.nOutput; ++i)
+				{
+					layer.bias[i] += layer.W(i, j) * intercept;
+					layer.W(i, j) *= slope;
+				}
+			}
+		}
+		
+		// a (W x + b) + c = (diag(a) W) x + (a b + c)
+		static void FoldNormalization(HostLayer& layer, const FeatureNormalization& normalization) noexcept
+		{
+			for (size_t i = 0; i < layer.nOutput; ++i)
+			{
+				const double slope = normalization.GetSlope(i);
+				layer.bias[i] = slope * layer.bias[i] + normalization.GetIntercept(i);
+				for (size_t j = 0; j < layer.nInput; ++j)
+					layer.W(i, j) *= slope;
+			}
+		}
+		
+		static bool CanFuse(const HostLayer& first, const HostLayer& second) noexcept
+		{
+			if (!IsFullyConnected(first.type) || !IsFullyConnected(second.type))
+				return false;
+			if (first.activationFunctionType != ActivationFunctionType::Null)
+				return false;
+			
+			return second.nOutput * first.nInput <= first.nOutput * (first.nInput + second.nOutput);
+		}
+		
+		// W_2 (W_1 x + b_1) + b_2 = (W_2 W_1) x + (W_2 b_1 + b_2)
+		static HostLayer Fuse(const HostLayer& first, const HostLayer& second) noexcept
+		{
+			HostLayer ret { second.type, second.activationFunctionType, first.nInput, second.nOutput, ConvolutionGeometry(), 0, second.nOutput,
+			                std::vector<double>(second.nOutput * first.nInput, 0.0), second.bias };
+			
+			for (size_t k = 0; k < first.nOutput; ++k)
+			{
+				for (size_t i = 0; i < second.nOutput; ++i)
+					ret.bias[i] += second.W(i, k) * first.bias[k];
+				
+				for (size_t j = 0; j < first.nInput; ++j)
+				{
+					const double w = first.W(k, j);
+					for (size_t i = 0; i < second.nOutput; ++i)
+						ret.W(i, j) += second.W(i, k) * w;
+				}
+			}
+			
+			return ret;
+		}
+		
+		FeatureNormalization _inputNormalization {};
+		std::map<size_t, FeatureNormalization> _normalizations {};
+	};
+}
@@ -2,5 +2,8 @@
 
 #include <NeuralNetworks/Layers/DenseLayer.h>
 #include <NeuralNetworks/Layers/SoftMaxLayer.h>
+#include <NeuralNetworks/Layers/LowRankDenseLayer.h>
+#include <NeuralNetworks/Layers/Convolution2DLayer.h>
+#include <NeuralNetworks/Layers/Pool2DLayer.h>
 #include <NeuralNetworks/Layers/NetworkTopology.h>
 
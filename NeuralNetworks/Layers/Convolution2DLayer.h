@@ -0,0 +1,63 @@
+#pragma once
+
+#include <NeuralNetworks/Layers/Layer.h>
+
+namespace nn
+{
+	// "Valid" 2D convolution of images stored one per column (see Convolution.h), followed by an element-wise activation.
+	// Weight is (nFilters, nChannels * kernelSize^2) and bias has one element per filter: the kernels work directly on
+	// the images, without an im2col copy, so that a conv front-end is both smaller and cheaper than a dense one
+	template<MathDomain mathDomain>
+	class Convolution2DLayer final: public Layer<mathDomain>
+	{
+		using Matrix = typename Layer<mathDomain>::Matrix;
+		using Vector = typename Layer<mathDomain>::Vector;
+		using Weight = typename Layer<mathDomain>::Weight;
+		using Bias = typename Layer<mathDomain>::Bias;
+	
+	public:
+		Convolution2DLayer(const ConvolutionGeometry& geometry,
+		                   std::unique_ptr<IActivationFunction<mathDomain>>&& activationFunction,
+		                   IBiasWeightInitializer<mathDomain>&& initializer)
+			: Layer<mathDomain>(geometry.GetNumberOfInputs(), geometry.GetNumberOfOutputs(), geometry.nFilters, geometry.GetNumberOfTaps(),
+			                    std::move(activationFunction), std::move(initializer)),
+			  _geometry(geometry)
+		{
+			assert(geometry.IsValid());
+		}
+		
+		constexpr LayerType GetType() const noexcept override { return LayerType::Convolution2D; }
+		ConvolutionGeometry GetGeometry() const noexcept override { return _geometry; }
+		
+		void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept override
+		{
+			if (!this->_activationFunction)
+			{
+				nn::detail::Convolution(output.GetBuffer(), input.GetBuffer(), this->_weight.GetBuffer(), this->_bias.GetBuffer(), _geometry);
+				return;
+			}
+			
+			auto z = workspace.GetZScratch(output.nRows(), output.nCols());
+			nn::detail::Convolution(z.GetBuffer(), input.GetBuffer(), this->_weight.GetBuffer(), this->_bias.GetBuffer(), _geometry);
+			this->_activationFunction->Infer(output, z, workspace);
+		}
+		
+		void Evaluate(const Matrix& input, const bool needGradient, Matrix* const output) noexcept override
+		{
+			auto& zMatrix = this->_zMatrix.Get(input.nCols());
+			nn::detail::Convolution(zMatrix.GetBuffer(), input.GetBuffer(), this->_weight.GetBuffer(), this->_bias.GetBuffer(), _geometry);
+			this->Activate(zMatrix, needGradient, output);
+		}
+		
+		void BackPropagate(Matrix* const inputGradient, Bias& biasGradient, Weight& weightGradient,
+		                   const Matrix& delta, const Matrix& input, const Vector&) const noexcept override
+		{
+			nn::detail::ConvolutionGradient(biasGradient.GetBuffer(), weightGradient.GetBuffer(), delta.GetBuffer(), input.GetBuffer(), _geometry);
+			if (inputGradient)
+				nn::detail::ConvolutionInputGradient(inputGradient->GetBuffer(), delta.GetBuffer(), this->_weight.GetBuffer(), _geometry);
+		}
+	
+	private:
+		const ConvolutionGeometry _geometry;
+	};
+}
@@ -2,6 +2,8 @@
 
 #include <NeuralNetworks/Layers/Layer.h>
 
+#include <Tensor.h>
+
 namespace nn
 {
 	template<MathDomain mathDomain>
@@ -18,51 +20,51 @@ namespace nn
 		
 		constexpr LayerType GetType() const noexcept override { return LayerType::Dense; }
 		
-		void Evaluate(const typename Layer<mathDomain>::Matrix& input, const bool needGradient, typename Layer<mathDomain>::Matrix* const output) noexcept override
+		void Infer(typename Layer<mathDomain>::Matrix& output, const typename Layer<mathDomain>::Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept override
 		{
-			auto zMatrixIter = this->_zMatrix.find(input.nCols());
-			if (zMatrixIter == this->_zMatrix.end())
-				zMatrixIter = this->_zMatrix.emplace(std::piecewise_construct,
-				                                     std::forward_as_tuple(input.nCols()),
-				                                     std::forward_as_tuple(typename Layer<mathDomain>::Matrix(this->_weight.nRows(), input.nCols()))).first;
+			this->_weight.Multiply(output, input);
+			output.AddEqualBroadcast(this->_bias, workspace.GetOnes(input.nCols()), false);
 			
-			this->_weight.Multiply(zMatrixIter->second, input);
-			
-			auto onesCacheIter = _onesCache.find(input.nCols());
-			if (onesCacheIter == _onesCache.end())
-				onesCacheIter = _onesCache.emplace(std::piecewise_construct,
-						                           std::forward_as_tuple(input.nCols()),
-				                                   std::forward_as_tuple(typename Layer<mathDomain>::Vector(input.nCols(), 1.0))).first;
-			zMatrixIter->second.AddEqualBroadcast(this->_bias, onesCacheIter->second, false);
+			// activations are element-wise (or column-wise), so they can be applied in place (see ObjectiveFunctions.cuh)
+			if (this->_activationFunction)
+				this->_activationFunction->Infer(output, output, workspace);
+		}
+		
+		void Reserve(const size_t capacity) noexcept override
+		{
+			Layer<mathDomain>::Reserve(capacity);
+			_onesCache.Reserve(capacity);
+		}
+		
+		void Evaluate(const typename Layer<mathDomain>::Matrix& input, const bool needGradient, typename Layer<mathDomain>::Matrix* const output) noexcept override
+		{
+			auto& zMatrix = this->_zMatrix.Get(input.nCols());
+			this->_weight.Multiply(zMatrix, input);
+			zMatrix.AddEqualBroadcast(this->_bias, _onesCache.Get(input.nCols()), false);
 			
 			// if output is not provided, use the activation buffers, and compute the gradient as well!
-			if (!output)
-			{
-				auto activationIter = this->_batchedActivation.find(input.nCols());
-				if (activationIter == this->_batchedActivation.end())
-					activationIter = this->_batchedActivation.emplace(std::piecewise_construct,
-					                                                  std::forward_as_tuple(input.nCols()),
-					                                                  std::forward_as_tuple(typename Layer<mathDomain>::Matrix(zMatrixIter->second.nRows(), zMatrixIter->second.nCols()))).first;
-				this->_lastActivation = &activationIter->second;
-				
-				assert(activationIter->second.size() == zMatrixIter->second.size());
-				this->_activationFunction->Evaluate(activationIter->second, zMatrixIter->second);
-				
-				// still need to retrieve the cache, even though gradient is not needed
-				auto activationGradientIter = this->_batchedActivationGradient.find(input.nCols());
-				if (activationGradientIter == this->_batchedActivationGradient.end())
-					activationGradientIter = this->_batchedActivationGradient.emplace(std::piecewise_construct,
-					                                                                  std::forward_as_tuple(input.nCols()),
-					                                                                  std::forward_as_tuple(typename Layer<mathDomain>::Matrix(zMatrixIter->second.nRows(), zMatrixIter->second.nCols()))).first;
-				this->_lastActivationGradient = &activationGradientIter->second;
-				if (needGradient)
-					this->_activationFunction->EvaluateGradient(activationGradientIter->second, zMatrixIter->second, activationIter->second);
-			}
-			else
-				this->_activationFunction->Evaluate(*output, zMatrixIter->second);
+			this->Activate(zMatrix, needGradient, output);
 		}
 		
+		void BackPropagate(typename Layer<mathDomain>::Matrix* const inputGradient,
+		                   typename Layer<mathDomain>::Bias& biasGradient,
+		                   typename Layer<mathDomain>::Weight& weightGradient,
+		                   const typename Layer<mathDomain>::Matrix& delta,
+		                   const typename Layer<mathDomain>::Matrix& input,
+		                   const typename Layer<mathDomain>::Vector& ones) const noexcept override
+		{
+			// dL/db += delta, summed over the columns
+			delta.Dot(biasGradient, ones, MatrixOperation::None, 1.0, 1.0);
+			
+			// dL/dW += delta \cdot input
+			cl::Tensor<MemorySpace::Device, mathDomain>::AccumulateKroneckerProduct(weightGradient, delta, input);
+			
+			// dL/d(input) = W^T * delta
+			if (inputGradient)
+				this->_weight.Multiply(*inputGradient, delta, MatrixOperation::Transpose);
+		}
+	
 	private:
-		std::unordered_map<size_t, typename ILayer<mathDomain>::Vector> _onesCache {};
+		VectorWorkspace<mathDomain> _onesCache { 0, 1.0 };
 	};
 }
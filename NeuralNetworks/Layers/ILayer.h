@@ -4,6 +4,10 @@
 #include <NeuralNetworks/Layers/LayerType.h>
 #include <NeuralNetworks/ISerializable.h>
 #include <NeuralNetworks/CostFunctions/CostFunctionType.h>
+#include <NeuralNetworks/Activations/ActivationFunctionType.h>
+#include <NeuralNetworks/Memory/LayerBufferType.h>
+#include <NeuralNetworks/Workspace.h>
+#include <NeuralNetworks/Memory/InferenceWorkspace.h>
 
 namespace nn
 {
@@ -25,6 +29,16 @@ namespace nn
 		
 		virtual void Evaluate(const Matrix& input, const bool needGradient, Matrix* const output = nullptr) noexcept = 0;
 		
+		// inference only: doesn't touch the cached activations, and doesn't compute any derivative. Any scratch comes
+		// from the workspace, so that concurrent inferences (one workspace each) don't share buffers
+		virtual void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept = 0;
+		
+		// back-propagation, given delta = dL/dz of the last Evaluate (i.e. already multiplied by f'(z)) and its input:
+		// accumulates dL/db and dL/dW, and writes dL/d(input) into inputGradient, unless it's null
+		// NB: dL/d(input) is not multiplied by the previous layer's f'
+		virtual void BackPropagate(Matrix* const inputGradient, Bias& biasGradient, Weight& weightGradient,
+		                           const Matrix& delta, const Matrix& input, const Vector& ones) const noexcept = 0;
+		
 		virtual void Update(const typename ILayer<mathDomain>::Bias& biasGradient,
 		                    const typename ILayer<mathDomain>::Weight& weightGradient,
 		                    const double averageLearningRate,
@@ -38,6 +52,23 @@ namespace nn
 		virtual const Matrix& GetActivationGradient() const noexcept = 0;
 		virtual const Weight& GetWeight() const noexcept = 0;
 		virtual const Bias& GetBias() const noexcept = 0;
+		virtual ActivationFunctionType GetActivationFunctionType() const noexcept = 0;
+		
+		// image shape of the spatial layers (see IsSpatial), empty for the others
+		virtual ConvolutionGeometry GetGeometry() const noexcept { return ConvolutionGeometry(); }
+		
+		// rank of the factorised layers (see IsFactorized), 0 for the others
+		virtual size_t GetRank() const noexcept { return 0; }
+		
+		// copy weight and bias from a layer with the same shape, without reallocating
+		virtual void ReadParametersFrom(const ILayer& rhs) noexcept = 0;
+		
+		// move weight and bias into externally owned memory (see ParameterBuffer), preserving their values
+		virtual void BindParameters(const std::ptrdiff_t weightPointer, const std::ptrdiff_t biasPointer) noexcept = 0;
+		
+		// pre-allocate the buffers for batches up to capacity columns
+		virtual void Reserve(const size_t capacity) noexcept = 0;
+		virtual Workspace<mathDomain>& GetWorkspace(const LayerBufferType type) noexcept = 0;
 		
 		// reset cached quantities
 		virtual void Reset() const noexcept {}
@@ -4,6 +4,8 @@
 #include <NeuralNetworks/Layers/ILayer.h>
 #include <NeuralNetworks/Activations/IActivationFunction.h>
 #include <NeuralNetworks/ISerializable.h>
+#include <NeuralNetworks/Workspace.h>
+#include <NeuralNetworks/NeuralNetworksManager.h>
 
 #include <sys/types.h>
 #include <unistd.h>
@@ -18,22 +20,42 @@ namespace nn
 			  const unsigned nOutput,
 			  std::unique_ptr<IActivationFunction<mathDomain>>&& activationFunction,
 			  IBiasWeightInitializer<mathDomain>&& initializer)
+			: Layer(nInput, nOutput, nOutput, nInput, std::move(activationFunction), std::move(initializer))
+		{
+		}
+		Layer(const Layer&) = delete;
+		Layer& operator=(const Layer&) = delete;
+		
+	protected:
+		// weight is (nWeightRows, nWeightColumns) and bias has nWeightRows elements, e.g. one per filter for a convolution
+		Layer(const unsigned nInput,
+			  const unsigned nOutput,
+			  const unsigned nWeightRows,
+			  const unsigned nWeightColumns,
+			  std::unique_ptr<IActivationFunction<mathDomain>>&& activationFunction,
+			  IBiasWeightInitializer<mathDomain>&& initializer)
 			: ILayer<mathDomain>(),
 			  
 			  _nInput(nInput),
 			  _nOutput(nOutput),
 			  
-			  _bias(nOutput, 0.0),
-			  _weight(nOutput, nInput, 0.0),
+			  _bias(nWeightRows, 0.0),
+			  _weight(nWeightRows, nWeightColumns, 0.0),
+			  
+			  _zMatrix(nOutput),
+			  _batchedActivation(nOutput),
+			  _batchedActivationGradient(nOutput),
 			
 			  _activationFunction(std::move(activationFunction))
 		{
 			initializer.Set(_bias);
 			initializer.Set(_weight);
+			
+			AllocationTracker::Instance().Record(_bias.GetBuffer());
+			AllocationTracker::Instance().Record(_weight.GetBuffer());
 		}
-        Layer(const Layer&) = delete;
-        Layer& operator=(const Layer&) = delete;
 		
+	public:
 		std::ostream& operator <<(std::ostream& stream) const noexcept override
 		{
 			const char* dataPath = getenv("DATA_PATH");
@@ -43,7 +65,11 @@ namespace nn
 			stream << ToString(this->GetType()) << std::endl;
 			stream << _nInput << std::endl;
 			stream << _nOutput << std::endl;
-			stream << ToString(this->_activationFunction->GetType()) << std::endl;
+			stream << ToString(GetActivationFunctionType()) << std::endl;
+			if (IsSpatial(this->GetType()))
+				stream << ToString(this->GetGeometry()) << std::endl;
+			if (IsFactorized(this->GetType()))
+				stream << this->GetRank() << std::endl;
 			
 			const std::string pidStr = std::to_string(getpid());
 			
@@ -84,6 +110,29 @@ namespace nn
 		inline size_t GetNumberOfInputs() const noexcept override final { return _nInput; }
 		inline size_t GetNumberOfOutputs() const noexcept override final { return _nOutput; }
 		
+		void Reserve(const size_t capacity) noexcept override
+		{
+			_zMatrix.Reserve(capacity);
+			_batchedActivation.Reserve(capacity);
+			_batchedActivationGradient.Reserve(capacity);
+		}
+		
+		Workspace<mathDomain>& GetWorkspace(const LayerBufferType type) noexcept override final
+		{
+			switch (type)
+			{
+				case LayerBufferType::Z:
+					return _zMatrix;
+				case LayerBufferType::Activation:
+					return _batchedActivation;
+				case LayerBufferType::ActivationGradient:
+					return _batchedActivationGradient;
+				default:
+					assert(false);
+					return _zMatrix;
+			}
+		}
+		
 		void Update(const typename ILayer<mathDomain>::Bias& biasGradient,
 		            const typename ILayer<mathDomain>::Weight& weightGradient,
 		            const double averageLearningRate,
@@ -93,24 +142,86 @@ namespace nn
 			_weight.AddEqualMatrix(weightGradient, MatrixOperation::None, MatrixOperation::None, regularizationFactor, -averageLearningRate);
 		}
 		
-		CostFunctionType GetBestCostFunctionType() const noexcept override { return _activationFunction->GetBestCostFunction(); }
+		CostFunctionType GetBestCostFunctionType() const noexcept override
+		{
+			return _activationFunction ? _activationFunction->GetBestCostFunction() : CostFunctionType::Null;
+		}
 		std::unique_ptr<ICostFunction<mathDomain>> GetBestCostFunction() const noexcept override { return nullptr; }
 		
 		inline typename ILayer<mathDomain>::Matrix& GetActivation() noexcept override final { return *_lastActivation; }
 		inline const typename ILayer<mathDomain>::Matrix& GetActivationGradient() const noexcept override final { return *_lastActivationGradient; }
 		inline const typename ILayer<mathDomain>::Weight& GetWeight() const noexcept override final { return _weight; }
 		inline const typename ILayer<mathDomain>::Bias& GetBias() const noexcept override final { return _bias; }
+		inline ActivationFunctionType GetActivationFunctionType() const noexcept override final
+		{
+			return _activationFunction ? _activationFunction->GetType() : ActivationFunctionType::Null;
+		}
+		
+		void ReadParametersFrom(const ILayer<mathDomain>& rhs) noexcept override final
+		{
+			assert(rhs.GetNumberOfInputs() == _nInput);
+			assert(rhs.GetNumberOfOutputs() == _nOutput);
+			
+			_weight.ReadFrom(rhs.GetWeight());
+			_bias.ReadFrom(rhs.GetBias());
+		}
+		
+		void BindParameters(const std::ptrdiff_t weightPointer, const std::ptrdiff_t biasPointer) noexcept override final
+		{
+			auto weight = detail::MakeMatrixView<mathDomain>(weightPointer, _weight.nRows(), _weight.nCols());
+			weight.ReadFrom(_weight);
+			_weight = std::move(weight);
+			
+			auto bias = detail::MakeVectorView<mathDomain>(biasPointer, _bias.size());
+			bias.ReadFrom(_bias);
+			_bias = std::move(bias);
+		}
 		
 	protected:
+		// applies the activation to z: into output if provided, otherwise into the activation buffers, together with
+		// its gradient if needed.
+		// NB: a null activation function is the identity, i.e. a linear layer
+		void Activate(const typename ILayer<mathDomain>::Matrix& zMatrix, const bool needGradient, typename ILayer<mathDomain>::Matrix* const output) noexcept
+		{
+			if (output)
+			{
+				if (_activationFunction)
+					_activationFunction->Evaluate(*output, zMatrix);
+				else
+					output->ReadFrom(zMatrix);
+				return;
+			}
+			
+			auto& activation = _batchedActivation.Get(zMatrix.nCols());
+			_lastActivation = &activation;
+			
+			assert(activation.size() == zMatrix.size());
+			if (_activationFunction)
+				_activationFunction->Evaluate(activation, zMatrix);
+			else
+				activation.ReadFrom(zMatrix);
+			
+			// still need to retrieve the cache, even though gradient is not needed
+			auto& activationGradient = _batchedActivationGradient.Get(zMatrix.nCols());
+			_lastActivationGradient = &activationGradient;
+			if (needGradient)
+			{
+				if (_activationFunction)
+					_activationFunction->EvaluateGradient(activationGradient, zMatrix, activation);
+				else
+					activationGradient.Set(1.0);
+			}
+		}
+		
 		const size_t _nInput;
 		const size_t _nOutput;
 		
 		typename ILayer<mathDomain>::Bias _bias;
 		typename ILayer<mathDomain>::Weight _weight;
 		
-		std::unordered_map<size_t, typename ILayer<mathDomain>::Matrix> _zMatrix {}; // stores weight * input + bias
-		std::unordered_map<size_t, typename ILayer<mathDomain>::Matrix> _batchedActivation {};
-		std::unordered_map<size_t, typename ILayer<mathDomain>::Matrix> _batchedActivationGradient {}; // TODO: move it into the optimizers?
+		Workspace<mathDomain> _zMatrix; // stores weight * input + bias
+		Workspace<mathDomain> _batchedActivation;
+		Workspace<mathDomain> _batchedActivationGradient; // TODO: move it into the optimizers?
 		
 		typename ILayer<mathDomain>::Matrix* _lastActivation = nullptr;
 		typename ILayer<mathDomain>::Matrix* _lastActivationGradient = nullptr;
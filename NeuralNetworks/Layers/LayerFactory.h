@@ -3,6 +3,8 @@
 #include <NeuralNetworks/Layers/All.h>
 #include <NeuralNetworks/Layers/LayerType.h>
 
+#include <type_traits>
+
 namespace nn
 {
 	template<MathDomain mathDomain>
@@ -14,6 +16,8 @@ namespace nn
 			return Create(GetActivationFunctionType(string));
 		}
 		
+		// dense layers are built from (nInput, nOutput, ...), low-rank ones from (nInput, nOutput, rank, ...), spatial ones
+		// from (geometry, ...): null if the arguments don't fit the type
 		template<typename... Args>
 		static std::unique_ptr<ILayer<mathDomain>> Create(const LayerType type, Args&&... args)
 		{
@@ -21,17 +25,54 @@ namespace nn
 			switch (type)
 			{
 				case LayerType::Dense:
-					ret = std::make_unique<DenseLayer<mathDomain>>(std::forward<Args>(args)...);
+					ret = Make<DenseLayer<mathDomain>>(std::forward<Args>(args)...);
 					break;
 				case LayerType::SoftMax:
-					ret = std::make_unique<SoftMaxLayer<mathDomain>>(std::forward<Args>(args)...);
+					ret = Make<SoftMaxLayer<mathDomain>>(std::forward<Args>(args)...);
+					break;
+				case LayerType::Convolution2D:
+					ret = Make<Convolution2DLayer<mathDomain>>(std::forward<Args>(args)...);
+					break;
+				case LayerType::MaxPool2D:
+					ret = Make<MaxPool2DLayer<mathDomain>>(std::forward<Args>(args)...);
+					break;
+				case LayerType::AvgPool2D:
+					ret = Make<AvgPool2DLayer<mathDomain>>(std::forward<Args>(args)...);
+					break;
+				case LayerType::LowRankDense:
+					ret = Make<LowRankDenseLayer<mathDomain>>(std::forward<Args>(args)...);
 					break;
 				default:
 					return nullptr;
 			}
 			
-			assert(ret->GetType() == type);
+			assert(!ret || ret->GetType() == type);
 			return ret;
 		}
+		
+		// same type and shape as a serialized (or existing) layer: the geometry is only used by the spatial layers, and the
+		// rank by the factorised ones
+		static std::unique_ptr<ILayer<mathDomain>> CreateWithShape(const LayerType type, const size_t nInput, const size_t nOutput, const ConvolutionGeometry& geometry, const size_t rank,
+		                                                           std::unique_ptr<IActivationFunction<mathDomain>>&& activationFunction,
+		                                                           IBiasWeightInitializer<mathDomain>&& initializer)
+		{
+			if (IsSpatial(type))
+				return Create(type, geometry, std::move(activationFunction), std::move(initializer));
+			if (IsFactorized(type))
+				return Create(type, static_cast<unsigned>(nInput), static_cast<unsigned>(nOutput), static_cast<unsigned>(rank), std::move(activationFunction), std::move(initializer));
+			
+			return Create(type, static_cast<unsigned>(nInput), static_cast<unsigned>(nOutput), std::move(activationFunction), std::move(initializer));
+		}
+	
+	private:
+		// NB: every case of the switch is compiled, but each layer only has the constructor that makes sense for it
+		template<typename LayerT, typename... Args>
+		static std::unique_ptr<ILayer<mathDomain>> Make(Args&&... args)
+		{
+			if constexpr (std::is_constructible_v<LayerT, Args&&...>)
+				return std::make_unique<LayerT>(std::forward<Args>(args)...);
+			else
+				return nullptr;
+		}
 	};
 }
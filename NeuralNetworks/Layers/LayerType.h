@@ -1,5 +1,10 @@
 #pragma once
 
+#include <Convolution.h>
+
+#include <sstream>
+#include <string>
+
 namespace nn
 {
 	enum class LayerType
@@ -8,6 +13,10 @@ namespace nn
 		Null = __BEGIN__,
 		Dense,
 		SoftMax,
+		Convolution2D,
+		MaxPool2D,
+		AvgPool2D,
+		LowRankDense,
 		
 		__END__
 	};
@@ -20,11 +29,53 @@ namespace nn
 				return "Dense";
 			case LayerType::SoftMax:
 				return "SoftMax";
+			case LayerType::Convolution2D:
+				return "Convolution2D";
+			case LayerType::MaxPool2D:
+				return "MaxPool2D";
+			case LayerType::AvgPool2D:
+				return "AvgPool2D";
+			case LayerType::LowRankDense:
+				return "LowRankDense";
 			default:
 				return "?";
 		}
 	}
 	
+	// layers working on images, whose shape is described by a ConvolutionGeometry rather than by (nInput, nOutput)
+	static inline bool IsSpatial(const LayerType type) noexcept
+	{
+		return type == LayerType::Convolution2D || type == LayerType::MaxPool2D || type == LayerType::AvgPool2D;
+	}
+	
+	// fully connected layers whose weight is factorised, and whose shape also needs the rank
+	static inline bool IsFactorized(const LayerType type) noexcept
+	{
+		return type == LayerType::LowRankDense;
+	}
+	
+	// layers whose weight and bias are only placeholders (i.e. pooling): they get no block of the parameter buffer, so
+	// that they're neither regularised nor updated
+	static inline bool HasParameters(const LayerType type) noexcept
+	{
+		return type != LayerType::MaxPool2D && type != LayerType::AvgPool2D;
+	}
+	
+	static inline std::string ToString(const ConvolutionGeometry& geometry) noexcept
+	{
+		std::ostringstream stream;
+		stream << geometry.nChannels << " " << geometry.height << " " << geometry.width << " " << geometry.nFilters << " " << geometry.kernelSize << " " << geometry.stride;
+		return stream.str();
+	}
+	
+	static inline ConvolutionGeometry GetConvolutionGeometry(const std::string& string) noexcept
+	{
+		ConvolutionGeometry geometry;
+		std::istringstream stream(string);
+		stream >> geometry.nChannels >> geometry.height >> geometry.width >> geometry.nFilters >> geometry.kernelSize >> geometry.stride;
+		return geometry;
+	}
+	
 	template<typename T>
 	static inline LayerType GetLayerType(T&& string) noexcept
 	{
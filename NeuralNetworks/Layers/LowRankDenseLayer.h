@@ -0,0 +1,148 @@
+#pragma once
+
+#include <NeuralNetworks/Layers/Layer.h>
+
+#include <Tensor.h>
+
+#include <algorithm>
+
+namespace nn
+{
+	// Fully connected layer whose weight is factorised as W = U * V, with U (nOutput, rank) and V (rank, nInput), so that
+	// the cost per sample is rank * (nOutput + nInput) rather than nOutput * nInput.
+	// Both factors live in the single weight matrix the rest of the library expects, packed column-wise as
+	//     [ U | V | 0 ], of shape (nOutput, rank + ceil(rank * nInput / nOutput))
+	// with V stored contiguously (i.e. with its own leading dimension) right after U. The zero padding never gets any
+	// gradient, so it stays so through the updates.
+	template<MathDomain mathDomain>
+	class LowRankDenseLayer final: public Layer<mathDomain>
+	{
+		using Matrix = typename Layer<mathDomain>::Matrix;
+		using Vector = typename Layer<mathDomain>::Vector;
+		using Weight = typename Layer<mathDomain>::Weight;
+		using Bias = typename Layer<mathDomain>::Bias;
+	
+	public:
+		LowRankDenseLayer(const unsigned nInput,
+		                  const unsigned nOutput,
+		                  const unsigned rank,
+		                  std::unique_ptr<IActivationFunction<mathDomain>>&& activationFunction,
+		                  IBiasWeightInitializer<mathDomain>&& initializer)
+			: Layer<mathDomain>(nInput, nOutput, nOutput, GetNumberOfPackedColumns(nInput, nOutput, rank), std::move(activationFunction), std::move(initializer)),
+			  _rank(rank),
+			  _hidden(rank),
+			  _hiddenGradient(rank)
+		{
+			assert(rank > 0);
+			
+			auto weight = this->_weight.Get();
+			std::fill(weight.begin() + static_cast<std::ptrdiff_t>(rank * (nOutput + nInput)), weight.end(), 0);
+			this->_weight.ReadFrom(weight);
+		}
+		
+		static inline unsigned GetNumberOfPackedColumns(const unsigned nInput, const unsigned nOutput, const unsigned rank) noexcept
+		{
+			return rank + (rank * nInput + nOutput - 1) / nOutput;
+		}
+		
+		constexpr LayerType GetType() const noexcept override { return LayerType::LowRankDense; }
+		size_t GetRank() const noexcept override { return _rank; }
+		
+		// views on the factors of weight, or of any matrix packed the same way (e.g. its gradient)
+		Matrix GetU(const Weight& packed) const noexcept
+		{
+			return detail::MakeMatrixView<mathDomain>(packed.GetBuffer().pointer, this->_nOutput, _rank);
+		}
+		Matrix GetV(const Weight& packed) const noexcept
+		{
+			const auto offset = static_cast<std::ptrdiff_t>(this->_nOutput * _rank * packed.GetBuffer().ElementarySize());
+			return detail::MakeMatrixView<mathDomain>(packed.GetBuffer().pointer + offset, _rank, this->_nInput);
+		}
+		inline Matrix GetU() const noexcept { return GetU(this->_weight); }
+		inline Matrix GetV() const noexcept { return GetV(this->_weight); }
+		
+		void SetFactors(const Matrix& u, const Matrix& v) noexcept
+		{
+			assert(u.nRows() == this->_nOutput && u.nCols() == _rank);
+			assert(v.nRows() == _rank && v.nCols() == this->_nInput);
+			
+			GetU().ReadFrom(u);
+			GetV().ReadFrom(v);
+		}
+		
+		// NB: Infer may be called concurrently (see Network::Evaluate): the rank-sized intermediate is the workspace's
+		void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept override
+		{
+			auto hidden = workspace.GetProductScratch(_rank, input.nCols());
+			GetV().Multiply(hidden, input);
+			
+			const auto linear = [&](Matrix& z)
+			{
+				GetU().Multiply(z, hidden);
+				z.AddEqualBroadcast(this->_bias, workspace.GetOnes(input.nCols()), false);
+			};
+			if (!this->_activationFunction)
+			{
+				linear(output);
+				return;
+			}
+			
+			auto z = workspace.GetZScratch(output.nRows(), output.nCols());
+			linear(z);
+			this->_activationFunction->Infer(output, z, workspace);
+		}
+		
+		void Reserve(const size_t capacity) noexcept override
+		{
+			Layer<mathDomain>::Reserve(capacity);
+			_hidden.Reserve(capacity);
+			_hiddenGradient.Reserve(capacity);
+			_onesCache.Reserve(capacity);
+		}
+		
+		void Evaluate(const Matrix& input, const bool needGradient, Matrix* const output) noexcept override
+		{
+			auto& hidden = _hidden.Get(input.nCols());
+			_lastHidden = &hidden;
+			GetV().Multiply(hidden, input);
+			
+			auto& zMatrix = this->_zMatrix.Get(input.nCols());
+			GetU().Multiply(zMatrix, hidden);
+			zMatrix.AddEqualBroadcast(this->_bias, _onesCache.Get(input.nCols()), false);
+			
+			this->Activate(zMatrix, needGradient, output);
+		}
+		
+		// z = U h + b, h = V x, h being the one of the last Evaluate: that must have been called on the same input
+		void BackPropagate(Matrix* const inputGradient, Bias& biasGradient, Weight& weightGradient,
+		                   const Matrix& delta, const Matrix& input, const Vector& ones) const noexcept override
+		{
+			delta.Dot(biasGradient, ones, MatrixOperation::None, 1.0, 1.0);
+			
+			// dL/dU += delta \cdot h
+			auto uGradient = GetU(weightGradient);
+			cl::Tensor<MemorySpace::Device, mathDomain>::AccumulateKroneckerProduct(uGradient, delta, *_lastHidden);
+			
+			// dL/dh = U^T * delta, in its own buffer: h stays valid for a further call with the same activations
+			auto& hiddenGradient = _hiddenGradient.Get(delta.nCols());
+			GetU().Multiply(hiddenGradient, delta, MatrixOperation::Transpose);
+			
+			// dL/dV += dL/dh \cdot input
+			auto vGradient = GetV(weightGradient);
+			cl::Tensor<MemorySpace::Device, mathDomain>::AccumulateKroneckerProduct(vGradient, hiddenGradient, input);
+			
+			// dL/d(input) = V^T * dL/dh
+			if (inputGradient)
+				GetV().Multiply(*inputGradient, hiddenGradient, MatrixOperation::Transpose);
+		}
+	
+	private:
+		const size_t _rank;
+		
+		Workspace<mathDomain> _hidden;
+		Matrix* _lastHidden = nullptr;
+		VectorWorkspace<mathDomain> _onesCache { 0, 1.0 };
+		
+		mutable Workspace<mathDomain> _hiddenGradient;
+	};
+}
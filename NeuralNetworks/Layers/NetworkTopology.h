@@ -5,6 +5,9 @@
 #include <NeuralNetworks/Layers/LayerFactory.h>
 #include <NeuralNetworks/Activations/ActivationFunctionFactory.h>
 #include <NeuralNetworks/Layers/Initializers/TrivialBiasWeightInitializer.h>
+#include <NeuralNetworks/Memory/InferenceWorkspace.h>
+#include <NeuralNetworks/Memory/ParameterBuffer.h>
+#include <NeuralNetworks/Profiler.h>
 
 namespace nn
 {
@@ -24,6 +27,8 @@ namespace nn
 			
 			for (size_t l = 1; l < _layers.size(); ++l)
 				assert(_layers[l]->GetNumberOfInputs() == _layers[l - 1]->GetNumberOfOutputs());
+			
+			BindParameters();
 		}
 		
 		explicit NetworkTopology(std::istream& stream)
@@ -45,39 +50,97 @@ namespace nn
 				ret.push_back(layer->GetNumberOfOutputs());
 			return ret;
 		}
+		// weight shapes, i.e. (nOutput, nInput) for dense layers, (nFilters, nChannels * kernelSize^2) for convolutions,
+		// the packed factors of the low-rank ones, and (0, 0) for the layers without parameters
 		inline std::vector<std::pair<size_t, size_t>> GetTransposedSizes() const noexcept
 		{
 			std::vector<std::pair<size_t, size_t>> ret;
 			for (const auto& layer: _layers)
-				ret.emplace_back(layer->GetNumberOfOutputs(), layer->GetNumberOfInputs());
+			{
+				if (HasParameters(layer->GetType()))
+					ret.emplace_back(layer->GetWeight().nRows(), layer->GetWeight().nCols());
+				else
+					ret.emplace_back(0, 0);
+			}
 			return ret;
 		}
 		
+		// pre-allocate every layer's buffers for batches up to capacity columns
+		void Reserve(const size_t capacity) const noexcept
+		{
+			for (const auto& layer: _layers)
+				layer->Reserve(capacity);
+		}
+		
 		void Evaluate(const Matrix& input, const bool needGradient, Matrix* const output = nullptr) const noexcept
 		{
 			// use input for first layer
-			_layers[0]->Evaluate(input, true);
+			{
+				NN_PROFILE_SCOPE_INDEXED("Forward", 0);
+				_layers[0]->Evaluate(input, true);
+			}
 			
 			// use previous activations for all other layers
 			const size_t nLayers = GetSize();
 			for (size_t l = 1; l < nLayers - 1; ++l)
+			{
+				NN_PROFILE_SCOPE_INDEXED("Forward", l);
 				_layers[l]->Evaluate(this->_layers[l - 1]->GetActivation(), true);
+			}
 			
+			NN_PROFILE_SCOPE_INDEXED("Forward", nLayers - 1);
 			_layers[nLayers - 1]->Evaluate(this->_layers[nLayers - 2]->GetActivation(), needGradient, output);
 		}
 		
-		double EvaluateTotalWeightCost() const noexcept
+		// inference only: hidden layers ping-pong between the two buffers of the workspace, the last one writes into output
+		void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept
 		{
-			double weightCost = 0.0;
+			const size_t nLayers = GetSize();
+			
+			const Matrix* layerInput = &input;
+			for (size_t l = 0; l < nLayers - 1; ++l)
+			{
+				auto& layerOutput = workspace.Get(l, _layers[l]->GetNumberOfOutputs(), input.nCols());
+				_layers[l]->Infer(layerOutput, *layerInput, workspace);
+				layerInput = &layerOutput;
+			}
+			
+			_layers[nLayers - 1]->Infer(output, *layerInput, workspace);
+		}
+		
+		// same layers and parameters, but with its own buffers
+		NetworkTopology Clone() const noexcept
+		{
+			Layers layers;
 			for (const auto& layer: _layers)
 			{
-				const auto norm = layer->GetWeight().EuclideanNorm();
-				weightCost += static_cast<double>(norm * norm);
+				auto activationFunction = ActivationFunctionFactory<mathDomain>::Create(layer->GetActivationFunctionType());
+				layers.emplace_back(LayerFactory<mathDomain>::CreateWithShape(layer->GetType(), layer->GetNumberOfInputs(), layer->GetNumberOfOutputs(), layer->GetGeometry(), layer->GetRank(),
+				                                                              std::move(activationFunction), std::move(TrivialBiasWeightInitializer<mathDomain>())));
 			}
 			
-			return weightCost;
+			NetworkTopology ret(std::move(layers));
+			ret.ReadParametersFrom(*this);
+			return ret;
 		}
 		
+		// NB: same shapes means same layout, so this is a single copy
+		void ReadParametersFrom(const NetworkTopology& rhs) noexcept
+		{
+			assert(rhs.GetSize() == GetSize());
+			assert(rhs._parameters->Get().size() == _parameters->Get().size());
+			_parameters->Get().ReadFrom(rhs._parameters->Get());
+		}
+		
+		double EvaluateTotalWeightCost() const noexcept
+		{
+			// weights are contiguous: one pass
+			const auto norm = _parameters->GetWeights().EuclideanNorm();
+			return static_cast<double>(norm * norm);
+		}
+			
+		inline ParameterBuffer<mathDomain>& GetParameters() const noexcept { return *_parameters; }
+		
 		std::ostream& operator <<(std::ostream& stream) const noexcept override
 		{
 			stream << _layers.size() << std::endl;
@@ -111,13 +174,29 @@ namespace nn
 				const ActivationFunctionType activationFunctionType = GetActivationFunctionType(line);
 				auto activationFunction = ActivationFunctionFactory<mathDomain>::Create(activationFunctionType);
 				
-				auto layer = LayerFactory<mathDomain>::Create(type, nInput, nOutput, std::move(activationFunction),
-				                                              std::move(TrivialBiasWeightInitializer<mathDomain>()));
+				ConvolutionGeometry geometry;
+				if (IsSpatial(type))
+				{
+					std::getline(stream, line);
+					geometry = GetConvolutionGeometry(line);
+				}
+				
+				size_t rank = 0;
+				if (IsFactorized(type))
+				{
+					std::getline(stream, line);
+					rank = static_cast<size_t>(std::atoi(line.c_str()));
+				}
+				
+				auto layer = LayerFactory<mathDomain>::CreateWithShape(type, nInput, nOutput, geometry, rank, std::move(activationFunction),
+				                                                       std::move(TrivialBiasWeightInitializer<mathDomain>()));
 				*layer >> stream;
 				
 				_layers.emplace_back(std::move(layer));
 			}
 			
+			BindParameters();
+			
 			return stream;
 		}
 		
@@ -128,7 +207,18 @@ namespace nn
 		const Layer& back() const noexcept { return _layers.back(); }
 		const Layer& operator[](const size_t i) const noexcept { return _layers[i]; }
 	
+	private:
+		// move every layer's parameters in a single flat buffer: the ones without parameters keep their placeholders
+		void BindParameters() noexcept
+		{
+			_parameters = std::make_unique<ParameterBuffer<mathDomain>>(GetTransposedSizes());
+			for (size_t l = 0; l < _layers.size(); ++l)
+				if (HasParameters(_layers[l]->GetType()))
+					_layers[l]->BindParameters(_parameters->GetWeight(l).GetBuffer().pointer, _parameters->GetBias(l).GetBuffer().pointer);
+		}
+	
 	protected:
 		Layers _layers {};
+		std::unique_ptr<ParameterBuffer<mathDomain>> _parameters {};
 	};
 }
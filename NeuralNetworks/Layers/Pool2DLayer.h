@@ -0,0 +1,80 @@
+#pragma once
+
+#include <NeuralNetworks/Layers/Layer.h>
+
+namespace nn
+{
+	// Max or average over kernelSize x kernelSize windows, channel by channel: no activation, and no parameters.
+	// NB: weight and bias are 1x1 placeholders, which are left out of the parameter buffer (see HasParameters)
+	template<MathDomain mathDomain, PoolingType poolingType>
+	class Pool2DLayer final: public Layer<mathDomain>
+	{
+		using Matrix = typename Layer<mathDomain>::Matrix;
+		using Vector = typename Layer<mathDomain>::Vector;
+		using Weight = typename Layer<mathDomain>::Weight;
+		using Bias = typename Layer<mathDomain>::Bias;
+	
+	public:
+		// pooling keeps the channels: geometry.nFilters is ignored
+		Pool2DLayer(const ConvolutionGeometry& geometry,
+		            std::unique_ptr<IActivationFunction<mathDomain>>&&,  // blissfully ignored
+		            IBiasWeightInitializer<mathDomain>&& initializer)
+			: Layer<mathDomain>(MakeGeometry(geometry).GetNumberOfInputs(), MakeGeometry(geometry).GetNumberOfOutputs(), 1, 1,
+			                    nullptr, std::move(initializer)),
+			  _geometry(MakeGeometry(geometry))
+		{
+			assert(_geometry.IsValid());
+		}
+		
+		constexpr LayerType GetType() const noexcept override
+		{
+			return poolingType == PoolingType::Max ? LayerType::MaxPool2D : LayerType::AvgPool2D;
+		}
+		ConvolutionGeometry GetGeometry() const noexcept override { return _geometry; }
+		
+		CostFunctionType GetBestCostFunctionType() const noexcept override { return CostFunctionType::Null; }
+		
+		void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>&) const noexcept override
+		{
+			nn::detail::Pooling(output.GetBuffer(), input.GetBuffer(), _geometry, poolingType);
+		}
+		
+		void Evaluate(const Matrix& input, const bool, Matrix* const output) noexcept override
+		{
+			if (output)
+			{
+				nn::detail::Pooling(output->GetBuffer(), input.GetBuffer(), _geometry, poolingType);
+				return;
+			}
+			
+			auto& activation = this->_batchedActivation.Get(input.nCols());
+			this->_lastActivation = &activation;
+			nn::detail::Pooling(activation.GetBuffer(), input.GetBuffer(), _geometry, poolingType);
+			
+			// identity activation: the optimizers don't read its gradient (see ActivationFunctionType::Null)
+			this->_lastActivationGradient = &this->_batchedActivationGradient.Get(input.nCols());
+		}
+		
+		void BackPropagate(Matrix* const inputGradient, Bias&, Weight&,
+		                   const Matrix& delta, const Matrix& input, const Vector&) const noexcept override
+		{
+			if (inputGradient)
+				nn::detail::PoolingInputGradient(inputGradient->GetBuffer(), delta.GetBuffer(), input.GetBuffer(), _geometry, poolingType);
+		}
+	
+	private:
+		static ConvolutionGeometry MakeGeometry(ConvolutionGeometry geometry) noexcept
+		{
+			geometry.nFilters = geometry.nChannels;
+			return geometry;
+		}
+		
+		const ConvolutionGeometry _geometry;
+	};
+	
+	template<MathDomain mathDomain>
+	using MaxPool2DLayer = Pool2DLayer<mathDomain, PoolingType::Max>;
+	
+	template<MathDomain mathDomain>
+	using AvgPool2DLayer = Pool2DLayer<mathDomain, PoolingType::Average>;
+}
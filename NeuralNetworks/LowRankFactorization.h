@@ -0,0 +1,337 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/Stopwatch.h>
+#include <NeuralNetworks/TrainingData.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+#include <NeuralNetworks/Layers/LayerFactory.h>
+#include <NeuralNetworks/Activations/ActivationFunctionFactory.h>
+#include <NeuralNetworks/Layers/Initializers/TrivialBiasWeightInitializer.h>
+#include <NeuralNetworks/Memory/InferenceWorkspace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <vector>
+
+namespace nn
+{
+	// thin SVD of a (nRows, nCols) column-major matrix, A = U diag(singularValues) V^T, with the singular values in
+	// decreasing order: U is (nRows, k) and V is (nCols, k), k = min(nRows, nCols)
+	struct SingularValueDecomposition
+	{
+		size_t nRows = 0;
+		size_t nCols = 0;
+		std::vector<double> u {};
+		std::vector<double> singularValues {};
+		std::vector<double> v {};
+		
+		inline size_t GetMaxRank() const noexcept { return singularValues.size(); }
+		
+		// fraction of the squared Frobenius norm kept by the first rank terms
+		double GetRetainedEnergy(const size_t rank) const noexcept
+		{
+			double total = 0.0;
+			double retained = 0.0;
+			for (size_t k = 0; k < singularValues.size(); ++k)
+			{
+				total += singularValues[k] * singularValues[k];
+				if (k < rank)
+					retained += singularValues[k] * singularValues[k];
+			}
+			return total > 0.0 ? retained / total : 1.0;
+		}
+		
+		// smallest rank that retains at least the given fraction of the energy
+		size_t GetRank(const double energy) const noexcept
+		{
+			assert(energy >= 0.0 && energy <= 1.0);
+			
+			for (size_t rank = 1; rank < GetMaxRank(); ++rank)
+			{
+				if (GetRetainedEnergy(rank) >= energy)
+					return rank;
+			}
+			return GetMaxRank();
+		}
+		
+		// one-sided Jacobi (Hestenes): the columns of A (or of A^T, whichever has fewer) are rotated pairwise until they
+		// are orthogonal, so that their norms are the singular values. Slow-ish, but accurate and only done offline.
+		static SingularValueDecomposition Decompose(const std::vector<double>& a, const size_t nRows, const size_t nCols) noexcept
+		{
+			assert(a.size() == nRows * nCols);
+			
+			const bool transpose = nRows < nCols;
+			const size_t m = transpose ? nCols : nRows;
+			const size_t n = transpose ? nRows : nCols;
+			
+			std::vector<double> b(m * n);
+			for (size_t j = 0; j < n; ++j)
+				for (size_t i = 0; i < m; ++i)
+					b[i + j * m] = transpose ? a[j + i * nRows] : a[i + j * nRows];
+			
+			std::vector<double> w(n * n, 0.0);
+			for (size_t j = 0; j < n; ++j)
+				w[j + j * n] = 1.0;
+			
+			static constexpr size_t maxSweeps = 60;
+			static constexpr double tolerance = 1e-15;
+			for (size_t sweep = 0; sweep < maxSweeps; ++sweep)
+			{
+				bool converged = true;
+				for (size_t p = 0; p + 1 < n; ++p)
+				{
+					for (size_t q = p + 1; q < n; ++q)
+					{
+						double alpha = 0.0;
+						double beta = 0.0;
+						double gamma = 0.0;
+						for (size_t i = 0; i < m; ++i)
+						{
+							alpha += b[i + p * m] * b[i + p * m];
+							beta += b[i + q * m] * b[i + q * m];
+							gamma += b[i + p * m] * b[i + q * m];
+						}
+						if (std::abs(gamma) <= tolerance * std::sqrt(alpha * beta))
+							continue;
+						converged = false;
+						
+						const double zeta = (beta - alpha) / (2.0 * gamma);
+						const double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::abs(zeta) + std::sqrt(1.0 + zeta * zeta));
+						const double c = 1.0 / std::sqrt(1.0 + t * t);
+						const double s = c * t;
+						Rotate(b, m, p, q, c, s);
+						Rotate(w, n, p, q, c, s);
+					}
+				}
+				if (converged)
+					break;
+			}
+			
+			std::vector<double> norms(n);
+			for (size_t j = 0; j < n; ++j)
+				norms[j] = std::sqrt(std::inner_product(b.begin() + static_cast<std::ptrdiff_t>(j * m), b.begin() + static_cast<std::ptrdiff_t>((j + 1) * m),
+				                                        b.begin() + static_cast<std::ptrdiff_t>(j * m), 0.0));
+			std::vector<size_t> order(n);
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [&norms](const size_t i, const size_t j) { return norms[i] > norms[j]; });
+			
+			// B = A W has orthogonal columns: B = U' diag(norms), so A = U' diag(norms) W^T
+			std::vector<double> left(m * n, 0.0);
+			std::vector<double> right(n * n);
+			std::vector<double> singularValues(n);
+			for (size_t k = 0; k < n; ++k)
+			{
+				const size_t j = order[k];
+				singularValues[k] = norms[j];
+				for (size_t i = 0; i < m; ++i)
+					left[i + k * m] = norms[j] > 0.0 ? b[i + j * m] / norms[j] : 0.0;
+				for (size_t i = 0; i < n; ++i)
+					right[i + k * n] = w[i + j * n];
+			}
+			
+			SingularValueDecomposition ret;
+			ret.nRows = nRows;
+			ret.nCols = nCols;
+			ret.singularValues = std::move(singularValues);
+			ret.u = transpose ? std::move(right) : std::move(left);
+			ret.v = transpose ? std::move(left) : std::move(right);
+			return ret;
+		}
+	
+	private:
+		// columns p and q of the (nRows, .) x become (c x_p - s x_q, s x_p + c x_q)
+		static void Rotate(std::vector<double>& x, const size_t nRows, const size_t p, const size_t q, const double c, const double s) noexcept
+		{
+			for (size_t i = 0; i < nRows; ++i)
+			{
+				const double xp = x[i + p * nRows];
+				const double xq = x[i + q * nRows];
+				x[i + p * nRows] = c * xp - s * xq;
+				x[i + q * nRows] = s * xp + c * xq;
+			}
+		}
+	};
+	
+	// Replaces trained dense layers with LowRankDenseLayer's, from the truncated SVD of their weight: with
+	// W ~ U_r diag(s_r) V_r^T, the factors are U_r diag(sqrt(s_r)) and diag(sqrt(s_r)) V_r^T. The rank is either chosen
+	// directly, or as the smallest one retaining a fraction of the energy (i.e. of sum(s^2)). The result can be
+	// fine-tuned with the usual optimizers.
+	template<MathDomain mathDomain>
+	class LowRankFactorization
+	{
+		using Real = typename Traits<mathDomain>::stdType;
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Metric = std::function<double(Matrix&, const Matrix&)>;
+	
+	public:
+		struct ReportEntry
+		{
+			size_t rank; // 0 for the original dense layer
+			size_t nParameters; // of the layer: rank * (nOutput + nInput) + nOutput
+			double retainedEnergy;
+			double metric;
+			double milliseconds; // per inference over the whole data
+		};
+		
+		static inline bool IsConvertible(const ILayer<mathDomain>& layer) noexcept { return layer.GetType() == LayerType::Dense; }
+		
+		// a factorised layer is cheaper only if rank * (nOutput + nInput) < nOutput * nInput
+		static inline bool IsWorthIt(const ILayer<mathDomain>& layer, const size_t rank) noexcept
+		{
+			return rank * (layer.GetNumberOfOutputs() + layer.GetNumberOfInputs()) < layer.GetNumberOfOutputs() * layer.GetNumberOfInputs();
+		}
+		
+		static SingularValueDecomposition Decompose(const ILayer<mathDomain>& layer) noexcept
+		{
+			const auto weight = layer.GetWeight().Get();
+			return SingularValueDecomposition::Decompose(std::vector<double>(weight.begin(), weight.end()), layer.GetWeight().nRows(), layer.GetWeight().nCols());
+		}
+		
+		// ranks[l] is the rank of the l-th layer, 0 to leave it as it is
+		static NetworkTopology<mathDomain> Convert(const NetworkTopology<mathDomain>& topology, const std::vector<size_t>& ranks) noexcept
+		{
+			assert(ranks.size() == topology.GetSize());
+			
+			std::vector<std::unique_ptr<ILayer<mathDomain>>> layers;
+			std::vector<std::vector<Real>> packedWeights(topology.GetSize());
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				const auto& layer = *topology[l];
+				auto activationFunction = ActivationFunctionFactory<mathDomain>::Create(layer.GetActivationFunctionType());
+				if (ranks[l] == 0)
+				{
+					layers.emplace_back(LayerFactory<mathDomain>::CreateWithShape(layer.GetType(), layer.GetNumberOfInputs(), layer.GetNumberOfOutputs(), layer.GetGeometry(), layer.GetRank(),
+					                                                              std::move(activationFunction), std::move(TrivialBiasWeightInitializer<mathDomain>())));
+					continue;
+				}
+				
+				assert(IsConvertible(layer));
+				assert(ranks[l] <= std::min(layer.GetNumberOfInputs(), layer.GetNumberOfOutputs()));
+				layers.emplace_back(std::make_unique<LowRankDenseLayer<mathDomain>>(static_cast<unsigned>(layer.GetNumberOfInputs()), static_cast<unsigned>(layer.GetNumberOfOutputs()),
+				                                                                    static_cast<unsigned>(ranks[l]), std::move(activationFunction), std::move(TrivialBiasWeightInitializer<mathDomain>())));
+				packedWeights[l] = Pack(Decompose(layer), ranks[l], layers.back()->GetWeight().size());
+			}
+			
+			NetworkTopology<mathDomain> ret(std::move(layers));
+			auto& parameters = ret.GetParameters();
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				if (!HasParameters(topology[l]->GetType()))
+					continue;
+				
+				if (ranks[l] == 0)
+					parameters.GetWeight(l).ReadFrom(topology[l]->GetWeight());
+				else
+					parameters.GetWeight(l).ReadFrom(packedWeights[l]);
+				parameters.GetBias(l).ReadFrom(topology[l]->GetBias());
+			}
+			
+			return ret;
+		}
+		
+		// every dense layer that is cheaper factorised at the rank retaining the given energy
+		static NetworkTopology<mathDomain> Compress(const NetworkTopology<mathDomain>& topology, const double energy) noexcept
+		{
+			std::vector<size_t> ranks(topology.GetSize(), 0);
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				if (!IsConvertible(*topology[l]))
+					continue;
+				
+				const size_t rank = Decompose(*topology[l]).GetRank(energy);
+				if (IsWorthIt(*topology[l], rank))
+					ranks[l] = rank;
+			}
+			
+			return Convert(topology, ranks);
+		}
+		
+		// accuracy and speed of the topology with its l-th layer factorised at each of the given ranks, the first entry
+		// being the original: the metric is evaluated on the whole of data, and the timings are the best of nRepetitions
+		static std::vector<ReportEntry> Report(const NetworkTopology<mathDomain>& topology, const size_t l, const std::vector<size_t>& ranks,
+		                                       const TrainingData<mathDomain>& data, const Metric& metric, const size_t nRepetitions = 5) noexcept
+		{
+			assert(IsConvertible(*topology[l]));
+			
+			const auto& layer = *topology[l];
+			const auto svd = Decompose(layer);
+			
+			std::vector<ReportEntry> ret;
+			ret.push_back(Measure(topology, data, metric, nRepetitions));
+			ret.back().rank = 0;
+			ret.back().nParameters = layer.GetWeight().size() + layer.GetBias().size();
+			ret.back().retainedEnergy = 1.0;
+			
+			for (const size_t rank: ranks)
+			{
+				std::vector<size_t> layerRanks(topology.GetSize(), 0);
+				layerRanks[l] = rank;
+				const auto lowRankTopology = Convert(topology, layerRanks);
+				
+				ret.push_back(Measure(lowRankTopology, data, metric, nRepetitions));
+				ret.back().rank = rank;
+				ret.back().nParameters = rank * (layer.GetNumberOfOutputs() + layer.GetNumberOfInputs()) + layer.GetBias().size();
+				ret.back().retainedEnergy = svd.GetRetainedEnergy(rank);
+			}
+			
+			return ret;
+		}
+		
+		static std::ostream& WriteReport(std::ostream& stream, const std::vector<ReportEntry>& report)
+		{
+			stream << "rank\tparameters\tenergy\tmetric\ttime[ms]\n";
+			for (const auto& entry: report)
+			{
+				if (entry.rank == 0)
+					stream << "dense";
+				else
+					stream << entry.rank;
+				stream << "\t" << entry.nParameters << "\t" << entry.retainedEnergy << "\t" << entry.metric << "\t" << entry.milliseconds << "\n";
+			}
+			
+			return stream;
+		}
+	
+	private:
+		// [ U_r diag(sqrt(s_r)) | diag(sqrt(s_r)) V_r^T | 0 ], as in LowRankDenseLayer
+		static std::vector<Real> Pack(const SingularValueDecomposition& svd, const size_t rank, const size_t packedSize) noexcept
+		{
+			const size_t nOutput = svd.nRows;
+			const size_t nInput = svd.nCols;
+			assert(rank <= svd.GetMaxRank());
+			
+			std::vector<Real> ret(packedSize, Real(0));
+			Real* v = ret.data() + nOutput * rank;
+			for (size_t r = 0; r < rank; ++r)
+			{
+				const double scale = std::sqrt(svd.singularValues[r]);
+				for (size_t i = 0; i < nOutput; ++i)
+					ret[i + r * nOutput] = static_cast<Real>(svd.u[i + r * nOutput] * scale);
+				for (size_t j = 0; j < nInput; ++j)
+					v[r + j * rank] = static_cast<Real>(svd.v[j + r * nInput] * scale);
+			}
+			return ret;
+		}
+		
+		static ReportEntry Measure(const NetworkTopology<mathDomain>& topology, const TrainingData<mathDomain>& data, const Metric& metric, const size_t nRepetitions) noexcept
+		{
+			InferenceWorkspace<mathDomain> workspace(topology);
+			Matrix output(static_cast<unsigned>(data.expectedOutput.nRows()), static_cast<unsigned>(data.expectedOutput.nCols()));
+			
+			double milliseconds = std::numeric_limits<double>::max();
+			for (size_t n = 0; n < std::max<size_t>(1, nRepetitions); ++n)
+			{
+				Stopwatch sw;
+				topology.Infer(output, data.input, workspace);
+				sw.Stop();
+				milliseconds = std::min(milliseconds, sw.GetMilliSeconds());
+			}
+			
+			return { 0, 0, 0.0, metric(output, data.expectedOutput), milliseconds };
+		}
+	};
+}
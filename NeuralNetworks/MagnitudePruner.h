@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+#include <NeuralNetworks/Memory/ParameterBuffer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace nn
+{
+	// Zeroes the smallest weights (in absolute value) of every fully connected layer, so that the given fraction of each
+	// of them is zero. Biases and the other layers are left untouched.
+	// The returned mask has the parameters' layout, 0 for the pruned weights and 1 elsewhere: it can be given to
+	// BatchedGradientOptimizer::SetParameterMask to fine-tune the surviving weights only.
+	template<MathDomain mathDomain>
+	class MagnitudePruner
+	{
+		using Real = typename Traits<mathDomain>::stdType;
+	
+	public:
+		static std::unique_ptr<ParameterBuffer<mathDomain>> Prune(NetworkTopology<mathDomain>& topology, const double sparsity) noexcept
+		{
+			assert(sparsity >= 0.0 && sparsity <= 1.0);
+			
+			auto& parameters = topology.GetParameters();
+			auto mask = std::make_unique<ParameterBuffer<mathDomain>>(topology.GetTransposedSizes());
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				const auto type = topology[l]->GetType();
+				if (!HasParameters(type))
+					continue;
+				
+				mask->GetBias(l).Set(1.0);
+				
+				if (type != LayerType::Dense && type != LayerType::SoftMax)
+				{
+					mask->GetWeight(l).Set(1.0);
+					continue;
+				}
+				
+				auto weight = parameters.GetWeight(l).Get();
+				std::vector<Real> layerMask(weight.size(), Real(1));
+				
+				// NB: ties are broken arbitrarily, so that exactly nPruned weights are dropped
+				const auto nPruned = static_cast<size_t>(sparsity * static_cast<double>(weight.size()));
+				std::vector<size_t> order(weight.size());
+				std::iota(order.begin(), order.end(), size_t(0));
+				std::nth_element(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(nPruned), order.end(),
+				                 [&weight](const size_t i, const size_t j) { return std::abs(weight[i]) < std::abs(weight[j]); });
+				for (size_t k = 0; k < nPruned; ++k)
+				{
+					weight[order[k]] = Real(0);
+					layerMask[order[k]] = Real(0);
+				}
+				
+				parameters.GetWeight(l).ReadFrom(weight);
+				mask->GetWeight(l).ReadFrom(layerMask);
+			}
+			
+			return mask;
+		}
+	};
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Types.h>
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+namespace nn
+{
+	struct AllocationStatistics
+	{
+		size_t count = 0;
+		size_t bytes = 0;
+	};
+	
+	// Counts the buffers allocated by the library (workspaces, arenas, parameters, optimizer states, ...), by phase and
+	// by memory space. The phase is a per-thread label, set by means of AllocationPhase.
+	// NB: only the allocations done on purpose are recorded: the ones hidden in CudaLight temporaries aren't
+	class AllocationTracker
+	{
+	public:
+		using Key = std::tuple<std::string, MemorySpace>;
+		
+		static AllocationTracker& Instance() noexcept
+		{
+			static AllocationTracker instance;
+			return instance;
+		}
+		
+		static const char*& GetPhase() noexcept
+		{
+			thread_local const char* phase = "Setup";
+			return phase;
+		}
+		
+		void Record(const MemorySpace memorySpace, const size_t bytes) noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto& entry = _statistics[Key(GetPhase(), memorySpace)];
+			++entry.count;
+			entry.bytes += bytes;
+			
+			++_total.count;
+			_total.bytes += bytes;
+		}
+		
+		inline void Record(const MemoryBuffer& buffer) noexcept { Record(buffer.memorySpace, buffer.TotalSize()); }
+		
+		AllocationStatistics GetTotal() const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _total;
+		}
+		
+		std::map<Key, AllocationStatistics> GetStatistics() const
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _statistics;
+		}
+		
+		void Reset() noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_statistics.clear();
+			_total = AllocationStatistics();
+		}
+		
+		std::ostream& WriteSummary(std::ostream& stream) const
+		{
+			const auto statistics = GetStatistics();
+			
+			stream << "phase\tmemorySpace\tcount\tbytes\n";
+			for (const auto& entry: statistics)
+				stream << std::get<0>(entry.first) << "\t" << ToString(std::get<1>(entry.first)) << "\t" << entry.second.count << "\t" << entry.second.bytes << "\n";
+			
+			return stream;
+		}
+		
+		static std::string ToString(const MemorySpace memorySpace) noexcept
+		{
+			switch (memorySpace)
+			{
+				case MemorySpace::Host:
+					return "Host";
+				case MemorySpace::Device:
+					return "Device";
+				case MemorySpace::Test:
+					return "Test";
+				default:
+					return "?";
+			}
+		}
+	
+	private:
+		AllocationTracker() noexcept = default;
+		
+		mutable std::mutex _mutex {};
+		std::map<Key, AllocationStatistics> _statistics {};
+		AllocationStatistics _total {};
+	};
+	
+	// labels the allocations of the current thread until it goes out of scope
+	// NB: the name must be a string literal
+	class AllocationPhase
+	{
+	public:
+		explicit AllocationPhase(const char* phase) noexcept
+			: _previousPhase(AllocationTracker::GetPhase())
+		{
+			AllocationTracker::GetPhase() = phase;
+		}
+		
+		~AllocationPhase()
+		{
+			AllocationTracker::GetPhase() = _previousPhase;
+		}
+		
+		AllocationPhase(const AllocationPhase&) = delete;
+		AllocationPhase& operator=(const AllocationPhase&) = delete;
+	
+	private:
+		const char* _previousPhase;
+	};
+}
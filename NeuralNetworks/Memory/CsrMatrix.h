@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/NeuralNetworksManager.h>
+#include <NeuralNetworks/Memory/AllocationTracker.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace nn
+{
+	// Compressed sparse row copy of a (mostly zero) matrix: the nonzeros and their column indices, row by row, and the
+	// offset of every row in them. Storage, and the cost of Multiply, are proportional to the number of nonzeros.
+	template<MathDomain mathDomain>
+	class CsrMatrix
+	{
+		using Real = typename Traits<mathDomain>::stdType;
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		using IndexVector = cl::Vector<MemorySpace::Device, MathDomain::Int>;
+	
+	public:
+		explicit CsrMatrix(const Matrix& dense) noexcept
+			: _nRows(dense.nRows()), _nCols(dense.nCols())
+		{
+			const auto values = dense.Get();
+			
+			std::vector<Real> nonZeros;
+			std::vector<int> columnIndices;
+			std::vector<int> rowPointers(1, 0);
+			for (size_t i = 0; i < _nRows; ++i)
+			{
+				for (size_t j = 0; j < _nCols; ++j)
+				{
+					const Real value = values[i + j * _nRows];
+					if (value == Real(0))
+						continue;
+					
+					nonZeros.push_back(value);
+					columnIndices.push_back(static_cast<int>(j));
+				}
+				rowPointers.push_back(static_cast<int>(nonZeros.size()));
+			}
+			_nNonZeros = nonZeros.size();
+			
+			// NB: buffers can't be empty, an all-zero matrix keeps one unused element
+			const auto nElements = static_cast<unsigned>(std::max<size_t>(1, _nNonZeros));
+			_values = std::make_unique<Vector>(nElements, 0.0);
+			_columnIndices = std::make_unique<IndexVector>(nElements, 0.0);
+			if (_nNonZeros > 0)
+			{
+				_values->ReadFrom(nonZeros);
+				_columnIndices->ReadFrom(columnIndices);
+			}
+			_rowPointers = std::make_unique<IndexVector>(static_cast<unsigned>(rowPointers.size()), 0.0);
+			_rowPointers->ReadFrom(rowPointers);
+			
+			AllocationTracker::Instance().Record(_values->GetBuffer());
+			AllocationTracker::Instance().Record(_columnIndices->GetBuffer());
+			AllocationTracker::Instance().Record(_rowPointers->GetBuffer());
+		}
+		
+		CsrMatrix(const CsrMatrix&) = delete;
+		CsrMatrix& operator=(const CsrMatrix&) = delete;
+		
+		inline size_t nRows() const noexcept { return _nRows; }
+		inline size_t nCols() const noexcept { return _nCols; }
+		inline size_t GetNumberOfNonZeros() const noexcept { return _nNonZeros; }
+		inline double GetSparsity() const noexcept { return 1.0 - static_cast<double>(_nNonZeros) / static_cast<double>(_nRows * _nCols); }
+		inline size_t GetNumberOfBytes() const noexcept { return _nNonZeros * (sizeof(Real) + sizeof(int)) + (_nRows + 1) * sizeof(int); }
+		
+		// out = this * x + bias, bias being broadcast over the columns
+		void Multiply(Matrix& out, const Matrix& x, const Vector& bias) const noexcept
+		{
+			assert(x.nRows() == _nCols);
+			assert(out.nRows() == _nRows && out.nCols() == x.nCols());
+			assert(bias.size() == _nRows);
+			
+			detail::CsrMultiply(out.GetBuffer(), _values->GetBuffer(), _columnIndices->GetBuffer(), _rowPointers->GetBuffer(), x.GetBuffer(), bias.GetBuffer());
+		}
+	
+	private:
+		size_t _nRows;
+		size_t _nCols;
+		size_t _nNonZeros = 0;
+		
+		std::unique_ptr<Vector> _values {};
+		std::unique_ptr<IndexVector> _columnIndices {};
+		std::unique_ptr<IndexVector> _rowPointers {};
+	};
+}
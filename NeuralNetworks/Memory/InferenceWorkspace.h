@@ -0,0 +1,98 @@
+#pragma once
+
+#include <NeuralNetworks/Workspace.h>
+
+#include <array>
+#include <vector>
+
+namespace nn
+{
+	template <MathDomain mathDomain> class NetworkTopology;
+	
+	// Buffers for inference only: hidden layers write alternately into two buffers sized for the widest hidden layer,
+	// as each layer only needs the output of the previous one. The last layer writes straight into the caller's output,
+	// so the memory is 2 * widest hidden layer * nCols, regardless of the depth of the network.
+	template<MathDomain mathDomain>
+	class InferenceWorkspace
+	{
+	public:
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		
+		explicit InferenceWorkspace(const NetworkTopology<mathDomain>& topology, const size_t capacity = 0) noexcept
+			: _views(topology.GetSize())
+		{
+			for (size_t l = 0; l + 1 < topology.GetSize(); ++l)
+				_nMaxRows = std::max(_nMaxRows, topology[l]->GetNumberOfOutputs());
+			
+			Reserve(capacity);
+		}
+		
+		void Reserve(const size_t capacity) noexcept
+		{
+			_ones.Reserve(capacity);
+			if (capacity <= _capacity)
+				return;
+			
+			for (auto& view: _views)
+				view.reset();
+			
+			if (_nMaxRows > 0)
+			{
+				for (auto& buffer: _buffers)
+				{
+					buffer = std::make_unique<Vector>(static_cast<unsigned>(_nMaxRows * capacity), 0.0);
+					AllocationTracker::Instance().Record(buffer->GetBuffer());
+				}
+			}
+			_capacity = capacity;
+		}
+		
+		// output buffer of the given hidden layer
+		Matrix& Get(const size_t layer, const size_t nRows, const size_t nCols) noexcept
+		{
+			assert(nRows <= _nMaxRows);
+			Reserve(nCols);
+			
+			auto& view = _views[layer];
+			if (!view || view->nCols() != nCols)
+				view = std::make_unique<Matrix>(detail::MakeMatrixView<mathDomain>(_buffers[layer % 2]->GetBuffer().pointer, nRows, nCols));
+			
+			return *view;
+		}
+		
+		inline Vector& GetOnes(const size_t nCols) noexcept { return _ones.Get(nCols); }
+		
+		// scratch of the column-wise activations (i.e. SoftMax): one element per column, and ones over the rows
+		// NB: kept apart from the ones above, which execution plans borrow
+		inline Vector& GetColumnScratch(const size_t nCols) noexcept { return _columnScratch.Get(nCols); }
+		inline Vector& GetRowOnes(const size_t nRows) noexcept { return _rowOnes.Get(nRows); }
+		
+		// intermediate product of the layers that go through two GEMMs (i.e. the low-rank layers' V x)
+		inline Matrix GetProductScratch(const size_t nRows, const size_t nCols) noexcept { return MakeScratch(_productScratch, nRows, nCols); }
+		
+		// z of a layer whose activation is applied straight into the output, so that it never runs in place
+		inline Matrix GetZScratch(const size_t nRows, const size_t nCols) noexcept { return MakeScratch(_zScratch, nRows, nCols); }
+		
+		inline size_t GetCapacity() const noexcept { return _capacity; }
+		inline size_t GetNumberOfMaxRows() const noexcept { return _nMaxRows; }
+	
+	private:
+		static Matrix MakeScratch(VectorWorkspace<mathDomain>& scratch, const size_t nRows, const size_t nCols) noexcept
+		{
+			return detail::MakeMatrixView<mathDomain>(scratch.Get(nRows * nCols).GetBuffer().pointer, nRows, nCols);
+		}
+	
+	private:
+		size_t _nMaxRows = 0;
+		size_t _capacity = 0;
+		
+		std::array<std::unique_ptr<Vector>, 2> _buffers {};
+		std::vector<std::unique_ptr<Matrix>> _views;  // one per layer, as the shape changes every layer
+		VectorWorkspace<mathDomain> _ones { 0, 1.0 };
+		VectorWorkspace<mathDomain> _columnScratch { 0, 0.0 };
+		VectorWorkspace<mathDomain> _rowOnes { 0, 1.0 };
+		VectorWorkspace<mathDomain> _productScratch { 0, 0.0 };
+		VectorWorkspace<mathDomain> _zScratch { 0, 0.0 };
+	};
+}
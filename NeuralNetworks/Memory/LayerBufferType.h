@@ -0,0 +1,15 @@
+#pragma once
+
+namespace nn
+{
+	// scratch buffers used while training a layer
+	enum class LayerBufferType
+	{
+		Z,  // weight * input + bias
+		Activation,
+		ActivationGradient,
+		BackPropagation,  // dL/dz, owned by the optimizers
+		
+		__END__
+	};
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+
+namespace nn
+{
+	// Assigns offsets in a single arena to a set of buffers, given the first and last step at which each of them is
+	// used: buffers whose lifetimes don't overlap are allowed to share the same memory.
+	// Placement is greedy (biggest buffers first, lowest offset that fits), which is what most frameworks do.
+	class MemoryPlanner
+	{
+	public:
+		static constexpr size_t alignment = { 64 };
+		
+		// returns the id to use for retrieving the offset once planned
+		size_t Add(const size_t nBytes, const size_t firstStep, const size_t lastStep) noexcept
+		{
+			assert(firstStep <= lastStep);
+			_requests.push_back({ AlignUp(nBytes), firstStep, lastStep, 0 });
+			_isPlanned = false;
+			
+			return _requests.size() - 1;
+		}
+		
+		void Plan() noexcept
+		{
+			std::vector<size_t> order(_requests.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](const size_t i, const size_t j) { return _requests[i].nBytes > _requests[j].nBytes; });
+			
+			_peakBytes = 0;
+			std::vector<size_t> placed;
+			std::vector<std::pair<size_t, size_t>> busyIntervals;
+			for (const size_t id: order)
+			{
+				auto& request = _requests[id];
+				
+				// memory intervals used by the buffers that are alive at the same time
+				busyIntervals.clear();
+				for (const size_t other: placed)
+				{
+					const auto& otherRequest = _requests[other];
+					if (request.firstStep <= otherRequest.lastStep && otherRequest.firstStep <= request.lastStep)
+						busyIntervals.emplace_back(otherRequest.offset, otherRequest.offset + otherRequest.nBytes);
+				}
+				std::sort(busyIntervals.begin(), busyIntervals.end());
+				
+				// first gap that fits
+				size_t offset = 0;
+				for (const auto& interval: busyIntervals)
+				{
+					if (offset + request.nBytes <= interval.first)
+						break;
+					offset = std::max(offset, interval.second);
+				}
+				
+				request.offset = offset;
+				placed.push_back(id);
+				_peakBytes = std::max(_peakBytes, offset + request.nBytes);
+			}
+			
+			_isPlanned = true;
+		}
+		
+		inline size_t GetOffset(const size_t id) const noexcept { assert(_isPlanned); return _requests[id].offset; }
+		inline size_t GetSize(const size_t id) const noexcept { return _requests[id].nBytes; }
+		inline size_t GetPeakBytes() const noexcept { assert(_isPlanned); return _peakBytes; }
+		inline size_t GetNumberOfBuffers() const noexcept { return _requests.size(); }
+		
+		// memory that would be used if every buffer had its own allocation
+		size_t GetTotalBytes() const noexcept
+		{
+			size_t ret = 0;
+			for (const auto& request: _requests)
+				ret += request.nBytes;
+			return ret;
+		}
+		
+		static constexpr size_t AlignUp(const size_t nBytes) noexcept { return (nBytes + alignment - 1) / alignment * alignment; }
+	
+	private:
+		struct Request
+		{
+			size_t nBytes;
+			size_t firstStep;
+			size_t lastStep;
+			size_t offset;
+		};
+		
+		std::vector<Request> _requests {};
+		size_t _peakBytes = 0;
+		bool _isPlanned = false;
+	};
+}
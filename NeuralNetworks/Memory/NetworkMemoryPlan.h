@@ -0,0 +1,132 @@
+#pragma once
+
+#include <NeuralNetworks/Memory/MemoryPlanner.h>
+#include <NeuralNetworks/Memory/LayerBufferType.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+
+#include <array>
+#include <limits>
+
+namespace nn
+{
+	// Computes the lifetime of every scratch buffer of a topology over a forward and backward pass of up to capacity
+	// columns, and lays them out in a single arena so that buffers which are never alive at the same time share memory.
+	// Steps are numbered as: forward of layer l -> l, backward of layer l -> 2 * nLayers - 1 - l
+	template<MathDomain mathDomain>
+	class NetworkMemoryPlan
+	{
+		using Arena = cl::Vector<MemorySpace::Device, mathDomain>;
+		static constexpr size_t npos = std::numeric_limits<size_t>::max();
+	
+	public:
+		NetworkMemoryPlan(const NetworkTopology<mathDomain>& topology, const size_t capacity, const bool training = true) noexcept
+			: _capacity(capacity), _elementSize(MemoryBuffer(0, 1, MemorySpace::Device, mathDomain).ElementarySize())
+		{
+			const size_t nLayers = topology.GetSize();
+			const auto backwardStep = [nLayers](const size_t l) { return 2 * nLayers - 1 - l; };
+			
+			_ids.resize(nLayers);
+			for (size_t l = 0; l < nLayers; ++l)
+			{
+				const size_t nBytes = topology[l]->GetNumberOfOutputs() * capacity * _elementSize;
+				auto& ids = _ids[l];
+				ids.fill(npos);
+				
+				// z is only needed for computing the activation and its gradient
+				ids[static_cast<size_t>(LayerBufferType::Z)] = _planner.Add(nBytes, l, l);
+				
+				if (!training)
+				{
+					ids[static_cast<size_t>(LayerBufferType::Activation)] = _planner.Add(nBytes, l, l + 1);
+					ids[static_cast<size_t>(LayerBufferType::ActivationGradient)] = _planner.Add(nBytes, l, l);
+					continue;
+				}
+				
+				// activations are needed for the weight gradient of the next layer. The last layer's activation gets
+				// overwritten with dL/dz_L, and is consumed when back-propagating into the layer before
+				size_t activationLastStep = backwardStep(l);
+				if (l + 1 < nLayers)
+					activationLastStep = backwardStep(l + 1);
+				else if (nLayers > 1)
+					activationLastStep = backwardStep(l - 1);
+				ids[static_cast<size_t>(LayerBufferType::Activation)] = _planner.Add(nBytes, l, activationLastStep);
+				
+				ids[static_cast<size_t>(LayerBufferType::ActivationGradient)] = _planner.Add(nBytes, l, backwardStep(l));
+				
+				// dL/dz_l is produced when back-propagating through layer l, and consumed by layer l - 1
+				if (l + 1 < nLayers)
+					ids[static_cast<size_t>(LayerBufferType::BackPropagation)] = _planner.Add(nBytes, backwardStep(l), l > 0 ? backwardStep(l - 1) : backwardStep(l));
+			}
+			
+			_planner.Plan();
+		}
+		
+		~NetworkMemoryPlan()
+		{
+			// layers must not outlive the arena they borrowed memory from: they'll allocate their own on demand.
+			// NB: workspaces since bound to another plan are left alone
+			if (!_boundTopology)
+				return;
+			
+			for (size_t l = 0; l < _boundTopology->GetSize(); ++l)
+			{
+				for (const auto type: { LayerBufferType::Z, LayerBufferType::Activation, LayerBufferType::ActivationGradient })
+				{
+					auto& workspace = (*_boundTopology)[l]->GetWorkspace(type);
+					if (workspace.IsBound() && workspace.GetPointer() == GetPointer(type, l))
+						workspace.Bind(0, 0);
+				}
+			}
+		}
+		
+		NetworkMemoryPlan(const NetworkMemoryPlan&) = delete;
+		NetworkMemoryPlan& operator=(const NetworkMemoryPlan&) = delete;
+		
+		// bind the layers' buffers to the arena, which gets allocated at the first call
+		void Bind(const NetworkTopology<mathDomain>& topology) noexcept
+		{
+			assert(topology.GetSize() == _ids.size());
+			Allocate();
+			
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+				for (const auto type: { LayerBufferType::Z, LayerBufferType::Activation, LayerBufferType::ActivationGradient })
+					topology[l]->GetWorkspace(type).Bind(GetPointer(type, l), _capacity);
+			
+			_boundTopology = &topology;
+		}
+		
+		std::ptrdiff_t GetPointer(const LayerBufferType type, const size_t layer) noexcept
+		{
+			const size_t id = _ids[layer][static_cast<size_t>(type)];
+			assert(id != npos);
+			
+			Allocate();
+			return _arena->GetBuffer().pointer + static_cast<std::ptrdiff_t>(_planner.GetOffset(id));
+		}
+		
+		inline size_t GetCapacity() const noexcept { return _capacity; }
+		inline size_t GetPeakBytes() const noexcept { return _planner.GetPeakBytes(); }
+		inline size_t GetTotalBytes() const noexcept { return _planner.GetTotalBytes(); }
+	
+	private:
+		void Allocate() noexcept
+		{
+			if (_arena)
+				return;
+			
+			const size_t nElements = (_planner.GetPeakBytes() + _elementSize - 1) / _elementSize;
+			_arena = std::make_unique<Arena>(static_cast<unsigned>(std::max<size_t>(nElements, 1)), 0.0);
+			AllocationTracker::Instance().Record(_arena->GetBuffer());
+		}
+	
+	private:
+		const size_t _capacity;
+		const size_t _elementSize;
+		
+		MemoryPlanner _planner {};
+		std::vector<std::array<size_t, static_cast<size_t>(LayerBufferType::__END__)>> _ids {};
+		
+		std::unique_ptr<Arena> _arena {};
+		const NetworkTopology<mathDomain>* _boundTopology = nullptr;
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <NeuralNetworks/Memory/MemoryPlanner.h>
+#include <NeuralNetworks/Workspace.h>
+
+#include <vector>
+#include <memory>
+
+namespace nn
+{
+	// All the weights and biases of a network (or their gradients) in a single flat buffer, laid out as
+	// [W_0 | W_1 | ... | b_0 | b_1 | ...], every block being aligned as the memory planner ones.
+	// Whole-network operations (updates, weight decay, norms, checkpoint copies, all-reduce) then take a single pass
+	// over contiguous memory, while the per-layer views can still be used as ordinary matrices and vectors.
+	// NB: padding between blocks is zero-initialised, and stays so as long as it's only combined with buffers with
+	// the same layout
+	template<MathDomain mathDomain>
+	class ParameterBuffer
+	{
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+	
+	public:
+		// shapes are the weight ones, as in NetworkTopology::GetTransposedSizes, and every bias has shape.first elements
+		explicit ParameterBuffer(const std::vector<std::pair<size_t, size_t>>& shapes) noexcept
+			: _elementSize(MemoryBuffer(0, 1, MemorySpace::Device, mathDomain).ElementarySize())
+		{
+			std::vector<size_t> weightOffsets;
+			std::vector<size_t> biasOffsets;
+			
+			size_t nBytes = 0;
+			for (const auto& shape: shapes)
+			{
+				weightOffsets.push_back(nBytes);
+				nBytes += MemoryPlanner::AlignUp(shape.first * shape.second * _elementSize);
+			}
+			_nWeightElements = nBytes / _elementSize;
+			
+			for (const auto& shape: shapes)
+			{
+				biasOffsets.push_back(nBytes);
+				nBytes += MemoryPlanner::AlignUp(shape.first * _elementSize);
+			}
+			
+			_buffer = std::make_unique<Vector>(static_cast<unsigned>(nBytes / _elementSize), 0.0);
+			AllocationTracker::Instance().Record(_buffer->GetBuffer());
+			
+			const auto pointer = _buffer->GetBuffer().pointer;
+			_weights.reserve(shapes.size());
+			_biases.reserve(shapes.size());
+			for (size_t l = 0; l < shapes.size(); ++l)
+			{
+				_weights.emplace_back(detail::MakeMatrixView<mathDomain>(pointer + static_cast<std::ptrdiff_t>(weightOffsets[l]), shapes[l].first, shapes[l].second));
+				_biases.emplace_back(detail::MakeVectorView<mathDomain>(pointer + static_cast<std::ptrdiff_t>(biasOffsets[l]), shapes[l].first));
+			}
+			_weightRegion = std::make_unique<Vector>(detail::MakeVectorView<mathDomain>(pointer, _nWeightElements));
+			_biasRegion = std::make_unique<Vector>(detail::MakeVectorView<mathDomain>(pointer + static_cast<std::ptrdiff_t>(_nWeightElements * _elementSize), nBytes / _elementSize - _nWeightElements));
+		}
+		
+		ParameterBuffer(const ParameterBuffer&) = delete;
+		ParameterBuffer& operator=(const ParameterBuffer&) = delete;
+		
+		inline size_t GetNumberOfLayers() const noexcept { return _weights.size(); }
+		
+		inline Matrix& GetWeight(const size_t l) noexcept { return _weights[l]; }
+		inline const Matrix& GetWeight(const size_t l) const noexcept { return _weights[l]; }
+		inline Vector& GetBias(const size_t l) noexcept { return _biases[l]; }
+		inline const Vector& GetBias(const size_t l) const noexcept { return _biases[l]; }
+		
+		// every parameter, including padding
+		inline Vector& Get() noexcept { return *_buffer; }
+		inline const Vector& Get() const noexcept { return *_buffer; }
+		
+		// weights only (e.g. for the L2 regularisation)
+		inline Vector& GetWeights() noexcept { return *_weightRegion; }
+		inline const Vector& GetWeights() const noexcept { return *_weightRegion; }
+		
+		// biases only, i.e. everything after the weights
+		inline Vector& GetBiases() noexcept { return *_biasRegion; }
+		inline const Vector& GetBiases() const noexcept { return *_biasRegion; }
+		
+		void Zero() noexcept { dm::detail::Zero(_buffer->GetBuffer()); }
+	
+	private:
+		size_t _elementSize;
+		size_t _nWeightElements = 0;
+		
+		std::unique_ptr<Vector> _buffer {};
+		std::unique_ptr<Vector> _weightRegion {};
+		std::unique_ptr<Vector> _biasRegion {};
+		std::vector<Matrix> _weights {};
+		std::vector<Vector> _biases {};
+	};
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/NeuralNetworksManager.h>
+#include <NeuralNetworks/Memory/ParameterBuffer.h>
+#include <NeuralNetworks/CostFunctions/ICostFunction.h>
+#include <NeuralNetworks/Optimizers/Shufflers/IShuffler.h>
+#include <NeuralNetworks/Profiler.h>
+
+#include <memory>
+#include <vector>
+
+namespace nn
+{
+	// K fully connected models with the same shape (e.g. an ensemble, or the same network with different seeds),
+	// trained together on the same data. Their parameters are stacked in a single ParameterBuffer, the ones of layer l
+	// being [W_l^0 | W_l^1 | ... | W_l^{K-1}] and [b_l^0 | ... | b_l^{K-1}], and their activations side by side, model k
+	// taking the columns [k * nCols, (k + 1) * nCols). So that:
+	//  - every product (forward, weight gradient, input gradient, bias broadcast and reduction) is a single batched
+	//    GEMM over the K models, rather than K small ones
+	//  - activations, their gradients and the cost function gradient are a single element-wise (or column-wise) call
+	//    over all of them
+	//  - the update is a single pass over the stacked parameters
+	// Training is the same as BatchedSgd's, model by model. Any model can be exported as a normal Network.
+	template<MathDomain mathDomain>
+	class ModelBatch
+	{
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		
+		struct LayerShape
+		{
+			LayerType type;
+			size_t nInput;
+			size_t nOutput;
+			std::unique_ptr<IActivationFunction<mathDomain>> activationFunction;
+		};
+	
+	public:
+		// the models' parameters are copied, and they can be dropped afterwards
+		ModelBatch(const std::vector<NetworkTopology<mathDomain>>& models,
+		           const size_t miniBatchSize,
+		           std::unique_ptr<ICostFunction<mathDomain>>&& costFunction,
+		           std::unique_ptr<IShuffler<mathDomain>>&& miniBatchShuffler) noexcept
+			: _nModels(models.size()), _costFunction(std::move(costFunction)), _miniBatchShuffler(std::move(miniBatchShuffler))
+		{
+			assert(IsSupported(models));
+			
+			const auto& prototype = models.front();
+			std::vector<std::pair<size_t, size_t>> shapes;
+			for (const auto& layer: prototype)
+			{
+				_layers.push_back({ layer->GetType(), layer->GetNumberOfInputs(), layer->GetNumberOfOutputs(), ActivationFunctionFactory<mathDomain>::Create(layer->GetActivationFunctionType()) });
+				shapes.emplace_back(_nModels * layer->GetNumberOfOutputs(), layer->GetNumberOfInputs());
+				
+				_z.emplace_back(layer->GetNumberOfOutputs(), _nModels * miniBatchSize);
+				_activations.emplace_back(layer->GetNumberOfOutputs(), _nModels * miniBatchSize);
+				_activationGradients.emplace_back(layer->GetNumberOfOutputs(), _nModels * miniBatchSize);
+				_deltas.emplace_back(layer->GetNumberOfOutputs(), _nModels * miniBatchSize);
+			}
+			_expectedOutput = std::make_unique<Workspace<mathDomain>>(_layers.back().nOutput, _nModels * miniBatchSize);
+			_ones.Reserve(miniBatchSize);
+			
+			_parameters = std::make_unique<ParameterBuffer<mathDomain>>(shapes);
+			_gradients = std::make_unique<ParameterBuffer<mathDomain>>(shapes);
+			for (size_t k = 0; k < _nModels; ++k)
+			{
+				for (size_t l = 0; l < _layers.size(); ++l)
+				{
+					GetWeight(l, k).ReadFrom(models[k].GetParameters().GetWeight(l));
+					GetBias(l, k).ReadFrom(models[k].GetParameters().GetBias(l));
+				}
+			}
+			
+			// softmax + log-likelihood and the like: the cost function gradient already accounts for the activation
+			const auto& lastActivation = _layers.back().activationFunction;
+			_needGradient = !lastActivation || lastActivation->GetBestCostFunction() != _costFunction->GetType();
+		}
+		
+		ModelBatch(const ModelBatch&) = delete;
+		ModelBatch& operator=(const ModelBatch&) = delete;
+		
+		// at least one model, all of them with the same fully connected layers
+		static bool IsSupported(const std::vector<NetworkTopology<mathDomain>>& models) noexcept
+		{
+			if (models.empty())
+				return false;
+			
+			const auto& prototype = models.front();
+			for (const auto& model: models)
+			{
+				if (model.GetSize() != prototype.GetSize())
+					return false;
+				
+				for (size_t l = 0; l < prototype.GetSize(); ++l)
+				{
+					const auto& layer = *model[l];
+					if (layer.GetType() != LayerType::Dense && layer.GetType() != LayerType::SoftMax)
+						return false;
+					if (layer.GetType() != prototype[l]->GetType() || layer.GetActivationFunctionType() != prototype[l]->GetActivationFunctionType())
+						return false;
+					if (layer.GetNumberOfInputs() != prototype[l]->GetNumberOfInputs() || layer.GetNumberOfOutputs() != prototype[l]->GetNumberOfOutputs())
+						return false;
+				}
+			}
+			
+			return true;
+		}
+		
+		inline size_t GetNumberOfModels() const noexcept { return _nModels; }
+		inline const ParameterBuffer<mathDomain>& GetParameters() const noexcept { return *_parameters; }
+		
+		// views on the k-th model's parameters
+		Matrix GetWeight(const size_t l, const size_t k) const noexcept
+		{
+			const auto& weights = _parameters->GetWeight(l).GetBuffer();
+			const auto offset = static_cast<std::ptrdiff_t>(k * _layers[l].nOutput * _layers[l].nInput * weights.ElementarySize());
+			return detail::MakeMatrixView<mathDomain>(weights.pointer + offset, _layers[l].nOutput, _layers[l].nInput);
+		}
+		Vector GetBias(const size_t l, const size_t k) const noexcept
+		{
+			const auto& biases = _parameters->GetBias(l).GetBuffer();
+			const auto offset = static_cast<std::ptrdiff_t>(k * _layers[l].nOutput * biases.ElementarySize());
+			return detail::MakeVectorView<mathDomain>(biases.pointer + offset, _layers[l].nOutput);
+		}
+		
+		// one epoch of mini-batches, as BatchedGradientOptimizer::Train
+		// NB: every model sees the same (shuffled) data, and micro-batches are not used
+		void Train(const NetworkTrainingData<mathDomain>& networkTrainingData) noexcept
+		{
+			{
+				NN_PROFILE_SCOPE("Shuffle");
+				const AllocationPhase allocationPhase("Shuffle");
+				_miniBatchShuffler->Shuffle(networkTrainingData.trainingData.input, networkTrainingData.trainingData.expectedOutput);
+			}
+			
+			const auto& hyperParameters = networkTrainingData.hyperParameters;
+			const size_t nSamples = networkTrainingData.trainingData.GetNumberOfSamples();
+			const size_t nMiniBatchIterations = nSamples / hyperParameters.miniBatchSize;
+			for (size_t n = 0; n < nMiniBatchIterations; ++n)
+			{
+				NN_PROFILE_SCOPE("MiniBatch");
+				const AllocationPhase allocationPhase("MiniBatch");
+				
+				const size_t startIndex = n * hyperParameters.miniBatchSize;
+				const size_t endIndex = std::min(nSamples, startIndex + hyperParameters.miniBatchSize);
+				const auto input = detail::MakeColumnsView<mathDomain>(networkTrainingData.trainingData.input, startIndex, endIndex);
+				const auto expectedOutput = detail::MakeColumnsView<mathDomain>(networkTrainingData.trainingData.expectedOutput, startIndex, endIndex);
+				
+				_gradients->Zero();
+				Evaluate(input, true);
+				BackPropagate(input, expectedOutput);
+				
+				// same fused pass as GradientOptimizer::UpdateParameters, for every layer of every model at once:
+				// W = (1 - eta * lambda / n) * W - eta / m * dW, the decay only applying to the weight region
+				const double averageLearningRate = hyperParameters.GetAverageLearningRate();
+				const double regularizationFactor = 1.0 - (hyperParameters.learningRate * hyperParameters.lambda) / static_cast<double>(nSamples);
+				
+				ParameterUpdateSettings settings;
+				settings.type = ParameterUpdateType::GradientDescent;
+				settings.learningRate = 1.0;
+				settings.gradientScale = averageLearningRate;
+				settings.decay = 1.0 - regularizationFactor;
+				settings.decayedSize = static_cast<unsigned>(_parameters->GetWeights().size());
+				
+				MemoryBuffer emptyState {};
+				nn::detail::UpdateParameters(_parameters->Get().GetBuffer(), emptyState, emptyState, _gradients->Get().GetBuffer(), settings);
+			}
+		}
+		
+		// output is (nOutput, nModels * input.nCols()), model k taking the columns [k * input.nCols(), (k + 1) * input.nCols())
+		void Infer(Matrix& output, const Matrix& input) noexcept
+		{
+			assert(output.nRows() == _layers.back().nOutput && output.nCols() == _nModels * input.nCols());
+			
+			Evaluate(input, false);
+			output.ReadFrom(_activations.back().Get(_nModels * input.nCols()));
+		}
+		
+		// the k-th model, on its own
+		std::unique_ptr<Network<mathDomain>> Export(const size_t k) const noexcept
+		{
+			assert(k < _nModels);
+			
+			std::vector<std::unique_ptr<ILayer<mathDomain>>> layers;
+			for (const auto& layer: _layers)
+			{
+				auto activationFunction = ActivationFunctionFactory<mathDomain>::Create(layer.activationFunction ? layer.activationFunction->GetType() : ActivationFunctionType::Null);
+				layers.emplace_back(LayerFactory<mathDomain>::Create(layer.type, static_cast<unsigned>(layer.nInput), static_cast<unsigned>(layer.nOutput),
+				                                                     std::move(activationFunction), std::move(TrivialBiasWeightInitializer<mathDomain>())));
+			}
+			
+			NetworkTopology<mathDomain> topology(std::move(layers));
+			auto& parameters = topology.GetParameters();
+			for (size_t l = 0; l < _layers.size(); ++l)
+			{
+				parameters.GetWeight(l).ReadFrom(GetWeight(l, k));
+				parameters.GetBias(l).ReadFrom(GetBias(l, k));
+			}
+			
+			return std::make_unique<Network<mathDomain>>(std::move(topology));
+		}
+	
+	private:
+		// c_k = op(a_k) * op(b_k) + beta * c_k, for k < nModels
+		void Multiply(MemoryBuffer& c, const MemoryBuffer& a, const MemoryBuffer& b,
+		              const size_t nRows, const size_t nCols, const size_t nInner,
+		              const bool transposeA, const bool transposeB,
+		              const size_t aStride, const size_t bStride, const size_t cStride, const double beta) const noexcept
+		{
+			BatchedMultiplyGeometry geometry;
+			geometry.nBatches = static_cast<unsigned>(_nModels);
+			geometry.nRows = static_cast<unsigned>(nRows);
+			geometry.nCols = static_cast<unsigned>(nCols);
+			geometry.nInner = static_cast<unsigned>(nInner);
+			geometry.transposeA = transposeA;
+			geometry.transposeB = transposeB;
+			geometry.aStride = static_cast<unsigned>(aStride);
+			geometry.bStride = static_cast<unsigned>(bStride);
+			geometry.cStride = static_cast<unsigned>(cStride);
+			geometry.beta = beta;
+			detail::BatchedMultiply(c, a, b, geometry);
+		}
+		
+		// the input is shared by every model, the following layers' ones are stacked
+		void Evaluate(const Matrix& input, const bool needGradient) noexcept
+		{
+			const size_t nCols = input.nCols();
+			const auto& ones = _ones.Get(nCols);
+			
+			const Matrix* layerInput = &input;
+			size_t inputStride = 0;
+			for (size_t l = 0; l < _layers.size(); ++l)
+			{
+				NN_PROFILE_SCOPE_INDEXED("Forward", l);
+				const auto& layer = _layers[l];
+				
+				// z_k = W_k * x_k + b_k
+				auto& z = _z[l].Get(_nModels * nCols);
+				Multiply(z.GetBuffer(), _parameters->GetWeight(l).GetBuffer(), layerInput->GetBuffer(), layer.nOutput, nCols, layer.nInput,
+				         false, false, layer.nOutput * layer.nInput, inputStride, layer.nOutput * nCols, 0.0);
+				Multiply(z.GetBuffer(), _parameters->GetBias(l).GetBuffer(), ones.GetBuffer(), layer.nOutput, nCols, 1,
+				         false, false, layer.nOutput, 0, layer.nOutput * nCols, 1.0);
+				
+				auto& activation = _activations[l].Get(_nModels * nCols);
+				if (layer.activationFunction)
+					layer.activationFunction->Evaluate(activation, z);
+				else
+					activation.ReadFrom(z);
+				
+				if (needGradient && (l + 1 < _layers.size() || _needGradient))
+				{
+					auto& activationGradient = _activationGradients[l].Get(_nModels * nCols);
+					if (layer.activationFunction)
+						layer.activationFunction->EvaluateGradient(activationGradient, z, activation);
+					else
+						activationGradient.Set(1.0);
+				}
+				
+				layerInput = &activation;
+				inputStride = layer.nOutput * nCols;
+			}
+		}
+		
+		// same as BatchedSgd's adjoint differentiation, accumulating into the stacked gradients
+		void BackPropagate(const Matrix& input, const Matrix& expectedOutput) noexcept
+		{
+			const size_t nCols = input.nCols();
+			const size_t nLayers = _layers.size();
+			const auto& ones = _ones.Get(nCols);
+			
+			// the expected output is the same for every model
+			auto& stackedExpectedOutput = _expectedOutput->Get(_nModels * nCols);
+			for (size_t k = 0; k < _nModels; ++k)
+			{
+				auto expectedOutputView = detail::MakeColumnsView<mathDomain>(stackedExpectedOutput, k * nCols, (k + 1) * nCols);
+				expectedOutputView.ReadFrom(expectedOutput);
+			}
+			
+			// NB override last layer's activation with the cost function derivative
+			auto& costFunctionGradient = _activations.back().Get(_nModels * nCols);
+			_costFunction->EvaluateGradient(costFunctionGradient, stackedExpectedOutput, _activationGradients.back().Get(_nModels * nCols));
+			
+			for (size_t l = nLayers; l-- > 0;)
+			{
+				NN_PROFILE_SCOPE_INDEXED("Backward", l);
+				const auto& layer = _layers[l];
+				
+				auto& delta = l == nLayers - 1 ? costFunctionGradient : _deltas[l].Get(_nModels * nCols);
+				if (l < nLayers - 1 && layer.activationFunction)
+					delta %= _activationGradients[l].Get(_nModels * nCols);
+				
+				const Matrix& layerInput = l == 0 ? input : _activations[l - 1].Get(_nModels * nCols);
+				const size_t inputStride = l == 0 ? 0 : layer.nInput * nCols;
+				
+				// dL/dW_k += delta_k * x_k^T
+				Multiply(_gradients->GetWeight(l).GetBuffer(), delta.GetBuffer(), layerInput.GetBuffer(), layer.nOutput, layer.nInput, nCols,
+				         false, true, layer.nOutput * nCols, inputStride, layer.nOutput * layer.nInput, 1.0);
+				
+				// dL/db_k += delta_k * 1
+				Multiply(_gradients->GetBias(l).GetBuffer(), delta.GetBuffer(), ones.GetBuffer(), layer.nOutput, 1, nCols,
+				         false, false, layer.nOutput * nCols, 0, layer.nOutput, 1.0);
+				
+				// dL/dx_k = W_k^T * delta_k
+				if (l > 0)
+				{
+					auto& inputGradient = _deltas[l - 1].Get(_nModels * nCols);
+					Multiply(inputGradient.GetBuffer(), _parameters->GetWeight(l).GetBuffer(), delta.GetBuffer(), layer.nInput, nCols, layer.nOutput,
+					         true, false, layer.nOutput * layer.nInput, layer.nOutput * nCols, layer.nInput * nCols, 0.0);
+				}
+			}
+		}
+	
+	private:
+		const size_t _nModels;
+		std::vector<LayerShape> _layers {};
+		
+		std::unique_ptr<ParameterBuffer<mathDomain>> _parameters {};
+		std::unique_ptr<ParameterBuffer<mathDomain>> _gradients {};
+		
+		const std::unique_ptr<ICostFunction<mathDomain>> _costFunction;
+		const std::unique_ptr<IShuffler<mathDomain>> _miniBatchShuffler;
+		bool _needGradient = true;
+		
+		// stacked buffers, one row per output of the layer and nModels * nCols columns
+		std::vector<Workspace<mathDomain>> _z {};
+		std::vector<Workspace<mathDomain>> _activations {};
+		std::vector<Workspace<mathDomain>> _activationGradients {};
+		std::vector<Workspace<mathDomain>> _deltas {};
+		std::unique_ptr<Workspace<mathDomain>> _expectedOutput {};
+		VectorWorkspace<mathDomain> _ones { 0, 1.0 };
+	};
+}
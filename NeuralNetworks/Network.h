@@ -2,6 +2,11 @@
 
 #include <Optimizers/MiniBatchData.h>
 #include <NeuralNetworks/Stopwatch.h>
+#include <NeuralNetworks/Profiler.h>
+#include <NeuralNetworks/Workspace.h>
+#include <NeuralNetworks/ExecutionPlan.h>
+#include <NeuralNetworks/Memory/NetworkMemoryPlan.h>
+#include <NeuralNetworks/Memory/AllocationTracker.h>
 #include <NeuralNetworks/Layers/Initializers/IBiasWeightInitializer.h>
 #include <NeuralNetworks/Layers/NetworkTopology.h>
 
@@ -10,6 +15,8 @@
 #include <NeuralNetworks/Layers/LayerFactory.h>
 #include <NeuralNetworks/Layers/Initializers/TrivialBiasWeightInitializer.h>
 
+#include <functional>
+
 namespace nn
 {
 	template<MathDomain mathDomain> class IOptimizer;
@@ -19,23 +26,62 @@ namespace nn
 	{
 		using mat = Matrix<mathDomain>;
 		using vec = Vector<mathDomain>;
+		
+		// buffers used by a single evaluation thread
+		struct EvaluationContext
+		{
+			InferenceWorkspace<mathDomain> inferenceWorkspace;
+			Workspace<mathDomain> modelOutput;
+			ExecutionPlanCache<mathDomain> executionPlans;
+			
+			explicit EvaluationContext(const NetworkTopology<mathDomain>& topology) noexcept
+				: inferenceWorkspace(topology), modelOutput(topology.back()->GetNumberOfOutputs())
+			{
+			}
+			
+			// plans borrow the workspace buffers, so they're dropped when these get reallocated
+			void Reserve(const size_t capacity) noexcept
+			{
+				const size_t previousCapacity = inferenceWorkspace.GetCapacity();
+				inferenceWorkspace.Reserve(capacity);
+				if (inferenceWorkspace.GetCapacity() != previousCapacity)
+					executionPlans.Clear();
+			}
+		};
+		
 	public:
+		using Metric = std::function<double(Matrix<mathDomain>&, const Matrix<mathDomain>&)>;
+		
 		explicit Network(NetworkTopology<mathDomain>&& topology) noexcept;
 		
 		explicit Network(std::istream& stream) noexcept;
 		
 		void Evaluate(mat& out, const mat& in, const int debugLevel = 0) const noexcept;
 		
+		// evaluates the network on chunks of chunkSize columns (0 -> all at once), spread over nThreads threads, and
+		// returns the sum of the metric over the chunks. Metric calls are serialised, so it needs not be thread safe
+		double Evaluate(const TrainingData<mathDomain>& data, const Metric& metric, const size_t chunkSize, const size_t nThreads = 1) const noexcept;
+		
 		void Train(IOptimizer<mathDomain>& optimizer, const NetworkTrainingData<mathDomain>& networkTrainingData) noexcept;
 		
 		std::ostream& operator <<(std::ostream& stream) const noexcept override;
 		std::istream& operator >>(std::istream& stream) noexcept override;
 		
 		inline const NetworkTopology<mathDomain>& GetTopology() const noexcept { return _topology; }
-		inline auto GetNumberOfLayers() const noexcept { return _topology().GetSize(); }
+		inline auto GetNumberOfLayers() const noexcept { return _topology.GetSize(); }
+		
+		// bytes needed by the scratch buffers when training with mini-batches of batchCapacity columns
+		size_t GetPlannedPeakMemory(const size_t batchCapacity) const noexcept;
+		
+	private:
+		EvaluationContext& GetEvaluationContext(const size_t thread) const noexcept;
+		
+		void Infer(mat& out, const mat& in, EvaluationContext& context) const noexcept;
 		
 	private:
 		NetworkTopology<mathDomain> _topology;
+		mutable std::vector<std::unique_ptr<EvaluationContext>> _evaluationContexts {};  // reused across calls
+		bool _useExecutionPlan;
 	};
 }
 
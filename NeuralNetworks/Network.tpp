@@ -3,17 +3,23 @@
 #include <NeuralNetworks/CostFunctions/CrossEntropyCostFunction.h>
 #include <NeuralNetworks/Optimizers/IOptimizer.h>
 
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
 namespace nn
 {
 	template<MathDomain mathDomain>
 	Network<mathDomain>::Network(NetworkTopology<mathDomain>&& topology) noexcept
-		: _topology(std::move(topology))
+		: _topology(std::move(topology)), _useExecutionPlan(ExecutionPlan<mathDomain>::IsSupported(_topology))
 	{
 	}
 	
 	template<MathDomain mathDomain>
 	Network<mathDomain>::Network(std::istream& stream) noexcept
-		: _topology(stream)
+		: _topology(stream), _useExecutionPlan(ExecutionPlan<mathDomain>::IsSupported(_topology))
 	{
 	}
 	
@@ -28,46 +34,125 @@ namespace nn
 	std::istream& Network<mathDomain>::operator >>(std::istream& stream) noexcept
 	{
 		_topology >> stream;
+		_evaluationContexts.clear();
+		_useExecutionPlan = ExecutionPlan<mathDomain>::IsSupported(_topology);
 		return stream;
 	}
 	
+	template<MathDomain mathDomain>
+	size_t Network<mathDomain>::GetPlannedPeakMemory(const size_t batchCapacity) const noexcept
+	{
+		return NetworkMemoryPlan<mathDomain>(_topology, batchCapacity).GetPeakBytes();
+	}
+	
 	template<MathDomain mathDomain>
 	void Network<mathDomain>::Evaluate(mat& out, const mat& in, const int debugLevel) const noexcept
 	{
+		NN_PROFILE_SCOPE("Evaluation");
+		const AllocationPhase allocationPhase("Evaluation");
 		Stopwatch sw(true);
 		
-		_topology.Evaluate(in, false, &out);
+		Infer(out, in, GetEvaluationContext(0));
 		
 		sw.Stop();
 		if (debugLevel > 1)
 			std::cout << "\tEvaluation completed in " << sw.GetMilliSeconds() << " ms" << std::endl;
 	}
 	
+	template<MathDomain mathDomain>
+	typename Network<mathDomain>::EvaluationContext& Network<mathDomain>::GetEvaluationContext(const size_t thread) const noexcept
+	{
+		while (_evaluationContexts.size() <= thread)
+			_evaluationContexts.emplace_back(std::make_unique<EvaluationContext>(_topology));
+		
+		return *_evaluationContexts[thread];
+	}
+	
+	template<MathDomain mathDomain>
+	void Network<mathDomain>::Infer(mat& out, const mat& in, EvaluationContext& context) const noexcept
+	{
+		if (!_useExecutionPlan)
+		{
+			_topology.Infer(out, in, context.inferenceWorkspace);
+			return;
+		}
+		
+		const size_t nCols = in.nCols();
+		context.Reserve(nCols);
+		auto& plan = context.executionPlans.Get(nCols, [&]()
+		{
+			return std::make_unique<ExecutionPlan<mathDomain>>(_topology, nCols, context.inferenceWorkspace);
+		});
+		plan.Infer(out, in);
+	}
+	
+	template<MathDomain mathDomain>
+	double Network<mathDomain>::Evaluate(const TrainingData<mathDomain>& data, const Metric& metric, const size_t chunkSize, const size_t nThreads) const noexcept
+	{
+		const size_t nCols = data.GetNumberOfSamples();
+		if (nCols == 0)
+			return 0.0;
+		
+		const size_t actualChunkSize = chunkSize == 0 ? nCols : std::min(chunkSize, nCols);
+		const size_t nChunks = (nCols + actualChunkSize - 1) / actualChunkSize;
+		const size_t actualThreads = std::max<size_t>(1, std::min(nThreads, nChunks));
+		
+		// contexts are created up-front, as the container is not thread safe, and sized for the widest chunk
+		for (size_t t = 0; t < actualThreads; ++t)
+			GetEvaluationContext(t).Reserve(actualChunkSize);
+		
+		std::atomic<size_t> nextChunk { 0 };
+		std::mutex metricMutex;
+		double ret = 0.0;
+		const auto worker = [&](EvaluationContext& context)
+		{
+			for (size_t chunk = nextChunk++; chunk < nChunks; chunk = nextChunk++)
+			{
+				NN_PROFILE_SCOPE("Evaluation");
+				const AllocationPhase allocationPhase("Evaluation");
+				const size_t startIndex = chunk * actualChunkSize;
+				const size_t endIndex = std::min(startIndex + actualChunkSize, nCols);
+				
+				const mat input = detail::MakeColumnsView<mathDomain>(data.input, startIndex, endIndex);
+				const mat expectedOutput = detail::MakeColumnsView<mathDomain>(data.expectedOutput, startIndex, endIndex);
+				auto& modelOutput = context.modelOutput.Get(endIndex - startIndex);
+				Infer(modelOutput, input, context);
+				
+				std::lock_guard<std::mutex> lock(metricMutex);
+				ret += metric(modelOutput, expectedOutput);
+			}
+		};
+		
+		std::vector<std::thread> threads;
+		threads.reserve(actualThreads - 1);
+		for (size_t t = 1; t < actualThreads; ++t)
+			threads.emplace_back(worker, std::ref(*_evaluationContexts[t]));
+		worker(*_evaluationContexts[0]);
+		for (auto& thread: threads)
+			thread.join();
+		
+		return ret;
+	}
+	
 	template<MathDomain mathDomain>
 	void Network<mathDomain>::Train(IOptimizer<mathDomain>& optimizer, const NetworkTrainingData<mathDomain>& networkTrainingData) noexcept
 	{
 		Stopwatch sw;
 		
 		MiniBatchData<mathDomain> data(networkTrainingData);
-		std::unordered_map<size_t, mat> modelOutputCache;
 		static constexpr size_t nEvaluationDimensions = { 3 };
 		std::array<double, nEvaluationDimensions> bestAccuracies = {{ 0.0 }};
 		std::array<size_t, nEvaluationDimensions> nEpochsWithNoImprovements = {{ 0 }};
-		const auto accuracyEvaluator = [&](const auto i, const auto epoch, const auto& networkData, auto accuracyIndex)
+		const auto accuracyEvaluator = [&](const Network& network, const auto& evaluator, std::ostream& log, const auto i, const auto epoch, const auto& networkData, auto accuracyIndex)
 		{
 			if (epoch > 0 && (i + 1) % epoch == 0)
 			{
-				auto modelOutput = modelOutputCache.find(networkData.expectedOutput.nCols());
-				if (modelOutput == modelOutputCache.end())
-					modelOutput = modelOutputCache.emplace(std::piecewise_construct,
-							                               std::forward_as_tuple(networkData.expectedOutput.nCols()),
-							                               std::forward_as_tuple(mat(networkData.expectedOutput.nRows(), networkData.expectedOutput.nCols()))).first;
-				Evaluate(modelOutput->second, networkData.input, networkTrainingData.debugLevel);
-				const double accuracy = networkTrainingData.evaluator(modelOutput->second, networkData.expectedOutput);
+				const double accuracy = network.Evaluate(networkData, evaluator, networkTrainingData.evaluationChunkSize, networkTrainingData.nEvaluationThreads);
+				log << "\t***\tScore = " << accuracy << " [" << networkData.GetNumberOfSamples() << "] = " << 100.0 * accuracy / networkData.GetNumberOfSamples() << "% ***" << std::endl;
 				
 				if (accuracy > bestAccuracies[accuracyIndex])
 				{
-					std::cout << "\t***\t\t*NEW best accuracy (" << bestAccuracies[accuracyIndex] << " -> " << accuracy << ") ***" << std::endl;
+					log << "\t***\t\t*NEW best accuracy (" << bestAccuracies[accuracyIndex] << " -> " << accuracy << ") ***" << std::endl;
 					bestAccuracies[accuracyIndex] = accuracy;
 					nEpochsWithNoImprovements[accuracyIndex] = 0;
 				}
@@ -76,7 +161,7 @@ namespace nn
 					++nEpochsWithNoImprovements[accuracyIndex];
 					if (nEpochsWithNoImprovements[accuracyIndex] > networkTrainingData.nMaxEpochsWithNoScoreImprovements)
 					{
-						std::cout << "\t***\tEarly stop due to " << nEpochsWithNoImprovements[accuracyIndex] << " epochs with no improvements" << std::endl;
+						log << "\t***\tEarly stop due to " << nEpochsWithNoImprovements[accuracyIndex] << " epochs with no improvements" << std::endl;
 						return false;
 					}
 				}
@@ -85,20 +170,77 @@ namespace nn
 			return true;
 		};
 		
-		const auto totalCostEvaluator = [&](const auto i, const auto epoch, const auto& networkData)
+		const auto totalCostEvaluator = [&](const Network& network, std::ostream& log, const auto i, const auto epoch, const auto& networkData)
 		{
 			if (epoch > 0 && (i + 1) % epoch == 0)
 			{
-				const auto modelOutput = modelOutputCache.insert({ networkData.expectedOutput.nCols(), mat(networkData.expectedOutput.nRows(), networkData.expectedOutput.nCols()) }).first;
-				Evaluate(modelOutput->second, networkData.input, networkTrainingData.debugLevel);
+				const auto& costFunction = optimizer.GetCostFunction();
+				const double costSum = network.Evaluate(networkData,
+						                        [&costFunction](mat& modelOutput, const mat& expectedOutput) { return costFunction.EvaluateSum(modelOutput, expectedOutput); },
+						                        networkTrainingData.evaluationChunkSize, networkTrainingData.nEvaluationThreads);
 				
-				const double totalCost =  optimizer.GetCostFunction().Evaluate(modelOutput->second, networkData.expectedOutput, _topology, networkTrainingData.hyperParameters.lambda);
-				std::cout << "\t###\tTotal Cost = " << totalCost << " ###" << std::endl;
+				const double totalCost = costFunction.EvaluateTotalCost(costSum, networkData.GetNumberOfSamples(), network._topology, networkTrainingData.hyperParameters.lambda);
+				log << "\t###\tTotal Cost = " << totalCost << " ###" << std::endl;
 			}
 		};
 		
+		const auto epochEvaluator = [&](const Network& network, const auto& evaluator, std::ostream& log, const size_t i, const TrainingData<mathDomain>& trainingData)
+		{
+			if (!accuracyEvaluator(network, evaluator, log, i, networkTrainingData.epochCalculationAccuracyTestData, networkTrainingData.testData, 0u))
+				return false;
+			if (!accuracyEvaluator(network, evaluator, log, i, networkTrainingData.epochCalculationAccuracyValidationData, networkTrainingData.validationData, 1u))
+				return false;
+			totalCostEvaluator(network, log, i, networkTrainingData.epochCalculationTotalCostTestData, networkTrainingData.testData);
+			totalCostEvaluator(network, log, i, networkTrainingData.epochCalculationTotalCostValidationData, networkTrainingData.validationData);
+			
+			if (!accuracyEvaluator(network, evaluator, log, i, networkTrainingData.epochCalculationAccuracyTrainingData, trainingData, 2u))
+				return false;
+			totalCostEvaluator(network, log, i, networkTrainingData.epochCalculationTotalCostTrainingData, trainingData);
+			
+			return true;
+		};
+		
+		// the snapshot is only written in between two asynchronous evaluations, so that training never waits for it.
+		// The asynchronous evaluation covers the training set as well, with its own evaluator copy and its own log,
+		// which is only written to std::cout once it's joined: its output then follows the next epoch's
+		std::unique_ptr<Network> snapshot;
+		if (networkTrainingData.asynchronousEvaluation)
+			snapshot = std::make_unique<Network>(_topology.Clone());
+		
+		// NB: if the optimizer shuffles the training data in place, the snapshot evaluates its own copy of it, refreshed
+		// only on the epochs its metrics are due
+		const auto isTrainingEvaluationDue = [&](const size_t i)
+		{
+			const auto isDue = [i](const size_t epoch) { return epoch > 0 && (i + 1) % epoch == 0; };
+			return isDue(networkTrainingData.epochCalculationAccuracyTrainingData) || isDue(networkTrainingData.epochCalculationTotalCostTrainingData);
+		};
+		std::unique_ptr<TrainingData<mathDomain>> trainingDataSnapshot;
+		if (snapshot && optimizer.IsShufflingTrainingData() && (networkTrainingData.epochCalculationAccuracyTrainingData > 0 || networkTrainingData.epochCalculationTotalCostTrainingData > 0))
+		{
+			const auto& trainingData = networkTrainingData.trainingData;
+			trainingDataSnapshot = std::make_unique<TrainingData<mathDomain>>(Matrix<mathDomain>(static_cast<unsigned>(trainingData.input.nRows()), static_cast<unsigned>(trainingData.input.nCols())),
+			                                                                  Matrix<mathDomain>(static_cast<unsigned>(trainingData.expectedOutput.nRows()), static_cast<unsigned>(trainingData.expectedOutput.nCols())));
+		}
+		const TrainingData<mathDomain>& snapshotTrainingData = trainingDataSnapshot ? *trainingDataSnapshot : networkTrainingData.trainingData;
+		
+		const auto snapshotEvaluator = networkTrainingData.evaluator;
+		std::ostringstream snapshotLog;
+		const auto joinSnapshotEvaluation = [&](std::future<bool>& evaluation)
+		{
+			const bool ret = evaluation.get();
+			std::cout << snapshotLog.str() << std::flush;
+			snapshotLog.str("");
+			return ret;
+		};
+		std::future<bool> pendingEvaluation;  // NB: declared last, as it must be joined before the state above goes away
+		
+		// the asynchronous evaluation of the first epoch can only be waited for at the end of the second one
+		const size_t warmUpEpoch = snapshot ? 1 : 0;
+		AllocationStatistics warmUpAllocations;
+		
 		for (size_t i = 0; i < networkTrainingData.hyperParameters.nEpochs; ++i)
 		{
+			NN_PROFILE_SCOPE_INDEXED("Epoch", i);
 			if (networkTrainingData.debugLevel > 0)
 				std::cout << "Epoch " << i << " start..." << std::endl;
 			
@@ -107,20 +249,47 @@ namespace nn
 			optimizer.Train(networkTrainingData);
 			
 			// accuracy and total cost -> mainly debug stuff!
-			if (!accuracyEvaluator(i, networkTrainingData.epochCalculationAccuracyTestData, networkTrainingData.testData, 0u))
-				return;
-			if (!accuracyEvaluator(i, networkTrainingData.epochCalculationAccuracyValidationData, networkTrainingData.validationData, 1u))
-				return;
-			if (!accuracyEvaluator(i, networkTrainingData.epochCalculationAccuracyTrainingData, networkTrainingData.trainingData, 2u))
-				return;
-			totalCostEvaluator(i, networkTrainingData.epochCalculationTotalCostTestData, networkTrainingData.testData);
-			totalCostEvaluator(i, networkTrainingData.epochCalculationTotalCostValidationData, networkTrainingData.validationData);
-			totalCostEvaluator(i, networkTrainingData.epochCalculationTotalCostTrainingData, networkTrainingData.trainingData);
+			if (!snapshot)
+			{
+				if (!epochEvaluator(*this, networkTrainingData.evaluator, std::cout, i, networkTrainingData.trainingData))
+					return;
+			}
+			else
+			{
+				// the early stop decision of the previous epoch is only known now
+				if (pendingEvaluation.valid() && !joinSnapshotEvaluation(pendingEvaluation))
+					return;
+				
+				snapshot->_topology.ReadParametersFrom(_topology);
+				if (trainingDataSnapshot && isTrainingEvaluationDue(i))
+				{
+					trainingDataSnapshot->input.ReadFrom(networkTrainingData.trainingData.input);
+					trainingDataSnapshot->expectedOutput.ReadFrom(networkTrainingData.trainingData.expectedOutput);
+				}
+				pendingEvaluation = std::async(std::launch::async, [&epochEvaluator, &snapshotEvaluator, &snapshotLog, &snapshot, &snapshotTrainingData, i]() { return epochEvaluator(*snapshot, snapshotEvaluator, snapshotLog, i, snapshotTrainingData); });
+			}
 			//
 			
 			sw.Stop();
 			if (networkTrainingData.debugLevel > 0)
 				std::cout << "Epoch " << i << " completed in " << sw.GetMilliSeconds() << "ms" << std::endl;
+			
+			if (networkTrainingData.checkNoAllocationsAfterFirstEpoch)
+			{
+				const auto allocations = AllocationTracker::Instance().GetTotal();
+				if (i == warmUpEpoch)
+					warmUpAllocations = allocations;
+				else if (i > warmUpEpoch && allocations.count != warmUpAllocations.count)
+				{
+					std::cerr << "Epoch " << i << ": " << allocations.count - warmUpAllocations.count << " allocations ("
+					          << allocations.bytes - warmUpAllocations.bytes << " bytes) after the first epoch" << std::endl;
+					AllocationTracker::Instance().WriteSummary(std::cerr);
+					std::abort();
+				}
+			}
 		}
+		
+		if (pendingEvaluation.valid())
+			joinSnapshotEvaluation(pendingEvaluation);
 	}
 }
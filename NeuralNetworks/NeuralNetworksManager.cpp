@@ -166,6 +166,19 @@ __CREATE_FUNCTION_4_ARG(SoftMax, CudaKernelExceptionFactory, MemoryBuffer&, z, c
 __CREATE_FUNCTION_3_ARG(CrossEntropyCostFunction, CudaKernelExceptionFactory, double&, cost, MemoryBuffer&, x, const MemoryBuffer&, y)
 __CREATE_FUNCTION_3_ARG(LogLikelihoodCostFunction, CudaKernelExceptionFactory, double&, cost, MemoryBuffer&, z, const MemoryBuffer&, x)
 
+__CREATE_FUNCTION_4_ARG(ClassificationAccuracy, CudaKernelExceptionFactory, int&, nCorrect, const MemoryTile&, x, const MemoryTile&, y, MemoryBuffer&, counterCache)
+
+__CREATE_FUNCTION_5_ARG(UpdateParameters, CudaKernelExceptionFactory, MemoryBuffer&, x, MemoryBuffer&, firstState, MemoryBuffer&, secondState, const MemoryBuffer&, gradient, const ParameterUpdateSettings&, settings)
+__CREATE_FUNCTION_8_ARG(ParameterUpdateNorms, CudaKernelExceptionFactory, double&, parameterNorm, double&, updateNorm, const MemoryBuffer&, x, MemoryBuffer&, firstState, MemoryBuffer&, secondState, const MemoryBuffer&, gradient, const ParameterUpdateSettings&, settings, MemoryBuffer&, normCache)
+
+__CREATE_FUNCTION_5_ARG(Convolution, CudaKernelExceptionFactory, MemoryTile&, z, const MemoryTile&, x, const MemoryTile&, weight, const MemoryBuffer&, bias, const ConvolutionGeometry&, geometry)
+__CREATE_FUNCTION_5_ARG(ConvolutionGradient, CudaKernelExceptionFactory, MemoryBuffer&, biasGradient, MemoryTile&, weightGradient, const MemoryTile&, delta, const MemoryTile&, x, const ConvolutionGeometry&, geometry)
+__CREATE_FUNCTION_4_ARG(ConvolutionInputGradient, CudaKernelExceptionFactory, MemoryTile&, inputGradient, const MemoryTile&, delta, const MemoryTile&, weight, const ConvolutionGeometry&, geometry)
+__CREATE_FUNCTION_4_ARG(Pooling, CudaKernelExceptionFactory, MemoryTile&, z, const MemoryTile&, x, const ConvolutionGeometry&, geometry, const PoolingType, type)
+__CREATE_FUNCTION_5_ARG(PoolingInputGradient, CudaKernelExceptionFactory, MemoryTile&, inputGradient, const MemoryTile&, delta, const MemoryTile&, x, const ConvolutionGeometry&, geometry, const PoolingType, type)
+__CREATE_FUNCTION_6_ARG(CsrMultiply, CudaKernelExceptionFactory, MemoryTile&, z, const MemoryBuffer&, values, const MemoryBuffer&, columnIndices, const MemoryBuffer&, rowPointers, const MemoryTile&, x, const MemoryBuffer&, bias)
+__CREATE_FUNCTION_4_ARG(BatchedMultiply, CudaKernelExceptionFactory, MemoryBuffer&, c, const MemoryBuffer&, a, const MemoryBuffer&, b, const BatchedMultiplyGeometry&, geometry)
+
 #pragma region Undef macros
 
 #undef __CREATE_FUNCTION_0_ARG
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <Types.h>
+#include <ParameterUpdate.h>
+#include <Convolution.h>
+#include <BatchedMultiply.h>
 
 #pragma region Macro Utilities
 
@@ -113,6 +116,19 @@ __CREATE_FUNCTION_4_ARG(SoftMax, MemoryBuffer&, z, const MemoryBuffer&, x, Memor
 __CREATE_FUNCTION_3_ARG(CrossEntropyCostFunction, double&, cost, MemoryBuffer&, z, const MemoryBuffer&, x)
 __CREATE_FUNCTION_3_ARG(LogLikelihoodCostFunction, double&, cost, MemoryBuffer&, z, const MemoryBuffer&, x)
 
+__CREATE_FUNCTION_4_ARG(ClassificationAccuracy, int&, nCorrect, const MemoryTile&, x, const MemoryTile&, y, MemoryBuffer&, counterCache)
+
+__CREATE_FUNCTION_5_ARG(UpdateParameters, MemoryBuffer&, x, MemoryBuffer&, firstState, MemoryBuffer&, secondState, const MemoryBuffer&, gradient, const ParameterUpdateSettings&, settings)
+__CREATE_FUNCTION_8_ARG(ParameterUpdateNorms, double&, parameterNorm, double&, updateNorm, const MemoryBuffer&, x, MemoryBuffer&, firstState, MemoryBuffer&, secondState, const MemoryBuffer&, gradient, const ParameterUpdateSettings&, settings, MemoryBuffer&, normCache)
+
+__CREATE_FUNCTION_5_ARG(Convolution, MemoryTile&, z, const MemoryTile&, x, const MemoryTile&, weight, const MemoryBuffer&, bias, const ConvolutionGeometry&, geometry)
+__CREATE_FUNCTION_5_ARG(ConvolutionGradient, MemoryBuffer&, biasGradient, MemoryTile&, weightGradient, const MemoryTile&, delta, const MemoryTile&, x, const ConvolutionGeometry&, geometry)
+__CREATE_FUNCTION_4_ARG(ConvolutionInputGradient, MemoryTile&, inputGradient, const MemoryTile&, delta, const MemoryTile&, weight, const ConvolutionGeometry&, geometry)
+__CREATE_FUNCTION_4_ARG(Pooling, MemoryTile&, z, const MemoryTile&, x, const ConvolutionGeometry&, geometry, const PoolingType, type)
+__CREATE_FUNCTION_5_ARG(PoolingInputGradient, MemoryTile&, inputGradient, const MemoryTile&, delta, const MemoryTile&, x, const ConvolutionGeometry&, geometry, const PoolingType, type)
+__CREATE_FUNCTION_6_ARG(CsrMultiply, MemoryTile&, z, const MemoryBuffer&, values, const MemoryBuffer&, columnIndices, const MemoryBuffer&, rowPointers, const MemoryTile&, x, const MemoryBuffer&, bias)
+__CREATE_FUNCTION_4_ARG(BatchedMultiply, MemoryBuffer&, c, const MemoryBuffer&, a, const MemoryBuffer&, b, const BatchedMultiplyGeometry&, geometry)
+
 #pragma region Undef macros
 
 #undef __CREATE_FUNCTION_0_ARG
@@ -2,3 +2,5 @@
 
 #include <NeuralNetworks/Optimizers/Shufflers/All.h>
 #include <NeuralNetworks/Optimizers/BatchedStochasticGradientDescent.h>
+#include <NeuralNetworks/Optimizers/BatchedAdaptiveGradientDescent.h>
+#include <NeuralNetworks/Optimizers/DataParallelStochasticGradientDescent.h>
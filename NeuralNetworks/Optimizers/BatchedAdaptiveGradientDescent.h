@@ -0,0 +1,121 @@
+#pragma once
+
+#include <NeuralNetworks/Optimizers/BatchedStochasticGradientDescent.h>
+#include <NeuralNetworks/Memory/ParameterBuffer.h>
+
+#include <cmath>
+
+namespace nn
+{
+	// Same gradient computation as BatchedStochasticGradientDescent, but the layers are updated with a stateful rule
+	// (Momentum, Nesterov, RMSProp or Adam). The states have the same flat layout as parameters and gradients, so that the
+	// whole network is updated by a single fused kernel, with the L2 regularisation folded into the gradient as weight
+	// decay (bias is not regularised, as in plain SGD).
+	// LARS and LAMB scale the weight step by a per-layer trust ratio, so that large mini-batches can use a large
+	// learning rate: the norms it needs come from one extra fused reduction over weight and weight gradient.
+	// NB: as the trust ratio is per layer, their weights are still updated one layer at a time (biases in one pass)
+	template<MathDomain mathDomain>
+	class BatchedAdaptiveGradientDescent final: public BatchedStochasticGradientDescent<mathDomain>
+	{
+	public:
+		BatchedAdaptiveGradientDescent(const NetworkTopology<mathDomain>& topology,
+		                               const size_t miniBatchSize,
+		                               std::unique_ptr<ICostFunction<mathDomain>>&& costFunction,
+		                               std::unique_ptr<IShuffler<mathDomain>>&& miniBatchShuffler,
+		                               const ParameterUpdateType updateType,
+		                               const double beta1 = 0.9,
+		                               const double beta2 = 0.999,
+		                               const double epsilon = 1e-8,
+		                               const double trustCoefficient = 0.001) noexcept
+			: BatchedStochasticGradientDescent<mathDomain>(topology, miniBatchSize, std::move(costFunction), std::move(miniBatchShuffler))
+		{
+			_settings.type = updateType;
+			_settings.beta1 = beta1;
+			_settings.beta2 = beta2;
+			_settings.epsilon = epsilon;
+			_settings.trustCoefficient = trustCoefficient;
+			
+			const unsigned nStateBuffers = GetNumberOfStateBuffers(updateType);
+			_states.reserve(nStateBuffers);
+			for (unsigned i = 0; i < nStateBuffers; ++i)
+				_states.emplace_back(std::make_unique<ParameterBuffer<mathDomain>>(topology.GetTransposedSizes()));
+			AllocationTracker::Instance().Record(_normCache.GetBuffer());
+		}
+		
+		inline ParameterUpdateType GetUpdateType() const noexcept { return _settings.type; }
+	
+	private:
+		void UpdateLayers(MiniBatchData<mathDomain>& batchData) noexcept override
+		{
+			NN_PROFILE_SCOPE("Update");
+			const AllocationPhase allocationPhase("Update");
+			Stopwatch sw(true);
+			
+			++_nSteps;
+			
+			const auto& hyperParameters = batchData.networkTrainingData.hyperParameters;
+			
+			// gradients are summed over the mini-batch, while these rules expect the average one
+			ParameterUpdateSettings biasSettings = _settings;
+			biasSettings.learningRate = hyperParameters.learningRate;
+			biasSettings.gradientScale = 1.0 / static_cast<double>(hyperParameters.miniBatchSize);
+			biasSettings.decay = 0.0;
+			biasSettings.firstMomentCorrection = 1.0 / (1.0 - std::pow(_settings.beta1, static_cast<double>(_nSteps)));
+			biasSettings.secondMomentCorrection = 1.0 / (1.0 - std::pow(_settings.beta2, static_cast<double>(_nSteps)));
+			
+			ParameterUpdateSettings weightSettings = biasSettings;
+			weightSettings.decay = hyperParameters.lambda / static_cast<double>(batchData.networkTrainingData.trainingData.GetNumberOfSamples());
+			
+			if (!IsLayerWise(_settings.type))
+			{
+				// weight decay is restricted to the weight region by UpdateParameters
+				this->UpdateParameters(weightSettings, GetState(0), GetState(1));
+			}
+			else
+			{
+				auto& parameters = this->_topology.GetParameters();
+				for (size_t l = 0; l < this->_topology.GetSize(); ++l)
+				{
+					if (!HasParameters(this->_topology[l]->GetType()))
+						continue;
+					
+					double parameterNorm = 0.0;
+					double updateNorm = 0.0;
+					nn::detail::ParameterUpdateNorms(parameterNorm, updateNorm,
+					                                 parameters.GetWeight(l).GetBuffer(), GetWeightState(0, l), GetWeightState(1, l),
+					                                 this->_gradients.GetWeight(l).GetBuffer(), weightSettings, _normCache.GetBuffer());
+					weightSettings.trustRatio = GetTrustRatio(weightSettings, parameterNorm, updateNorm);
+					nn::detail::UpdateParameters(parameters.GetWeight(l).GetBuffer(), GetWeightState(0, l), GetWeightState(1, l), this->_gradients.GetWeight(l).GetBuffer(), weightSettings);
+				}
+				
+				// bias doesn't get any trust ratio
+				biasSettings.type = GetNonLayerWiseType(_settings.type);
+				nn::detail::UpdateParameters(parameters.GetBiases().GetBuffer(), GetBiasState(0), GetBiasState(1), this->_gradients.GetBiases().GetBuffer(), biasSettings);
+			}
+			
+			sw.Stop();
+			
+			if (batchData.networkTrainingData.debugLevel > 3)
+				std::cout << "\t\tUBW[" << batchData.startIndex << ", " << batchData.endIndex << "] completed in " << sw.GetMilliSeconds() << "ms" << std::endl;
+		}
+	
+		// NB: states not used by the update rule are empty buffers
+		MemoryBuffer& GetState(const size_t i) noexcept { return i < _states.size() ? _states[i]->Get().GetBuffer() : _emptyState; }
+		MemoryBuffer& GetBiasState(const size_t i) noexcept { return i < _states.size() ? _states[i]->GetBiases().GetBuffer() : _emptyState; }
+		MemoryBuffer& GetWeightState(const size_t i, const size_t l) noexcept { return i < _states.size() ? _states[i]->GetWeight(l).GetBuffer() : _emptyState; }
+	
+	private:
+		ParameterUpdateSettings _settings {};
+		
+		// velocity, first and second moments, with the same layout as the parameters
+		std::vector<std::unique_ptr<ParameterBuffer<mathDomain>>> _states {};
+		MemoryBuffer _emptyState {};
+		
+		// device accumulator for the layer-wise norms
+		Vector<MathDomain::Double> _normCache { 2u };
+		size_t _nSteps = 0;
+	};
+	
+	template<MathDomain mathDomain>
+	using BatchedAgd = BatchedAdaptiveGradientDescent<mathDomain>;
+}
@@ -2,6 +2,7 @@
 
 #include <NeuralNetworks/Optimizers/GradientOptimizer.h>
 #include <NeuralNetworks/Optimizers/Shufflers/IShuffler.h>
+#include <NeuralNetworks/Profiler.h>
 
 namespace nn
 {
@@ -17,14 +18,31 @@ namespace nn
 		{
 		}
 		
+		// parameters are multiplied by mask (same layout, e.g. the 0/1 one of MagnitudePruner) after every update, so
+		// that pruned weights stay at zero. Null disables it.
+		// NB: the mask is borrowed
+		void SetParameterMask(const ParameterBuffer<mathDomain>* mask) noexcept
+		{
+			assert(!mask || mask->Get().size() == this->_gradients.Get().size());
+			_parameterMask = mask;
+		}
+		
+		bool IsShufflingTrainingData() const noexcept override { return _miniBatchShuffler->IsReordering(); }
+		
 		void Train(const NetworkTrainingData<mathDomain>& networkTrainingData) noexcept override
 		{
-			_miniBatchShuffler->Shuffle(networkTrainingData.trainingData.input,
-					                    networkTrainingData.trainingData.expectedOutput);
+			{
+				NN_PROFILE_SCOPE("Shuffle");
+				const AllocationPhase allocationPhase("Shuffle");
+				_miniBatchShuffler->Shuffle(networkTrainingData.trainingData.input,
+						                    networkTrainingData.trainingData.expectedOutput);
+			}
 			
 			MiniBatchData<mathDomain> batchData(networkTrainingData);
+			MiniBatchData<mathDomain> microBatchData(networkTrainingData);
 			Stopwatch sw;
 			
+			const size_t microBatchSize = networkTrainingData.hyperParameters.GetMicroBatchSize();
 			const size_t nMiniBatchIterations = networkTrainingData.trainingData.GetNumberOfSamples() / networkTrainingData.hyperParameters.miniBatchSize;
 			for (size_t n = 0; n < nMiniBatchIterations; ++n)
 			{
@@ -32,10 +50,22 @@ namespace nn
 				batchData.endIndex += networkTrainingData.hyperParameters.miniBatchSize;
 				batchData.endIndex = std::min(networkTrainingData.trainingData.GetNumberOfSamples(), batchData.endIndex);
 				
+				NN_PROFILE_SCOPE("MiniBatch");
+				const AllocationPhase allocationPhase("MiniBatch");
 				sw.Start();
 				
-				TrainMiniBatch(batchData);
+				// reset cache
+				this->_gradients.Zero();
+				
+				// gradients are accumulated over the micro-batches, and the layers are updated once per mini-batch
+				for (microBatchData.startIndex = batchData.startIndex; microBatchData.startIndex < batchData.endIndex; microBatchData.startIndex = microBatchData.endIndex)
+				{
+					microBatchData.endIndex = std::min(microBatchData.startIndex + microBatchSize, batchData.endIndex);
+					TrainMiniBatch(microBatchData);
+				}
 				UpdateLayers(batchData);
+				if (_parameterMask)
+					this->_topology.GetParameters().Get() %= _parameterMask->Get();
 				
 				sw.Stop();
 				if (batchData.networkTrainingData.debugLevel > 2)
@@ -44,17 +74,18 @@ namespace nn
 		}
 		
 	protected:
+		// accumulates into the gradients the contribution of the columns in [batchData.startIndex, batchData.endIndex)
 		virtual void TrainMiniBatch(MiniBatchData<mathDomain>& batchData) noexcept = 0;
 		
-	private:
-		void UpdateLayers(MiniBatchData<mathDomain>& batchData) noexcept
+		virtual void UpdateLayers(MiniBatchData<mathDomain>& batchData) noexcept
 		{
+			NN_PROFILE_SCOPE("Update");
+			const AllocationPhase allocationPhase("Update");
 			Stopwatch sw(true);
 			
 			const double averageLearningRate = batchData.networkTrainingData.hyperParameters.GetAverageLearningRate();
 			const double regularizationFactor = 1.0 - (batchData.networkTrainingData.hyperParameters.learningRate * batchData.networkTrainingData.hyperParameters.lambda) / static_cast<double>(batchData.networkTrainingData.trainingData.GetNumberOfSamples());
-			for (size_t l = 0; l < this->_topology.GetSize(); ++l)
-				this->_topology[l]->Update(this->_biasGradients[l], this->_weightGradients[l], averageLearningRate, regularizationFactor);
+			this->UpdateParameters(averageLearningRate, regularizationFactor);
 			
 			sw.Stop();
 			
@@ -66,5 +97,6 @@ namespace nn
 	protected:
 		const size_t _miniBatchSize;
 		const std::unique_ptr<IShuffler<mathDomain>> _miniBatchShuffler;
+		const ParameterBuffer<mathDomain>* _parameterMask = nullptr;
 	};
 }
@@ -1,60 +1,43 @@
 #pragma once
 
 #include <NeuralNetworks/Optimizers/BatchedGradientOptimizer.h>
-#include <TensorCollection.h>
+#include <NeuralNetworks/Workspace.h>
+#include <NeuralNetworks/ExecutionPlan.h>
+#include <NeuralNetworks/Memory/NetworkMemoryPlan.h>
 
 namespace nn
 {
 	namespace detail
 	{
-		template<MathDomain mathDomain>
-		static inline std::vector<std::tuple<size_t, size_t, size_t>> GetWeightSizes(const NetworkTopology<mathDomain> &topology, const size_t miniBatchSize)
-		{
-			std::vector<std::tuple<size_t, size_t, size_t>> ret;
-			auto sizes = topology.GetTransposedSizes();
-			for (auto& size: sizes)
-				ret.emplace_back(std::make_tuple(size.first, size.second, miniBatchSize));
-			
-			return ret;
-		}
-		
-		template<MathDomain mathDomain>
-		static inline std::vector<std::pair<size_t, size_t>> GetBiasSizes(const NetworkTopology<mathDomain> &topology, const size_t miniBatchSize)
-		{
-			std::vector<std::pair<size_t, size_t>> ret;
-			auto sizes = topology.GetTransposedSizes();
-			for (auto& size: sizes)
-				ret.emplace_back(size.first, miniBatchSize);
-			
-			return ret;
-		}
-		
 		template<MathDomain mathDomain>
 		struct MiniBatchCache
 		{
-			cl::ColumnWiseMatrixCollection<MemorySpace::Device, mathDomain> biasGradients;
-			cl::TensorCollection<MemorySpace::Device, mathDomain> weightGradients;
-			Vector<mathDomain> ones;
+			// every scratch buffer of the forward and backward pass lives in this arena
+			NetworkMemoryPlan<mathDomain> memoryPlan;
+			
+			std::vector<Workspace<mathDomain>> biasGradients;
+			VectorWorkspace<mathDomain> ones;
 			
 			explicit MiniBatchCache(const NetworkTopology<mathDomain>& topology, const size_t miniBatchSize)
-				: biasGradients(GetBiasSizes(topology, miniBatchSize)),
-				  weightGradients(GetWeightSizes(topology, miniBatchSize)),
-				  ones(static_cast<unsigned>(miniBatchSize), 1.0)
+				: memoryPlan(topology, miniBatchSize), ones(miniBatchSize, 1.0)
 			{
-			}
+				memoryPlan.Bind(topology);
 		
-			void Reset()
-			{
-				dm::detail::Zero(weightGradients.Get().GetBuffer());
+				biasGradients.reserve(topology.GetSize());
+				for (size_t l = 0; l < topology.GetSize(); ++l)
+				{
+					biasGradients.emplace_back(topology[l]->GetNumberOfOutputs());
+					
+					// last layer back-propagates straight into its activation buffer
+					if (l + 1 < topology.GetSize())
+						biasGradients.back().Bind(memoryPlan.GetPointer(LayerBufferType::BackPropagation, l), miniBatchSize);
+				}
 			}
 		};
-		
-		template<MathDomain mathDomain>
-		using CacheMap = std::unordered_map<size_t, MiniBatchCache<mathDomain>>;
 	}
 	
 	template<MathDomain mathDomain>
-	class BatchedStochasticGradientDescent final: public BatchedGradientOptimizer<mathDomain>
+	class BatchedStochasticGradientDescent: public BatchedGradientOptimizer<mathDomain>
 	{
 	
 	public:
@@ -62,69 +45,111 @@ namespace nn
 		                                 const size_t miniBatchSize,
 				                         std::unique_ptr<ICostFunction<mathDomain>>&& costFunction,
 				                         std::unique_ptr<IShuffler<mathDomain>>&& miniBatchShuffler) noexcept
-			: BatchedGradientOptimizer<mathDomain>(topology, miniBatchSize, std::move(costFunction), std::move(miniBatchShuffler))
+			: BatchedGradientOptimizer<mathDomain>(topology, miniBatchSize, std::move(costFunction), std::move(miniBatchShuffler)),
+			  _cache(std::make_unique<detail::MiniBatchCache<mathDomain>>(topology, miniBatchSize)),
+			  _useExecutionPlan(ExecutionPlan<mathDomain>::IsSupported(topology))
 		{
 		}
 		
-	private:
+	protected:
 		virtual void TrainMiniBatch(MiniBatchData<mathDomain>& batchData) noexcept override
 		{
-			// reset cache
-			dm::detail::Zero(this->_biasGradients.Get().GetBuffer());
-			dm::detail::Zero(this->_weightGradients.Get().GetBuffer());
-			
 			// calculates analytically the gradient, by means of backward differentiation
+			if (_useExecutionPlan)
+			{
+				ReplayExecutionPlan(batchData);
+				return;
+			}
+			
 			_needGradient = this->_topology.back()->GetBestCostFunctionType() != this->_costFunction->GetType();
 			AdjointDifferentiation(batchData);
 		}
 		
+		// same as AdjointDifferentiation, with every buffer resolved once per batch width
+		void ReplayExecutionPlan(MiniBatchData<mathDomain>& batchData) noexcept
+		{
+			NN_PROFILE_SCOPE("AdjointDifferentiation");
+			Stopwatch sw(true);
+			
+			const size_t actualMiniBatchSize = batchData.endIndex - batchData.startIndex;
+			Reserve(actualMiniBatchSize);
+			auto& plan = _executionPlans.Get(actualMiniBatchSize, [&]()
+			{
+				return std::make_unique<ExecutionPlan<mathDomain>>(this->_topology, actualMiniBatchSize, *this->_costFunction, this->_gradients, _cache->biasGradients, _cache->ones);
+			});
+			
+			const auto input = detail::MakeColumnsView<mathDomain>(batchData.networkTrainingData.trainingData.input, batchData.startIndex, batchData.endIndex);
+			const auto expectedOutput = detail::MakeColumnsView<mathDomain>(batchData.networkTrainingData.trainingData.expectedOutput, batchData.startIndex, batchData.endIndex);
+			plan.Train(input, expectedOutput, [&](const size_t l) { OnGradientsReady(l, batchData); });
+			
+			sw.Stop();
+			
+			if (batchData.networkTrainingData.debugLevel > 3)
+				std::cout << "\t\tAD[" << batchData.startIndex << ", " << batchData.endIndex << "] completed in " << sw.GetMilliSeconds() << "ms" << std::endl;
+		}
+		
+		// layer l's gradients are complete for these columns: called last layer first, by both paths above
+		virtual void OnGradientsReady(const size_t /*l*/, MiniBatchData<mathDomain>& /*batchData*/) noexcept
+		{
+		}
+		
+		// batches wider than the cache (e.g. hyper-parameters with a larger mini-batch than the constructor's) need a new
+		// arena: plans borrow the cache's buffers, so they're dropped together with it
+		void Reserve(const size_t capacity) noexcept
+		{
+			if (capacity <= _cache->memoryPlan.GetCapacity())
+				return;
+			
+			_executionPlans.Clear();
+			_cache = std::make_unique<detail::MiniBatchCache<mathDomain>>(this->_topology, capacity);
+		}
+		
 		void AdjointDifferentiation(MiniBatchData<mathDomain>& batchData) noexcept
 		{
+			NN_PROFILE_SCOPE("AdjointDifferentiation");
 			Stopwatch sw(true);
 			const size_t nLayers = this->_topology.GetSize();
 			
 			const size_t actualMiniBatchSize = batchData.endIndex - batchData.startIndex;  // last iteration is spurious
+			Reserve(actualMiniBatchSize);
 			
-			// retrieve cached quantities
-			auto cacheIter = _cache.find(actualMiniBatchSize);
-			if (cacheIter == _cache.end())
-				cacheIter = _cache.emplace(std::piecewise_construct, std::forward_as_tuple(actualMiniBatchSize),
-				                           std::forward_as_tuple(this->_topology, actualMiniBatchSize)).first;
-			else
-				// reset weight gradient cache
-				cacheIter->second.Reset();
-			auto& cache = cacheIter->second;
+			auto& ones = _cache->ones.Get(actualMiniBatchSize);
 			
 			// network evaluation: feed forward
-			Matrix<mathDomain> input(batchData.networkTrainingData.trainingData.input, batchData.startIndex, batchData.endIndex);
+			const auto input = detail::MakeColumnsView<mathDomain>(batchData.networkTrainingData.trainingData.input, batchData.startIndex, batchData.endIndex);
 			this->_topology.Evaluate(input, _needGradient);  // compute y = f(z_L)
 			
 			// *** Back propagation of the last layer ***
-			Matrix<mathDomain> expectedOutput(batchData.networkTrainingData.trainingData.expectedOutput, batchData.startIndex, batchData.endIndex);
+			const auto expectedOutput = detail::MakeColumnsView<mathDomain>(batchData.networkTrainingData.trainingData.expectedOutput, batchData.startIndex, batchData.endIndex);
 			auto& costFunctionGradient = this->_topology.back()->GetActivation();  // dL/dy \outerdot f'(z_L) (delta_L in some literature)
-			// NB override last layer's activation with the cost function derivative!
-			this->_costFunction->EvaluateGradient(costFunctionGradient, expectedOutput, this->_topology.back()->GetActivationGradient());
-			costFunctionGradient.RowWiseSum(this->_biasGradients.back(), cache.ones);  // dL/db_L == dL/dy
-			
-			// dL/dW_L = dL/db_L \cdot f(z_{L - 1})
-			Tensor<mathDomain>::AccumulateKroneckerProduct(this->_weightGradients.back(),
-					                                       costFunctionGradient,
-					                                       this->_topology[nLayers - 2]->GetActivation());
 			//***
 			
-			// now back-propagate through the remaining layers
-			for (size_t l = 2; l <= nLayers; ++l)
+			// now back-propagate through every layer: each one accumulates dL/db_l and dL/dW_l, and returns W_l^T * delta_l
+			// (or its convolution/pooling counterpart) into the previous layer's delta
+			for (size_t l = nLayers; l-- > 0;)
 			{
-				// dL/db_l = (W_l^T * dL/db_{l + 1}) \outerdot f'(z_l)
-				this->_topology[nLayers - l + 1]->GetWeight().Multiply(cache.biasGradients[nLayers - l],
-						                                               l == 2 ? costFunctionGradient : cache.biasGradients[nLayers - l + 1], MatrixOperation::Transpose);
-				cache.biasGradients[nLayers - l] %= this->_topology[nLayers - l]->GetActivationGradient();
-				cache.biasGradients[nLayers - l].RowWiseSum(this->_biasGradients[nLayers - l], cache.ones);
+				NN_PROFILE_SCOPE_INDEXED("Backward", l);
+				
+				// NB override last layer's activation with the cost function derivative! It's part of the last layer's
+				// backward span, as in the execution plan
+				if (l == nLayers - 1)
+					this->_costFunction->EvaluateGradient(costFunctionGradient, expectedOutput, this->_topology.back()->GetActivationGradient());
+				
+				auto& delta = l == nLayers - 1 ? costFunctionGradient : _cache->biasGradients[l].Get(actualMiniBatchSize);
 				
-				// dL/dW_l = dL/db_l \cdot f(z_{L - 1})
-				Tensor<mathDomain>::AccumulateKroneckerProduct(this->_weightGradients[nLayers - l],
-				                                               cache.biasGradients[nLayers - l],
-				                                               l == 2 ? input : this->_topology[nLayers - l - 1]->GetActivation());
+				// dL/db_l = (W_{l + 1}^T * dL/db_{l + 1}) \outerdot f'(z_l)
+				// NB: no activation (i.e. pooling) means f' = 1
+				if (l < nLayers - 1 && this->_topology[l]->GetActivationFunctionType() != ActivationFunctionType::Null)
+					delta %= this->_topology[l]->GetActivationGradient();
+				
+				// accumulates over micro-batches
+				this->_topology[l]->BackPropagate(l > 0 ? &_cache->biasGradients[l - 1].Get(actualMiniBatchSize) : nullptr,
+				                                  this->_gradients.GetBias(l),
+				                                  this->_gradients.GetWeight(l),
+				                                  delta,
+				                                  l == 0 ? input : this->_topology[l - 1]->GetActivation(),
+				                                  ones);
+				OnGradientsReady(l, batchData);
 			}
 			
 			sw.Stop();
@@ -134,7 +159,11 @@ namespace nn
 		}
 		
 	private:
-		detail::CacheMap<mathDomain> _cache {};
+		std::unique_ptr<detail::MiniBatchCache<mathDomain>> _cache;
+		
+		// fully connected topologies replay a pre-built plan, other ones go through the layers
+		const bool _useExecutionPlan;
+		ExecutionPlanCache<mathDomain> _executionPlans {};
 		
 		bool _needGradient = true;
 	};
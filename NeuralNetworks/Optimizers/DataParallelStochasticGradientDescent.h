@@ -0,0 +1,205 @@
+#pragma once
+
+#include <NeuralNetworks/Optimizers/BatchedStochasticGradientDescent.h>
+#include <NeuralNetworks/Distributed/SharedMemoryCommunicator.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nn
+{
+	// rank's share of the samples, the same number for every rank, so that they all run the same number of mini-batches
+	// NB: the remaining nSamples % nRanks samples are dropped
+	template<MathDomain mathDomain>
+	TrainingData<mathDomain> MakeShard(const TrainingData<mathDomain>& data, const size_t rank, const size_t nRanks) noexcept
+	{
+		assert(rank < nRanks);
+		const size_t nSamples = data.GetNumberOfSamples() / nRanks;
+		
+		TrainingData<mathDomain> ret(Matrix<mathDomain>(static_cast<unsigned>(data.input.nRows()), static_cast<unsigned>(nSamples)),
+		                             Matrix<mathDomain>(static_cast<unsigned>(data.expectedOutput.nRows()), static_cast<unsigned>(nSamples)));
+		ret.input.ReadFrom(detail::MakeColumnsView<mathDomain>(data.input, rank * nSamples, (rank + 1) * nSamples));
+		ret.expectedOutput.ReadFrom(detail::MakeColumnsView<mathDomain>(data.expectedOutput, rank * nSamples, (rank + 1) * nSamples));
+		return ret;
+	}
+	
+	// BatchedSgd over several processes (ranks): each of them trains on its own shard of the training data, and before
+	// every update the gradients are summed across ranks, so that every rank applies the same update, the one of a
+	// nRanks times larger mini-batch (i.e. the rank mini-batches side by side).
+	// Gradients are reduced in buckets of layers, on a separate thread: a bucket is handed over as soon as the backward
+	// pass is done with its layers (in the last micro-batch), and it's reduced while the pass goes on with the previous
+	// ones. The update only waits for the last buckets.
+	// Parameters are broadcast from rank 0 at construction, so that the ranks needn't be initialised consistently.
+	// NB: shufflers only shuffle the own shard
+	template<MathDomain mathDomain>
+	class DataParallelStochasticGradientDescent: public BatchedStochasticGradientDescent<mathDomain>
+	{
+		using Real = typename Traits<mathDomain>::stdType;
+		
+		// consecutive layers, stored last one first, weights then bias
+		struct Bucket
+		{
+			size_t firstLayer;
+			size_t lastLayer;
+			std::vector<Real> data;
+		};
+	
+	public:
+		// bucketSize: minimum number of elements per bucket. Smaller buckets start earlier, larger ones synchronise less
+		DataParallelStochasticGradientDescent(const NetworkTopology<mathDomain>& topology,
+		                                      const size_t miniBatchSize,
+		                                      std::unique_ptr<ICostFunction<mathDomain>>&& costFunction,
+		                                      std::unique_ptr<IShuffler<mathDomain>>&& miniBatchShuffler,
+		                                      SharedMemoryCommunicator& communicator,
+		                                      const size_t bucketSize = 1 << 18) noexcept
+			: BatchedStochasticGradientDescent<mathDomain>(topology, miniBatchSize, std::move(costFunction), std::move(miniBatchShuffler)),
+			  _communicator(communicator)
+		{
+			for (size_t l = topology.GetSize(); l-- > 0;)
+			{
+				const size_t layerSize = this->_gradients.GetWeight(l).size() + this->_gradients.GetBias(l).size();
+				if (_buckets.empty() || _buckets.back().data.size() >= bucketSize)
+					_buckets.push_back({ l, l, {} });
+				
+				_buckets.back().firstLayer = l;
+				_buckets.back().data.resize(_buckets.back().data.size() + layerSize);
+			}
+			
+			// every rank starts from the same parameters
+			auto& parameters = this->_topology.GetParameters().Get();
+			auto values = parameters.Get();
+			_communicator.Broadcast(values.data(), values.size());
+			parameters.ReadFrom(values);
+			
+			_thread = std::thread([this]() { ReduceBuckets(); });
+		}
+		
+		~DataParallelStochasticGradientDescent() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stop = true;
+			}
+			_condition.notify_all();
+			_thread.join();
+		}
+		
+		inline size_t GetNumberOfBuckets() const noexcept { return _buckets.size(); }
+	
+	protected:
+		void OnGradientsReady(const size_t l, MiniBatchData<mathDomain>& batchData) noexcept override
+		{
+			// gradients are accumulated until the last micro-batch of the mini-batch
+			const size_t miniBatchSize = batchData.networkTrainingData.hyperParameters.miniBatchSize;
+			if (batchData.endIndex % miniBatchSize != 0 && batchData.endIndex != batchData.networkTrainingData.trainingData.GetNumberOfSamples())
+				return;
+			
+			if (_nSubmittedBuckets < _buckets.size() && l == _buckets[_nSubmittedBuckets].firstLayer)
+				SubmitBucket();
+		}
+		
+		void UpdateLayers(MiniBatchData<mathDomain>& batchData) noexcept override
+		{
+			{
+				NN_PROFILE_SCOPE("AllReduce");
+				while (_nSubmittedBuckets < _buckets.size())
+					SubmitBucket();
+				
+				std::unique_lock<std::mutex> lock(_mutex);
+				_condition.wait(lock, [this]() { return _nReducedBuckets == _buckets.size(); });
+				_nQueuedBuckets = _nReducedBuckets = 0;
+			}
+			_nSubmittedBuckets = 0;
+			
+			// straight from the buckets into the gradients
+			for (auto& bucket: _buckets)
+				ForEachGradient(bucket, [](MemoryBuffer& gradient, const MemoryBuffer& host) { dm::detail::AutoCopy(gradient, host); });
+			
+			NN_PROFILE_SCOPE("Update");
+			const AllocationPhase allocationPhase("Update");
+			
+			// same as BatchedGradientOptimizer's, with the mini-batch and the training data of every rank
+			const auto& hyperParameters = batchData.networkTrainingData.hyperParameters;
+			const double nRanks = static_cast<double>(_communicator.GetNumberOfRanks());
+			const double averageLearningRate = hyperParameters.GetAverageLearningRate() / nRanks;
+			const double regularizationFactor = 1.0 - (hyperParameters.learningRate * hyperParameters.lambda) / (nRanks * static_cast<double>(batchData.networkTrainingData.trainingData.GetNumberOfSamples()));
+			this->UpdateParameters(averageLearningRate, regularizationFactor);
+		}
+	
+	private:
+		// copies the bucket to the host, and queues it
+		void SubmitBucket() noexcept
+		{
+			ForEachGradient(_buckets[_nSubmittedBuckets++], [](const MemoryBuffer& gradient, MemoryBuffer& host) { dm::detail::AutoCopy(host, gradient); });
+			
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				++_nQueuedBuckets;
+			}
+			_condition.notify_all();
+		}
+		
+		// f(device gradient, its host memory in the bucket) for the weight and the bias of every layer of the bucket
+		template<typename F>
+		void ForEachGradient(Bucket& bucket, F&& f) noexcept
+		{
+			Real* data = bucket.data.data();
+			const auto apply = [&](MemoryBuffer& gradient)
+			{
+				MemoryBuffer host(reinterpret_cast<std::ptrdiff_t>(data), gradient.size, MemorySpace::Host, mathDomain);
+				f(gradient, host);
+				data += gradient.size;
+			};
+			
+			for (size_t l = bucket.lastLayer + 1; l-- > bucket.firstLayer;)
+			{
+				if (!HasParameters(this->_topology[l]->GetType()))
+					continue;
+				
+				apply(this->_gradients.GetWeight(l).GetBuffer());
+				apply(this->_gradients.GetBias(l).GetBuffer());
+			}
+		}
+		
+		// buckets are queued, and then reduced, in the same order on every rank
+		void ReduceBuckets() noexcept
+		{
+			for (;;)
+			{
+				size_t b;
+				{
+					std::unique_lock<std::mutex> lock(_mutex);
+					_condition.wait(lock, [this]() { return _stop || _nReducedBuckets < _nQueuedBuckets; });
+					if (_stop)
+						return;
+					b = _nReducedBuckets;
+				}
+				
+				_communicator.AllReduce(_buckets[b].data.data(), _buckets[b].data.size());
+				
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					++_nReducedBuckets;
+				}
+				_condition.notify_all();
+			}
+		}
+	
+	private:
+		SharedMemoryCommunicator& _communicator;
+		std::vector<Bucket> _buckets {};
+		size_t _nSubmittedBuckets = 0;
+		
+		std::thread _thread {};
+		std::mutex _mutex {};
+		std::condition_variable _condition {};
+		size_t _nQueuedBuckets = 0;
+		size_t _nReducedBuckets = 0;
+		bool _stop = false;
+	};
+	
+	template<MathDomain mathDomain>
+	using DataParallelSgd = DataParallelStochasticGradientDescent<mathDomain>;
+}
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <NeuralNetworks/Optimizers/IOptimizer.h>
-#include <VectorCollection.h>
-#include <ColumnWiseMatrixCollection.h>
+#include <NeuralNetworks/Memory/ParameterBuffer.h>
+#include <NeuralNetworks/NeuralNetworksManager.h>
 
 #include <vector>
 #include <memory>
@@ -17,8 +17,7 @@ namespace nn
 	public:
 		GradientOptimizer(const NetworkTopology<mathDomain>& topology, std::unique_ptr<ICostFunction < mathDomain>>&& costFunction) noexcept
 			: _topology(topology), _costFunction(std::move(costFunction))
-			, _biasGradients(topology.GetNumberOfOutputs())
-			, _weightGradients(topology.GetTransposedSizes())
+			, _gradients(topology.GetTransposedSizes())
 		{
 //			_biasGradients.reserve(_topology.GetSize());
 //			_weightGradients.reserve(_topology.GetSize());
@@ -32,10 +31,36 @@ namespace nn
 		const ICostFunction<mathDomain>& GetCostFunction() const noexcept override final { return *_costFunction; }
 	
 	protected:
+		// a single fused pass over every parameter, with the gradients having the same layout: the decay only applies to the
+		// weight region, as bias is not regularised
+		void UpdateParameters(ParameterUpdateSettings settings, MemoryBuffer& firstState, MemoryBuffer& secondState) noexcept
+		{
+			auto& parameters = _topology.GetParameters();
+			settings.decayedSize = static_cast<unsigned>(parameters.GetWeights().size());
+			nn::detail::UpdateParameters(parameters.Get().GetBuffer(), firstState, secondState, _gradients.Get().GetBuffer(), settings);
+		}
+		void UpdateParameters(const ParameterUpdateSettings& settings) noexcept
+		{
+			MemoryBuffer emptyState {};
+			UpdateParameters(settings, emptyState, emptyState);
+		}
+		
+		// plain gradient descent: weight <- regularizationFactor * weight - averageLearningRate * weightGradient, and
+		// bias <- bias - averageLearningRate * biasGradient
+		void UpdateParameters(const double averageLearningRate, const double regularizationFactor) noexcept
+		{
+			ParameterUpdateSettings settings;
+			settings.type = ParameterUpdateType::GradientDescent;
+			settings.learningRate = 1.0;
+			settings.gradientScale = averageLearningRate;
+			settings.decay = 1.0 - regularizationFactor;
+			UpdateParameters(settings);
+		}
+		
 		const NetworkTopology<mathDomain>& _topology;
 		const std::unique_ptr<ICostFunction<mathDomain>> _costFunction;
 		
-		cl::VectorCollection<MemorySpace::Device, mathDomain> _biasGradients;
-		cl::ColumnWiseMatrixCollection<MemorySpace::Device, mathDomain> _weightGradients;
+		// same layout as the network parameters: resetting, norms and reductions are a single pass
+		ParameterBuffer<mathDomain> _gradients;
 	};
 }
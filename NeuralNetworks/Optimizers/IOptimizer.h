@@ -15,5 +15,8 @@ namespace nn
 		
 		virtual void Train(const NetworkTrainingData<mathDomain>& networkTrainingData) noexcept = 0;
 		virtual const ICostFunction<mathDomain>& GetCostFunction() const noexcept = 0;
+		
+		// whether Train reorders the training data in place, which then can't be shared (see HyperParameterSweep)
+		virtual bool IsShufflingTrainingData() const noexcept { return true; }
 	};
 }
@@ -12,5 +12,8 @@ namespace nn
 		
 		virtual ~IShuffler() = default;
 		virtual void Shuffle(Matrix& input, Matrix& expectedOutput) const noexcept = 0;
+		
+		// false if Shuffle leaves the data as it is
+		virtual bool IsReordering() const noexcept { return true; }
 	};
 }
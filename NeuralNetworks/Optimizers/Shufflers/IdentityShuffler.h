@@ -10,5 +10,6 @@ namespace nn
 	public:
 		using IShuffler<mathDomain>::IShuffler;
 		void Shuffle(typename IShuffler<mathDomain>::Matrix&, typename IShuffler<mathDomain>::Matrix&) const noexcept override {}  // no shuffle
+		bool IsReordering() const noexcept override { return false; }
 	};
 }
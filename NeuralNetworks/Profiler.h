@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Scoped timers for the hot path: spans are recorded into per-thread ring buffers, and can be exported either as an
+// aggregate table or as a Chrome trace_event JSON (chrome://tracing, Perfetto).
+// The timers compile to nothing unless USE_PROFILER is defined, so that they can be left in the hot path.
+// NB: kernels are launched asynchronously, so device spans only include the work that the host waited for
+#ifdef USE_PROFILER
+	#define __NN_PROFILE_CONCAT_WORKER__(X, Y) X##Y
+	#define __NN_PROFILE_CONCAT__(X, Y) __NN_PROFILE_CONCAT_WORKER__(X, Y)
+	#define NN_PROFILE_SCOPE(NAME) nn::ScopedTimer __NN_PROFILE_CONCAT__(__scopedTimer, __COUNTER__)(NAME)
+	#define NN_PROFILE_SCOPE_INDEXED(NAME, INDEX) nn::ScopedTimer __NN_PROFILE_CONCAT__(__scopedTimer, __COUNTER__)(NAME, INDEX)
+#else
+	#define NN_PROFILE_SCOPE(NAME) ((void)0)
+	#define NN_PROFILE_SCOPE_INDEXED(NAME, INDEX) ((void)0)
+#endif
+
+namespace nn
+{
+	struct ProfilerEvent
+	{
+		static constexpr size_t noIndex = std::numeric_limits<size_t>::max();
+		
+		const char* name = nullptr;  // NB: must be a string literal, or anyway outlive the profiler
+		size_t index = noIndex;  // e.g. the layer
+		int64_t start = 0;  // ns since the profiler epoch
+		int64_t duration = 0;  // ns
+	};
+	
+	struct ProfilerStatistics
+	{
+		size_t count = 0;
+		int64_t total = 0;  // ns
+		int64_t min = std::numeric_limits<int64_t>::max();
+		int64_t max = 0;
+	};
+	
+	// fixed capacity: when full, the oldest events are overwritten, so that recording never allocates
+	class ProfilerRingBuffer
+	{
+	public:
+		ProfilerRingBuffer(const size_t threadId, const size_t capacity) noexcept
+			: _threadId(threadId), _events(std::max<size_t>(1, capacity))
+		{
+		}
+		
+		inline void Push(const ProfilerEvent& event) noexcept
+		{
+			_events[_head] = event;
+			_head = (_head + 1) % _events.size();
+			if (_size < _events.size())
+				++_size;
+		}
+		
+		// oldest to newest
+		template<typename F>
+		void ForEach(F&& f) const
+		{
+			const size_t first = (_head + _events.size() - _size) % _events.size();
+			for (size_t i = 0; i < _size; ++i)
+				f(_events[(first + i) % _events.size()]);
+		}
+		
+		inline void Clear() noexcept { _head = _size = 0; }
+		inline size_t GetThreadId() const noexcept { return _threadId; }
+		inline size_t GetSize() const noexcept { return _size; }
+	
+	private:
+		size_t _threadId;
+		std::vector<ProfilerEvent> _events;
+		size_t _head = 0;
+		size_t _size = 0;
+	};
+	
+	class Profiler
+	{
+		using Clock = std::chrono::steady_clock;
+	
+	public:
+		static constexpr size_t defaultCapacity = { 1 << 16 };
+		
+		static Profiler& Instance() noexcept
+		{
+			static Profiler instance;
+			return instance;
+		}
+		
+		static constexpr bool IsEnabled() noexcept
+		{
+			#ifdef USE_PROFILER
+				return true;
+			#else
+				return false;
+			#endif
+		}
+		
+		inline int64_t Now() const noexcept { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _epoch).count(); }
+		
+		// the buffer is taken on the first call from every thread, and then cached. When the thread exits, its buffer is
+		// handed to the next new thread (which then shares its track), so that the number of buffers is bounded by the
+		// number of threads alive at the same time, rather than growing with every thread ever created.
+		// NB: a recycled buffer keeps its events, so that they are still exported
+		ProfilerRingBuffer& GetThreadBuffer() noexcept
+		{
+			thread_local ThreadBufferHandle handle;
+			if (!handle.buffer)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_freeBuffers.empty())
+				{
+					handle.buffer = _freeBuffers.back();
+					_freeBuffers.pop_back();
+				}
+				else
+				{
+					_buffers.emplace_back(std::make_unique<ProfilerRingBuffer>(_buffers.size(), _capacity));
+					handle.buffer = _buffers.back().get();
+				}
+			}
+			
+			return *handle.buffer;
+		}
+		
+		inline size_t GetNumberOfBuffers() const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _buffers.size();
+		}
+		
+		// NB: the functions below must not run concurrently with the recording threads
+		
+		// only affects the threads which haven't recorded anything yet
+		void SetCapacity(const size_t capacity) noexcept { _capacity = capacity; }
+		
+		void Reset() noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (auto& buffer: _buffers)
+				buffer->Clear();
+		}
+		
+		size_t GetNumberOfEvents() const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			size_t ret = 0;
+			for (const auto& buffer: _buffers)
+				ret += buffer->GetSize();
+			return ret;
+		}
+		
+		// count, total, min and max duration of every (name, index) pair
+		std::map<std::tuple<std::string, size_t>, ProfilerStatistics> GetStatistics() const
+		{
+			std::map<std::tuple<std::string, size_t>, ProfilerStatistics> statistics;
+			
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (const auto& buffer: _buffers)
+			{
+				buffer->ForEach([&statistics](const ProfilerEvent& event)
+				{
+					auto& entry = statistics[std::make_tuple(std::string(event.name), event.index)];
+					++entry.count;
+					entry.total += event.duration;
+					entry.min = std::min(entry.min, event.duration);
+					entry.max = std::max(entry.max, event.duration);
+				});
+			}
+			
+			return statistics;
+		}
+		
+		std::ostream& WriteSummary(std::ostream& stream) const
+		{
+			const auto statistics = GetStatistics();
+			
+			stream << "name\tindex\tcount\ttotal[ms]\tmean[us]\tmin[us]\tmax[us]\n";
+			for (const auto& entry: statistics)
+			{
+				const auto& s = entry.second;
+				stream << std::get<0>(entry.first) << "\t";
+				if (std::get<1>(entry.first) != ProfilerEvent::noIndex)
+					stream << std::get<1>(entry.first);
+				stream << "\t" << s.count
+				       << "\t" << static_cast<double>(s.total) * 1e-6
+				       << "\t" << static_cast<double>(s.total) * 1e-3 / static_cast<double>(s.count)
+				       << "\t" << static_cast<double>(s.min) * 1e-3
+				       << "\t" << static_cast<double>(s.max) * 1e-3 << "\n";
+			}
+			
+			return stream;
+		}
+		
+		// complete ("X") events, one track per thread
+		std::ostream& WriteChromeTrace(std::ostream& stream) const
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			
+			stream << "{\"traceEvents\":[";
+			bool first = true;
+			for (const auto& buffer: _buffers)
+			{
+				const size_t threadId = buffer->GetThreadId();
+				buffer->ForEach([&stream, &first, threadId](const ProfilerEvent& event)
+				{
+					if (!first)
+						stream << ",";
+					first = false;
+					
+					stream << "\n{\"name\":\"" << event.name;
+					if (event.index != ProfilerEvent::noIndex)
+						stream << "[" << event.index << "]";
+					stream << "\",\"cat\":\"nn\",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadId
+					       << ",\"ts\":" << static_cast<double>(event.start) * 1e-3
+					       << ",\"dur\":" << static_cast<double>(event.duration) * 1e-3;
+					if (event.index != ProfilerEvent::noIndex)
+						stream << ",\"args\":{\"index\":" << event.index << "}";
+					stream << "}";
+				});
+			}
+			stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+			
+			return stream;
+		}
+	
+	private:
+		// gives the buffer back when its thread exits
+		struct ThreadBufferHandle
+		{
+			ProfilerRingBuffer* buffer = nullptr;
+			
+			~ThreadBufferHandle()
+			{
+				if (buffer)
+					Profiler::Instance().Release(*buffer);
+			}
+		};
+		
+		Profiler() noexcept = default;
+		
+		void Release(ProfilerRingBuffer& buffer) noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_freeBuffers.push_back(&buffer);
+		}
+		
+		const Clock::time_point _epoch = Clock::now();
+		size_t _capacity = defaultCapacity;
+		
+		mutable std::mutex _mutex {};
+		std::vector<std::unique_ptr<ProfilerRingBuffer>> _buffers {};
+		std::vector<ProfilerRingBuffer*> _freeBuffers {};
+	};
+	
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer(const char* name, const size_t index = ProfilerEvent::noIndex) noexcept
+			: _name(name), _index(index), _start(Profiler::Instance().Now())
+		{
+		}
+		
+		~ScopedTimer()
+		{
+			auto& profiler = Profiler::Instance();
+			profiler.GetThreadBuffer().Push({ _name, _index, _start, profiler.Now() - _start });
+		}
+		
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+	
+	private:
+		const char* _name;
+		size_t _index;
+		int64_t _start;
+	};
+}
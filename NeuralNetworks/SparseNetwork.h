@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+#include <NeuralNetworks/Activations/ActivationFunctionFactory.h>
+#include <NeuralNetworks/Memory/InferenceWorkspace.h>
+#include <NeuralNetworks/Memory/CsrMatrix.h>
+
+#include <memory>
+#include <vector>
+
+namespace nn
+{
+	// Inference-only view of a pruned topology: the fully connected layers that are sparse enough are copied in CSR
+	// format, so that their storage and their cost scale with the number of nonzeros, while the other layers are
+	// evaluated by the topology itself.
+	// NB: the dense layers are borrowed, so the topology must outlive this
+	template<MathDomain mathDomain>
+	class SparseNetwork
+	{
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		
+		struct SparseLayer
+		{
+			std::unique_ptr<CsrMatrix<mathDomain>> weight;
+			std::unique_ptr<Vector> bias;
+			std::unique_ptr<IActivationFunction<mathDomain>> activationFunction;
+		};
+	
+	public:
+		// below minSparsity the dense GEMM is faster than the CSR product, whatever the memory saving
+		explicit SparseNetwork(const NetworkTopology<mathDomain>& topology, const double minSparsity = 0.5) noexcept
+			: _topology(topology), _layers(topology.GetSize())
+		{
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				const auto& layer = *topology[l];
+				if (layer.GetType() != LayerType::Dense && layer.GetType() != LayerType::SoftMax)
+					continue;
+				
+				auto weight = std::make_unique<CsrMatrix<mathDomain>>(layer.GetWeight());
+				if (weight->GetSparsity() < minSparsity)
+					continue;
+				
+				_layers[l].weight = std::move(weight);
+				_layers[l].bias = std::make_unique<Vector>(layer.GetBias());
+				_layers[l].activationFunction = ActivationFunctionFactory<mathDomain>::Create(layer.GetActivationFunctionType());
+				AllocationTracker::Instance().Record(_layers[l].bias->GetBuffer());
+			}
+		}
+		
+		inline bool IsSparse(const size_t l) const noexcept { return _layers[l].weight != nullptr; }
+		
+		// weights and biases actually stored: the dense layers' ones count in full
+		size_t GetNumberOfBytes() const noexcept
+		{
+			size_t ret = 0;
+			for (size_t l = 0; l < _layers.size(); ++l)
+			{
+				const auto& layer = *_topology[l];
+				const size_t elementSize = sizeof(typename Traits<mathDomain>::stdType);
+				if (IsSparse(l))
+					ret += _layers[l].weight->GetNumberOfBytes() + layer.GetBias().size() * elementSize;
+				else
+					ret += (layer.GetWeight().size() + layer.GetBias().size()) * elementSize;
+			}
+			return ret;
+		}
+		
+		// same as NetworkTopology::Infer
+		void Infer(Matrix& output, const Matrix& input, InferenceWorkspace<mathDomain>& workspace) const noexcept
+		{
+			const size_t nLayers = _layers.size();
+			
+			const Matrix* layerInput = &input;
+			for (size_t l = 0; l < nLayers; ++l)
+			{
+				auto& layerOutput = l + 1 < nLayers ? workspace.Get(l, _topology[l]->GetNumberOfOutputs(), input.nCols()) : output;
+				if (IsSparse(l))
+				{
+					if (_layers[l].activationFunction)
+					{
+						auto z = workspace.GetZScratch(layerOutput.nRows(), layerOutput.nCols());
+						_layers[l].weight->Multiply(z, *layerInput, *_layers[l].bias);
+						_layers[l].activationFunction->Infer(layerOutput, z, workspace);
+					}
+					else
+						_layers[l].weight->Multiply(layerOutput, *layerInput, *_layers[l].bias);
+				}
+				else
+					_topology[l]->Infer(layerOutput, *layerInput, workspace);
+				
+				layerInput = &layerOutput;
+			}
+		}
+	
+	private:
+		const NetworkTopology<mathDomain>& _topology;
+		std::vector<SparseLayer> _layers;
+	};
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <Types.h>
+#include <NeuralNetworks/Layers/LayerType.h>
+#include <NeuralNetworks/Activations/ActivationFunctorTraits.h>
+#include <NeuralNetworks/Layers/ILayer.h>
+#include <NeuralNetworks/Layers/NetworkTopology.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+#include <utility>
+
+namespace nn
+{
+	// compile-time description of a dense layer
+	template<size_t nInput_, size_t nOutput_, ActivationFunctionType activation_>
+	struct StaticDense
+	{
+		static constexpr size_t nInput = nInput_;
+		static constexpr size_t nOutput = nOutput_;
+		static constexpr ActivationFunctionType activation = activation_;
+		static constexpr LayerType type = LayerType::Dense;
+	};
+	
+	template<size_t nInput_, size_t nOutput_>
+	struct StaticSoftMax
+	{
+		static constexpr size_t nInput = nInput_;
+		static constexpr size_t nOutput = nOutput_;
+		static constexpr ActivationFunctionType activation = ActivationFunctionType::SoftMax;
+		static constexpr LayerType type = LayerType::SoftMax;
+	};
+	
+	namespace detail
+	{
+		// weight and bias of a layer, column-major as in the dynamic layers, so that they can be copied as they are
+		template<typename T, typename Layer>
+		struct StaticLayerParameters
+		{
+			std::array<T, Layer::nOutput * Layer::nInput> weight {};
+			std::array<T, Layer::nOutput> bias {};
+		};
+		
+		// z = W * x + b: every column of the weight is scaled by its input and accumulated into the output, so that the
+		// inner loop is a contiguous, fixed-size axpy the compiler can vectorise
+		template<typename T, size_t nInput, size_t nOutput, typename Functor>
+		static inline void StaticDenseForward(T* __restrict z, const T* __restrict weight, const T* __restrict bias, const T* __restrict x) noexcept
+		{
+			for (size_t i = 0; i < nOutput; ++i)
+				z[i] = bias[i];
+			for (size_t j = 0; j < nInput; ++j)
+			{
+				const T xj = x[j];
+				const T* __restrict column = weight + j * nOutput;
+				for (size_t i = 0; i < nOutput; ++i)
+					z[i] += column[i] * xj;
+			}
+			for (size_t i = 0; i < nOutput; ++i)
+				z[i] = Functor::Value(z[i]);
+		}
+		
+		template<typename T, typename Layer>
+		static inline void StaticLayerForward(T* output, const StaticLayerParameters<T, Layer>& parameters, const T* input) noexcept
+		{
+			if constexpr (Layer::activation == ActivationFunctionType::SoftMax)
+			{
+				StaticDenseForward<T, Layer::nInput, Layer::nOutput, IdentityFunctor>(output, parameters.weight.data(), parameters.bias.data(), input);
+				
+				// NB: the maximum is subtracted for stability, which doesn't change the result
+				const T max = *std::max_element(output, output + Layer::nOutput);
+				T sum = static_cast<T>(0.0);
+				for (size_t i = 0; i < Layer::nOutput; ++i)
+				{
+					output[i] = std::exp(output[i] - max);
+					sum += output[i];
+				}
+				const T normalisation = static_cast<T>(1.0) / sum;
+				for (size_t i = 0; i < Layer::nOutput; ++i)
+					output[i] *= normalisation;
+			}
+			else
+				StaticDenseForward<T, Layer::nInput, Layer::nOutput, ActivationFunctor<Layer::activation>>(output, parameters.weight.data(), parameters.bias.data(), input);
+		}
+		
+		template<typename... Layers> struct StaticShapesMatch;
+		template<typename Layer> struct StaticShapesMatch<Layer> { static constexpr bool value = true; };
+		template<typename Layer, typename Next, typename... Layers>
+		struct StaticShapesMatch<Layer, Next, Layers...>
+		{
+			static constexpr bool value = Layer::nOutput == Next::nInput && StaticShapesMatch<Next, Layers...>::value;
+		};
+	}
+	
+	// Fixed MLP whose shapes and activations are template parameters, for single-sample inference on the host, e.g.
+	//     StaticNetwork<MathDomain::Float, StaticDense<784, 100, ActivationFunctionType::Sigmoid>, StaticSoftMax<100, 10>>
+	// There's no virtual call, no workspace and no allocation: intermediate activations live on the stack, and
+	// the parameters are read from a trained NetworkTopology with the same shape.
+	// NB: the parameters are stored inline, so large networks should be heap allocated
+	template<MathDomain mathDomain, typename... Layers>
+	class StaticNetwork
+	{
+		static_assert(sizeof...(Layers) > 0, "a network needs at least one layer");
+		static_assert(detail::StaticShapesMatch<Layers...>::value, "the number of inputs of a layer must match the number of outputs of the previous one");
+		
+		using FirstLayer = std::tuple_element_t<0, std::tuple<Layers...>>;
+		using LastLayer = std::tuple_element_t<sizeof...(Layers) - 1, std::tuple<Layers...>>;
+	
+	public:
+		using Real = typename Traits<mathDomain>::stdType;
+		
+		static constexpr size_t nLayers = sizeof...(Layers);
+		static constexpr size_t nInput = FirstLayer::nInput;
+		static constexpr size_t nOutput = LastLayer::nOutput;
+		
+		// false if the topology doesn't have the same layers, activations and shapes
+		bool ReadFrom(const NetworkTopology<mathDomain>& topology) noexcept
+		{
+			if (topology.GetSize() != nLayers)
+				return false;
+			return ReadFromWorker(topology, std::index_sequence_for<Layers...>());
+		}
+		
+		void Evaluate(Real* output, const Real* input) const noexcept
+		{
+			EvaluateWorker<0>(output, input);
+		}
+		
+		std::array<Real, nOutput> Evaluate(const std::array<Real, nInput>& input) const noexcept
+		{
+			std::array<Real, nOutput> ret;
+			Evaluate(ret.data(), input.data());
+			return ret;
+		}
+		
+		template<size_t l>
+		auto& GetParameters() noexcept { return std::get<l>(_parameters); }
+		template<size_t l>
+		const auto& GetParameters() const noexcept { return std::get<l>(_parameters); }
+	
+	private:
+		template<size_t l>
+		void EvaluateWorker(Real* output, const Real* input) const noexcept
+		{
+			using Layer = std::tuple_element_t<l, std::tuple<Layers...>>;
+			if constexpr (l + 1 == nLayers)
+				detail::StaticLayerForward<Real, Layer>(output, std::get<l>(_parameters), input);
+			else
+			{
+				Real activation[Layer::nOutput];
+				detail::StaticLayerForward<Real, Layer>(activation, std::get<l>(_parameters), input);
+				EvaluateWorker<l + 1>(output, activation);
+			}
+		}
+		
+		template<size_t... l>
+		bool ReadFromWorker(const NetworkTopology<mathDomain>& topology, std::index_sequence<l...>) noexcept
+		{
+			return (ReadLayerFrom<l>(*topology[l]) && ...);
+		}
+		
+		template<size_t l>
+		bool ReadLayerFrom(const ILayer<mathDomain>& layer) noexcept
+		{
+			using Layer = std::tuple_element_t<l, std::tuple<Layers...>>;
+			if (layer.GetType() != Layer::type || layer.GetActivationFunctionType() != Layer::activation)
+				return false;
+			if (layer.GetNumberOfInputs() != Layer::nInput || layer.GetNumberOfOutputs() != Layer::nOutput)
+				return false;
+			
+			auto& parameters = std::get<l>(_parameters);
+			const auto weight = layer.GetWeight().Get();
+			const auto bias = layer.GetBias().Get();
+			std::copy(weight.begin(), weight.end(), parameters.weight.begin());
+			std::copy(bias.begin(), bias.end(), parameters.bias.begin());
+			return true;
+		}
+	
+	private:
+		std::tuple<detail::StaticLayerParameters<Real, Layers>...> _parameters {};
+	};
+}
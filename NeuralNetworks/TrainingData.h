@@ -4,6 +4,7 @@
 #include <ColumnWiseMatrix.h>
 #include <Vector.h>
 
+#include <algorithm>
 #include <functional>
 
 namespace nn
@@ -39,6 +40,11 @@ namespace nn
 		size_t nEpochs = 10;
 		size_t miniBatchSize = 32;
 		
+		// number of columns run through the network at once: their gradients are accumulated until a whole mini-batch
+		// has been processed, and only then the layers are updated. 0 -> same as miniBatchSize
+		// NB: the optimizer scratch memory should be sized for this, rather than for miniBatchSize
+		size_t microBatchSize = 0;
+		
 		double learningRate = 0.1;
 		double lambda = 5.0;
 		
@@ -46,6 +52,11 @@ namespace nn
 		{
 			return learningRate / static_cast<double>(miniBatchSize);
 		}
+		
+		size_t GetMicroBatchSize() const noexcept
+		{
+			return microBatchSize == 0 ? miniBatchSize : std::min(microBatchSize, miniBatchSize);
+		}
 	};
 	
 	
@@ -56,6 +67,8 @@ namespace nn
 		TrainingData<mathDomain>& testData;
 		TrainingData<mathDomain>& validationData;
 		
+		// NB: the data is evaluated in chunks of columns, and the evaluator results are summed up: it must then be
+		// additive over columns (e.g. the number of correct predictions)
 		const std::function<double(Matrix<mathDomain>&, const Matrix<mathDomain>&)>& evaluator;
 		
 		HyperParameters hyperParameters {};
@@ -71,6 +84,21 @@ namespace nn
 		
 		size_t nMaxEpochsWithNoScoreImprovements = 0;
 		
+		// accuracy and total cost are evaluated on chunks of this many columns (0 -> whole data set at once), so that
+		// the evaluation memory doesn't depend on the size of the data set
+		size_t evaluationChunkSize = 1000;
+		size_t nEvaluationThreads = 1;
+		
+		// if set, the accuracy and total cost are evaluated on a snapshot of the weights in a separate thread, while the
+		// next epoch trains. The early stop then kicks in one epoch late.
+		// NB: if the optimizer shuffles the training data in place, its metrics are evaluated on a copy of it
+		bool asynchronousEvaluation = false;
+		
+		// test mode: aborts if anything is allocated after the first epoch (the second one, with asynchronous evaluation),
+		// printing the allocations by phase
+		// NB: evaluations should run every epoch, as their first run allocates its workspaces
+		bool checkNoAllocationsAfterFirstEpoch = false;
+		
 		int debugLevel = 0;
 		
 		NetworkTrainingData(TrainingData<mathDomain>& trainingData_, TrainingData<mathDomain>& testData_,
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <Types.h>
+#include <ColumnWiseMatrix.h>
+#include <Vector.h>
+#include <NeuralNetworks/Memory/AllocationTracker.h>
+
+#include <cassert>
+#include <memory>
+
+namespace nn
+{
+	namespace detail
+	{
+		// non-owning views over memory that is owned by someone else
+		template<MathDomain mathDomain>
+		static inline cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain> MakeMatrixView(const std::ptrdiff_t pointer, const size_t nRows, const size_t nCols) noexcept
+		{
+			return cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>(MemoryTile(pointer, static_cast<unsigned>(nRows), static_cast<unsigned>(nCols), MemorySpace::Device, mathDomain));
+		}
+		
+		template<MathDomain mathDomain>
+		static inline cl::Vector<MemorySpace::Device, mathDomain> MakeVectorView(const std::ptrdiff_t pointer, const size_t size) noexcept
+		{
+			return cl::Vector<MemorySpace::Device, mathDomain>(MemoryBuffer(pointer, static_cast<unsigned>(size), MemorySpace::Device, mathDomain));
+		}
+		
+		// columns [colStart, colEnd) of a matrix: being a plain view on its memory, it never goes through the allocator
+		template<MathDomain mathDomain>
+		static inline cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain> MakeColumnsView(cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>& matrix, const size_t colStart, const size_t colEnd) noexcept
+		{
+			const auto& buffer = matrix.GetBuffer();
+			const auto offset = static_cast<std::ptrdiff_t>(colStart * buffer.nRows * buffer.ElementarySize());
+			return MakeMatrixView<mathDomain>(buffer.pointer + offset, buffer.nRows, colEnd - colStart);
+		}
+		
+		// NB: the view of a const matrix is const as well, so that it can't be written through
+		template<MathDomain mathDomain>
+		static inline const cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain> MakeColumnsView(const cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>& matrix, const size_t colStart, const size_t colEnd) noexcept
+		{
+			return MakeColumnsView<mathDomain>(const_cast<cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>&>(matrix), colStart, colEnd);
+		}
+	}
+	
+	// Scratch matrix with a fixed number of rows, allocated once for the widest batch requested so far.
+	// Narrower batches (e.g. the ragged last mini-batch) get a view on the first nCols columns, so that the memory
+	// is bounded by the capacity rather than by the number of distinct batch sizes seen.
+	// The memory can also be borrowed from an arena (see NetworkMemoryPlan) by means of Bind.
+	template<MathDomain mathDomain>
+	class Workspace
+	{
+	public:
+		using Matrix = cl::ColumnWiseMatrix<MemorySpace::Device, mathDomain>;
+		
+		explicit Workspace(const size_t nRows, const size_t capacity = 0, const double initialValue = 0.0) noexcept
+			: _nRows(nRows), _initialValue(initialValue)
+		{
+			Reserve(capacity);
+		}
+		
+		// NB: growing the capacity invalidates the views previously handed out. A bound workspace can't grow: its
+		// memory is laid out by the plan it's bound to, which has to be rebuilt for the wider batch
+		void Reserve(const size_t capacity) noexcept
+		{
+			if (capacity <= _capacity)
+				return;
+			assert(!IsBound());
+			
+			_view.reset();
+			_buffer = std::make_unique<Matrix>(static_cast<unsigned>(_nRows), static_cast<unsigned>(capacity), _initialValue);
+			AllocationTracker::Instance().Record(_buffer->GetBuffer());
+			_pointer = _buffer->GetBuffer().pointer;
+			_capacity = capacity;
+		}
+		
+		// use externally owned memory, big enough for nRows * capacity elements, instead of the own buffer
+		void Bind(const std::ptrdiff_t pointer, const size_t capacity) noexcept
+		{
+			_view.reset();
+			_buffer.reset();
+			_pointer = pointer;
+			_capacity = capacity;
+		}
+		
+		Matrix& Get(const size_t nCols) noexcept
+		{
+			Reserve(nCols);
+			if (!_view || _view->nCols() != nCols)
+				_view = std::make_unique<Matrix>(detail::MakeMatrixView<mathDomain>(_pointer, _nRows, nCols));
+			
+			return *_view;
+		}
+		
+		inline size_t GetNumberOfRows() const noexcept { return _nRows; }
+		inline size_t GetCapacity() const noexcept { return _capacity; }
+		inline bool IsBound() const noexcept { return _capacity > 0 && !_buffer; }
+		inline std::ptrdiff_t GetPointer() const noexcept { return _pointer; }
+	
+	private:
+		size_t _nRows;
+		size_t _capacity = 0;
+		double _initialValue;
+		
+		std::unique_ptr<Matrix> _buffer {};
+		std::ptrdiff_t _pointer = 0;
+		std::unique_ptr<Matrix> _view {};  // last handed-out view, rebuilt only when the batch width changes
+	};
+	
+	// same as above, for vectors (e.g. the ones used for broadcasting the bias)
+	template<MathDomain mathDomain>
+	class VectorWorkspace
+	{
+	public:
+		using Vector = cl::Vector<MemorySpace::Device, mathDomain>;
+		
+		explicit VectorWorkspace(const size_t capacity = 0, const double initialValue = 0.0) noexcept
+			: _initialValue(initialValue)
+		{
+			Reserve(capacity);
+		}
+		
+		void Reserve(const size_t capacity) noexcept
+		{
+			if (capacity <= _capacity)
+				return;
+			
+			_view.reset();
+			_buffer = std::make_unique<Vector>(static_cast<unsigned>(capacity), _initialValue);
+			AllocationTracker::Instance().Record(_buffer->GetBuffer());
+			_capacity = capacity;
+		}
+		
+		Vector& Get(const size_t size) noexcept
+		{
+			Reserve(size);
+			if (!_view || _view->size() != size)
+				_view = std::make_unique<Vector>(detail::MakeVectorView<mathDomain>(_buffer->GetBuffer().pointer, size));
+			
+			return *_view;
+		}
+		
+		inline size_t GetCapacity() const noexcept { return _capacity; }
+	
+	private:
+		size_t _capacity = 0;
+		double _initialValue;
+		
+		std::unique_ptr<Vector> _buffer {};
+		std::unique_ptr<Vector> _view {};
+	};
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <HostObjectiveFunctions.h>
+#include <NeuralNetworks/Activations/ActivationFunctorTraits.h>
+
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace nnt
+{
+	class ActivationFunctorTests : public ::testing::Test
+	{
+	public:
+		// derivative against central finite differences, and derivative from the output against the derivative
+		template<typename Functor>
+		static void CheckDerivatives()
+		{
+			static constexpr double h = 1e-6;
+			for (double x = -3.0; x <= 3.0; x += 0.25)
+			{
+				// NB: skip the kink of the piecewise activations
+				if (std::abs(x) < 0.1)
+					continue;
+				
+				const double finiteDifference = (Functor::Value(x + h) - Functor::Value(x - h)) / (2.0 * h);
+				ASSERT_NEAR(finiteDifference, Functor::Derivative(x), 1e-6) << "x=" << x;
+				ASSERT_NEAR(Functor::Derivative(x), Functor::DerivativeFromOutput(Functor::Value(x)), 1e-9) << "x=" << x;
+			}
+		}
+	};
+	
+	TEST_F(ActivationFunctorTests, Derivatives)
+	{
+		CheckDerivatives<IdentityFunctor>();
+		CheckDerivatives<SigmoidFunctor>();
+		CheckDerivatives<HyperbolicTangentFunctor>();
+		CheckDerivatives<RectifiedLinearUnitFunctor>();
+		CheckDerivatives<LeakyRectifiedLinearUnitFunctor>();
+		CheckDerivatives<InverseSquareRootLinearUnitFunctor>();
+		CheckDerivatives<ExponentialLinearUnitFunctor>();
+		CheckDerivatives<BentIdentityFunctor>();
+	}
+	
+	TEST_F(ActivationFunctorTests, InverseSquareRootLinearUnitAndExponentialLinearUnit)
+	{
+		const std::vector<double> x = { -3.0, -1.0, -0.5, 0.5, 1.0, 3.0 };
+		std::vector<double> isrlu(x.size()), isrluPrime(x.size()), elu(x.size()), eluPrime(x.size());
+		__ActivationHost__<InverseSquareRootLinearUnitFunctor>(isrlu.data(), x.data(), static_cast<unsigned>(x.size()));
+		__ActivationPrimeHost__<InverseSquareRootLinearUnitFunctor>(isrluPrime.data(), x.data(), static_cast<unsigned>(x.size()));
+		__ActivationHost__<ExponentialLinearUnitFunctor>(elu.data(), x.data(), static_cast<unsigned>(x.size()));
+		__ActivationPrimeHost__<ExponentialLinearUnitFunctor>(eluPrime.data(), x.data(), static_cast<unsigned>(x.size()));
+		
+		for (size_t i = 0; i < x.size(); ++i)
+		{
+			if (x[i] > 0.0)
+			{
+				ASSERT_DOUBLE_EQ(x[i], isrlu[i]);
+				ASSERT_DOUBLE_EQ(1.0, isrluPrime[i]);
+				ASSERT_DOUBLE_EQ(x[i], elu[i]);
+				ASSERT_DOUBLE_EQ(1.0, eluPrime[i]);  // used to be x
+				continue;
+			}
+			
+			const double invSqrt = 1.0 / std::sqrt(1.0 + x[i] * x[i]);
+			ASSERT_DOUBLE_EQ(x[i] * invSqrt, isrlu[i]);  // used to be x / (1 + x^2)
+			ASSERT_DOUBLE_EQ(invSqrt * invSqrt * invSqrt, isrluPrime[i]);
+			ASSERT_DOUBLE_EQ(std::exp(x[i]) - 1.0, elu[i]);  // used to be the ISRLU
+			ASSERT_DOUBLE_EQ(std::exp(x[i]), eluPrime[i]);
+		}
+	}
+	
+	TEST_F(ActivationFunctorTests, CompileTimeMapping)
+	{
+		static_assert(std::is_same<ExponentialLinearUnitFunctor, nn::ActivationFunctor<nn::ActivationFunctionType::Elu>>::value, "");
+		static_assert(std::is_same<LeakyRectifiedLinearUnitFunctor, nn::ActivationFunctor<nn::ActivationFunctionType::LeakyReLu>>::value, "");
+		static_assert(std::is_same<IdentityFunctor, nn::ActivationFunctor<nn::ActivationFunctionType::Null>>::value, "");
+		
+		const std::vector<float> x = { -2.0f, -0.5f, 0.5f, 2.0f };
+		std::vector<float> y(x.size());
+		__ActivationHost__<nn::ActivationFunctor<nn::ActivationFunctionType::Sigmoid>>(y.data(), x.data(), static_cast<unsigned>(x.size()));
+		for (size_t i = 0; i < x.size(); ++i)
+			ASSERT_FLOAT_EQ(1.0f / (1.0f + std::exp(-x[i])), y[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include <NeuralNetworks/Memory/AllocationTracker.h>
+#include <NeuralNetworks/Workspace.h>
+
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	class AllocationTrackerTests : public ::testing::Test
+	{
+	public:
+		void SetUp() override
+		{
+			nn::AllocationTracker::Instance().Reset();
+		}
+	};
+	
+	TEST_F(AllocationTrackerTests, AllocationsAreLabelledByPhase)
+	{
+		auto& tracker = nn::AllocationTracker::Instance();
+		tracker.Record(MemorySpace::Device, 100);
+		{
+			nn::AllocationPhase phase("MiniBatch");
+			tracker.Record(MemorySpace::Device, 10);
+			tracker.Record(MemorySpace::Host, 1);
+		}
+		tracker.Record(MemorySpace::Device, 1000);
+		
+		const auto statistics = tracker.GetStatistics();
+		ASSERT_EQ(statistics.size(), 3);
+		ASSERT_EQ(statistics.at(nn::AllocationTracker::Key("Setup", MemorySpace::Device)).count, 2);
+		ASSERT_EQ(statistics.at(nn::AllocationTracker::Key("Setup", MemorySpace::Device)).bytes, 1100);
+		ASSERT_EQ(statistics.at(nn::AllocationTracker::Key("MiniBatch", MemorySpace::Device)).bytes, 10);
+		ASSERT_EQ(statistics.at(nn::AllocationTracker::Key("MiniBatch", MemorySpace::Host)).count, 1);
+		ASSERT_EQ(tracker.GetTotal().count, 4);
+	}
+	
+	TEST_F(AllocationTrackerTests, WorkspaceOnlyAllocatesWhenGrowing)
+	{
+		nn::Workspace<MathDomain::Float> workspace(10, 32);
+		ASSERT_EQ(nn::AllocationTracker::Instance().GetTotal().count, 1);
+		
+		// narrower (e.g. ragged) and same-size batches are views on the existing buffer
+		workspace.Get(32);
+		workspace.Get(7);
+		workspace.Get(32);
+		ASSERT_EQ(nn::AllocationTracker::Instance().GetTotal().count, 1);
+		
+		workspace.Get(64);
+		ASSERT_EQ(nn::AllocationTracker::Instance().GetTotal().count, 2);
+	}
+}
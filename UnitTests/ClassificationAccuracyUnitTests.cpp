@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <HostObjectiveFunctions.h>
+
+#include <random>
+#include <cmath>
+
+namespace nnt
+{
+	class ClassificationAccuracyTests : public ::testing::Test
+	{
+	public:
+		// reference implementation: two argmax passes and a count, as done by ColumnWiseArgAbsMaximum + CountEquals
+		static int CountEquals(const std::vector<float>& x, const std::vector<float>& y, const unsigned nRows, const unsigned nCols)
+		{
+			const auto argAbsMax = [nRows](const std::vector<float>& z, const unsigned j)
+			{
+				unsigned ret = 0;
+				for (unsigned i = 1; i < nRows; ++i)
+					if (std::abs(z[j * nRows + i]) > std::abs(z[j * nRows + ret]))
+						ret = i;
+				return ret;
+			};
+			
+			int ret = 0;
+			for (unsigned j = 0; j < nCols; ++j)
+				ret += argAbsMax(x, j) == argAbsMax(y, j);
+			return ret;
+		}
+	};
+	
+	TEST_F(ClassificationAccuracyTests, ArgAbsMaximum)
+	{
+		const std::vector<float> x = { 0.1f, -0.7f, 0.3f, 0.7f };
+		ASSERT_EQ(1u, __ColumnArgAbsMaximumWorker__(x.data(), 4));
+		ASSERT_EQ(0u, __ColumnArgAbsMaximumWorker__(x.data(), 1));
+		ASSERT_EQ(0u, __ColumnArgAbsMaximumWorker__(x.data() + 1, 3));  // ties go to the first index
+	}
+	
+	TEST_F(ClassificationAccuracyTests, SmallMatrix)
+	{
+		// 3 columns with 2 rows: only the first and the last are classified correctly
+		const std::vector<float> modelOutput = { 0.9f, 0.1f,   0.4f, 0.6f,   0.2f, 0.8f };
+		const std::vector<float> expectedOutput = { 1.0f, 0.0f,   1.0f, 0.0f,   0.0f, 1.0f };
+		ASSERT_EQ(2, __ClassificationAccuracyHost__(modelOutput.data(), expectedOutput.data(), 2, 3));
+	}
+	
+	TEST_F(ClassificationAccuracyTests, MultiThreadedMatchesReference)
+	{
+		constexpr unsigned nRows = 10;
+		constexpr unsigned nCols = 10007;  // not a multiple of the number of threads
+		
+		std::mt19937 generator(1234);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::uniform_int_distribution<unsigned> label(0, nRows - 1);
+		
+		std::vector<float> modelOutput(nRows * nCols);
+		std::vector<float> expectedOutput(nRows * nCols, 0.0f);
+		for (auto& x: modelOutput)
+			x = uniform(generator);
+		for (unsigned j = 0; j < nCols; ++j)
+			expectedOutput[j * nRows + label(generator)] = 1.0f;
+		
+		const int expected = CountEquals(modelOutput, expectedOutput, nRows, nCols);
+		ASSERT_GT(expected, 0);
+		for (unsigned nThreads: { 1u, 2u, 3u, 8u, 0u })
+			ASSERT_EQ(expected, __ClassificationAccuracyHost__(modelOutput.data(), expectedOutput.data(), nRows, nCols, nThreads));
+	}
+}
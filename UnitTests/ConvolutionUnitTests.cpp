@@ -0,0 +1,318 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+#include <fstream>
+#include <random>
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class ConvolutionTests : public ::testing::Test
+	{
+	public:
+		static std::vector<double> Random(const size_t size, const unsigned seed)
+		{
+			std::mt19937 generator(seed);
+			std::normal_distribution<double> distribution;
+			std::vector<double> ret(size);
+			for (auto& x: ret)
+				x = distribution(generator);
+			return ret;
+		}
+		
+		// straightforward definition, as reference
+		static std::vector<double> Convolution(const std::vector<double>& x, const std::vector<double>& weight, const std::vector<double>& bias, const ConvolutionGeometry& g, const unsigned nCols)
+		{
+			std::vector<double> z(g.GetNumberOfOutputs() * nCols);
+			for (unsigned j = 0; j < nCols; ++j)
+				for (unsigned f = 0; f < g.nFilters; ++f)
+					for (unsigned oy = 0; oy < g.GetOutputHeight(); ++oy)
+						for (unsigned ox = 0; ox < g.GetOutputWidth(); ++ox)
+						{
+							double sum = bias[f];
+							for (unsigned c = 0; c < g.nChannels; ++c)
+								for (unsigned ky = 0; ky < g.kernelSize; ++ky)
+									for (unsigned kx = 0; kx < g.kernelSize; ++kx)
+										sum += weight[f + ((c * g.kernelSize + ky) * g.kernelSize + kx) * g.nFilters] * x[j * g.GetNumberOfInputs() + (c * g.height + oy * g.stride + ky) * g.width + ox * g.stride + kx];
+							z[j * g.GetNumberOfOutputs() + (f * g.GetOutputHeight() + oy) * g.GetOutputWidth() + ox] = sum;
+						}
+			return z;
+		}
+		
+		// host views of the test data: the kernels are then called through the host branch of their entry point
+		static MemoryTile MakeHostTile(std::vector<double>& x, const unsigned nRows, const unsigned nCols)
+		{
+			return MemoryTile(reinterpret_cast<std::ptrdiff_t>(x.data()), nRows, nCols, MemorySpace::Host, md);
+		}
+		
+		static MemoryBuffer MakeHostBuffer(std::vector<double>& x)
+		{
+			return MemoryBuffer(reinterpret_cast<std::ptrdiff_t>(x.data()), static_cast<unsigned>(x.size()), MemorySpace::Host, md);
+		}
+		
+		static double Dot(const std::vector<double>& x, const std::vector<double>& y)
+		{
+			double ret = 0.0;
+			for (size_t i = 0; i < x.size(); ++i)
+				ret += x[i] * y[i];
+			return ret;
+		}
+		
+		// checks gradient against the central finite differences of L(parameter) = <r, z(parameter)>
+		template<typename F>
+		static void CheckGradient(std::vector<double>& parameter, const std::vector<double>& gradient, const std::vector<double>& r, const F& evaluate)
+		{
+			static constexpr double h = 1e-5;
+			for (size_t i = 0; i < parameter.size(); ++i)
+			{
+				const double x = parameter[i];
+				parameter[i] = x + h;
+				const double up = Dot(r, evaluate());
+				parameter[i] = x - h;
+				const double down = Dot(r, evaluate());
+				parameter[i] = x;
+				
+				ASSERT_NEAR((up - down) / (2.0 * h), gradient[i], 1e-6) << "i=" << i;
+			}
+		}
+		
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			// 2 x 10 x 9 images -> 3 filters of 8 x 7 -> 3 x 4 x 3 -> 5 -> 4
+			ConvolutionGeometry convolution;
+			convolution.nChannels = 2;
+			convolution.height = 10;
+			convolution.width = 9;
+			convolution.nFilters = 3;
+			convolution.kernelSize = 3;
+			convolution.stride = 1;
+			
+			ConvolutionGeometry pooling;
+			pooling.nChannels = 3;
+			pooling.height = 8;
+			pooling.width = 7;
+			pooling.kernelSize = 2;
+			pooling.stride = 2;
+			
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::Convolution2DLayer<md>>(convolution, std::make_unique<nn::RectifiedLinearUnitActivationFunction<md>>(), nn::SmallVarianceRandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::MaxPool2DLayer<md>>(pooling, nullptr, nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(36, 5, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::SmallVarianceRandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(5, 4, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::ZeroBiasWeightInitializer<md>()));
+			return nn::NetworkTopology<md>(std::move(layers));
+		}
+	};
+	
+	TEST_F(ConvolutionTests, HostConvolution)
+	{
+		for (const unsigned stride: { 1u, 2u })
+		{
+			ConvolutionGeometry g;
+			g.nChannels = 3;
+			g.height = 11;
+			g.width = 9;
+			g.nFilters = 6;  // not a multiple of the filter block
+			g.kernelSize = 3;
+			g.stride = stride;
+			const unsigned nCols = 3;
+			
+			auto x = Random(g.GetNumberOfInputs() * nCols, 1);
+			auto weight = Random(g.nFilters * g.GetNumberOfTaps(), 2);
+			auto bias = Random(g.nFilters, 3);
+			auto r = Random(g.GetNumberOfOutputs() * nCols, 4);
+			
+			const auto expected = Convolution(x, weight, bias, g, nCols);
+			std::vector<double> z(expected.size());
+			auto zTile = MakeHostTile(z, g.GetNumberOfOutputs(), nCols);
+			nn::detail::Convolution(zTile, MakeHostTile(x, g.GetNumberOfInputs(), nCols), MakeHostTile(weight, g.nFilters, g.GetNumberOfTaps()), MakeHostBuffer(bias), g);
+			for (size_t i = 0; i < z.size(); ++i)
+				ASSERT_NEAR(expected[i], z[i], 1e-12);
+			
+			// back-propagate r as if it were dL/dz
+			std::vector<double> inputGradient(x.size());
+			std::vector<double> weightGradient(weight.size(), 0.0);
+			std::vector<double> biasGradient(bias.size(), 0.0);
+			auto inputGradientTile = MakeHostTile(inputGradient, g.GetNumberOfInputs(), nCols);
+			auto weightGradientTile = MakeHostTile(weightGradient, g.nFilters, g.GetNumberOfTaps());
+			auto biasGradientBuffer = MakeHostBuffer(biasGradient);
+			const auto delta = MakeHostTile(r, g.GetNumberOfOutputs(), nCols);
+			nn::detail::ConvolutionInputGradient(inputGradientTile, delta, MakeHostTile(weight, g.nFilters, g.GetNumberOfTaps()), g);
+			nn::detail::ConvolutionGradient(biasGradientBuffer, weightGradientTile, delta, MakeHostTile(x, g.GetNumberOfInputs(), nCols), g);
+			
+			const auto evaluate = [&]() { return Convolution(x, weight, bias, g, nCols); };
+			CheckGradient(x, inputGradient, r, evaluate);
+			CheckGradient(weight, weightGradient, r, evaluate);
+			CheckGradient(bias, biasGradient, r, evaluate);
+		}
+	}
+	
+	TEST_F(ConvolutionTests, HostPooling)
+	{
+		ConvolutionGeometry g;
+		g.nChannels = 2;
+		g.height = 7;
+		g.width = 6;
+		g.nFilters = 2;
+		g.kernelSize = 3;
+		g.stride = 2;
+		const unsigned nCols = 2;
+		
+		auto x = Random(g.GetNumberOfInputs() * nCols, 5);
+		auto r = Random(g.GetNumberOfOutputs() * nCols, 6);
+		for (const auto type: { PoolingType::Max, PoolingType::Average })
+		{
+			const auto evaluate = [&]()
+			{
+				std::vector<double> z(g.GetNumberOfOutputs() * nCols);
+				auto zTile = MakeHostTile(z, g.GetNumberOfOutputs(), nCols);
+				nn::detail::Pooling(zTile, MakeHostTile(x, g.GetNumberOfInputs(), nCols), g, type);
+				return z;
+			};
+			
+			const auto z = evaluate();
+			ASSERT_EQ(static_cast<size_t>(2 * 3 * 2 * nCols), z.size());
+			
+			// top left window of the first channel
+			double expected = type == PoolingType::Max ? x[0] : 0.0;
+			for (unsigned ky = 0; ky < 3; ++ky)
+				for (unsigned kx = 0; kx < 3; ++kx)
+					expected = type == PoolingType::Max ? std::max(expected, x[ky * g.width + kx]) : expected + x[ky * g.width + kx] / 9.0;
+			ASSERT_NEAR(expected, z[0], 1e-12);
+			
+			std::vector<double> inputGradient(x.size());
+			auto inputGradientTile = MakeHostTile(inputGradient, g.GetNumberOfInputs(), nCols);
+			nn::detail::PoolingInputGradient(inputGradientTile, MakeHostTile(r, g.GetNumberOfOutputs(), nCols), MakeHostTile(x, g.GetNumberOfInputs(), nCols), g, type);
+			CheckGradient(x, inputGradient, r, evaluate);
+		}
+	}
+	
+	TEST_F(ConvolutionTests, LayerInfer)
+	{
+		const auto topology = MakeTopology();
+		const auto& layer = *topology.front();
+		const auto g = layer.GetGeometry();
+		const unsigned nCols = 5;
+		
+		auto x = Random(g.GetNumberOfInputs() * nCols, 1234);
+		nn::Matrix<md> input(g.GetNumberOfInputs(), nCols);
+		input.ReadFrom(x);
+		
+		nn::InferenceWorkspace<md> workspace(topology);
+		nn::Matrix<md> output(g.GetNumberOfOutputs(), nCols);
+		layer.Infer(output, input, workspace);
+		
+		const auto weight = layer.GetWeight().Get();
+		const auto bias = layer.GetBias().Get();
+		const auto z = Convolution(x, std::vector<double>(weight.begin(), weight.end()), std::vector<double>(bias.begin(), bias.end()), g, nCols);
+		const auto _output = output.Get();
+		for (size_t i = 0; i < z.size(); ++i)
+			ASSERT_NEAR(std::max(z[i], 0.0), _output[i], 1e-12) << "i=" << i;
+	}
+	
+	TEST_F(ConvolutionTests, PoolingHasNoParameters)
+	{
+		auto topology = MakeTopology();
+		const auto& parameters = topology.GetParameters();
+		ASSERT_EQ(0, parameters.GetWeight(1).size());
+		ASSERT_EQ(0, parameters.GetBias(1).size());
+		ASSERT_EQ(1, topology[1]->GetWeight().size());
+		ASSERT_EQ(1, topology[1]->GetBias().size());
+		
+		const auto weight = topology[1]->GetWeight().Get();
+		const auto bias = topology[1]->GetBias().Get();
+		
+		nn::TrainingData<md> trainingData(nn::Matrix<md>(180, 8), nn::Matrix<md>(4, 8, 0.25));
+		trainingData.input.RandomGaussian();
+		
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.miniBatchSize = 4;
+		data.hyperParameters.lambda = 10.0;
+		
+		nn::BatchedSgd<md> optimizer(topology, 4, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		optimizer.Train(data);
+		
+		ASSERT_EQ(weight, topology[1]->GetWeight().Get());
+		ASSERT_EQ(bias, topology[1]->GetBias().Get());
+	}
+	
+	TEST_F(ConvolutionTests, Serialization)
+	{
+		nn::Network<md> network(MakeTopology());
+		
+		std::ofstream f("out");
+		ASSERT_TRUE(f.is_open());
+		network.Serialize(f);
+		f.close();
+		
+		std::ifstream g("out");
+		ASSERT_TRUE(g.is_open());
+		nn::Network<md> deserializedNetwork(g);
+		
+		const auto& layers = network.GetTopology();
+		const auto& deserializedLayers = deserializedNetwork.GetTopology();
+		ASSERT_EQ(layers.GetSize(), deserializedLayers.GetSize());
+		for (size_t i = 0; i < layers.GetSize(); ++i)
+		{
+			ASSERT_EQ(layers[i]->GetType(), deserializedLayers[i]->GetType());
+			ASSERT_EQ(layers[i]->GetNumberOfInputs(), deserializedLayers[i]->GetNumberOfInputs());
+			ASSERT_EQ(layers[i]->GetNumberOfOutputs(), deserializedLayers[i]->GetNumberOfOutputs());
+			ASSERT_EQ(nn::ToString(layers[i]->GetGeometry()), nn::ToString(deserializedLayers[i]->GetGeometry()));
+			ASSERT_EQ(layers[i]->GetWeight().nRows(), deserializedLayers[i]->GetWeight().nRows());
+			ASSERT_EQ(layers[i]->GetWeight().nCols(), deserializedLayers[i]->GetWeight().nCols());
+		}
+		
+		nn::Matrix<md> in(layers.front()->GetNumberOfInputs(), 7);
+		in.RandomGaussian();
+		
+		nn::Matrix<md> out(layers.back()->GetNumberOfOutputs(), 7);
+		network.Evaluate(out, in);
+		nn::Matrix<md> out2(layers.back()->GetNumberOfOutputs(), 7);
+		deserializedNetwork.Evaluate(out2, in);
+		
+		const auto _out = out.Get();
+		const auto _out2 = out2.Get();
+		for (size_t i = 0; i < _out.size(); ++i)
+			ASSERT_DOUBLE_EQ(_out[i], _out2[i]);
+	}
+	
+	TEST_F(ConvolutionTests, TrainingWithBatchedSgd)
+	{
+		auto topology = MakeTopology();
+		
+		// learn to classify 32 fixed random images
+		nn::TrainingData<md> trainingData(nn::Matrix<md>(180, 32), nn::Matrix<md>(4, 32, 0.0));
+		trainingData.input.RandomGaussian();
+		std::vector<double> expectedOutput(4 * 32, 0.0);
+		for (size_t j = 0; j < 32; ++j)
+			expectedOutput[j % 4 + 4 * j] = 1.0;
+		trainingData.expectedOutput.ReadFrom(expectedOutput);
+		
+		nn::InferenceWorkspace<md> workspace(topology);
+		const auto cost = [&]()
+		{
+			nn::Matrix<md> out(4, 32);
+			topology.Infer(out, trainingData.input, workspace);
+			return nn::LogLikelihoodCostFunction<md>().EvaluateSum(out, trainingData.expectedOutput);
+		};
+		const double initialCost = cost();
+		
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.miniBatchSize = 8;
+		data.hyperParameters.learningRate = 0.5;
+		
+		nn::BatchedSgd<md> optimizer(topology, 8, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		for (size_t epoch = 0; epoch < 20; ++epoch)
+			optimizer.Train(data);
+		
+		ASSERT_LT(cost(), 0.5 * initialCost);
+	}
+}
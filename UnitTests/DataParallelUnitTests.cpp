@@ -0,0 +1,206 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	// every rank runs this executable again, in a process of its own (see DISABLED_Rank), rather than a fork of the
+	// test's: the CUDA context doesn't survive a fork. The ranks build everything deterministically
+	class DataParallelTests : public ::testing::Test
+	{
+	public:
+		static constexpr const char* nameVariable = "NN_DATA_PARALLEL_NAME";
+		static constexpr const char* rankVariable = "NN_DATA_PARALLEL_RANK";
+		
+		static constexpr size_t nRanks = 3;
+		static constexpr size_t miniBatchSize = 4;
+		static constexpr size_t nSamples = nRanks * miniBatchSize * 5;
+		static constexpr size_t nEpochs = 2;
+		
+		static nn::TrainingData<md> MakeData()
+		{
+			std::mt19937 generator(1234);
+			std::normal_distribution<double> distribution;
+			std::vector<double> input(5 * nSamples);
+			for (auto& x: input)
+				x = distribution(generator);
+			std::vector<double> expectedOutput(3 * nSamples, 0.0);
+			for (size_t j = 0; j < nSamples; ++j)
+				expectedOutput[j % 3 + 3 * j] = 1.0;
+			
+			nn::TrainingData<md> ret(nn::Matrix<md>(5, nSamples), nn::Matrix<md>(3, nSamples));
+			ret.input.ReadFrom(input);
+			ret.expectedOutput.ReadFrom(expectedOutput);
+			return ret;
+		}
+		
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(5, 6, std::make_unique<nn::TanhActivationFunction<md>>(), nn::TrivialBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(6, 4, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::TrivialBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(4, 3, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::TrivialBiasWeightInitializer<md>()));
+			nn::NetworkTopology<md> ret(std::move(layers));
+			
+			std::mt19937 generator(5678);
+			std::normal_distribution<double> distribution(0.0, 0.5);
+			auto parameters = ret.GetParameters().Get().Get();
+			for (auto& x: parameters)
+				x = distribution(generator);
+			ret.GetParameters().Get().ReadFrom(parameters);
+			return ret;
+		}
+		
+		static nn::HyperParameters MakeHyperParameters(const size_t miniBatchSize_)
+		{
+			nn::HyperParameters ret;
+			ret.miniBatchSize = miniBatchSize_;
+			ret.learningRate = 0.5;
+			ret.lambda = 0.5;
+			return ret;
+		}
+		
+		// NB: unique per job, as the shared memory segment
+		static std::string GetFileName(const std::string& name, const size_t rank) { return name.substr(1) + "Rank" + std::to_string(rank); }
+		
+		// starts a rank's process, with its name and rank in the environment: -1 if it couldn't
+		static pid_t SpawnRank(const std::string& name, const size_t rank)
+		{
+			std::vector<std::string> environment;
+			for (char** variable = environ; *variable; ++variable)
+				environment.emplace_back(*variable);
+			environment.push_back(std::string(nameVariable) + "=" + name);
+			environment.push_back(std::string(rankVariable) + "=" + std::to_string(rank));
+			
+			std::vector<std::string> arguments { "/proc/self/exe", "--gtest_filter=DataParallelTests.DISABLED_Rank", "--gtest_also_run_disabled_tests" };
+			
+			const auto toPointers = [](std::vector<std::string>& strings)
+			{
+				std::vector<char*> ret;
+				for (auto& string: strings)
+					ret.push_back(&string[0]);
+				ret.push_back(nullptr);
+				return ret;
+			};
+			auto argv = toPointers(arguments);
+			auto envp = toPointers(environment);
+			
+			pid_t pid = -1;
+			return posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, argv.data(), envp.data()) == 0 ? pid : -1;
+		}
+		
+		// a rank's process: trains on its shard, and writes the final parameters
+		static int TrainRank(const std::string& name, const size_t rank)
+		{
+			nn::SharedMemoryCommunicator communicator(name, rank, nRanks, 64 * sizeof(double));
+			
+			const auto data = MakeData();
+			auto shard = nn::MakeShard(data, rank, nRanks);
+			auto topology = MakeTopology();
+			
+			// a bucket per layer, and micro-batches: only the last one of every mini-batch starts reducing
+			nn::DataParallelSgd<md> optimizer(topology, miniBatchSize, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>(), communicator, 1);
+			if (optimizer.GetNumberOfBuckets() != topology.GetSize())
+				return 1;
+			
+			const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+			nn::NetworkTrainingData<md> trainingData(shard, shard, shard, evaluator, MakeHyperParameters(miniBatchSize));
+			trainingData.hyperParameters.microBatchSize = miniBatchSize / 2;
+			for (size_t epoch = 0; epoch < nEpochs; ++epoch)
+				optimizer.Train(trainingData);
+			
+			const auto parameters = topology.GetParameters().Get().Get();
+			std::ofstream f(GetFileName(name, rank), std::ios::binary);
+			f.write(reinterpret_cast<const char*>(parameters.data()), static_cast<std::streamsize>(parameters.size() * sizeof(double)));
+			return f.good() ? 0 : 1;
+		}
+	};
+	
+	// a rank of MatchesSingleProcessTraining, which runs it in its own process
+	TEST_F(DataParallelTests, DISABLED_Rank)
+	{
+		const char* name = std::getenv(nameVariable);
+		const char* rank = std::getenv(rankVariable);
+		ASSERT_NE(nullptr, name);
+		ASSERT_NE(nullptr, rank);
+		ASSERT_EQ(0, TrainRank(name, static_cast<size_t>(std::atoi(rank))));
+	}
+	
+	TEST_F(DataParallelTests, MatchesSingleProcessTraining)
+	{
+		const std::string name = "/nnDataParallelTests" + std::to_string(getpid());
+		
+		std::vector<pid_t> processes;
+		for (size_t rank = 0; rank < nRanks; ++rank)
+		{
+			const pid_t pid = SpawnRank(name, rank);
+			ASSERT_GT(pid, 0);
+			processes.push_back(pid);
+		}
+		for (const pid_t pid: processes)
+		{
+			int status = 0;
+			ASSERT_EQ(pid, waitpid(pid, &status, 0));
+			ASSERT_TRUE(WIFEXITED(status));
+			ASSERT_EQ(0, WEXITSTATUS(status));
+		}
+		
+		// the reference is a single process, whose mini-batches are the ranks' ones side by side
+		auto data = MakeData();
+		const auto input = data.input.Get();
+		const auto expectedOutput = data.expectedOutput.Get();
+		std::vector<double> globalInput(input.size());
+		std::vector<double> globalExpectedOutput(expectedOutput.size());
+		const size_t nShardSamples = nSamples / nRanks;
+		for (size_t j = 0; j < nSamples; ++j)
+		{
+			const size_t n = j / (nRanks * miniBatchSize);
+			const size_t rank = (j / miniBatchSize) % nRanks;
+			const size_t shardColumn = rank * nShardSamples + n * miniBatchSize + j % miniBatchSize;
+			std::copy(input.begin() + 5 * shardColumn, input.begin() + 5 * (shardColumn + 1), globalInput.begin() + 5 * j);
+			std::copy(expectedOutput.begin() + 3 * shardColumn, expectedOutput.begin() + 3 * (shardColumn + 1), globalExpectedOutput.begin() + 3 * j);
+		}
+		data.input.ReadFrom(globalInput);
+		data.expectedOutput.ReadFrom(globalExpectedOutput);
+		
+		auto topology = MakeTopology();
+		nn::BatchedSgd<md> optimizer(topology, nRanks * miniBatchSize, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> trainingData(data, data, data, evaluator, MakeHyperParameters(nRanks * miniBatchSize));
+		for (size_t epoch = 0; epoch < nEpochs; ++epoch)
+			optimizer.Train(trainingData);
+		const auto expectedParameters = topology.GetParameters().Get().Get();
+		
+		std::vector<double> rank0Parameters;
+		for (size_t rank = 0; rank < nRanks; ++rank)
+		{
+			std::vector<double> parameters(expectedParameters.size());
+			std::ifstream f(GetFileName(name, rank), std::ios::binary);
+			f.read(reinterpret_cast<char*>(parameters.data()), static_cast<std::streamsize>(parameters.size() * sizeof(double)));
+			ASSERT_TRUE(f.good());
+			std::remove(GetFileName(name, rank).c_str());
+			
+			for (size_t i = 0; i < parameters.size(); ++i)
+				ASSERT_NEAR(expectedParameters[i], parameters[i], 1e-10);
+			
+			// ranks are in sync, bit by bit
+			if (rank == 0)
+				rank0Parameters = parameters;
+			ASSERT_EQ(rank0Parameters, parameters);
+		}
+	}
+}
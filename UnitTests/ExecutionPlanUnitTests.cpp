@@ -0,0 +1,167 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/ExecutionPlan.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	// reference implementation: back-propagation through the layers' own Evaluate
+	class AdjointDifferentiationSgd final: public nn::BatchedSgd<md>
+	{
+	public:
+		using nn::BatchedSgd<md>::BatchedSgd;
+	
+	protected:
+		void TrainMiniBatch(nn::MiniBatchData<md>& batchData) noexcept override
+		{
+			this->AdjointDifferentiation(batchData);
+		}
+	};
+	
+	class ExecutionPlanTests : public ::testing::Test
+	{
+	public:
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(5, 7, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(7, 6, std::make_unique<nn::TanhActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(6, 3, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			return nn::NetworkTopology<md>(std::move(layers));
+		}
+		
+		// one-hot labels, cycling over the 3 classes
+		static nn::TrainingData<md> MakeTrainingData(const size_t nSamples)
+		{
+			nn::TrainingData<md> trainingData(nn::Matrix<md>(5, nSamples), nn::Matrix<md>(3, nSamples, 0.0));
+			trainingData.input.RandomGaussian();
+			std::vector<double> expectedOutput(3 * nSamples, 0.0);
+			for (size_t j = 0; j < nSamples; ++j)
+				expectedOutput[j % 3 + 3 * j] = 1.0;
+			trainingData.expectedOutput.ReadFrom(expectedOutput);
+			
+			return trainingData;
+		}
+		
+		static void AssertSameParameters(const nn::NetworkTopology<md>& expected, const nn::NetworkTopology<md>& actual)
+		{
+			const auto parameters = actual.GetParameters().Get().Get();
+			const auto referenceParameters = expected.GetParameters().Get().Get();
+			ASSERT_EQ(referenceParameters.size(), parameters.size());
+			for (size_t i = 0; i < parameters.size(); ++i)
+				ASSERT_NEAR(referenceParameters[i], parameters[i], 1e-12);
+		}
+	};
+	
+	TEST_F(ExecutionPlanTests, InferenceMatchesLayers)
+	{
+		const auto topology = MakeTopology();
+		ASSERT_TRUE(nn::ExecutionPlan<md>::IsSupported(topology));
+		
+		nn::Matrix<md> input(5, 13);
+		input.RandomGaussian();
+		
+		nn::InferenceWorkspace<md> expectedWorkspace(topology);
+		nn::Matrix<md> expected(3, 13);
+		topology.Infer(expected, input, expectedWorkspace);
+		
+		nn::InferenceWorkspace<md> workspace(topology, 13);
+		nn::ExecutionPlan<md> plan(topology, 13, workspace);
+		nn::Matrix<md> output(3, 13);
+		plan.Infer(output, input);
+		
+		const auto hostExpected = expected.Get();
+		const auto hostOutput = output.Get();
+		for (size_t i = 0; i < hostExpected.size(); ++i)
+			ASSERT_NEAR(hostExpected[i], hostOutput[i], 1e-12);
+	}
+	
+	TEST_F(ExecutionPlanTests, CacheDropsLeastRecentlyUsedPlan)
+	{
+		const auto topology = MakeTopology();
+		nn::InferenceWorkspace<md> workspace(topology, 8);
+		nn::InferenceWorkspace<md> expectedWorkspace(topology);
+		
+		nn::ExecutionPlanCache<md> cache(2);
+		size_t nBuiltPlans = 0;
+		for (const size_t nCols: { 8u, 3u, 8u, 5u, 3u, 8u })
+		{
+			auto& plan = cache.Get(nCols, [&]()
+			{
+				++nBuiltPlans;
+				return std::make_unique<nn::ExecutionPlan<md>>(topology, nCols, workspace);
+			});
+			ASSERT_EQ(nCols, plan.GetNumberOfColumns());
+			ASSERT_LE(cache.GetSize(), 2);
+			
+			nn::Matrix<md> input(5, nCols);
+			input.RandomGaussian();
+			nn::Matrix<md> expected(3, nCols);
+			topology.Infer(expected, input, expectedWorkspace);
+			nn::Matrix<md> output(3, nCols);
+			plan.Infer(output, input);
+			
+			const auto hostExpected = expected.Get();
+			const auto hostOutput = output.Get();
+			for (size_t i = 0; i < hostExpected.size(); ++i)
+				ASSERT_NEAR(hostExpected[i], hostOutput[i], 1e-12);
+		}
+		
+		// 8 is kept when 5 comes in, as 3 was used less recently; 3 is rebuilt, then 8 again
+		ASSERT_EQ(5, nBuiltPlans);
+	}
+	
+	TEST_F(ExecutionPlanTests, TrainingMatchesAdjointDifferentiation)
+	{
+		auto topology = MakeTopology();
+		auto referenceTopology = topology.Clone();
+		
+		// 25 samples in mini-batches of 4, and micro-batches of 3: the plan is built for widths 3 and 1
+		auto trainingData = MakeTrainingData(25);
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.miniBatchSize = 4;
+		data.hyperParameters.microBatchSize = 3;
+		
+		nn::BatchedSgd<md> optimizer(topology, 4, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		AdjointDifferentiationSgd referenceOptimizer(referenceTopology, 4, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		for (size_t epoch = 0; epoch < 2; ++epoch)
+		{
+			optimizer.Train(data);
+			referenceOptimizer.Train(data);
+		}
+		
+		AssertSameParameters(referenceTopology, topology);
+	}
+	
+	TEST_F(ExecutionPlanTests, WiderBatchAfterRaggedOne)
+	{
+		auto topology = MakeTopology();
+		auto referenceTopology = topology.Clone();
+		
+		auto trainingData = MakeTrainingData(25);
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		
+		// sized for mini-batches of 3: the first epoch builds the plans for widths 2 and 1, the second one needs 10
+		// columns, so the buffers the first plans borrowed get reallocated
+		nn::BatchedSgd<md> optimizer(topology, 3, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		AdjointDifferentiationSgd referenceOptimizer(referenceTopology, 3, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		for (const size_t miniBatchSize: { 3u, 10u, 3u })
+		{
+			data.hyperParameters.miniBatchSize = miniBatchSize;
+			data.hyperParameters.microBatchSize = miniBatchSize == 3 ? 2 : miniBatchSize;
+			optimizer.Train(data);
+			referenceOptimizer.Train(data);
+			AssertSameParameters(referenceTopology, topology);
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/HyperParameterSweep.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Evaluators/All.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class HyperParameterSweepTests : public ::testing::Test
+	{
+	public:
+		// 4 classes, each one marked by a large value in its own input row
+		static nn::TrainingData<md> MakeData(const size_t nSamples)
+		{
+			nn::TrainingData<md> ret(nn::Matrix<md>(8, static_cast<unsigned>(nSamples)), nn::Matrix<md>(4, static_cast<unsigned>(nSamples), 0.0));
+			ret.input.RandomGaussian();
+			auto input = ret.input.Get();
+			std::vector<double> expectedOutput(4 * nSamples, 0.0);
+			for (size_t j = 0; j < nSamples; ++j)
+			{
+				input[j % 4 + 8 * j] += 4.0;
+				expectedOutput[j % 4 + 4 * j] = 1.0;
+			}
+			ret.input.ReadFrom(input);
+			ret.expectedOutput.ReadFrom(expectedOutput);
+			return ret;
+		}
+		
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(8, 6, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(6, 4, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			return nn::NetworkTopology<md>(std::move(layers));
+		}
+		
+		static nn::HyperParameterSweep<md>::Configuration MakeConfiguration(const std::string& name, const double learningRate)
+		{
+			nn::HyperParameters hyperParameters;
+			hyperParameters.nEpochs = 8;
+			hyperParameters.miniBatchSize = 8;
+			hyperParameters.learningRate = learningRate;
+			hyperParameters.lambda = 0.0;
+			return { name, hyperParameters, MakeTopology };
+		}
+	};
+	
+	TEST_F(HyperParameterSweepTests, SuccessiveHalving)
+	{
+		const auto trainingData = MakeData(256);
+		const auto validationData = MakeData(64);
+		const auto input = trainingData.input.Get();
+		const auto expectedOutput = trainingData.expectedOutput.Get();
+		
+		nn::HyperParameterSweep<md> sweep(trainingData, validationData, nn::ClassificationAccuracy<md>());
+		sweep.Add(MakeConfiguration("frozen0", 0.0));
+		sweep.Add(MakeConfiguration("good", 1.0));
+		sweep.Add(MakeConfiguration("frozen1", 0.0));
+		sweep.Add(MakeConfiguration("frozen2", 0.0));
+		
+		// 4 x 1 epoch, then 2 x 2 epochs, then the winner runs its 8 epochs
+		const auto results = sweep.Run(4, 1, 2);
+		ASSERT_EQ(4, results.size());
+		ASSERT_EQ(1, sweep.GetBest());
+		ASSERT_EQ("good", results[1].name);
+		ASSERT_EQ(8, results[1].nEpochs);
+		ASSERT_GT(results[1].score, 0.9);
+		
+		// a configuration that doesn't learn is dropped early
+		size_t nEpochs = 0;
+		for (size_t i: { 0, 2, 3 })
+		{
+			ASSERT_LE(results[i].nEpochs, 2);
+			ASSERT_LT(results[i].score, results[1].score);
+			nEpochs += results[i].nEpochs;
+		}
+		ASSERT_EQ(4, nEpochs);
+		
+		// the winner's network is the trained one
+		nn::Matrix<md> output(4, 64);
+		sweep.GetNetwork(sweep.GetBest()).Evaluate(output, validationData.input);
+		ASSERT_DOUBLE_EQ(results[1].score, nn::ClassificationAccuracy<md>()(output, validationData.expectedOutput) / 64.0);
+		
+		// the shared data is only read
+		ASSERT_EQ(input, trainingData.input.Get());
+		ASSERT_EQ(expectedOutput, trainingData.expectedOutput.Get());
+	}
+	
+	TEST_F(HyperParameterSweepTests, SingleConfigurationRunsToCompletion)
+	{
+		const auto trainingData = MakeData(64);
+		const auto validationData = MakeData(32);
+		
+		nn::HyperParameterSweep<md> sweep(trainingData, validationData, nn::ClassificationAccuracy<md>());
+		auto configuration = MakeConfiguration("only", 0.5);
+		configuration.hyperParameters.nEpochs = 5;
+		sweep.Add(configuration);
+		
+		const auto results = sweep.Run(2, 2, 3);
+		ASSERT_EQ(1, results.size());
+		ASSERT_EQ(5, results[0].nEpochs);
+		ASSERT_EQ(0, sweep.GetBest());
+	}
+	
+	TEST_F(HyperParameterSweepTests, ShufflingOptimizerIsRejected)
+	{
+		const auto trainingData = MakeData(64);
+		const auto validationData = MakeData(32);
+		const auto input = trainingData.input.Get();
+		
+		const auto makeShufflingSgd = [](const nn::NetworkTopology<md>& topology, const nn::HyperParameters& hyperParameters) -> std::unique_ptr<nn::IOptimizer<md>>
+		{
+			return std::make_unique<nn::BatchedSgd<md>>(topology, hyperParameters.miniBatchSize, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::RandomShuffler<md>>());
+		};
+		nn::HyperParameterSweep<md> sweep(trainingData, validationData, nn::ClassificationAccuracy<md>(), makeShufflingSgd);
+		sweep.Add(MakeConfiguration("shuffled", 0.5));
+		
+		ASSERT_TRUE(sweep.Run(2).empty());
+		ASSERT_EQ(input, trainingData.input.Get());
+	}
+}
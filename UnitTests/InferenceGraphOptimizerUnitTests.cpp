@@ -0,0 +1,222 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/InferenceGraphOptimizer.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+
+#include <cmath>
+#include <sstream>
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class InferenceGraphOptimizerTests : public ::testing::Test
+	{
+	public:
+		static nn::FeatureNormalization MakeNormalization(const size_t size, const bool affine)
+		{
+			nn::FeatureNormalization ret;
+			for (size_t i = 0; i < size; ++i)
+			{
+				ret.mean.push_back(0.1 * static_cast<double>(i) - 0.3);
+				ret.standardDeviation.push_back(0.5 + 0.25 * static_cast<double>(i));
+				if (affine)
+				{
+					ret.scale.push_back(1.5 - 0.1 * static_cast<double>(i));
+					ret.shift.push_back(0.2 * static_cast<double>(i));
+				}
+			}
+			return ret;
+		}
+		
+		// plain host forward pass, normalizing where requested
+		static std::vector<double> Infer(const nn::NetworkTopology<md>& topology, std::vector<double> x, const size_t nCols,
+		                                 const nn::FeatureNormalization& inputNormalization, const size_t normalizedLayer, const nn::FeatureNormalization& normalization)
+		{
+			const auto normalize = [&](std::vector<double>& y, const nn::FeatureNormalization& n)
+			{
+				for (size_t i = 0; i < y.size(); ++i)
+					y[i] = (n.scale.empty() ? 1.0 : n.scale[i % n.size()]) * (y[i] - n.mean[i % n.size()]) / n.standardDeviation[i % n.size()] + (n.shift.empty() ? 0.0 : n.shift[i % n.size()]);
+			};
+			
+			normalize(x, inputNormalization);
+			for (size_t l = 0; l < topology.GetSize(); ++l)
+			{
+				const auto& layer = *topology[l];
+				const size_t nInput = layer.GetNumberOfInputs();
+				const size_t nOutput = layer.GetNumberOfOutputs();
+				const auto weight = layer.GetWeight().Get();
+				const auto bias = layer.GetBias().Get();
+				
+				std::vector<double> z(nOutput * nCols);
+				for (size_t j = 0; j < nCols; ++j)
+					for (size_t i = 0; i < nOutput; ++i)
+					{
+						z[i + j * nOutput] = bias[i];
+						for (size_t k = 0; k < nInput; ++k)
+							z[i + j * nOutput] += weight[i + k * nOutput] * x[k + j * nInput];
+					}
+				if (l == normalizedLayer)
+					normalize(z, normalization);
+				
+				switch (layer.GetActivationFunctionType())
+				{
+					case nn::ActivationFunctionType::Sigmoid:
+						for (auto& y: z)
+							y = 1.0 / (1.0 + std::exp(-y));
+						break;
+					case nn::ActivationFunctionType::SoftMax:
+						for (size_t j = 0; j < nCols; ++j)
+						{
+							double sum = 0.0;
+							for (size_t i = 0; i < nOutput; ++i)
+								sum += std::exp(z[i + j * nOutput]);
+							for (size_t i = 0; i < nOutput; ++i)
+								z[i + j * nOutput] = std::exp(z[i + j * nOutput]) / sum;
+						}
+						break;
+					default:
+						break;
+				}
+				x = std::move(z);
+			}
+			
+			return x;
+		}
+	};
+	
+	TEST_F(InferenceGraphOptimizerTests, FoldAndFuse)
+	{
+		// linear -> sigmoid -> linear -> softmax: both pairs can be merged
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(6, 8, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(8, 5, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(5, 7, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(7, 3, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		nn::NetworkTopology<md> topology(std::move(layers));
+		
+		const auto inputNormalization = MakeNormalization(6, false);
+		const auto normalization = MakeNormalization(5, true);
+		
+		nn::InferenceGraphOptimizer<md> optimizer;
+		optimizer.SetInputNormalization(inputNormalization);
+		optimizer.SetNormalization(1, normalization);
+		ASSERT_TRUE(optimizer.IsSupported(topology));
+		
+		const auto optimized = optimizer.Optimize(topology);
+		ASSERT_NE(nullptr, optimized);
+		const auto& optimizedTopology = *optimized;
+		ASSERT_EQ(2, optimizedTopology.GetSize());
+		ASSERT_EQ(6, optimizedTopology[0]->GetNumberOfInputs());
+		ASSERT_EQ(5, optimizedTopology[0]->GetNumberOfOutputs());
+		ASSERT_EQ(nn::ActivationFunctionType::Sigmoid, optimizedTopology[0]->GetActivationFunctionType());
+		ASSERT_EQ(nn::LayerType::SoftMax, optimizedTopology[1]->GetType());
+		
+		nn::Matrix<md> input(6, 11);
+		input.RandomGaussian();
+		nn::InferenceWorkspace<md> workspace(optimizedTopology);
+		nn::Matrix<md> output(3, 11);
+		optimizedTopology.Infer(output, input, workspace);
+		
+		const auto expected = Infer(topology, input.Get(), 11, inputNormalization, 1, normalization);
+		const auto _output = output.Get();
+		ASSERT_EQ(expected.size(), _output.size());
+		for (size_t i = 0; i < _output.size(); ++i)
+			ASSERT_NEAR(expected[i], _output[i], 1e-12);
+	}
+	
+	TEST_F(InferenceGraphOptimizerTests, KeepBottleneck)
+	{
+		// 10 x 10 is more expensive than 2 x 10 + 10 x 2
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(10, 2, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(2, 10, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		nn::NetworkTopology<md> topology(std::move(layers));
+		
+		nn::InferenceGraphOptimizer<md> optimizer;
+		ASSERT_EQ(2, optimizer.Optimize(topology)->GetSize());
+		
+		// 3 features for 10 inputs
+		optimizer.SetInputNormalization(MakeNormalization(3, false));
+		ASSERT_FALSE(optimizer.IsSupported(topology));
+		ASSERT_EQ(nullptr, optimizer.Optimize(topology));
+	}
+	
+	TEST_F(InferenceGraphOptimizerTests, KeepPoolingLayers)
+	{
+		// linear -> convolution -> max pooling: the last layer has no parameters
+		ConvolutionGeometry convolution;
+		convolution.nChannels = 2;
+		convolution.height = 5;
+		convolution.width = 4;
+		convolution.nFilters = 3;
+		convolution.kernelSize = 2;
+		
+		ConvolutionGeometry pooling;
+		pooling.nChannels = 3;
+		pooling.height = 4;
+		pooling.width = 3;
+		pooling.kernelSize = 2;
+		
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(20, 40, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::Convolution2DLayer<md>>(convolution, std::make_unique<nn::RectifiedLinearUnitActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::MaxPool2DLayer<md>>(pooling, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		nn::NetworkTopology<md> topology(std::move(layers));
+		
+		const auto inputNormalization = MakeNormalization(20, true);
+		nn::InferenceGraphOptimizer<md> optimizer;
+		optimizer.SetInputNormalization(inputNormalization);
+		
+		const auto optimized = optimizer.Optimize(topology);
+		ASSERT_NE(nullptr, optimized);
+		const auto& optimizedTopology = *optimized;
+		ASSERT_EQ(3, optimizedTopology.GetSize());
+		ASSERT_EQ(nn::LayerType::MaxPool2D, optimizedTopology[2]->GetType());
+		ASSERT_EQ(optimizedTopology.GetParameters().Get().size(), topology.GetParameters().Get().size());
+		
+		const size_t nCols = 7;
+		nn::Matrix<md> input(20, nCols);
+		input.RandomGaussian();
+		auto x = input.Get();
+		for (size_t i = 0; i < x.size(); ++i)
+			x[i] = inputNormalization.GetSlope(i % 20) * x[i] + inputNormalization.GetIntercept(i % 20);
+		nn::Matrix<md> normalizedInput(20, nCols);
+		normalizedInput.ReadFrom(x);
+		
+		nn::InferenceWorkspace<md> workspace(topology);
+		nn::Matrix<md> expectedOutput(18, nCols);
+		topology.Infer(expectedOutput, normalizedInput, workspace);
+		
+		nn::InferenceWorkspace<md> optimizedWorkspace(optimizedTopology);
+		nn::Matrix<md> output(18, nCols);
+		optimizedTopology.Infer(output, input, optimizedWorkspace);
+		
+		const auto expected = expectedOutput.Get();
+		const auto _output = output.Get();
+		for (size_t i = 0; i < _output.size(); ++i)
+			ASSERT_NEAR(expected[i], _output[i], 1e-12);
+	}
+	
+	TEST_F(InferenceGraphOptimizerTests, SerializeLinearLayer)
+	{
+		// a bottleneck keeps its linear layer, which must survive a round trip
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(10, 2, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(2, 10, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		const auto optimized = nn::InferenceGraphOptimizer<md>().Optimize(nn::NetworkTopology<md>(std::move(layers)));
+		ASSERT_NE(nullptr, optimized);
+		
+		std::stringstream stream;
+		*optimized << stream;
+		ASSERT_NE(std::string::npos, stream.str().find("\nNull\n"));
+		ASSERT_EQ(std::string::npos, stream.str().find('?'));
+		
+		nn::NetworkTopology<md> deserialized(stream);
+		ASSERT_EQ(2, deserialized.GetSize());
+		ASSERT_EQ(nn::ActivationFunctionType::Null, deserialized[0]->GetActivationFunctionType());
+		ASSERT_EQ(nn::ActivationFunctionType::Sigmoid, deserialized[1]->GetActivationFunctionType());
+	}
+}
@@ -0,0 +1,266 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/LowRankFactorization.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class LowRankTests : public ::testing::Test
+	{
+	public:
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(20, 16, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(16, 12, std::make_unique<nn::TanhActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(12, 4, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			return nn::NetworkTopology<md>(std::move(layers));
+		}
+		
+		static std::vector<double> Infer(const nn::NetworkTopology<md>& topology, const nn::Matrix<md>& input)
+		{
+			nn::InferenceWorkspace<md> workspace(topology);
+			nn::Matrix<md> output(4, input.nCols());
+			topology.Infer(output, input, workspace);
+			return output.Get();
+		}
+	};
+	
+	TEST_F(LowRankTests, SingularValueDecomposition)
+	{
+		std::mt19937 generator(1234);
+		std::normal_distribution<double> distribution;
+		for (const auto& [nRows, nCols]: std::vector<std::pair<size_t, size_t>> { { 9, 5 }, { 5, 9 }, { 6, 6 } })
+		{
+			std::vector<double> a(nRows * nCols);
+			for (auto& x: a)
+				x = distribution(generator);
+			
+			const auto svd = nn::SingularValueDecomposition::Decompose(a, nRows, nCols);
+			ASSERT_EQ(std::min(nRows, nCols), svd.GetMaxRank());
+			for (size_t k = 1; k < svd.GetMaxRank(); ++k)
+				ASSERT_LE(svd.singularValues[k], svd.singularValues[k - 1]);
+			
+			for (size_t i = 0; i < nRows; ++i)
+			{
+				for (size_t j = 0; j < nCols; ++j)
+				{
+					double x = 0.0;
+					for (size_t k = 0; k < svd.GetMaxRank(); ++k)
+						x += svd.u[i + k * nRows] * svd.singularValues[k] * svd.v[j + k * nCols];
+					ASSERT_NEAR(a[i + j * nRows], x, 1e-12);
+				}
+			}
+			
+			ASSERT_DOUBLE_EQ(1.0, svd.GetRetainedEnergy(svd.GetMaxRank()));
+			ASSERT_EQ(svd.GetMaxRank(), svd.GetRank(1.0));
+			const size_t rank = svd.GetRank(0.5);
+			ASSERT_GE(svd.GetRetainedEnergy(rank), 0.5);
+			ASSERT_LT(svd.GetRetainedEnergy(rank - 1), 0.5);
+		}
+	}
+	
+	TEST_F(LowRankTests, FullRankMatchesDense)
+	{
+		const auto topology = MakeTopology();
+		const auto lowRankTopology = nn::LowRankFactorization<md>::Convert(topology, { 16, 12, 0 });
+		ASSERT_EQ(nn::LayerType::LowRankDense, lowRankTopology[0]->GetType());
+		ASSERT_EQ(16, lowRankTopology[0]->GetRank());
+		ASSERT_EQ(nn::LayerType::SoftMax, lowRankTopology[2]->GetType());
+		
+		nn::Matrix<md> input(20, 13);
+		input.RandomGaussian();
+		const auto expected = Infer(topology, input);
+		const auto output = Infer(lowRankTopology, input);
+		for (size_t i = 0; i < output.size(); ++i)
+			ASSERT_NEAR(expected[i], output[i], 1e-10);
+	}
+	
+	TEST_F(LowRankTests, InferAndBackPropagateAgain)
+	{
+		nn::LowRankDenseLayer<md> layer(6, 5, 2, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>());
+		
+		nn::Matrix<md> input(6, 7);
+		input.RandomGaussian();
+		layer.Evaluate(input, true, nullptr);
+		const auto activation = layer.GetActivation().Get();
+		
+		// same values through the workspace's scratch: any topology will do, as Infer only uses that
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(6, 5, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		nn::InferenceWorkspace<md> workspace(nn::NetworkTopology<md>(std::move(layers)));
+		nn::Matrix<md> output(5, 7);
+		layer.Infer(output, input, workspace);
+		const auto _output = output.Get();
+		for (size_t i = 0; i < _output.size(); ++i)
+			ASSERT_NEAR(activation[i], _output[i], 1e-12);
+		
+		// h isn't overwritten: a second call gives the same gradients
+		nn::Matrix<md> delta(5, 7);
+		delta.RandomGaussian();
+		const nn::Vector<md> ones(7, 1.0);
+		const auto backPropagate = [&]()
+		{
+			nn::Vector<md> biasGradient(5, 0.0);
+			nn::Matrix<md> weightGradient(layer.GetWeight().nRows(), layer.GetWeight().nCols(), 0.0);
+			nn::Matrix<md> inputGradient(6, 7);
+			layer.BackPropagate(&inputGradient, biasGradient, weightGradient, delta, input, ones);
+			auto ret = weightGradient.Get();
+			const auto _inputGradient = inputGradient.Get();
+			ret.insert(ret.end(), _inputGradient.begin(), _inputGradient.end());
+			return ret;
+		};
+		ASSERT_EQ(backPropagate(), backPropagate());
+	}
+	
+	TEST_F(LowRankTests, ErrorDecreasesWithRank)
+	{
+		const auto topology = MakeTopology();
+		
+		nn::Matrix<md> input(20, 13);
+		input.RandomGaussian();
+		const auto expected = Infer(topology, input);
+		
+		double previousError = 1e300;
+		for (size_t rank = 2; rank <= 16; rank += 2)
+		{
+			const auto output = Infer(nn::LowRankFactorization<md>::Convert(topology, { rank, 0, 0 }), input);
+			double error = 0.0;
+			for (size_t i = 0; i < output.size(); ++i)
+				error += (expected[i] - output[i]) * (expected[i] - output[i]);
+			ASSERT_LE(error, previousError + 1e-12);
+			previousError = error;
+		}
+		ASSERT_NEAR(0.0, previousError, 1e-18);
+	}
+	
+	TEST_F(LowRankTests, CompressOnlyWhenCheaper)
+	{
+		const auto topology = MakeTopology();
+		
+		// rank 16 is too expensive for the first layer, and so is rank 12 for the second one
+		const auto uncompressed = nn::LowRankFactorization<md>::Compress(topology, 1.0);
+		for (size_t l = 0; l < topology.GetSize(); ++l)
+			ASSERT_EQ(topology[l]->GetType(), uncompressed[l]->GetType());
+		
+		const auto compressed = nn::LowRankFactorization<md>::Compress(topology, 0.5);
+		for (size_t l = 0; l < 2; ++l)
+		{
+			ASSERT_EQ(nn::LayerType::LowRankDense, compressed[l]->GetType());
+			const auto svd = nn::LowRankFactorization<md>::Decompose(*topology[l]);
+			ASSERT_EQ(svd.GetRank(0.5), compressed[l]->GetRank());
+		}
+		ASSERT_EQ(nn::LayerType::SoftMax, compressed[2]->GetType());
+	}
+	
+	TEST_F(LowRankTests, SerializationRoundTrip)
+	{
+		const auto topology = nn::LowRankFactorization<md>::Convert(MakeTopology(), { 4, 3, 0 });
+		
+		std::stringstream ss;
+		topology.Serialize(ss);
+		const nn::NetworkTopology<md> deserialized(ss);
+		ASSERT_EQ(nn::LayerType::LowRankDense, deserialized[1]->GetType());
+		ASSERT_EQ(3, deserialized[1]->GetRank());
+		
+		const auto clone = topology.Clone();
+		
+		nn::Matrix<md> input(20, 13);
+		input.RandomGaussian();
+		const auto expected = Infer(topology, input);
+		const auto output = Infer(deserialized, input);
+		const auto cloneOutput = Infer(clone, input);
+		for (size_t i = 0; i < output.size(); ++i)
+		{
+			ASSERT_NEAR(expected[i], output[i], 1e-12);
+			ASSERT_NEAR(expected[i], cloneOutput[i], 1e-12);
+		}
+	}
+	
+	TEST_F(LowRankTests, TrainDirectly)
+	{
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::LowRankDenseLayer<md>>(20, 16, 3, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(16, 4, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+		nn::NetworkTopology<md> topology(std::move(layers));
+		
+		nn::TrainingData<md> trainingData(nn::Matrix<md>(20, 32), nn::Matrix<md>(4, 32, 0.0));
+		trainingData.input.RandomGaussian();
+		std::vector<double> expectedOutput(4 * 32, 0.0);
+		for (size_t j = 0; j < 32; ++j)
+			expectedOutput[j % 4 + 4 * j] = 1.0;
+		trainingData.expectedOutput.ReadFrom(expectedOutput);
+		
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.miniBatchSize = 8;
+		data.hyperParameters.lambda = 0.0;
+		
+		const auto cost = [&]()
+		{
+			nn::LogLikelihoodCostFunction<md> costFunction;
+			nn::Matrix<md> output(4, 32);
+			nn::InferenceWorkspace<md> workspace(topology);
+			topology.Infer(output, trainingData.input, workspace);
+			return costFunction.EvaluateSum(output, trainingData.expectedOutput);
+		};
+		
+		const double initialCost = cost();
+		nn::BatchedSgd<md> optimizer(topology, 8, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		for (size_t epoch = 0; epoch < 20; ++epoch)
+			optimizer.Train(data);
+		ASSERT_LT(cost(), initialCost);
+		
+		// the padding after the factors never moves
+		const auto weight = topology[0]->GetWeight().Get();
+		for (size_t i = 3 * (16 + 20); i < weight.size(); ++i)
+			ASSERT_EQ(0.0, weight[i]);
+	}
+	
+	TEST_F(LowRankTests, Report)
+	{
+		const auto topology = MakeTopology();
+		
+		nn::TrainingData<md> data(nn::Matrix<md>(20, 32), nn::Matrix<md>(4, 32, 0.0));
+		data.input.RandomGaussian();
+		data.expectedOutput.ReadFrom(Infer(topology, data.input));
+		
+		// distance from the dense outputs
+		const auto metric = [](nn::Matrix<md>& output, const nn::Matrix<md>& expected)
+		{
+			const auto _output = output.Get();
+			const auto _expected = expected.Get();
+			double ret = 0.0;
+			for (size_t i = 0; i < _output.size(); ++i)
+				ret += std::abs(_output[i] - _expected[i]);
+			return ret;
+		};
+		
+		const auto report = nn::LowRankFactorization<md>::Report(topology, 0, { 2, 8, 16 }, data, metric);
+		ASSERT_EQ(4, report.size());
+		ASSERT_EQ(0, report[0].rank);
+		ASSERT_EQ(16 * 20 + 16, report[0].nParameters);
+		ASSERT_NEAR(0.0, report[0].metric, 1e-12);
+		ASSERT_EQ(2 * (16 + 20) + 16, report[1].nParameters);
+		ASSERT_LT(report[1].retainedEnergy, report[2].retainedEnergy);
+		ASSERT_GT(report[1].metric, report[3].metric);
+		ASSERT_NEAR(0.0, report[3].metric, 1e-10);
+		for (const auto& entry: report)
+			ASSERT_GE(entry.milliseconds, 0.0);
+		
+		std::stringstream ss;
+		nn::LowRankFactorization<md>::WriteReport(ss, report);
+		ASSERT_NE(std::string::npos, ss.str().find("dense"));
+	}
+}
@@ -0,0 +1,110 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/Memory/MemoryPlanner.h>
+#include <NeuralNetworks/Memory/NetworkMemoryPlan.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class MemoryPlannerTests : public ::testing::Test
+	{
+	public:
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(4, 6, std::make_unique<nn::TanhActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(6, 3, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			return nn::NetworkTopology<md>(std::move(layers));
+		}
+	};
+	
+	TEST_F(MemoryPlannerTests, DisjointLifetimesShareMemory)
+	{
+		nn::MemoryPlanner planner;
+		const auto a = planner.Add(1000, 0, 1);
+		const auto b = planner.Add(1000, 2, 3);
+		const auto c = planner.Add(500, 4, 4);
+		planner.Plan();
+		
+		ASSERT_EQ(planner.GetOffset(a), 0);
+		ASSERT_EQ(planner.GetOffset(b), 0);
+		ASSERT_EQ(planner.GetOffset(c), 0);
+		ASSERT_EQ(planner.GetPeakBytes(), nn::MemoryPlanner::AlignUp(1000));
+		ASSERT_EQ(planner.GetTotalBytes(), 2 * nn::MemoryPlanner::AlignUp(1000) + nn::MemoryPlanner::AlignUp(500));
+	}
+	
+	TEST_F(MemoryPlannerTests, OverlappingLifetimesDoNotAlias)
+	{
+		nn::MemoryPlanner planner;
+		const auto a = planner.Add(100, 0, 2);
+		const auto b = planner.Add(200, 1, 3);
+		const auto c = planner.Add(300, 2, 2);
+		planner.Plan();
+		
+		const std::vector<size_t> ids = { a, b, c };
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			ASSERT_EQ(planner.GetOffset(ids[i]) % nn::MemoryPlanner::alignment, 0);
+			for (size_t j = i + 1; j < ids.size(); ++j)
+			{
+				const bool disjoint = planner.GetOffset(ids[i]) + planner.GetSize(ids[i]) <= planner.GetOffset(ids[j]) ||
+						              planner.GetOffset(ids[j]) + planner.GetSize(ids[j]) <= planner.GetOffset(ids[i]);
+				ASSERT_TRUE(disjoint);
+			}
+		}
+		ASSERT_EQ(planner.GetPeakBytes(), planner.GetTotalBytes());
+	}
+	
+	TEST_F(MemoryPlannerTests, ReusesGapLeftByDeadBuffer)
+	{
+		nn::MemoryPlanner planner;
+		const auto big = planner.Add(1024, 0, 10);
+		const auto early = planner.Add(512, 0, 1);
+		const auto late = planner.Add(512, 5, 6);
+		planner.Plan();
+		
+		ASSERT_EQ(planner.GetOffset(big), 0);
+		ASSERT_EQ(planner.GetOffset(early), planner.GetOffset(late));
+		ASSERT_EQ(planner.GetPeakBytes(), 1536);
+	}
+	
+	TEST_F(MemoryPlannerTests, DestroyingAPlanLeavesAnotherPlanBound)
+	{
+		const auto topology = MakeTopology();
+		
+		auto oldPlan = std::make_unique<nn::NetworkMemoryPlan<md>>(topology, 8);
+		oldPlan->Bind(topology);
+		nn::NetworkMemoryPlan<md> newPlan(topology, 16);
+		newPlan.Bind(topology);
+		oldPlan.reset();
+		
+		for (size_t l = 0; l < topology.GetSize(); ++l)
+		{
+			for (const auto type: { nn::LayerBufferType::Z, nn::LayerBufferType::Activation, nn::LayerBufferType::ActivationGradient })
+			{
+				const auto& workspace = topology[l]->GetWorkspace(type);
+				ASSERT_TRUE(workspace.IsBound());
+				ASSERT_EQ(workspace.GetCapacity(), 16u);
+				ASSERT_EQ(workspace.GetPointer(), newPlan.GetPointer(type, l));
+			}
+		}
+	}
+	
+	TEST_F(MemoryPlannerTests, BoundWorkspaceCannotGrow)
+	{
+		nn::Vector<md> arena(4 * 8, 0.0);
+		nn::Workspace<md> workspace(4);
+		workspace.Bind(arena.GetBuffer().pointer, 8);
+		ASSERT_EQ(workspace.Get(8).GetBuffer().pointer, arena.GetBuffer().pointer);
+		
+		// the plan it's bound to must be rebuilt instead
+		// NB: the death test re-executes the binary, as the device context can't be forked
+		::testing::FLAGS_gtest_death_test_style = "threadsafe";
+		EXPECT_DEBUG_DEATH(workspace.Get(9), "");
+	}
+}
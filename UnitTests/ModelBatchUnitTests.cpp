@@ -0,0 +1,178 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/ModelBatch.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+#include <random>
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class ModelBatchTests : public ::testing::Test
+	{
+	public:
+		static nn::TrainingData<md> MakeData(const size_t nSamples)
+		{
+			nn::TrainingData<md> ret(nn::Matrix<md>(6, static_cast<unsigned>(nSamples)), nn::Matrix<md>(3, static_cast<unsigned>(nSamples), 0.0));
+			ret.input.RandomGaussian();
+			std::vector<double> expectedOutput(3 * nSamples, 0.0);
+			for (size_t j = 0; j < nSamples; ++j)
+				expectedOutput[j % 3 + 3 * j] = 1.0;
+			ret.expectedOutput.ReadFrom(expectedOutput);
+			return ret;
+		}
+		
+		static std::vector<nn::NetworkTopology<md>> MakeModels(const size_t nModels)
+		{
+			std::vector<nn::NetworkTopology<md>> ret;
+			for (size_t k = 0; k < nModels; ++k)
+			{
+				std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+				layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(6, 5, std::make_unique<nn::TanhActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+				layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(5, 4, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+				layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(4, 3, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+				ret.emplace_back(std::move(layers));
+			}
+			return ret;
+		}
+		
+		static void Compare(const nn::Matrix<md>& expected, const nn::Matrix<md>& actual, const double tolerance)
+		{
+			const auto expectedValues = expected.Get();
+			const auto actualValues = actual.Get();
+			ASSERT_EQ(expectedValues.size(), actualValues.size());
+			for (size_t i = 0; i < expectedValues.size(); ++i)
+				ASSERT_NEAR(expectedValues[i], actualValues[i], tolerance);
+		}
+	};
+	
+	TEST_F(ModelBatchTests, BatchedMultiply)
+	{
+		std::mt19937 generator(1234);
+		std::normal_distribution<double> distribution;
+		
+		for (const bool transposeA: { false, true })
+		{
+			for (const bool transposeB: { false, true })
+			{
+				BatchedMultiplyGeometry geometry;
+				geometry.nBatches = 3;
+				geometry.nRows = 5;
+				geometry.nCols = 4;
+				geometry.nInner = 7;
+				geometry.transposeA = transposeA;
+				geometry.transposeB = transposeB;
+				geometry.aStride = geometry.nRows * geometry.nInner;
+				geometry.bStride = 0; // shared
+				geometry.cStride = geometry.nRows * geometry.nCols;
+				geometry.alpha = 0.5;
+				geometry.beta = 2.0;
+				
+				std::vector<double> a(geometry.nBatches * geometry.aStride);
+				std::vector<double> b(geometry.nInner * geometry.nCols);
+				std::vector<double> c(geometry.GetOutputSize());
+				for (auto* v: { &a, &b, &c })
+					for (auto& x: *v)
+						x = distribution(generator);
+				
+				auto expected = c;
+				for (unsigned k = 0; k < geometry.nBatches; ++k)
+				{
+					for (unsigned i = 0; i < geometry.nRows; ++i)
+					{
+						for (unsigned j = 0; j < geometry.nCols; ++j)
+						{
+							double sum = 0.0;
+							for (unsigned p = 0; p < geometry.nInner; ++p)
+								sum += a[k * geometry.aStride + geometry.GetIndexA(i, p)] * b[geometry.GetIndexB(p, j)];
+							auto& cij = expected[k * geometry.cStride + i + j * geometry.nRows];
+							cij = geometry.alpha * sum + geometry.beta * cij;
+						}
+					}
+				}
+				
+				nn::Vector<md> aDevice(static_cast<unsigned>(a.size()));
+				nn::Vector<md> bDevice(static_cast<unsigned>(b.size()));
+				nn::Vector<md> cDevice(static_cast<unsigned>(c.size()));
+				aDevice.ReadFrom(a);
+				bDevice.ReadFrom(b);
+				cDevice.ReadFrom(c);
+				
+				nn::detail::BatchedMultiply(cDevice.GetBuffer(), aDevice.GetBuffer(), bDevice.GetBuffer(), geometry);
+				const auto actual = cDevice.Get();
+				for (size_t i = 0; i < actual.size(); ++i)
+					ASSERT_NEAR(expected[i], actual[i], 1e-12);
+			}
+		}
+	}
+	
+	TEST_F(ModelBatchTests, TrainingMatchesSeparateModels)
+	{
+		constexpr size_t nModels = 3;
+		auto trainingData = MakeData(32);
+		auto models = MakeModels(nModels);
+		ASSERT_TRUE(nn::ModelBatch<md>::IsSupported(models));
+		
+		// NB: the stack copies the models' parameters, so that the originals can be trained separately as a reference
+		nn::ModelBatch<md> modelBatch(models, 8, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		ASSERT_EQ(nModels, modelBatch.GetNumberOfModels());
+		
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.miniBatchSize = 8;
+		data.hyperParameters.learningRate = 0.5;
+		data.hyperParameters.lambda = 0.1;
+		
+		for (size_t k = 0; k < nModels; ++k)
+		{
+			nn::BatchedSgd<md> optimizer(models[k], 8, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+			for (size_t epoch = 0; epoch < 3; ++epoch)
+				optimizer.Train(data);
+		}
+		for (size_t epoch = 0; epoch < 3; ++epoch)
+			modelBatch.Train(data);
+		
+		for (size_t k = 0; k < nModels; ++k)
+		{
+			for (size_t l = 0; l < models[k].GetSize(); ++l)
+			{
+				Compare(models[k].GetParameters().GetWeight(l), modelBatch.GetWeight(l, k), 1e-10);
+				
+				const auto expectedBias = models[k].GetParameters().GetBias(l).Get();
+				const auto bias = modelBatch.GetBias(l, k).Get();
+				for (size_t i = 0; i < bias.size(); ++i)
+					ASSERT_NEAR(expectedBias[i], bias[i], 1e-10);
+			}
+		}
+	}
+	
+	TEST_F(ModelBatchTests, InferenceMatchesExportedNetworks)
+	{
+		constexpr size_t nModels = 4;
+		const auto testData = MakeData(16);
+		auto models = MakeModels(nModels);
+		
+		nn::ModelBatch<md> modelBatch(models, 16, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		nn::Matrix<md> stackedOutput(3, nModels * 16);
+		modelBatch.Infer(stackedOutput, testData.input);
+		
+		for (size_t k = 0; k < nModels; ++k)
+		{
+			const auto network = modelBatch.Export(k);
+			nn::Matrix<md> output(3, 16);
+			network->Evaluate(output, testData.input);
+			Compare(output, nn::detail::MakeColumnsView<md>(stackedOutput, k * 16, (k + 1) * 16), 1e-12);
+			
+			// and the exported network is the original one
+			nn::Matrix<md> expectedOutput(3, 16);
+			nn::Network<md>(std::move(models[k])).Evaluate(expectedOutput, testData.input);
+			Compare(expectedOutput, output, 1e-12);
+		}
+	}
+}
@@ -388,4 +388,84 @@ namespace nnt
 		for (size_t i = 0; i < actualScores.size(); ++i)
 			EXPECT_DOUBLE_EQ(expectedScores[i], actualScores[i]);
 	}
+	
+	TEST_F(NetworkTests, ActivationInPlace)
+	{
+		for (int t = static_cast<int>(nn::ActivationFunctionType::BentIdentity); t < static_cast<int>(nn::ActivationFunctionType::__END__); ++t)
+		{
+			const auto activationFunction = nn::ActivationFunctionFactory<md>::Create(static_cast<nn::ActivationFunctionType>(t));
+			
+			nn::Matrix<md> input(7, 5);
+			input.RandomGaussian();
+			nn::Matrix<md> expected(7, 5);
+			activationFunction->Evaluate(expected, input);
+			
+			// layers apply their activation in place
+			activationFunction->Evaluate(input, input);
+			
+			const auto expectedValues = expected.Get();
+			const auto actualValues = input.Get();
+			for (size_t i = 0; i < expectedValues.size(); ++i)
+				ASSERT_DOUBLE_EQ(expectedValues[i], actualValues[i]) << nn::ToString(activationFunction->GetType());
+		}
+	}
+	
+	TEST_F(NetworkTests, ParallelEvaluationThroughSoftMax)
+	{
+		// the linear layer keeps it off the execution plans, so that the threads share the layers' activations
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(6, 8, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(8, 4, nullptr, nn::RandomBiasWeightInitializer<md>()));
+		const nn::Network<md> network(nn::NetworkTopology<md>(std::move(layers)));
+		
+		nn::TrainingData<md> data(nn::Matrix<md>(6, 1000), nn::Matrix<md>(4, 1000, 0.0));
+		data.input.RandomGaussian();
+		
+		// weighs every output differently, so that any mix-up between the threads shows
+		const auto metric = [](nn::Matrix<md>& output, const nn::Matrix<md>&)
+		{
+			double ret = 0.0;
+			const auto values = output.Get();
+			for (size_t i = 0; i < values.size(); ++i)
+				ret += values[i] * static_cast<double>(i % 7 + 1);
+			return ret;
+		};
+		const double expected = network.Evaluate(data, metric, 50, 1);
+		for (size_t nThreads: { 2, 4, 8 })
+			ASSERT_NEAR(expected, network.Evaluate(data, metric, 50, nThreads), 1e-9);
+	}
+	
+	TEST_F(NetworkTests, NoAllocationsAfterFirstEpoch)
+	{
+		std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(5, 8, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::SmallVarianceRandomBiasWeightInitializer<md>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(8, 3, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::ZeroBiasWeightInitializer<md>()));
+		nn::Network<md> network((nn::NetworkTopology<md>(std::move(layers))));
+		
+		nn::TrainingData<md> trainingData(nn::Matrix<md>(5, 40), nn::Matrix<md>(3, 40, 0.0));
+		trainingData.input.RandomGaussian();
+		nn::TrainingData<md> testData(nn::Matrix<md>(5, 17), nn::Matrix<md>(3, 17, 0.0));
+		testData.input.RandomGaussian();
+		
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, testData, testData, evaluator);
+		data.hyperParameters.nEpochs = 2;
+		data.hyperParameters.miniBatchSize = 10;
+		data.epochCalculationAccuracyTestData = 1;
+		data.epochCalculationAccuracyTrainingData = 1;
+		data.epochCalculationTotalCostTestData = 1;
+		data.evaluationChunkSize = 16;
+		
+		// any allocation in the second epoch aborts
+		data.checkNoAllocationsAfterFirstEpoch = true;
+		nn::BatchedSgd<md> optimizer(network.GetTopology(), data.hyperParameters.miniBatchSize, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::RandomShuffler<md>>());
+		network.Train(optimizer, data);
+		
+		// and so does any further epoch
+		const auto allocations = nn::AllocationTracker::Instance().GetTotal();
+		data.hyperParameters.nEpochs = 1;
+		network.Train(optimizer, data);
+		ASSERT_EQ(allocations.count, nn::AllocationTracker::Instance().GetTotal().count);
+		ASSERT_EQ(allocations.bytes, nn::AllocationTracker::Instance().GetTotal().bytes);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <NeuralNetworks/NeuralNetworksManager.h>
+
+#include <type_traits>
+
+namespace nnt
+{
+	class ParameterUpdateTests : public ::testing::Test
+	{
+	public:
+		static ParameterUpdateSettings MakeSettings(const ParameterUpdateType type)
+		{
+			ParameterUpdateSettings settings;
+			settings.type = type;
+			settings.learningRate = 0.1;
+			settings.gradientScale = 0.5;
+			settings.decay = 0.01;
+			settings.beta1 = 0.9;
+			settings.beta2 = 0.99;
+			settings.epsilon = 1e-8;
+			return settings;
+		}
+		
+		// host views of the test data: the updates are then called through the host branch of their entry points
+		template<typename T>
+		static MemoryBuffer MakeHostBuffer(std::vector<T>* x)
+		{
+			if (!x)
+				return MemoryBuffer();
+			return MemoryBuffer(reinterpret_cast<std::ptrdiff_t>(x->data()), static_cast<unsigned>(x->size()), MemorySpace::Host, std::is_same<T, float>::value ? MathDomain::Float : MathDomain::Double);
+		}
+		
+		// NB: T is deduced from x only, so that the states can be nullptr
+		template<typename T>
+		static void Update(std::vector<T>& x, std::common_type_t<std::vector<T>*> firstState, std::common_type_t<std::vector<T>*> secondState, std::vector<T>& gradient, const ParameterUpdateSettings& settings)
+		{
+			auto xBuffer = MakeHostBuffer(&x);
+			auto firstStateBuffer = MakeHostBuffer(firstState);
+			auto secondStateBuffer = MakeHostBuffer(secondState);
+			nn::detail::UpdateParameters(xBuffer, firstStateBuffer, secondStateBuffer, MakeHostBuffer(&gradient), settings);
+		}
+		
+		static void Norms(double& parameterNorm, double& updateNorm, std::vector<double>& x, std::vector<double>* firstState, std::vector<double>* secondState, std::vector<double>& gradient, const ParameterUpdateSettings& settings)
+		{
+			auto firstStateBuffer = MakeHostBuffer(firstState);
+			auto secondStateBuffer = MakeHostBuffer(secondState);
+			MemoryBuffer normCache;
+			nn::detail::ParameterUpdateNorms(parameterNorm, updateNorm, MakeHostBuffer(&x), firstStateBuffer, secondStateBuffer, MakeHostBuffer(&gradient), settings, normCache);
+		}
+	};
+	
+	TEST_F(ParameterUpdateTests, GradientDescentFoldsDecay)
+	{
+		const auto settings = MakeSettings(ParameterUpdateType::GradientDescent);
+		std::vector<double> x = { 1.0, -2.0 };
+		std::vector<double> gradient = { 4.0, 2.0 };
+		Update(x, nullptr, nullptr, gradient, settings);
+		
+		// same as plain SGD: x * (1 - lr * decay) - lr * scale * g
+		ASSERT_NEAR(1.0 * (1.0 - 0.1 * 0.01) - 0.1 * 0.5 * 4.0, x[0], 1e-12);
+		ASSERT_NEAR(-2.0 * (1.0 - 0.1 * 0.01) - 0.1 * 0.5 * 2.0, x[1], 1e-12);
+	}
+	
+	TEST_F(ParameterUpdateTests, DecayOnlyAppliesToTheDecayedRange)
+	{
+		// e.g. [weight | weight | bias] in a single pass
+		auto settings = MakeSettings(ParameterUpdateType::Momentum);
+		settings.decayedSize = 2;
+		
+		std::vector<double> x = { 1.0, 1.0, 1.0 }, velocity = { 0.0, 0.0, 0.0 };
+		std::vector<double> gradient = { 0.0, 0.0, 0.0 };
+		Update(x, &velocity, nullptr, gradient, settings);
+		ASSERT_NEAR(1.0 - 0.1 * 0.01, x[0], 1e-12);
+		ASSERT_NEAR(1.0 - 0.1 * 0.01, x[1], 1e-12);
+		ASSERT_DOUBLE_EQ(1.0, x[2]);
+		ASSERT_DOUBLE_EQ(0.0, velocity[2]);
+	}
+	
+	TEST_F(ParameterUpdateTests, MomentumAndNesterov)
+	{
+		auto settings = MakeSettings(ParameterUpdateType::Momentum);
+		settings.decay = 0.0;
+		settings.gradientScale = 1.0;
+		
+		std::vector<double> x = { 0.0 }, velocity = { 0.0 };
+		std::vector<double> gradient = { 1.0 };
+		Update(x, &velocity, nullptr, gradient, settings);
+		Update(x, &velocity, nullptr, gradient, settings);
+		ASSERT_NEAR(-0.19, velocity[0], 1e-12);
+		ASSERT_NEAR(-0.1 - 0.19, x[0], 1e-12);
+		
+		// Nesterov looks ahead along the new velocity
+		settings.type = ParameterUpdateType::Nesterov;
+		x = { 0.0 };
+		velocity = { 0.0 };
+		Update(x, &velocity, nullptr, gradient, settings);
+		ASSERT_NEAR(-0.1, velocity[0], 1e-12);
+		ASSERT_NEAR(-0.19, x[0], 1e-12);
+	}
+	
+	TEST_F(ParameterUpdateTests, RmsPropAndAdamFirstStep)
+	{
+		auto settings = MakeSettings(ParameterUpdateType::RmsProp);
+		settings.decay = 0.0;
+		settings.gradientScale = 1.0;
+		
+		std::vector<double> x = { 0.0, 0.0 }, meanSquare = { 0.0, 0.0 };
+		std::vector<double> gradient = { 3.0, -0.001 };
+		Update(x, &meanSquare, nullptr, gradient, settings);
+		ASSERT_NEAR(-0.1 / std::sqrt(0.01), x[0], 1e-6);
+		ASSERT_NEAR(0.1 / std::sqrt(0.01), x[1], 1e-4);
+		
+		// bias-corrected Adam moves every parameter by ~learningRate on the first step, regardless of the gradient scale
+		settings.type = ParameterUpdateType::Adam;
+		settings.firstMomentCorrection = 1.0 / (1.0 - settings.beta1);
+		settings.secondMomentCorrection = 1.0 / (1.0 - settings.beta2);
+		
+		std::vector<float> y = { 1.0f, 1.0f }, firstMoment = { 0.0f, 0.0f }, secondMoment = { 0.0f, 0.0f };
+		std::vector<float> floatGradient = { 100.0f, -0.01f };
+		Update(y, &firstMoment, &secondMoment, floatGradient, settings);
+		ASSERT_NEAR(0.9f, y[0], 1e-5f);
+		ASSERT_NEAR(1.1f, y[1], 1e-4f);
+	}
+	
+	TEST_F(ParameterUpdateTests, LarsTrustRatio)
+	{
+		auto settings = MakeSettings(ParameterUpdateType::Lars);
+		settings.gradientScale = 1.0;
+		settings.trustCoefficient = 0.5;
+		
+		std::vector<double> x = { 3.0, 4.0 }, velocity = { 0.0, 0.0 };
+		std::vector<double> gradient = { 0.0, 2.0 };
+		
+		double parameterNorm = 0.0, updateNorm = 0.0;
+		Norms(parameterNorm, updateNorm, x, &velocity, nullptr, gradient, settings);
+		ASSERT_NEAR(5.0, parameterNorm, 1e-12);
+		ASSERT_NEAR(2.0, updateNorm, 1e-12);
+		
+		settings.trustRatio = GetTrustRatio(settings, parameterNorm, updateNorm);
+		ASSERT_NEAR(0.5 * 5.0 / (2.0 + 0.01 * 5.0), settings.trustRatio, 1e-12);
+		
+		Update(x, &velocity, nullptr, gradient, settings);
+		ASSERT_NEAR(3.0 - 0.1 * settings.trustRatio * 0.01 * 3.0, x[0], 1e-12);
+		ASSERT_NEAR(4.0 - 0.1 * settings.trustRatio * (2.0 + 0.01 * 4.0), x[1], 1e-12);
+		
+		// degenerate norms don't scale the step
+		ASSERT_DOUBLE_EQ(1.0, GetTrustRatio(settings, 0.0, 1.0));
+	}
+	
+	TEST_F(ParameterUpdateTests, LambUpdatesMomentsOnce)
+	{
+		auto settings = MakeSettings(ParameterUpdateType::Lamb);
+		settings.gradientScale = 1.0;
+		settings.decay = 0.0;
+		settings.firstMomentCorrection = 1.0 / (1.0 - settings.beta1);
+		settings.secondMomentCorrection = 1.0 / (1.0 - settings.beta2);
+		
+		std::vector<double> x = { 3.0, 4.0 }, firstMoment = { 0.0, 0.0 }, secondMoment = { 0.0, 0.0 };
+		std::vector<double> gradient = { 1.0, -1.0 };
+		
+		double parameterNorm = 0.0, updateNorm = 0.0;
+		Norms(parameterNorm, updateNorm, x, &firstMoment, &secondMoment, gradient, settings);
+		ASSERT_NEAR(0.1, firstMoment[0], 1e-12);
+		ASSERT_NEAR(5.0, parameterNorm, 1e-12);
+		ASSERT_NEAR(std::sqrt(2.0), updateNorm, 1e-6);  // first Adam direction is sign(g)
+		
+		settings.trustRatio = GetTrustRatio(settings, parameterNorm, updateNorm);
+		Update(x, &firstMoment, &secondMoment, gradient, settings);
+		ASSERT_NEAR(0.1, firstMoment[0], 1e-12);
+		ASSERT_NEAR(3.0 - 0.1 * 5.0 / std::sqrt(2.0), x[0], 1e-6);
+		ASSERT_NEAR(4.0 + 0.1 * 5.0 / std::sqrt(2.0), x[1], 1e-6);
+	}
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <NeuralNetworks/Profiler.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace nnt
+{
+	class ProfilerTests : public ::testing::Test
+	{
+	public:
+		void SetUp() override
+		{
+			nn::Profiler::Instance().Reset();
+		}
+	};
+	
+	TEST_F(ProfilerTests, ScopedTimerRecordsOneEvent)
+	{
+		{
+			nn::ScopedTimer timer("Forward", 1);
+		}
+		ASSERT_EQ(1u, nn::Profiler::Instance().GetNumberOfEvents());
+		
+		std::stringstream summary;
+		nn::Profiler::Instance().WriteSummary(summary);
+		ASSERT_NE(std::string::npos, summary.str().find("Forward\t1\t1\t"));
+	}
+	
+	TEST_F(ProfilerTests, RingBufferOverwritesOldestEvents)
+	{
+		nn::ProfilerRingBuffer buffer(0, 3);
+		for (int64_t i = 0; i < 5; ++i)
+			buffer.Push({ "Event", nn::ProfilerEvent::noIndex, i, 1 });
+		ASSERT_EQ(3u, buffer.GetSize());
+		
+		std::vector<int64_t> starts;
+		buffer.ForEach([&starts](const nn::ProfilerEvent& event) { starts.push_back(event.start); });
+		ASSERT_EQ(std::vector<int64_t>({ 2, 3, 4 }), starts);
+	}
+	
+	TEST_F(ProfilerTests, ChromeTraceHasOneTrackPerThread)
+	{
+		{
+			nn::ScopedTimer timer("Update");
+		}
+		const size_t mainThreadId = nn::Profiler::Instance().GetThreadBuffer().GetThreadId();
+		
+		// NB: track ids depend on which threads ran before, so they're only compared with each other
+		size_t workerThreadId = mainThreadId;
+		std::thread worker([&workerThreadId]()
+		{
+			nn::ScopedTimer timer("Evaluation");
+			workerThreadId = nn::Profiler::Instance().GetThreadBuffer().GetThreadId();
+		});
+		worker.join();
+		ASSERT_NE(mainThreadId, workerThreadId);
+		ASSERT_EQ(2u, nn::Profiler::Instance().GetNumberOfEvents());
+		
+		std::stringstream trace;
+		nn::Profiler::Instance().WriteChromeTrace(trace);
+		const std::string json = trace.str();
+		ASSERT_EQ(0u, json.find("{\"traceEvents\":["));
+		ASSERT_NE(std::string::npos, json.find("\"name\":\"Update\""));
+		ASSERT_NE(std::string::npos, json.find("\"name\":\"Evaluation\""));
+		ASSERT_NE(json.find("\"tid\":" + std::to_string(mainThreadId) + ","), std::string::npos);
+		ASSERT_NE(json.find("\"tid\":" + std::to_string(workerThreadId) + ","), std::string::npos);
+	}
+	
+	TEST_F(ProfilerTests, ThreadBuffersAreRecycled)
+	{
+		const auto getThreadId = []()
+		{
+			size_t ret = 0;
+			std::thread worker([&ret]() { ret = nn::Profiler::Instance().GetThreadBuffer().GetThreadId(); });
+			worker.join();
+			return ret;
+		};
+		
+		// the buffer of an exited thread goes to the next one
+		const size_t threadId = getThreadId();
+		const size_t nBuffers = nn::Profiler::Instance().GetNumberOfBuffers();
+		for (size_t i = 0; i < 10; ++i)
+			ASSERT_EQ(threadId, getThreadId());
+		ASSERT_EQ(nBuffers, nn::Profiler::Instance().GetNumberOfBuffers());
+	}
+}
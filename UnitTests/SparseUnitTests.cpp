@@ -0,0 +1,184 @@
+#include <NeuralNetworks/Network.h>
+#include <NeuralNetworks/MagnitudePruner.h>
+#include <NeuralNetworks/SparseNetwork.h>
+#include <NeuralNetworks/Memory/CsrMatrix.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/CostFunctions/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+#include <NeuralNetworks/Optimizers/All.h>
+#include <NeuralNetworks/Optimizers/Shufflers/All.h>
+
+#include <cmath>
+#include <random>
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	static constexpr MathDomain md = MathDomain::Double;
+	
+	class SparseTests : public ::testing::Test
+	{
+	public:
+		static nn::NetworkTopology<md> MakeTopology()
+		{
+			std::vector<std::unique_ptr<nn::ILayer<md>>> layers;
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(20, 16, std::make_unique<nn::SigmoidActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::DenseLayer<md>>(16, 12, std::make_unique<nn::TanhActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			layers.emplace_back(std::make_unique<nn::SoftMaxLayer<md>>(12, 4, std::make_unique<nn::SoftMaxActivationFunction<md>>(), nn::RandomBiasWeightInitializer<md>()));
+			return nn::NetworkTopology<md>(std::move(layers));
+		}
+	};
+	
+	TEST_F(SparseTests, CsrMultiply)
+	{
+		// 7 x 9 with about a third of nonzeros, one of the rows being empty
+		const unsigned nRows = 7;
+		const unsigned nInput = 9;
+		const unsigned nCols = 11;
+		
+		std::mt19937 generator(1234);
+		std::normal_distribution<double> distribution;
+		std::vector<double> dense(nRows * nInput, 0.0);
+		for (unsigned i = 1; i < nRows; ++i)
+			for (unsigned k = 0; k < nInput; ++k)
+				if ((i + 2 * k) % 3 == 0)
+					dense[i + k * nRows] = distribution(generator);
+		
+		nn::Matrix<md> weight(nRows, nInput);
+		weight.ReadFrom(dense);
+		const nn::CsrMatrix<md> csr(weight);
+		ASSERT_EQ(18, csr.GetNumberOfNonZeros());
+		
+		nn::Matrix<md> x(nInput, nCols);
+		x.RandomGaussian();
+		nn::Vector<md> bias(nRows);
+		bias.RandomGaussian();
+		
+		nn::Matrix<md> z(nRows, nCols);
+		csr.Multiply(z, x, bias);
+		
+		const auto _x = x.Get();
+		const auto _bias = bias.Get();
+		const auto _z = z.Get();
+		for (unsigned j = 0; j < nCols; ++j)
+		{
+			for (unsigned i = 0; i < nRows; ++i)
+			{
+				double expected = _bias[i];
+				for (unsigned k = 0; k < nInput; ++k)
+					expected += dense[i + k * nRows] * _x[k + j * nInput];
+				ASSERT_NEAR(expected, _z[i + j * nRows], 1e-12);
+			}
+		}
+	}
+	
+	TEST_F(SparseTests, PruneSmallestWeights)
+	{
+		auto topology = MakeTopology();
+		
+		std::vector<std::vector<double>> weights;
+		for (const auto& layer: topology)
+			weights.emplace_back(layer->GetWeight().Get());
+		
+		const auto mask = nn::MagnitudePruner<md>::Prune(topology, 0.75);
+		for (size_t l = 0; l < topology.GetSize(); ++l)
+		{
+			const auto prunedWeight = topology[l]->GetWeight().Get();
+			const auto layerMask = mask->GetWeight(l).Get();
+			
+			// every survivor is at least as big as every pruned weight, and unchanged
+			size_t nPruned = 0;
+			double maxPruned = 0.0;
+			double minKept = 1e300;
+			for (size_t i = 0; i < prunedWeight.size(); ++i)
+			{
+				if (layerMask[i] == 0.0)
+				{
+					ASSERT_EQ(0.0, prunedWeight[i]);
+					maxPruned = std::max(maxPruned, std::abs(weights[l][i]));
+					++nPruned;
+				}
+				else
+				{
+					ASSERT_EQ(weights[l][i], prunedWeight[i]);
+					minKept = std::min(minKept, std::abs(weights[l][i]));
+				}
+			}
+			ASSERT_EQ(static_cast<size_t>(0.75 * static_cast<double>(prunedWeight.size())), nPruned);
+			ASSERT_LE(maxPruned, minKept);
+			
+			for (const auto b: mask->GetBias(l).Get())
+				ASSERT_EQ(1.0, b);
+		}
+	}
+	
+	TEST_F(SparseTests, SparseInferenceMatchesDense)
+	{
+		auto topology = MakeTopology();
+		nn::MagnitudePruner<md>::Prune(topology, 0.8);
+		
+		nn::SparseNetwork<md> sparseNetwork(topology);
+		for (size_t l = 0; l < topology.GetSize(); ++l)
+			ASSERT_TRUE(sparseNetwork.IsSparse(l));
+		
+		size_t denseBytes = 0;
+		for (const auto& layer: topology)
+			denseBytes += (layer->GetWeight().size() + layer->GetBias().size()) * sizeof(double);
+		ASSERT_LT(sparseNetwork.GetNumberOfBytes(), denseBytes / 2);
+		
+		nn::Matrix<md> input(20, 13);
+		input.RandomGaussian();
+		
+		nn::InferenceWorkspace<md> workspace(topology);
+		nn::Matrix<md> expected(4, 13);
+		topology.Infer(expected, input, workspace);
+		nn::Matrix<md> output(4, 13);
+		sparseNetwork.Infer(output, input, workspace);
+		
+		const auto _expected = expected.Get();
+		const auto _output = output.Get();
+		for (size_t i = 0; i < _output.size(); ++i)
+			ASSERT_NEAR(_expected[i], _output[i], 1e-12);
+		
+		// not sparse enough: the topology's own layers are used
+		nn::SparseNetwork<md> denseNetwork(topology, 0.9);
+		for (size_t l = 0; l < topology.GetSize(); ++l)
+			ASSERT_FALSE(denseNetwork.IsSparse(l));
+	}
+	
+	TEST_F(SparseTests, FineTuningKeepsMask)
+	{
+		auto topology = MakeTopology();
+		const auto mask = nn::MagnitudePruner<md>::Prune(topology, 0.5);
+		
+		nn::TrainingData<md> trainingData(nn::Matrix<md>(20, 32), nn::Matrix<md>(4, 32, 0.0));
+		trainingData.input.RandomGaussian();
+		std::vector<double> expectedOutput(4 * 32, 0.0);
+		for (size_t j = 0; j < 32; ++j)
+			expectedOutput[j % 4 + 4 * j] = 1.0;
+		trainingData.expectedOutput.ReadFrom(expectedOutput);
+		
+		const std::function<double(nn::Matrix<md>&, const nn::Matrix<md>&)> evaluator = [](nn::Matrix<md>&, const nn::Matrix<md>&) { return 0.0; };
+		nn::NetworkTrainingData<md> data(trainingData, trainingData, trainingData, evaluator);
+		data.hyperParameters.miniBatchSize = 8;
+		
+		nn::BatchedSgd<md> optimizer(topology, 8, std::make_unique<nn::LogLikelihoodCostFunction<md>>(), std::make_unique<nn::IdentityShuffler<md>>());
+		optimizer.SetParameterMask(mask.get());
+		const auto initialBias = topology[0]->GetBias().Get();
+		for (size_t epoch = 0; epoch < 3; ++epoch)
+			optimizer.Train(data);
+		
+		for (size_t l = 0; l < topology.GetSize(); ++l)
+		{
+			const auto weight = topology[l]->GetWeight().Get();
+			const auto layerMask = mask->GetWeight(l).Get();
+			for (size_t i = 0; i < weight.size(); ++i)
+				if (layerMask[i] == 0.0)
+					ASSERT_EQ(0.0, weight[i]);
+		}
+		
+		// while the rest is still trained
+		ASSERT_NE(initialBias, topology[0]->GetBias().Get());
+	}
+}
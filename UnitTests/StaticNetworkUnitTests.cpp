@@ -0,0 +1,94 @@
+#include <Network.h>
+#include <NeuralNetworks/StaticNetwork.h>
+#include <NeuralNetworks/Layers/Initializers/All.h>
+#include <NeuralNetworks/Layers/All.h>
+#include <NeuralNetworks/Activations/All.h>
+
+#include <gtest/gtest.h>
+
+namespace nnt
+{
+	class StaticNetworkTests : public ::testing::Test
+	{
+	};
+	
+	TEST_F(StaticNetworkTests, DenseLayerMatchesReference)
+	{
+		static constexpr size_t nInput = 3;
+		static constexpr size_t nOutput = 20;
+		nn::StaticNetwork<MathDomain::Double, nn::StaticDense<nInput, nOutput, nn::ActivationFunctionType::Sigmoid>> network;
+		
+		auto& parameters = network.GetParameters<0>();
+		for (size_t k = 0; k < parameters.weight.size(); ++k)
+			parameters.weight[k] = 0.01 * static_cast<double>(k) - 0.2;
+		for (size_t i = 0; i < nOutput; ++i)
+			parameters.bias[i] = 0.1 * static_cast<double>(i);
+		
+		const std::array<double, nInput> input = {{ 1.0, -2.0, 0.5 }};
+		const auto output = network.Evaluate(input);
+		for (size_t i = 0; i < nOutput; ++i)
+		{
+			double z = parameters.bias[i];
+			for (size_t j = 0; j < nInput; ++j)
+				z += parameters.weight[i + j * nOutput] * input[j];
+			ASSERT_NEAR(1.0 / (1.0 + std::exp(-z)), output[i], 1e-12);
+		}
+	}
+	
+	TEST_F(StaticNetworkTests, InverseSquareRootLinearUnit)
+	{
+		// identity weights, so that the output is the activation of the input
+		nn::StaticNetwork<MathDomain::Double, nn::StaticDense<4, 4, nn::ActivationFunctionType::InverseSquareRootLinearUnit>> network;
+		auto& parameters = network.GetParameters<0>();
+		for (size_t i = 0; i < 4; ++i)
+			parameters.weight[i + i * 4] = 1.0;
+		
+		const std::array<double, 4> input = {{ -3.0, -0.5, 0.0, 2.0 }};
+		const auto output = network.Evaluate(input);
+		for (size_t i = 0; i < input.size(); ++i)
+		{
+			const double x = input[i];
+			ASSERT_NEAR(x <= 0.0 ? x / std::sqrt(1.0 + x * x) : x, output[i], 1e-12);
+		}
+	}
+	
+	TEST_F(StaticNetworkTests, SoftMaxOutputIsNormalised)
+	{
+		nn::StaticNetwork<MathDomain::Float, nn::StaticDense<4, 5, nn::ActivationFunctionType::RectifiedLinearUnit>, nn::StaticSoftMax<5, 3>> network;
+		network.GetParameters<0>().weight.fill(0.5f);
+		network.GetParameters<1>().weight.fill(-0.25f);
+		network.GetParameters<1>().bias = {{ 0.0f, 1.0f, 2.0f }};
+		
+		const auto output = network.Evaluate({{ 1.0f, 2.0f, 3.0f, 4.0f }});
+		ASSERT_NEAR(1.0f, output[0] + output[1] + output[2], 1e-6f);
+		ASSERT_LT(output[0], output[1]);
+		ASSERT_LT(output[1], output[2]);
+	}
+	
+	TEST_F(StaticNetworkTests, ReadFromTrainedTopology)
+	{
+		std::vector<std::unique_ptr<nn::ILayer<MathDomain::Float>>> layers;
+		layers.emplace_back(std::make_unique<nn::DenseLayer<MathDomain::Float>>(784, 100, std::make_unique<nn::SigmoidActivationFunction<MathDomain::Float>>(), nn::SmallVarianceRandomBiasWeightInitializer<MathDomain::Float>()));
+		layers.emplace_back(std::make_unique<nn::SoftMaxLayer<MathDomain::Float>>(100, 10, std::make_unique<nn::SoftMaxActivationFunction<MathDomain::Float>>(), nn::SmallVarianceRandomBiasWeightInitializer<MathDomain::Float>()));
+		nn::Network<MathDomain::Float> network((nn::NetworkTopology<MathDomain::Float>(std::move(layers))));
+		
+		using Mnist = nn::StaticNetwork<MathDomain::Float, nn::StaticDense<784, 100, nn::ActivationFunctionType::Sigmoid>, nn::StaticSoftMax<100, 10>>;
+		auto staticNetwork = std::make_unique<Mnist>();
+		ASSERT_TRUE(staticNetwork->ReadFrom(network.GetTopology()));
+		
+		using WrongShape = nn::StaticNetwork<MathDomain::Float, nn::StaticDense<784, 50, nn::ActivationFunctionType::Sigmoid>, nn::StaticSoftMax<50, 10>>;
+		ASSERT_FALSE(std::make_unique<WrongShape>()->ReadFrom(network.GetTopology()));
+		
+		nn::Matrix<MathDomain::Float> input(784, 1);
+		input.RandomGaussian();
+		nn::Matrix<MathDomain::Float> expected(10, 1);
+		network.Evaluate(expected, input);
+		
+		const auto hostInput = input.Get();
+		std::array<float, 10> output;
+		staticNetwork->Evaluate(output.data(), hostInput.data());
+		const auto hostExpected = expected.Get();
+		for (size_t i = 0; i < output.size(); ++i)
+			ASSERT_NEAR(hostExpected[i], output[i], 1e-5f);
+	}
+}